@@ -0,0 +1,219 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <iostream>
+
+#include "bitmap.h"
+#include "extract.h"
+#include "hide.h"
+#include "parallel.h"
+
+/**
+ * @brief Interface of an executor resuming coroutines of the async API.
+ * Implement it to run sharky coroutines on your own event loop, `post`
+ * should resume the handle later on one of the loop threads.
+ */
+class executor {
+public:
+    virtual ~executor() = default;
+
+    /**
+     * @brief Schedules resumption of the coroutine. It must not resume
+     * the coroutine before returning.
+     */
+    virtual void post(std::coroutine_handle<> handle) = 0;
+};
+
+/**
+ * @brief Built-in executor resuming coroutines on a fixed number of threads.
+ * Coroutines which are still queued when the executor is destroyed are
+ * never resumed.
+ */
+class thread_pool_executor : public executor {
+public:
+    explicit thread_pool_executor(std::size_t threads = default_jobs());
+    ~thread_pool_executor() override;
+
+    void post(std::coroutine_handle<> handle) override;
+
+private:
+    void run();
+
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    std::deque<std::coroutine_handle<>> queue{};
+    bool stopping{false};
+    std::vector<std::jthread> threads{};
+};
+
+/**
+ * @brief Awaitable which suspends the coroutine and resumes it through
+ * the executor. The async API awaits it before each step of a session,
+ * so coroutines sharing the executor take turns between steps. It does not
+ * wait for any I/O, the step which follows reads and writes its streams
+ * on the executor thread.
+ */
+struct next_block {
+    executor &ex;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { ex.post(handle); }
+    void await_resume() const noexcept {}
+};
+
+/**
+ * @brief Lazily started coroutine returning value of type `T`. It starts
+ * when it is awaited, and the awaiting coroutine is resumed when it finishes.
+ */
+template<typename T>
+class task {
+public:
+    struct promise_type;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    struct promise_type {
+        std::optional<T> value{};
+        std::exception_ptr exception{};
+        std::coroutine_handle<> continuation{std::noop_coroutine()};
+
+        task get_return_object() { return task{handle_type::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        auto final_suspend() noexcept {
+            struct final_awaiter {
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(handle_type h) noexcept {
+                    return h.promise().continuation;
+                }
+                void await_resume() const noexcept {}
+            };
+            return final_awaiter{};
+        }
+
+        void return_value(T result) { value = std::move(result); }
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    task(task &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+    ~task() {
+        if (handle)
+            handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume() {
+        if (handle.promise().exception)
+            std::rethrow_exception(handle.promise().exception);
+        return std::move(*handle.promise().value);
+    }
+
+private:
+    explicit task(handle_type handle) : handle(handle) {}
+
+    handle_type handle;
+};
+
+/**
+ * @brief Coroutine which starts immediately and destroys itself when
+ * it finishes, used by `sync_wait`.
+ */
+struct detached_task {
+    struct promise_type {
+        detached_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+/**
+ * @brief Starts the task and blocks the calling thread until it finishes.
+ * 
+ * @return value returned by the task
+ */
+template<typename T>
+T sync_wait(task<T> t) {
+    std::optional<T> result{};
+    std::exception_ptr exception{};
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    bool done = false;
+
+    [](task<T> &t, std::optional<T> &result, std::exception_ptr &exception,
+       std::mutex &mutex, std::condition_variable &cv,
+       bool &done) -> detached_task {
+        try {
+            result = co_await t;
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        std::lock_guard lock{mutex};
+        done = true;
+        cv.notify_one();
+    }(t, result, exception, mutex, cv, done);
+
+    std::unique_lock lock{mutex};
+    cv.wait(lock, [&] { return done; });
+    if (exception)
+        std::rethrow_exception(exception);
+    return std::move(*result);
+}
+
+/**
+ * @brief Hides message (data) into images, the same way as `hide` does,
+ * but suspends before each step of `hide_session` and is resumed through
+ * the executor, so many hidings can share a few threads. The streams are
+ * read and written synchronously, each step blocks the executor thread
+ * until its I/O finishes.
+ * 
+ * @note all the arguments have to outlive the returned task
+ * 
+ * @see hide
+ */
+task<int> async_hide(
+    executor &ex,
+    std::vector<bmp_image> &images,
+    std::istream &data,
+    std::ostream &out = std::cout,
+    std::ostream &err = std::cerr,
+    const hide_options &options = {}
+);
+
+/**
+ * @brief Extracts hidden data/message from images, the same way as `extract`
+ * does, but suspends before each step of `extract_session` and is resumed
+ * through the executor, so many extractions can share a few threads.
+ * The streams are read and written synchronously, each step blocks
+ * the executor thread until its I/O finishes.
+ * 
+ * @note all the arguments have to outlive the returned task
+ * 
+ * @see extract
+ */
+task<int> async_extract(
+    executor &ex,
+    std::vector<bmp_image> &images,
+    std::ostream &data_ostream,
+    std::ostream &err = std::cerr,
+    const extract_options &options = {}
+);
+
+#endif  // ASYNC_H
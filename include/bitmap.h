@@ -6,8 +6,20 @@
 #include <vector>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <iostream>
 
+#include "distortion.h"
+
+/* size of the bmp file header, which is followed by the info header */
+const uint32_t BMP_FILE_HEADER_SIZE = 14;
+/* size of the smallest info header (BITMAPINFOHEADER) with the fields read
+ * by `parse_info_header` */
+const uint32_t BMP_INFO_HEADER_SIZE = 40;
+
+/* filename (or output path) used for standard input (or output) */
+const std::string STDIO_FILENAME = "-";
+
 /**
  * @brief Struct representing a bmp image, containing all relevant information
  * about the image, as well as input and output streams for reading and writing
@@ -36,9 +48,27 @@ struct bmp_image {
     /* used for extraction */
     uint8_t id{0};
     uint8_t seq{0};
+    /* metadata flags, see MD_FLAG_* in configuration.h */
+    uint16_t flags{0};
+    /* metadata hidden right after the fixed size metadata, the fields
+     * present depend on flags, see `metadata_size` and metadata.h */
+    std::vector<uint8_t> extra_metadata{};
 
     std::vector<uint8_t> header{};
 
+    /* path of the output file, if empty, the default path is used */
+    std::string output_path{};
+
+    /* set to measure the distortion caused by hiding, see distortion.h */
+    std::optional<image_distortion> distortion{};
+
+    /* `false` for pipes and FIFOs, which have to be read sequentially */
+    bool seekable{true};
+
+    /* streams opened by `open_input`/`open_output`, closed by `close` */
+    bool input_opened{false};
+    bool output_opened{false};
+
     /**
      * @brief This constructor does not open the input nor output file, it only
      * initializes the filename and chunk_size members. The input/output files
@@ -48,7 +78,8 @@ struct bmp_image {
 
     /**
      * @brief Opens the input stream for the image using the filename
-     * member variable.
+     * member variable. If the filename is `STDIO_FILENAME`, the standard
+     * input is used.
      * 
      * @return `true` on success, `false` otherwise
      */
@@ -77,8 +108,34 @@ struct bmp_image {
     bool load_header(std::ostream &err = std::cerr);
 
     /**
-     * @brief Trims the filename and returns path to output file,
-     * which is "sharky/bitmaps_out/" + trimmed filename
+     * @brief Checks and stores information from the bmp file header, which
+     * should be already stored in the first `BMP_FILE_HEADER_SIZE` bytes
+     * of `header`. This is called by `load_header`, and it can be used
+     * when the header was read without the input stream. The data offset
+     * has to leave room for the info header, so `parse_info_header` never
+     * reads past `data_offset` bytes.
+     * 
+     * @param err stream where error messages will be written
+     * 
+     * @return `true` on success, `false` otherwise
+     */
+    bool parse_file_header(std::ostream &err = std::cerr);
+
+    /**
+     * @brief Checks and stores information from the bmp info header. `header`
+     * should already contain `data_offset` bytes, so `parse_file_header`
+     * has to be called first.
+     * 
+     * @param err stream where error messages will be written
+     * 
+     * @return `true` on success, `false` otherwise
+     */
+    bool parse_info_header(std::ostream &err = std::cerr);
+
+    /**
+     * @brief Returns `output_path` if it is set. Otherwise trims the filename
+     * and returns path to output file, which is "bitmaps_out/" + trimmed
+     * filename
      * 
      * @return path to output file
      */
@@ -95,7 +152,7 @@ struct bmp_image {
 
     /**
      * @brief Opens the output stream for the image using the get_output_path
-     * method.
+     * method. If the path is `STDIO_FILENAME`, the standard output is used.
      * 
      * @return `true` on success, `false` otherwise
      */
@@ -109,6 +166,30 @@ struct bmp_image {
      */
     bool assign_output(std::unique_ptr<std::ostream> output);
 
+    /**
+     * @brief Opens the input stream using `assign_input()`, unless the input
+     * stream is already assigned. The stream opened by this method is closed
+     * by `close`, so images can be opened only when they are needed.
+     * 
+     * @return `true` on success, `false` otherwise
+     */
+    bool open_input();
+
+    /**
+     * @brief Opens the output stream using `assign_output()` and writes
+     * the header to it, unless the output stream is already assigned.
+     * The stream opened by this method is closed by `close`.
+     * 
+     * @return `true` on success, `false` otherwise
+     */
+    bool open_output();
+
+    /**
+     * @brief Closes the streams opened by `open_input` and `open_output`.
+     * Streams assigned by the caller are kept.
+     */
+    void close();
+
     /**
      * @brief Image comparison operator, compares images by their sequence
      * number. This is useful when extracting data from images.
@@ -117,17 +198,44 @@ struct bmp_image {
 
     /**
      * @brief Moves reading position of the input stream to data offset.
+     * Images which are not `seekable` are not moved, as their input stream
+     * is already positioned there by `load_header`.
      */
     void set_data_start();
 
     /**
      * @brief Returns how many bytes can be hidden into the image in total,
      * excluding the size of metadata. This is calculated
-     * as capacity / cells_per_byte.
+     * as capacity / cells_per_byte, capacity used by extra metadata
+     * (see `flags`) is excluded as well.
      * 
      * @return byte capacity of the image for hidden data, excluding metadata
      */
     std::size_t byte_capacity() const;
+
+    /**
+     * @brief Returns size of all metadata hidden into the image, which is
+     * `HIDDEN_METADATA_SIZE` and size of extra metadata required by `flags`.
+     */
+    std::size_t metadata_size() const;
+
+    /**
+     * @brief Returns the cell where the hidden data start, right after
+     * the metadata.
+     */
+    std::size_t data_start_cell() const;
+
+    /**
+     * @brief Returns the offset of the given cell relative to `data_offset`.
+     * Cell is a byte of pixel data which can be used for hiding data,
+     * so padding bytes are not counted as cells.
+     * 
+     * @param cell index of the cell, starting with the first cell of the first
+     * row of the pixel data
+     * 
+     * @return offset of the cell in bytes, padding included
+     */
+    std::size_t cell_offset(std::size_t cell) const;
 };
 
 const std::size_t BUFFER_SIZE = 4096;
@@ -150,6 +258,7 @@ public:
      * @brief Hides the provided chunk of data into the image. It returns `true`
      * on success, and `false` if there is no more space in the image to hide
      * the chunk, or if there was an error while reading/writing the image file.
+     * The altered cell is accounted in `bmp_image::distortion` if it is set.
      */
     bool hide_chunk(uint8_t chunk);
 
@@ -174,6 +283,25 @@ public:
      */
     void copy_rest();
 
+    /**
+     * @brief Copies one buffer of the rest of the image data, see `copy_rest`.
+     * 
+     * @return `true` if there is more data to copy, `false` otherwise
+     */
+    bool copy_block();
+
+    /**
+     * @brief Moves the buffer to the given cell of the image, so that the next
+     * `extract_chunk` call extracts chunk from this cell. This discards the
+     * loaded data and seeks the input stream, so it can be used for reading
+     * only.
+     * 
+     * @param cell index of the cell, see `bmp_image::cell_offset`
+     * 
+     * @return `true` on success, `false` if the input stream could not seek
+     */
+    bool seek_cell(std::size_t cell);
+
 private:
     bool read();
     bool write_and_read();
@@ -0,0 +1,84 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <utility>
+
+/**
+ * @brief Memory needed by a hiding or an extraction at the same time,
+ * see `hide_options::memory_limit` and `extract_options::memory_limit`.
+ */
+struct memory_needs {
+    /* held during the whole run: the message, its reordered copy
+     * and parity parts */
+    std::size_t message{0};
+    /* the largest buffer held for a single image */
+    std::size_t image{0};
+
+    std::size_t total() const {
+        return message + image;
+    }
+};
+
+/**
+ * @brief Checks that the needed memory fits into the limit.
+ * 
+ * @param limit memory limit in bytes, `0` for no limit
+ * @param needed bytes which have to be held at the same time
+ * @param err output stream for error logging
+ * 
+ * @return `true` if the memory fits, `false` otherwise
+ */
+bool check_memory_limit(
+    std::size_t limit,
+    std::size_t needed,
+    std::ostream &err = std::cerr
+);
+
+/**
+ * @brief Budget of memory shared by jobs which read whole images. A job is
+ * started only when the memory it needs is available, otherwise it waits
+ * until running jobs release their memory. Waiting jobs are started in the
+ * order in which they were submitted.
+ */
+class memory_budget {
+public:
+    using job = std::function<void()>;
+
+    /**
+     * @param limit bytes which can be reserved at the same time, `0` for
+     * no limit
+     * @param start starts a job, e.g. spawns it on a scheduler, it is called
+     * from `submit` and `release`
+     */
+    memory_budget(std::size_t limit, std::function<void(job)> start);
+
+    /**
+     * @brief Reserves the memory and starts the job, or queues the job until
+     * the memory is released. A job needing more than the limit is started
+     * once no memory is reserved.
+     *
+     * @param bytes memory needed by the job, the job has to `release` it
+     * @param j the job
+     */
+    void submit(std::size_t bytes, job j);
+
+    /**
+     * @brief Releases memory reserved by a job and starts waiting jobs
+     * for which there is enough memory now.
+     */
+    void release(std::size_t bytes);
+
+private:
+    std::size_t limit;
+    std::function<void(job)> start;
+    std::mutex mutex{};
+    std::size_t reserved{0};
+    std::deque<std::pair<std::size_t, job>> waiting{};
+};
+
+#endif  // BUDGET_H
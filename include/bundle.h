@@ -0,0 +1,117 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bitmap.h"
+#include "extract.h"
+
+/* "SB", version, reserved byte, file count (4 bytes), entries size (4 bytes) */
+const std::size_t BUNDLE_HEADER_SIZE = 12;
+
+/**
+ * @brief File stored in a bundle, its data are at `offset` of the bundle.
+ */
+struct bundle_entry {
+    std::string name{};
+    uint64_t offset{0};
+    uint64_t size{0};
+};
+
+/**
+ * @brief Packs files into a bundle, which is hidden as a single message.
+ * The table of contents is at the front of the bundle: the header, then for
+ * each file the length of its name (2 bytes), the name and its size
+ * (8 bytes), followed by the data of all files. Only names of the files
+ * (without directories) are stored, they have to be unique.
+ * 
+ * @param paths files to be packed
+ * @param out output stream of the bundle
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` if a file could not be read or names
+ * are not unique
+ */
+bool write_bundle(
+    const std::vector<std::string> &paths,
+    std::ostream &out,
+    std::ostream &err = std::cerr
+);
+
+/**
+ * @brief Parses the header of a bundle.
+ * 
+ * @param header first `BUNDLE_HEADER_SIZE` bytes of the bundle
+ * @param entries_size size of the table of contents after the header
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` if the data are not a bundle
+ */
+bool parse_bundle_header(
+    std::span<const uint8_t> header,
+    std::size_t &entries_size,
+    std::ostream &err = std::cerr
+);
+
+/**
+ * @brief Parses the table of contents of a bundle.
+ * 
+ * @param toc header and the table of contents, it can be followed by data
+ * @param entries parsed entries with offsets in the bundle
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` if the table of contents is corrupted
+ */
+bool parse_bundle_toc(
+    std::span<const uint8_t> toc,
+    std::vector<bundle_entry> &entries,
+    std::ostream &err = std::cerr
+);
+
+/**
+ * @brief Writes all files of the bundle into the directory, which is created
+ * if it does not exist.
+ * 
+ * @param bundle the whole bundle
+ * @param directory where files are written
+ * @param out output stream for info logging
+ * @param err output stream for error logging
+ * 
+ * @return 0 on success, 1 if the bundle is corrupted, 2 if a file could not
+ * be written
+ */
+int unpack_bundle(
+    std::span<const uint8_t> bundle,
+    const std::string &directory,
+    std::ostream &out = std::cout,
+    std::ostream &err = std::cerr
+);
+
+/**
+ * @brief Extracts a single file of a bundle hidden in images. The table
+ * of contents is read by `extract_range` first and then only the range
+ * of the file, so the rest of the bundle is not extracted. Compressed bundles
+ * and images which can not seek are extracted whole.
+ * 
+ * @param images images with loaded headers
+ * @param name name of the file in the bundle
+ * @param data_ostream output stream where the file should be extracted
+ * @param err output stream for error logging
+ * @param options options of extraction
+ * 
+ * @return 0 on success, 1 otherwise
+ */
+int extract_bundle_file(
+    std::vector<bmp_image> &images,
+    const std::string &name,
+    std::ostream &data_ostream,
+    std::ostream &err = std::cerr,
+    const extract_options &options = {}
+);
+
+#endif  // BUNDLE_H
@@ -0,0 +1,127 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bitmap.h"
+
+/**
+ * @brief Image of the catalog. Only geometry needed to select carriers
+ * is decoded, the whole header is kept in the catalog file.
+ */
+struct catalog_entry {
+    std::string_view path{};
+    /* modification time in nanoseconds and size of the file when it was
+     * indexed, the entry is used only if the file still matches them */
+    int64_t mtime{0};
+    uint64_t file_size{0};
+    /* `bmp_image::capacity`, cells available for hidden data */
+    uint64_t capacity{0};
+    std::span<const uint8_t> header{};
+
+    /**
+     * @brief Returns how many bytes the image can hold with the given chunk
+     * size, the same as `bmp_image::byte_capacity` without extra metadata.
+     */
+    std::size_t byte_capacity(uint8_t chunk_size) const;
+};
+
+/**
+ * @brief Index of parsed image headers stored in a single file, so headers
+ * of a large library of carriers do not have to be read from every image.
+ * The file is memory-mapped and entries are sorted by path, so a lookup is
+ * a binary search without reading the whole catalog.
+ * 
+ * The file starts with "SHCT", version (4 bytes) and the number of entries
+ * (8 bytes), then fixed size entries follow (offset and size of the path,
+ * offset and size of the header, modification time, file size, capacity),
+ * paths and headers are stored after the entries. Numbers are little-endian.
+ */
+class carrier_catalog {
+public:
+    carrier_catalog() = default;
+    carrier_catalog(const carrier_catalog &) = delete;
+    carrier_catalog &operator=(const carrier_catalog &) = delete;
+    carrier_catalog(carrier_catalog &&other) noexcept;
+    carrier_catalog &operator=(carrier_catalog &&other) noexcept;
+    ~carrier_catalog();
+
+    /**
+     * @brief Maps the catalog file into memory.
+     * 
+     * @param path path of the catalog file
+     * @param err output stream for error logging
+     * 
+     * @return `true` on success, `false` if the file could not be mapped or
+     * it is not a valid catalog
+     */
+    bool open(const std::string &path, std::ostream &err = std::cerr);
+
+    /**
+     * @brief Returns the number of images in the catalog.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Returns the entry at the given index, entries are sorted by path.
+     */
+    catalog_entry entry(std::size_t index) const;
+
+    /**
+     * @brief Finds the entry of the image with the given path.
+     */
+    std::optional<catalog_entry> find(std::string_view path) const;
+
+    /**
+     * @brief Loads the header of the image from the catalog, instead
+     * of reading the image file. The file is only checked by `stat`, the entry
+     * is used if its modification time and size were not changed.
+     * 
+     * @param im image with filename set, on success its header and geometry
+     * members are set
+     * @param err stream where error messages of an invalid header are written
+     * 
+     * @return `true` on success, `false` if the image is not in the catalog,
+     * it was changed or its header is not valid
+     */
+    bool load(bmp_image &im, std::ostream &err = std::cerr) const;
+
+private:
+    const uint8_t *data{nullptr};
+    std::size_t data_size{0};
+    std::size_t count{0};
+};
+
+/**
+ * @brief Creates or updates the catalog file with headers of the given images.
+ * Images indexed in the existing catalog whose modification time and size
+ * did not change are taken from it, only the other images are read, using
+ * at most `jobs` worker threads. Images which are not in `paths` are removed
+ * from the catalog. The new catalog is written into a temporary file, which
+ * replaces the old one, so readers always see a complete catalog.
+ * 
+ * @param catalog_path path of the catalog file
+ * @param paths images which should be in the catalog
+ * @param jobs maximum number of worker threads
+ * @param out output stream for info logging
+ * @param err output stream for error logging, invalid images are reported
+ * and skipped
+ * 
+ * @return 0 on success, 2 if the catalog could not be written
+ */
+int build_catalog(
+    const std::string &catalog_path,
+    const std::vector<std::string> &paths,
+    std::size_t jobs,
+    std::ostream &out = std::cout,
+    std::ostream &err = std::cerr
+);
+
+#endif  // CATALOG_H
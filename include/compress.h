@@ -0,0 +1,56 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <iostream>
+
+/*
+ * Compressed data are a sequence of blocks, each block holds at most
+ * `COMPRESSION_BLOCK_SIZE` bytes of the original data:
+ * 
+ *   4 bytes  size of the original block (little endian)
+ *   4 bytes  size of the stored block (little endian)
+ *   ...      stored block, LZ compressed, or the original block itself
+ *            when both sizes are equal (incompressible data)
+ * 
+ * The LZ format is a sequence of (literals, match) pairs, see compress.cpp.
+ */
+
+/**
+ * @brief Compresses the data block by block.
+ * 
+ * @return compressed data
+ */
+std::vector<uint8_t> compress(std::span<const uint8_t> data);
+
+/**
+ * @brief Decompresses data created by `compress` which are received in parts
+ * of any size, each block is written as soon as it is complete.
+ */
+class decompressor {
+public:
+    /**
+     * @brief Decompresses all blocks completed by the given part.
+     * 
+     * @param data next part of compressed data
+     * @param os where the decompressed blocks are written
+     * 
+     * @return `false` if the compressed data are corrupted, stream errors
+     * have to be checked on `os`
+     */
+    bool write(std::span<const uint8_t> data, std::ostream &os);
+
+    /**
+     * @brief Returns `true` if all received data were decompressed,
+     * so the compressed data did not end in the middle of a block.
+     */
+    bool finished() const;
+
+private:
+    std::vector<uint8_t> pending{};
+    std::vector<uint8_t> block{};
+};
+
+#endif  // COMPRESS_H
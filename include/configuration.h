@@ -9,4 +9,70 @@ const std::size_t HIDDEN_METADATA_SIZE = 9;
 /* metadata chunk_size */
 const uint8_t MD_CHUNK_SIZE = 2;
 
+/* the last metadata byte holds chunk size in the low bits and flags
+ * in the high bits */
+const uint8_t MD_CHUNK_SIZE_MASK = 0x0f;
+
+/* hidden data are compressed, see compress.h */
+const uint16_t MD_FLAG_COMPRESSED = 0x10;
+
+/* hidden data are encrypted, the nonce follows the metadata, see crypto.h */
+const uint16_t MD_FLAG_ENCRYPTED = 0x20;
+
+/* hidden data are scattered over the image in keyed order, see scatter.h,
+ * it is used only together with encryption */
+const uint16_t MD_FLAG_SCATTERED = 0x40;
+
+/* flags 0x100 and above are extended flags, they are hidden in a byte
+ * right after the metadata, which is signalled by this flag */
+const uint16_t MD_FLAG_EXTENDED = 0x80;
+
+/* CRC32C of the hidden data part follows the metadata, see crc.h */
+const uint16_t MD_FLAG_CHECKSUM = 0x100;
+
+/* the hiding has parity carriers, numbers of data and parity carriers
+ * and the parity header follow the metadata, see parity.h */
+const uint16_t MD_FLAG_PARITY = 0x200;
+
+/* units of the message rotate across the data carriers instead of filling
+ * them one by one, see interleave.h, it is not used with scattering */
+const uint16_t MD_FLAG_INTERLEAVED = 0x400;
+
+/* flags which this version of sharky understands */
+const uint16_t MD_SUPPORTED_FLAGS = MD_FLAG_COMPRESSED | MD_FLAG_ENCRYPTED |
+    MD_FLAG_SCATTERED | MD_FLAG_EXTENDED | MD_FLAG_CHECKSUM | MD_FLAG_PARITY |
+    MD_FLAG_INTERLEAVED;
+
+/* in bytes */
+const std::size_t MD_NONCE_SIZE = 12;
+const std::size_t MD_CHECKSUM_SIZE = 4;
+const std::size_t MD_CARRIERS_SIZE = 6;
+/* metadata with every field of extra metadata, extended flags included */
+const std::size_t MAX_METADATA_SIZE = HIDDEN_METADATA_SIZE + 1 + MD_NONCE_SIZE
+    + MD_CHECKSUM_SIZE + MD_CARRIERS_SIZE;
+
+/* how many cells are used by metadata */
+const std::size_t HIDDEN_METADATA_CELLS = HIDDEN_METADATA_SIZE * 8 / MD_CHUNK_SIZE;
+
+/* seq is stored in a single byte of metadata */
+const std::size_t MAX_IMAGES = 256;
+
+/* approximate number of cells processed by one stripe job of parallel
+ * hiding and extraction, stripes always consist of whole rows */
+const std::size_t STRIPE_CELLS = 1 << 20;
+
+/* cells of one block of scattered data, the block spans about one page
+ * of pixel data */
+const std::size_t SCATTER_BLOCK_CELLS = 4096;
+
+/* images up to this size are read and written by a single system call
+ * and processed in memory, see in_memory.h */
+const std::size_t SMALL_IMAGE_SIZE = 1 << 16;
+
+/* bytes of the message in one unit of the interleaved layout */
+const std::size_t INTERLEAVE_UNIT_SIZE = 4096;
+
+/* maximum size of uncompressed block of compressed data */
+const std::size_t COMPRESSION_BLOCK_SIZE = 1 << 16;
+
 #endif  // CONFIGURATION_H
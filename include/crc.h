@@ -0,0 +1,25 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <cstdint>
+#include <span>
+
+/**
+ * @brief Computes CRC32C (Castagnoli) checksum of the data. The checksum
+ * can be computed incrementally by passing the result of the previous call,
+ * `crc32c(b, crc32c(a))` is the checksum of `a` followed by `b`.
+ * 
+ * SSE4.2 crc32 instruction is used when the CPU supports it.
+ * 
+ * @param data checksummed bytes
+ * @param crc checksum of the preceding data, 0 at the start
+ */
+uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc = 0);
+
+/**
+ * @brief Computes the same checksum as `crc32c` without using special
+ * instructions.
+ */
+uint32_t crc32c_portable(std::span<const uint8_t> data, uint32_t crc = 0);
+
+#endif  // CRC_H
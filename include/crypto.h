@@ -0,0 +1,75 @@
+#ifndef CRYPTO_H
+#define CRYPTO_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "configuration.h"
+
+/* bytes of keystream of a single nonce, the block counter has 32 bits and
+ * wrapping it would reuse the keystream */
+const uint64_t CHACHA_MAX_MESSAGE_SIZE = (uint64_t{1} << 32) * 64;
+
+/* iteration count of PBKDF2 deriving the key from passphrase */
+const std::size_t KEY_DERIVATION_ITERATIONS = 100000;
+
+using key_type = std::array<uint8_t, 32>;
+using nonce_type = std::array<uint8_t, MD_NONCE_SIZE>;
+
+/**
+ * @brief Computes SHA-256 digest of the data.
+ */
+std::array<uint8_t, 32> sha256(std::span<const uint8_t> data);
+
+/**
+ * @brief Derives a 32 byte key from passphrase by PBKDF2 (RFC 8018)
+ * with HMAC-SHA-256 as the pseudorandom function.
+ * 
+ * @param passphrase password of PBKDF2
+ * @param salt salt of PBKDF2
+ * @param iterations iteration count of PBKDF2
+ */
+key_type pbkdf2_hmac_sha256(
+    std::string_view passphrase,
+    std::span<const uint8_t> salt,
+    std::size_t iterations
+);
+
+/**
+ * @brief Derives encryption key from passphrase by PBKDF2-HMAC-SHA-256 with
+ * `KEY_DERIVATION_ITERATIONS` iterations. The nonce of hiding is the salt,
+ * so each hiding uses a different key.
+ */
+key_type derive_key(std::string_view passphrase, const nonce_type &nonce);
+
+/**
+ * @brief Generates random nonce for a new hiding.
+ */
+nonce_type generate_nonce();
+
+/**
+ * @brief ChaCha20 stream cipher (RFC 8439). The keystream can be applied
+ * at any offset of the message, so parts of the message can be encrypted
+ * or decrypted independently, in any order.
+ */
+class chacha20 {
+public:
+    chacha20(const key_type &key, const nonce_type &nonce);
+
+    /**
+     * @brief Encrypts or decrypts the data in place by XORing them with
+     * the keystream.
+     * 
+     * @param data part of the message
+     * @param offset offset of the part in the message, the part has to end
+     * within `CHACHA_MAX_MESSAGE_SIZE`
+     */
+    void apply(std::span<uint8_t> data, uint64_t offset) const;
+
+private:
+    std::array<uint32_t, 16> state{};
+};
+
+#endif  // CRYPTO_H
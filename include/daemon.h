@@ -0,0 +1,135 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+
+/* bytes of the request header: "SD", version, reserved byte and the size
+ * of the arguments (4 bytes, little-endian) */
+const std::size_t DAEMON_HEADER_SIZE = 8;
+
+/* maximum size of the arguments of a single request */
+const std::size_t DAEMON_MAX_REQUEST_SIZE = 1 << 20;
+
+/**
+ * @brief Command sent to the daemon. The standard input, output and error
+ * of the client are passed along with it, so the command reads and writes
+ * them directly.
+ */
+struct daemon_request {
+    /* working directory of the client, relative paths are resolved in it */
+    std::string cwd{};
+    /* command line arguments, without the program name */
+    std::vector<std::string> args{};
+};
+
+/**
+ * @brief Serves a request, the streams write to the file descriptors passed
+ * by the client.
+ * 
+ * @return exit code sent back to the client
+ */
+using daemon_handler = std::function<int(
+    const daemon_request &request,
+    std::istream &in,
+    std::ostream &out,
+    std::ostream &err
+)>;
+
+/**
+ * @brief Server listening on a Unix domain socket. Connections are accepted
+ * by `run` and served by worker threads started with the server, so a request
+ * does not pay for a new process, loading of the library or thread startup.
+ * 
+ * A request starts with the header (see `DAEMON_HEADER_SIZE`), the standard
+ * input, output and error of the client are attached to it as `SCM_RIGHTS`
+ * ancillary data. The working directory and the arguments follow, each
+ * of them terminated by a zero byte. The response is the exit code
+ * (4 bytes, little-endian).
+ */
+class daemon_server {
+public:
+    /**
+     * @param handler function serving requests, it is called from multiple
+     * worker threads at the same time
+     * @param workers number of worker threads, `0` is treated as `1`
+     */
+    explicit daemon_server(
+        daemon_handler handler,
+        std::size_t workers = default_jobs()
+    );
+    daemon_server(const daemon_server &) = delete;
+    daemon_server &operator=(const daemon_server &) = delete;
+    ~daemon_server();
+
+    /**
+     * @brief Binds the socket. A socket file left by a daemon which is not
+     * running anymore is replaced, any other file at the path is kept
+     * and the socket is not bound.
+     * 
+     * @param socket_path path of the socket file
+     * @param err output stream for error logging
+     * 
+     * @return `true` on success, `false` if the socket could not be bound,
+     * the path is not a socket or another daemon is listening on it
+     */
+    bool listen(const std::string &socket_path, std::ostream &err = std::cerr);
+
+    /**
+     * @brief Accepts connections until `stop` is called, then waits for
+     * the requests being served and removes the socket file.
+     */
+    void run();
+
+    /**
+     * @brief Makes `run` return, it is safe to call it from a signal handler.
+     */
+    void stop();
+
+private:
+    void work(std::size_t worker);
+    void serve(int connection, std::vector<char> &arguments);
+
+    daemon_handler handler;
+    std::string socket_path{};
+    int listen_fd{-1};
+    std::atomic<bool> stopping{false};
+
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    std::deque<int> connections{};
+    bool closing{false};
+    /* each worker reuses its buffer for arguments of requests */
+    std::vector<std::vector<char>> buffers{};
+    std::vector<std::jthread> workers{};
+};
+
+/**
+ * @brief Sends the request to the daemon and waits for its exit code.
+ * 
+ * @param socket_path path of the socket of the daemon
+ * @param request working directory and arguments of the command
+ * @param fds standard input, output and error of the command
+ * @param err output stream for error logging
+ * 
+ * @return exit code of the command, `1` if the daemon could not be reached
+ */
+int send_request(
+    const std::string &socket_path,
+    const daemon_request &request,
+    std::array<int, 3> fds = {0, 1, 2},
+    std::ostream &err = std::cerr
+);
+
+#endif  // DAEMON_H
@@ -0,0 +1,72 @@
+#ifndef DISCOVER_H
+#define DISCOVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bitmap.h"
+#include "loader.h"
+
+/**
+ * @brief Carriers of a single hiding found among many files
+ * by `discover_hidings`.
+ */
+struct discovered_hiding {
+    uint8_t id{0};
+    /* carriers ordered by seq, with their metadata probed */
+    std::vector<bmp_image> images{};
+    /* seq numbers of carriers which were not found, for hidings without
+     * parity carriers only gaps are known, as the number of carriers
+     * is not stored */
+    std::vector<std::size_t> missing{};
+    /* seq numbers found in more than one image */
+    std::vector<std::size_t> duplicate{};
+
+    /**
+     * @brief Returns `true` if the hidden data can be extracted: no seq
+     * is duplicated and no data carrier is missing, or there are enough
+     * carriers to rebuild the missing ones from parity.
+     */
+    bool complete() const;
+};
+
+/**
+ * @brief Replaces directories among image arguments by the regular files
+ * they hold (not recursively), sorted by name, with the chunk size
+ * of the directory argument.
+ */
+std::vector<image_arg> expand_directories(const std::vector<image_arg> &args);
+
+/**
+ * @brief Probes metadata of the images concurrently (see `probe_metadata`),
+ * so only their first few hundred bytes are read, and groups the carriers
+ * by hiding. Carriers belong to the same hiding if they have the same id,
+ * flags, nonce and numbers of carriers. Files which are not carriers are
+ * skipped silently, as directories usually hold other files as well.
+ * 
+ * @param args images to be probed
+ * @param jobs maximum number of worker threads
+ * @param skipped set to the number of files which are not carriers
+ * 
+ * @return hidings ordered by id, then by the path of their first carrier
+ */
+std::vector<discovered_hiding> discover_hidings(
+    const std::vector<image_arg> &args,
+    std::size_t jobs,
+    std::size_t &skipped
+);
+
+/**
+ * @brief Writes a line about each hiding: its id, number of carriers
+ * and whether it is complete, missing or duplicated seq numbers
+ * are listed otherwise.
+ */
+void print_hidings(
+    std::ostream &os,
+    const std::vector<discovered_hiding> &hidings
+);
+
+#endif  // DISCOVER_H
@@ -0,0 +1,90 @@
+#ifndef DISTORTION_H
+#define DISTORTION_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+/* channels of 32 bit images, blue, green, red and alpha */
+const std::size_t MAX_CHANNELS = 4;
+
+/**
+ * @brief Distortion of an image caused by hiding. It is accumulated cell
+ * by cell right where the cells are altered, so the carrier does not have
+ * to be read again and compared with the altered image.
+ */
+struct image_distortion {
+    /* cells (channel values) of the whole image, padding excluded */
+    std::size_t cells{0};
+    uint16_t channel_count{0};
+    /* the following are indexed by channel */
+    std::array<uint64_t, MAX_CHANNELS> changed{};
+    std::array<uint64_t, MAX_CHANNELS> squared_error{};
+    std::array<uint8_t, MAX_CHANNELS> max_delta{};
+
+    /**
+     * @brief Accounts a single altered cell.
+     * 
+     * @param channel channel of the cell, its index in the row modulo
+     * `channel_count`
+     * @param before value of the cell in the carrier
+     * @param after value of the cell in the altered image
+     */
+    void add(std::size_t channel, uint8_t before, uint8_t after) {
+        auto delta = static_cast<uint8_t>(
+            before > after ? before - after : after - before);
+        changed[channel] += delta != 0;
+        squared_error[channel] += static_cast<uint64_t>(delta) * delta;
+        max_delta[channel] = std::max(max_delta[channel], delta);
+    }
+
+    /**
+     * @brief Adds distortion accumulated separately for other cells
+     * of the same image, e.g. by another stripe.
+     */
+    void merge(const image_distortion &other);
+
+    /**
+     * @brief Returns number of cells whose value changed.
+     */
+    uint64_t changed_cells() const;
+
+    /**
+     * @brief Returns mean squared error over all cells of the image.
+     */
+    double mse() const;
+
+    /**
+     * @brief Returns peak signal-to-noise ratio in dB, infinity if no cell
+     * changed.
+     */
+    double psnr() const;
+};
+
+/**
+ * @brief Writes the header line of the distortion report, which is
+ * tab-separated, so it can be read by other tools.
+ */
+void write_distortion_header(std::ostream &os);
+
+/**
+ * @brief Writes a line of the distortion report: the carrier, the altered
+ * image, changed cells, all cells, MSE, PSNR ("inf" if nothing changed)
+ * and comma-separated maximal deltas of channels.
+ * 
+ * @param os report stream
+ * @param carrier path of the carrier
+ * @param output path of the altered image
+ * @param distortion distortion of the image
+ */
+void write_distortion(
+    std::ostream &os,
+    std::string_view carrier,
+    std::string_view output,
+    const image_distortion &distortion
+);
+
+#endif  // DISTORTION_H
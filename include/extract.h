@@ -2,8 +2,38 @@
 #define EXTRACT_H
 
 #include <span>
+#include <memory>
+#include <optional>
+#include <vector>
 
 #include "bitmap.h"
+#include "budget.h"
+#include "compress.h"
+#include "crypto.h"
+#include "interleave.h"
+#include "journal.h"
+#include "prefetch.h"
+#include "scatter.h"
+
+/**
+ * Options of extraction, stages like decompression are detected from
+ * metadata.
+ */
+struct extract_options {
+    /* passphrase used to decrypt encrypted data */
+    std::string key{};
+    /* bytes of buffers held at the same time, `0` for no limit,
+     * see budget.h */
+    std::size_t memory_limit{0};
+    /* records finished images, so an interrupted extraction can be resumed,
+     * see journal.h */
+    journal_options journal{};
+    /* path of the file written by `data_ostream`, required by the journal */
+    std::string data_path{};
+    /* number of images read ahead of the image being extracted,
+     * see prefetch.h */
+    std::size_t prefetch{0};
+};
 
 /**
  * Extract, check and load metadata about hidden data from the image
@@ -43,19 +73,253 @@ bool extract_data(
     std::ostream& err
 );
 
+/**
+ * Sorts images by their seq and checks that they belong to the same hiding
+ * session, so seq numbers are 0 to n-1 and all ids and flags are the same.
+ * Images of a hiding with parity carriers can be missing as long as there
+ * are at least as many images as data carriers, see parity.h.
+ * 
+ * @param images images with extracted metadata
+ * @param indx indices of images sorted by seq will be stored here
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` otherwise
+ */
+bool order_session(
+    std::vector<bmp_image>& images,
+    std::vector<std::size_t>& indx,
+    std::ostream& err
+);
+
+/**
+ * Decoding of hidden data shared by all images of a hiding, the inverse
+ * of `data_encoding`.
+ */
+struct data_decoding {
+    /* set if the data are encrypted */
+    std::optional<chacha20> cipher{};
+    /* key of `cell_scatter` if the data are scattered */
+    std::optional<key_type> scatter_key{};
+};
+
+/**
+ * Prepares decryption and scattered order of hidden data if the image
+ * metadata state that they are used.
+ * 
+ * @param im any image of the session, with extracted metadata
+ * @param options options with the key
+ * @param decoding the decoding is stored here
+ * @param err output stream for error logging
+ * 
+ * @return `false` if the data are encrypted and no key was given
+ */
+bool prepare_decoding(
+    const bmp_image& im,
+    const extract_options& options,
+    data_decoding& decoding,
+    std::ostream& err
+);
+
+/**
+ * Computes memory held while the data are extracted from the images.
+ * Rebuilt data parts, extracted data held by parallel extraction and their
+ * reordered copy are held during the whole extraction, images are read
+ * into memory one by one when data parts are rebuilt.
+ * 
+ * @param images images of the session with extracted metadata
+ * @param indx indices of images sorted by seq (see `order_session`)
+ * @param rebuilding `true` if missing data parts are rebuilt
+ * (see `data_carriers_missing`)
+ * @param whole_images `true` if every image is read into memory and the whole
+ * message is held (see stripes.h), otherwise only scattered and small
+ * images are and the message is written block by block
+ * 
+ * @return memory needed by the extraction
+ */
+memory_needs extraction_memory(
+    const std::vector<bmp_image>& images,
+    const std::vector<std::size_t>& indx,
+    bool rebuilding,
+    bool whole_images
+);
+
 /**
  * Extracts hidden data/message from images.
  * 
  * @param images reference to vector of images to be extracted
  * @param data_ostream output stream where data should be extracted
  * @param err output stream for error logging
+ * @param options options of extraction
  * 
  * @return `0` on success, `1` otherwise
  */
 int extract(
     std::vector<bmp_image>& images,
     std::ostream& data_ostream,
-    std::ostream& err = std::cerr
+    std::ostream& err = std::cerr,
+    const extract_options& options = {}
 );
 
+/**
+ * Extracts only the given range of hidden data/message from images. Metadata
+ * of all images is extracted first, then only images holding the range are
+ * read, starting directly at the cell which holds the first requested byte.
+ * 
+ * @param images reference to vector of images to be extracted
+ * @param offset index of the first extracted byte of hidden data
+ * @param length how many bytes should be extracted
+ * @param data_ostream output stream where data should be extracted
+ * @param err output stream for error logging
+ * @param options options of extraction
+ * 
+ * @return `0` on success, `1` otherwise
+ * 
+ * @note images which are not `seekable` are read sequentially up to the end
+ * of the range
+ * @note range of compressed data can not be extracted
+ */
+int extract_range(
+    std::vector<bmp_image>& images,
+    std::size_t offset,
+    std::size_t length,
+    std::ostream& data_ostream,
+    std::ostream& err = std::cerr,
+    const extract_options& options = {}
+);
+
+/**
+ * @brief Extracts hidden data/message from images in steps, see `extract`
+ * and `extract_range` for details. Each step extracts metadata of one image
+ * or at most one buffer of data, which makes it possible to run many
+ * extractions on a few threads (see `async_extract`). Missing data parts
+ * of a hiding with parity carriers are rebuilt in a single step. Interleaved
+ * data are extracted unit by unit in the order of the message, each data part
+ * is read by its own reader, which stays open until the part is finished.
+ * 
+ * With `options.journal`, each image is recorded in the journal once its data
+ * are written and flushed. A resumed session skips the images whose data
+ * in `options.data_path` are unchanged and seeks `data_ostream` right after
+ * them. Compressed, interleaved and rebuilt data are not written image
+ * by image, so they can not be journaled.
+ * 
+ * With `options.prefetch`, the images following the current one are read
+ * ahead, both while metadata are loaded and while data are extracted.
+ */
+class extract_session {
+public:
+    /**
+     * @see extract, all the arguments have to outlive the session
+     */
+    extract_session(
+        std::vector<bmp_image>& images,
+        std::ostream& data_ostream,
+        std::ostream& err = std::cerr,
+        const extract_options& options = {}
+    );
+
+    /**
+     * @see extract_range, all the arguments have to outlive the session
+     */
+    extract_session(
+        std::vector<bmp_image>& images,
+        std::size_t offset,
+        std::size_t length,
+        std::ostream& data_ostream,
+        std::ostream& err = std::cerr,
+        const extract_options& options = {}
+    );
+
+    /**
+     * @brief Does the next step of extraction.
+     * 
+     * @return `true` if there is more work to do, `false` if the session
+     * is finished
+     */
+    bool step();
+
+    /**
+     * @brief Returns result of the session, the same as `extract` would,
+     * valid after `step` returned `false`.
+     */
+    int result() const;
+
+private:
+    bool load_metadata();
+    bool check_session();
+    bool start_part();
+    bool extract_block();
+    bool process_block();
+    bool open_part(std::size_t part, std::size_t part_offset);
+    bool extract_unit();
+    bool extract_rebuilt();
+    bool finish_data();
+    bool open_journal(bool rebuilding);
+    bool write_block();
+    bool finish(int result);
+
+    enum session_state { METADATA, CHECK, DATA, REBUILT, FINISHED };
+
+    std::vector<bmp_image>& images;
+    std::ostream& data_ostream;
+    std::ostream& err;
+    extract_options options;
+
+    /* `true` if the whole data is extracted, not only the range */
+    bool whole;
+    std::size_t offset{0};
+    std::size_t length{0};
+
+    session_state state{METADATA};
+    int res{0};
+
+    std::size_t data_size{0};
+    /* buffers kept for images which are not seekable */
+    std::vector<std::unique_ptr<bmp_image_buffer>> streamed{};
+    /* indices of images sorted by seq */
+    std::vector<std::size_t> indx{};
+    /* index of the next image (into `images` or `indx`, based on state) */
+    std::size_t next{0};
+    /* offset of the first byte hidden in the `next` image */
+    std::size_t image_offset{0};
+
+    /* image from which data is being extracted, `nullptr` if none */
+    bmp_image *current{nullptr};
+    std::unique_ptr<bmp_image_buffer> buffer{};
+    bmp_image_buffer *part_buffer{nullptr};
+    /* bytes to be dropped before the range starts (images read sequentially) */
+    std::size_t to_drop{0};
+    /* bytes of the range remaining in the current image */
+    std::size_t remaining{0};
+    std::vector<uint8_t> block{};
+    /* set if the hidden data are compressed */
+    std::optional<decompressor> decompress{};
+    data_decoding decoding{};
+    /* order of data cells of the current image if the data are scattered */
+    std::optional<cell_scatter> scatter{};
+    /* the current image held in memory, used for scattered data */
+    std::vector<std::byte> memory_image{};
+    /* checksum of the current data part extracted so far, set if the whole
+     * part is extracted and its checksum is stored */
+    std::optional<uint32_t> checksum{};
+    /* stored data of all data parts if some of them were rebuilt from parity
+     * carriers, see parity.h */
+    std::vector<uint8_t> rebuilt{};
+
+    /* set if the data parts are interleaved, see interleave.h */
+    std::optional<interleaved_layout> layout{};
+    /* readers of interleaved data parts, indexed by seq, `nullptr` until
+     * the first unit of the part is extracted */
+    std::vector<bmp_image_buffer *> part_readers{};
+    std::vector<std::unique_ptr<bmp_image_buffer>> part_buffers{};
+    /* bytes of each interleaved data part read so far */
+    std::vector<std::size_t> part_positions{};
+    std::vector<std::optional<uint32_t>> part_checksums{};
+
+    /* set if `options.journal` is used */
+    std::optional<job_journal> journal{};
+    /* checksum of the data of the current image written so far */
+    uint32_t written_checksum{0};
+    image_prefetcher prefetcher;
+};
+
 #endif  // EXTRACT_H
@@ -2,8 +2,284 @@
 #define HIDE_H
 
 #include <span>
+#include <optional>
 
 #include "bitmap.h"
+#include "budget.h"
+#include "chunker.h"
+#include "crypto.h"
+#include "journal.h"
+#include "metadata.h"
+#include "planner.h"
+#include "prefetch.h"
+
+/**
+ * @brief Optional stages applied to the message before it is hidden.
+ */
+struct hide_options {
+    /* compress the message, see compress.h */
+    bool compress{false};
+    /* passphrase used to encrypt the message, empty for no encryption */
+    std::string key{};
+    /* spread the data over images in keyed order, it requires `key`,
+     * see scatter.h */
+    bool scatter{false};
+    /* store CRC32C of each data part in its metadata, see crc.h */
+    bool checksum{false};
+    /* number of parity carriers hidden after the data carriers, see parity.h */
+    std::size_t parity{0};
+    /* how carriers are selected from the given images, see planner.h */
+    carrier_selection select{carrier_selection::ORDER};
+    /* give each image the smallest chunk size with which the message fits,
+     * instead of the chunk sizes of images */
+    bool auto_chunk{false};
+    /* rotate units of the message across the data carriers, see interleave.h,
+     * it can not be used with `scatter` */
+    bool interleave{false};
+    /* bytes of buffers held at the same time, `0` for no limit,
+     * see budget.h */
+    std::size_t memory_limit{0};
+    /* records finished images, so an interrupted hiding can be resumed,
+     * see journal.h */
+    journal_options journal{};
+    /* measure the distortion of every altered image into its
+     * `bmp_image::distortion`, see distortion.h */
+    bool distortion{false};
+    /* number of images read ahead of the image being hidden, see prefetch.h */
+    std::size_t prefetch{0};
+};
+
+/**
+ * @brief Encoding of the message shared by all images of a hiding.
+ */
+struct data_encoding {
+    /* metadata flags of every used image */
+    uint16_t flags{0};
+    /* nonce stored in extra metadata if the data are encrypted */
+    nonce_type nonce{};
+    /* applied to data parts right before they are hidden */
+    std::optional<chacha20> cipher{};
+    /* key of `cell_scatter` if the data are scattered */
+    std::optional<key_type> scatter_key{};
+    /* set by `plan_carriers` if there are parity carriers */
+    carrier_counts carriers{};
+    /* sizes of data parts, set by `plan_carriers` if the data
+     * are interleaved */
+    std::vector<std::size_t> part_sizes{};
+};
+
+/**
+ * @brief Generates random id of hidding.
+ */
+uint8_t generate_id();
+
+/**
+ * @brief Reads the whole input stream. Streams which can not seek (pipes)
+ * are read block by block until the end of stream.
+ */
+std::vector<uint8_t> read_data(std::istream &data_in);
+
+/**
+ * @brief Reads the whole input stream like `read_data`, unless the message
+ * does not fit into `options.memory_limit`. The size of streams which can
+ * seek is checked before anything is read, other streams are read until
+ * the limit is exceeded. Compression holds the message and its compressed
+ * copy at the same time, so both have to fit.
+ * 
+ * @param data_in input stream of the message
+ * @param data the message will be stored here
+ * @param options options of the hiding
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` if the message does not fit
+ * into the limit
+ */
+bool read_message(
+    std::istream &data_in,
+    std::vector<uint8_t> &data,
+    const hide_options &options,
+    std::ostream &err
+);
+
+/**
+ * @brief Applies the stages selected by options which work on the whole
+ * message (compression), before it is split among images, and prepares
+ * the encryption, which is done block by block as the data are hidden.
+ * 
+ * @param data in-out parameter, the message
+ * @param options selected stages
+ * @param out output stream for info logging
+ * 
+ * @return encoding which has to be used for every used image
+ */
+data_encoding encode_data(
+    std::vector<uint8_t> &data,
+    const hide_options &options,
+    std::ostream &out
+);
+
+/**
+ * @brief Sets metadata flags and extra metadata of the image according
+ * to the encoding, it has to be done before the capacity of the image
+ * is computed, because extra metadata reduce it.
+ */
+void apply_encoding(bmp_image &im, const data_encoding &encoding);
+
+/**
+ * @brief Selects carriers of the message from their headers before any image
+ * is opened, so a message which does not fit is rejected without writing
+ * anything. Data carriers are counted if parity carriers are used, so
+ * the counts can be stored in the metadata of every carrier before the first
+ * one is hidden. Encoding is applied to the images and chunk sizes are
+ * assigned if `options.auto_chunk` is set. Interleaved data are spread over
+ * as many of the given images as there are units of the message, unless
+ * the carriers are selected.
+ * 
+ * @param images images of the hiding, unless `options.select` is
+ * `carrier_selection::ORDER`, selected images are moved to the front
+ * in the order in which they are used
+ * @param encoding encoding of the message, its `carriers` are set
+ * @param data_size size of the encoded message
+ * @param err output stream for error logging
+ * @param options options of the hiding, see `hide_options::select`,
+ * `hide_options::auto_chunk` and `hide_options::interleave`
+ * 
+ * @return `true` on success, `false` if the message does not fit, there
+ * are not enough images for parity carriers or the encrypted message is longer
+ * than `CHACHA_MAX_MESSAGE_SIZE`
+ */
+bool plan_carriers(
+    std::vector<bmp_image> &images,
+    data_encoding &encoding,
+    std::size_t data_size,
+    std::ostream &err,
+    const hide_options &options = {}
+);
+
+/**
+ * @brief Computes memory held while the message is hidden into the carriers
+ * planned by `plan_carriers`: the message, its reordered copy if it is
+ * interleaved, parity parts and the largest buffer of a single carrier.
+ * 
+ * @param images images of the hiding, with encoding applied
+ * @param encoding encoding of the message
+ * @param data_size size of the encoded message
+ * @param whole_images `true` if every carrier is read into memory
+ * (see stripes.h), otherwise only scattered and small images are
+ * 
+ * @return memory needed by the hiding
+ */
+memory_needs hiding_memory(
+    const std::vector<bmp_image> &images,
+    const data_encoding &encoding,
+    std::size_t data_size,
+    bool whole_images
+);
+
+/**
+ * @brief Encrypts the whole message and reorders it into the data parts
+ * of the interleaved layout stored one after another, so they are hidden
+ * like any other data parts. The cipher is reset, because the data parts are
+ * encrypted already.
+ * 
+ * @param data in-out parameter, the encoded message
+ * @param encoding encoding with `part_sizes` set by `plan_carriers`
+ */
+void interleave_data(std::vector<uint8_t> &data, data_encoding &encoding);
+
+/**
+ * @brief Starts measuring the distortion of the image if
+ * `options.distortion` is set, right before the image is hidden.
+ */
+void measure_distortion(bmp_image &im, const hide_options &options);
+
+/**
+ * @brief Finishes the data part right before its metadata are made,
+ * the data part is encrypted if `cipher` is set and its checksum is stored
+ * into the extra metadata if `im` has `MD_FLAG_CHECKSUM` set.
+ * 
+ * @param im image with encoding applied
+ * @param to_hide data part, it is encrypted in place
+ * @param cipher cipher of the message, or `nullptr`
+ * @param message_offset offset of the data part in the message
+ */
+void seal_data_part(
+    bmp_image &im,
+    std::span<uint8_t> to_hide,
+    const chacha20 *cipher,
+    std::size_t message_offset
+);
+
+/**
+ * @brief Hides data part into a single image in steps, so hiding can be
+ * interleaved with other work. Each step hides at most one buffer of chunks
+ * or copies one buffer of the rest of the image. Image streams should be
+ * open during the whole hiding.
+ */
+class image_hider {
+public:
+    /**
+     * @param im image into which data will be hidden
+     * @param to_hide data part to be hidden, it has to outlive the hider
+     * @param id id of hidding
+     * @param seq data part index
+     * @param cipher if set, each block of the data part is encrypted in place
+     * right before it is hidden, the checksum stored in the metadata is
+     * computed from the same block and the metadata are rewritten once
+     * the image is written. The whole part is sealed at once instead if
+     * the image streams can not seek.
+     * @param message_offset offset of the data part in the message, used
+     * as the keystream offset
+     */
+    image_hider(
+        bmp_image &im,
+        std::span<uint8_t> to_hide,
+        uint8_t id,
+        uint8_t seq,
+        const chacha20 *cipher = nullptr,
+        std::size_t message_offset = 0
+    );
+
+    /**
+     * @brief Does the next step of hiding.
+     * 
+     * @param err output stream for error logging
+     * 
+     * @return `true` if there is more work to do, `false` if the hiding
+     * is finished or failed
+     */
+    bool step(std::ostream &err);
+
+    /**
+     * @brief Returns `true` if the hiding failed.
+     */
+    bool failed() const;
+
+private:
+    enum hider_state { METADATA, DATA, REST, DONE, FAILED };
+
+    bool rewrite_metadata();
+
+    bmp_image &im;
+    /* set if the checksum of the data part is computed as it is hidden,
+     * and the metadata are rewritten once the image is written */
+    bool deferred;
+    /* output position of the first pixel byte, used if `deferred` */
+    std::streamoff output_start;
+    std::vector<uint8_t> metadata;
+    bmp_image_buffer buffer;
+    chunker metadata_chnkr;
+    chunker data_chnkr;
+    std::span<uint8_t> to_hide;
+    uint8_t id;
+    uint8_t seq;
+    const chacha20 *cipher;
+    std::size_t message_offset;
+    /* bytes of the data part which were already encrypted and checksummed */
+    std::size_t sealed;
+    uint32_t checksum{0};
+    hider_state state{METADATA};
+};
 
 /**
  * @brief Hides data part into a single image.
@@ -25,12 +301,15 @@ bool hide_data(
 );
 
 /**
- * @brief Hides message (data) from file into images.
+ * @brief Hides message (data) from file into images. Images are opened
+ * only when data is hidden into them and closed right after that, so images
+ * which are not necessary do not produce any output.
  * 
  * @param images vector of images, where text will be hidden
  * @param data input stream of the message file
  * @param out output stream for info logging
  * @param err output stream for error logging
+ * @param options optional stages applied to the message
  * 
  * @return 0 on success, 1 if the full message could not be hidden
  * due to small images sizes, 2 in case of stream errors
@@ -39,7 +318,85 @@ int hide(
     std::vector<bmp_image> &images,
     std::istream &data,
     std::ostream &out = std::cout,
-    std::ostream &err = std::cerr
+    std::ostream &err = std::cerr,
+    const hide_options &options = {}
 );
 
+/**
+ * @brief Hides message (data) into images in steps, see `hide` for details.
+ * Each step does a bounded amount of work, which makes it possible to run
+ * many hidings on a few threads (see `async_hide`). Scattered data are hidden
+ * into a whole image held in memory in a single step, and so are small images
+ * (see `is_small_image`), which are read and written by a single system call.
+ * 
+ * With `options.journal`, each finished image is recorded in the journal.
+ * A resumed session reuses the id and the nonce of the recorded hiding
+ * and skips images whose altered files are unchanged, their data parts are
+ * only encrypted, as parity carriers are computed from them.
+ * 
+ * With `options.prefetch`, the images following the current one are read
+ * ahead while it is hidden.
+ */
+class hide_session {
+public:
+    /**
+     * @see hide, all the arguments have to outlive the session
+     */
+    hide_session(
+        std::vector<bmp_image> &images,
+        std::istream &data_in,
+        std::ostream &out = std::cout,
+        std::ostream &err = std::cerr,
+        const hide_options &options = {}
+    );
+
+    /**
+     * @brief Does the next step of hiding.
+     * 
+     * @return `true` if there is more work to do, `false` if the session
+     * is finished
+     */
+    bool step();
+
+    /**
+     * @brief Returns result of the session, the same as `hide` would,
+     * valid after `step` returned `false`.
+     */
+    int result() const;
+
+private:
+    bool hide_parity_part();
+    bool open_journal(std::size_t message_size, uint32_t message_checksum);
+    bool completed_image(bool &completed);
+    bool record_image();
+    bool finish(int result);
+
+    std::vector<bmp_image> &images;
+    std::istream &data_in;
+    std::ostream &out;
+    std::ostream &err;
+    hide_options options;
+
+    uint8_t id;
+    data_encoding encoding{};
+    std::vector<uint8_t> data{};
+    bool data_loaded{false};
+    std::size_t data_index{0};
+    std::size_t seq{0};
+    std::optional<image_hider> hider{};
+    /* data parts hidden so far and parity parts computed from them */
+    std::vector<std::span<const uint8_t>> data_parts{};
+    std::vector<std::vector<uint8_t>> parity_parts{};
+    /* set if `options.journal` is used */
+    std::optional<job_journal> journal{};
+    /* part of the message (or of the parity) planned for the current image,
+     * compared with the journal */
+    std::size_t part_offset{0};
+    std::size_t part_size{0};
+    image_prefetcher prefetcher;
+
+    bool finished{false};
+    int res{0};
+};
+
 #endif  // HIDE_H
@@ -0,0 +1,241 @@
+#ifndef IN_MEMORY_H
+#define IN_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <iostream>
+
+#include "bitmap.h"
+#include "scatter.h"
+
+/**
+ * @brief Reads, checks and stores relevant information about bmp image held
+ * in memory into image struct, without using any stream.
+ * 
+ * @param im image struct with `filename` (used in error messages only)
+ * and `chunk_size` set
+ * @param image whole bmp file
+ * @param err stream where error messages will be written
+ * 
+ * @return `true` on success, `false` otherwise
+ */
+bool load_header_from_memory(
+    bmp_image &im,
+    std::span<const std::byte> image,
+    std::ostream &err = std::cerr
+);
+
+/**
+ * @brief Reads the whole image file into memory using its input stream,
+ * which is opened by `bmp_image::open_input` if needed. The header has
+ * to be loaded already, it is copied from `bmp_image::header`, so images
+ * which are not seekable can be read as well.
+ * 
+ * @param im image with loaded header
+ * @param image the image file will be stored here
+ * 
+ * @return `true` on success, `false` if the image could not be opened
+ */
+bool read_image(bmp_image &im, std::vector<std::byte> &image);
+
+/**
+ * @brief Returns the size of the image file computed from its header,
+ * the header and the pixel data, which is the memory held by `read_image`.
+ */
+std::size_t image_file_size(const bmp_image &im);
+
+/**
+ * @brief Checks whether the image is a file of at most `SMALL_IMAGE_SIZE`
+ * bytes, which can be read by `read_image_file`. Per-file costs of streams
+ * dominate for such images, e.g. thumbnails.
+ * 
+ * @param im image with loaded header and no assigned input stream
+ */
+bool is_small_image(const bmp_image &im);
+
+/**
+ * @brief Returns a buffer for whole small images owned by the calling thread,
+ * so its allocation is reused by all images processed on the thread. It has
+ * to be used only within a single step of a session, because sessions can
+ * move between threads.
+ */
+std::vector<std::byte> &small_image_buffer();
+
+/**
+ * @brief Reads the whole image file by a single system call, without any
+ * stream.
+ * 
+ * @param im image for which `is_small_image` holds
+ * @param image the image file will be stored here
+ * 
+ * @return `true` on success, `false` if the file could not be read
+ */
+bool read_image_file(const bmp_image &im, std::vector<std::byte> &image);
+
+/**
+ * @brief Writes the whole altered image file to the output path of the image
+ * by a single system call, without any stream.
+ * 
+ * @return `true` on success, `false` if the file could not be written
+ */
+bool write_image_file(bmp_image &im, std::span<const std::byte> image);
+
+/**
+ * @brief Hides bytes into the pixel data, starting at the given cell.
+ * 
+ * @param im image with loaded header
+ * @param pixels pixel data of the image (bytes starting at `data_offset`)
+ * @param first_cell cell where the first chunk will be hidden,
+ * see `bmp_image::cell_offset`
+ * @param bytes bytes to be hidden
+ * @param chunk_size size of chunk in bits
+ * @param distortion if set, altered cells are accounted in it
+ * 
+ * @return `true` on success, `false` if the bytes do not fit into the image
+ */
+bool hide_bytes_at(
+    const bmp_image &im,
+    std::span<std::byte> pixels,
+    std::size_t first_cell,
+    std::span<const uint8_t> bytes,
+    uint8_t chunk_size,
+    image_distortion *distortion = nullptr
+);
+
+/**
+ * @brief Extracts bytes from the pixel data, starting at the given cell.
+ * 
+ * @param im image with loaded header
+ * @param pixels pixel data of the image (bytes starting at `data_offset`)
+ * @param first_cell cell from which the first chunk will be extracted
+ * @param bytes where the extracted bytes will be stored, its size determines
+ * how many bytes are extracted
+ * @param chunk_size size of chunk in bits
+ * 
+ * @return `true` on success, `false` if the image is too small
+ */
+bool extract_bytes_at(
+    const bmp_image &im,
+    std::span<const std::byte> pixels,
+    std::size_t first_cell,
+    std::span<uint8_t> bytes,
+    uint8_t chunk_size
+);
+
+/**
+ * @brief Hides bytes into the data cells of the pixel data in the order given
+ * by the scatter.
+ * 
+ * @param im image with loaded header
+ * @param pixels whole pixel data of the image (bytes starting at `data_offset`)
+ * @param scatter order of data cells of the image
+ * @param first_index index of the data cell where the first chunk will be
+ * hidden, data cells are counted from `im.data_start_cell()`
+ * @param bytes bytes to be hidden
+ * @param chunk_size size of chunk in bits
+ * @param distortion if set, altered cells are accounted in it
+ * 
+ * @return `true` on success, `false` if the bytes do not fit into the image
+ */
+bool hide_bytes_scattered(
+    const bmp_image &im,
+    std::span<std::byte> pixels,
+    const cell_scatter &scatter,
+    std::size_t first_index,
+    std::span<const uint8_t> bytes,
+    uint8_t chunk_size,
+    image_distortion *distortion = nullptr
+);
+
+/**
+ * @brief Extracts bytes hidden by `hide_bytes_scattered`.
+ * 
+ * @see hide_bytes_scattered, extract_bytes_at
+ */
+bool extract_bytes_scattered(
+    const bmp_image &im,
+    std::span<const std::byte> pixels,
+    const cell_scatter &scatter,
+    std::size_t first_index,
+    std::span<uint8_t> bytes,
+    uint8_t chunk_size
+);
+
+/**
+ * @brief Hides data part into a single image held in memory. The carrier is
+ * copied into the output, which is then modified directly.
+ * 
+ * @param im image struct with `filename` and `chunk_size` set, header will be
+ * loaded from the carrier
+ * @param carrier whole bmp file
+ * @param output buffer for the altered bmp file, at least as large
+ * as the carrier, it can be the same memory as `carrier`
+ * @param to_hide data part to be hidden
+ * @param id id of hidding
+ * @param seq data part index
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` on failure
+ */
+bool hide_data_in_memory(
+    bmp_image &im,
+    std::span<const std::byte> carrier,
+    std::span<std::byte> output,
+    std::span<const uint8_t> to_hide,
+    uint8_t id,
+    uint8_t seq,
+    std::ostream &err = std::cerr
+);
+
+/**
+ * @brief Hides data part into a single image held in memory, modifying
+ * the image in place.
+ * 
+ * @see hide_data_in_memory
+ */
+bool hide_data_in_place(
+    bmp_image &im,
+    std::span<std::byte> image,
+    std::span<const uint8_t> to_hide,
+    uint8_t id,
+    uint8_t seq,
+    std::ostream &err = std::cerr
+);
+
+/**
+ * @brief Loads header and hidden metadata of the image held in memory.
+ * 
+ * @param im in-out parameter, after the call the header members
+ * and `id`, `seq`, `hidden_data_size`, `chunk_size` will be set
+ * @param image whole bmp file
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` otherwise
+ */
+bool extract_metadata_in_memory(
+    bmp_image &im,
+    std::span<const std::byte> image,
+    std::ostream &err = std::cerr
+);
+
+/**
+ * @brief Extracts hidden data from the image held in memory.
+ * 
+ * @param im image struct, `extract_metadata_in_memory` has to be
+ * called with it first
+ * @param image whole bmp file
+ * @param data where extracted data will be placed, at most
+ * `im.hidden_data_size` bytes
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` otherwise
+ */
+bool extract_data_in_memory(
+    const bmp_image &im,
+    std::span<const std::byte> image,
+    std::span<uint8_t> data,
+    std::ostream &err = std::cerr
+);
+
+#endif  // IN_MEMORY_H
@@ -0,0 +1,60 @@
+#ifndef INTERLEAVE_H
+#define INTERLEAVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Continuous range of the message stored in a single data part.
+ */
+struct interleave_unit {
+    /* index of the data part (seq of its carrier) */
+    std::size_t part{0};
+    /* offset of the unit in the data part */
+    std::size_t part_offset{0};
+    std::size_t message_offset{0};
+    std::size_t size{0};
+};
+
+/**
+ * @brief Interleaved layout of a message. Units of `INTERLEAVE_UNIT_SIZE`
+ * bytes are assigned to data parts in rotation, parts which are full
+ * are skipped. The layout is computed from capacities of carriers when
+ * hiding, and the same layout is computed from sizes of the hidden data parts
+ * when extracting.
+ */
+struct interleaved_layout {
+    /* units in the order of the message */
+    std::vector<interleave_unit> units{};
+    std::vector<std::size_t> part_sizes{};
+    /* offsets of data parts if they are stored one after another */
+    std::vector<std::size_t> part_starts{};
+
+    /**
+     * @param capacities capacities of carriers, or sizes of data parts
+     * @param data_size size of the message, it has to fit into the capacities
+     */
+    interleaved_layout(std::span<const std::size_t> capacities,
+                       std::size_t data_size);
+
+    /**
+     * @brief Returns the unit holding the byte of the message at `offset`.
+     */
+    const interleave_unit &unit_at(std::size_t offset) const;
+
+    /**
+     * @brief Reorders the message into data parts stored one after another.
+     */
+    void interleave(std::span<const uint8_t> message,
+                    std::span<uint8_t> parts) const;
+
+    /**
+     * @brief Reorders data parts stored one after another into the message.
+     */
+    void deinterleave(std::span<const uint8_t> parts,
+                      std::span<uint8_t> message) const;
+};
+
+#endif  // INTERLEAVE_H
@@ -0,0 +1,144 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "crypto.h"
+
+/* the first line of every journal */
+const std::string JOURNAL_MAGIC = "sharky-journal 2";
+
+/**
+ * @brief Options of the checkpoint journal of hiding or extraction.
+ */
+struct journal_options {
+    /* path of the journal, empty for no journal */
+    std::string path{};
+    /* skip images recorded in the journal, if it exists */
+    bool resume{false};
+};
+
+/**
+ * @brief Job recorded by the journal, a resumed job has to be the same.
+ */
+struct journal_header {
+    /* "hide" or "extract" */
+    std::string kind{};
+    /* id of hiding */
+    uint8_t id{0};
+    /* size of the message read by hiding, or of the hidden data */
+    std::size_t size{0};
+    /* CRC32C of the message read by hiding, 0 for extraction */
+    uint32_t checksum{0};
+    /* metadata flags of the hiding */
+    uint16_t flags{0};
+    /* nonce of encrypted hiding, so the resumed hiding encrypts
+     * the message the same way */
+    nonce_type nonce{};
+
+    bool operator==(const journal_header &) const = default;
+};
+
+/**
+ * @brief Image which was finished, the file written for it holds
+ * `size` bytes at `offset` with the given checksum. Hiding records also
+ * the part of the message the image holds, so a resumed hiding with
+ * a different plan is recognized.
+ */
+struct journal_entry {
+    /* seq of the image */
+    std::size_t seq{0};
+    /* the altered image, or the file with extracted data */
+    std::string path{};
+    std::size_t offset{0};
+    std::size_t size{0};
+    /* CRC32C of the written bytes */
+    uint32_t checksum{0};
+    /* part of the message (or of the parity) hidden into the image and its
+     * chunk size, zero for extraction */
+    std::size_t part_offset{0};
+    std::size_t part_size{0};
+    uint8_t chunk_size{0};
+};
+
+/**
+ * @brief Checkpoint journal of a job, it records images which were finished,
+ * so an interrupted job can skip them when it is run again. The journal is
+ * a text file, the header line follows `JOURNAL_MAGIC` and each finished image
+ * has its own line. The whole journal is written to a temporary file, which
+ * replaces the journal, after each image, so the journal is never left
+ * partially written.
+ */
+class job_journal {
+public:
+    /**
+     * @brief Loads the journal of a previous run.
+     *
+     * @param path path of the journal
+     * @param err output stream for error logging
+     *
+     * @return `true` on success, `false` if the journal does not exist
+     * or is corrupted, which is logged
+     */
+    bool load(const std::string &path, std::ostream &err = std::cerr);
+
+    /**
+     * @brief Starts a new journal of the job, the previous journal
+     * is replaced.
+     *
+     * @return `true` on success, `false` if the journal could not be written
+     */
+    bool start(
+        const std::string &path,
+        const journal_header &header,
+        std::ostream &err = std::cerr
+    );
+
+    /**
+     * @brief Records the finished image and writes the journal.
+     *
+     * @return `true` on success, `false` if the journal could not be written
+     */
+    bool record(const journal_entry &entry, std::ostream &err = std::cerr);
+
+    /**
+     * @brief Returns the entry of the image if it was recorded and the file
+     * written for it still holds the recorded bytes, `nullptr` otherwise.
+     * The file is read to compare the checksum.
+     * 
+     * @param seq seq of the image
+     * @param path the file which has to be written for the image
+     */
+    const journal_entry *completed(
+        std::size_t seq,
+        const std::string &path
+    ) const;
+
+    const journal_header &header() const;
+
+private:
+    bool write(std::ostream &err);
+
+    std::string path{};
+    journal_header hdr{};
+    std::vector<journal_entry> entries{};
+};
+
+/**
+ * @brief Computes CRC32C of `size` bytes of the file starting at `offset`.
+ * 
+ * @return `true` on success, `false` if the file could not be read or it
+ * is too short
+ */
+bool file_checksum(
+    const std::string &path,
+    std::size_t offset,
+    std::size_t size,
+    uint32_t &checksum
+);
+
+#endif  // JOURNAL_H
@@ -0,0 +1,78 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "bitmap.h"
+
+class carrier_catalog;
+
+/**
+ * @brief Image given on the command line, which was not opened yet.
+ */
+struct image_arg {
+    std::string filename;
+    uint8_t chunk_size;
+};
+
+/**
+ * @brief Reads and checks the header of the image file using positional
+ * reads of the header bytes only. The file is closed afterwards.
+ * 
+ * @param im image with filename set, on success its header and geometry
+ * members are set
+ * @param err stream where error messages will be written
+ * 
+ * @return `true` on success, `false` otherwise
+ */
+bool probe_header(bmp_image &im, std::ostream &err);
+
+/**
+ * @brief Reads the header and the hidden metadata of the image file like
+ * `probe_header`, only the header and the cells holding the metadata are
+ * read, which are at most a few hundred bytes at the start of the pixel data.
+ * 
+ * @param im image with filename set, on success its header members and `id`,
+ * `seq`, `hidden_data_size`, `chunk_size`, `flags` and `extra_metadata`
+ * are set
+ * @param err stream where error messages will be written
+ * 
+ * @return `true` on success, `false` if the file could not be read or it does
+ * not hold valid metadata
+ */
+bool probe_metadata(bmp_image &im, std::ostream &err);
+
+/**
+ * @brief Returns `true` if the file has to be read sequentially, which is
+ * the case for the standard input (`STDIO_FILENAME`), pipes and FIFOs.
+ */
+bool is_streamed(const std::string &filename);
+
+/**
+ * @brief Loads headers of images concurrently, using at most `jobs` worker
+ * threads. Images are not kept open, they should be opened by
+ * `bmp_image::open_input` when they are needed. The exception are streamed
+ * images (see `is_streamed`), which stay open and are not `seekable`. Images which could not be opened or have invalid
+ * headers are skipped. Error messages are written in the order of `args`,
+ * regardless of the order in which the images were processed.
+ * 
+ * @param args images to be loaded
+ * @param images vector where successfully loaded images are appended,
+ * in the order of `args`
+ * @param jobs maximum number of worker threads
+ * @param err stream where error messages will be written
+ * @param catalog if set, headers of images which did not change since they
+ * were indexed are taken from it, see catalog.h
+ */
+void load_images(
+    const std::vector<image_arg> &args,
+    std::vector<bmp_image> &images,
+    std::size_t jobs,
+    std::ostream &err = std::cerr,
+    const carrier_catalog *catalog = nullptr
+);
+
+#endif  // LOADER_H
@@ -0,0 +1,121 @@
+#ifndef METADATA_H
+#define METADATA_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <iostream>
+
+#include "bitmap.h"
+
+/**
+ * @brief Creates metadata which are hidden before the data part
+ * of the image. The layout of metadata is described in README.
+ * 
+ * @param im image into which data will be hidden, its `chunk_size`,
+ * `flags` and `extra_metadata` are stored
+ * @param data_size size of the data part hidden into the image
+ * @param id id of hidding
+ * @param seq data part index
+ * 
+ * @return metadata of size `im.metadata_size()`
+ */
+std::vector<uint8_t> make_metadata(
+    const bmp_image &im,
+    uint32_t data_size,
+    uint8_t id,
+    uint8_t seq
+);
+
+/**
+ * @brief Checks and loads extracted metadata into image struct.
+ * 
+ * @param im in-out parameter, after the call `id`, `seq`, `hidden_data_size`,
+ * `chunk_size`, `cells_per_byte` and `flags` will be set
+ * @param metadata extracted metadata of size `HIDDEN_METADATA_SIZE`,
+ * extra metadata are not parsed (see `bmp_image::metadata_size`)
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` otherwise
+ */
+bool parse_metadata(
+    bmp_image &im,
+    std::span<const uint8_t> metadata,
+    std::ostream &err
+);
+
+/**
+ * @brief Returns how many bytes of extra metadata have to be extracted next.
+ * Extra metadata are extracted in parts, because the extended flags, which
+ * are the first byte of extra metadata, determine the size of the rest.
+ * `parse_extra_metadata` has to be called after each part.
+ * 
+ * @param im image with parsed metadata and extra metadata extracted so far
+ * in `extra_metadata`
+ * 
+ * @return size of the next part, 0 if all extra metadata were extracted
+ */
+std::size_t missing_extra_metadata(const bmp_image &im);
+
+/**
+ * @brief Loads extended flags from extra metadata extracted so far
+ * and checks them.
+ * 
+ * @return `true` on success, `false` if the flags are not supported
+ */
+bool parse_extra_metadata(bmp_image &im, std::ostream &err);
+
+/**
+ * @brief Creates extra metadata which hold the given flags, fields of extra
+ * metadata are zeroed.
+ * 
+ * @param flags flags, `MD_FLAG_EXTENDED` is added if extended flags are used
+ */
+void init_extra_metadata(bmp_image &im, uint16_t flags);
+
+/**
+ * @brief Returns the field of extra metadata present due to the flag
+ * (`MD_FLAG_ENCRYPTED` for nonce, `MD_FLAG_CHECKSUM` for checksum).
+ */
+std::span<uint8_t> extra_metadata_field(bmp_image &im, uint16_t flag);
+std::span<const uint8_t> extra_metadata_field(const bmp_image &im, uint16_t flag);
+
+/**
+ * @brief Returns checksum of the data part stored in the metadata.
+ */
+uint32_t metadata_checksum(const bmp_image &im);
+
+/**
+ * @brief Stores checksum of the data part into the metadata.
+ */
+void set_metadata_checksum(bmp_image &im, uint32_t checksum);
+
+/**
+ * @brief Numbers of carriers of a hiding with parity carriers, data carriers
+ * have seq from 0, parity carriers follow them.
+ */
+struct carrier_counts {
+    std::size_t data{0};
+    std::size_t parity{0};
+};
+
+/**
+ * @brief Returns numbers of carriers stored in the metadata of an image
+ * with `MD_FLAG_PARITY`.
+ */
+carrier_counts metadata_carriers(const bmp_image &im);
+
+/**
+ * @brief Stores numbers of carriers into the metadata, each of them has
+ * to be less than `MAX_IMAGES`.
+ */
+void set_metadata_carriers(bmp_image &im, carrier_counts carriers);
+
+/**
+ * @brief Returns the parity header of a parity carrier stored in the metadata,
+ * it is zeroed in data carriers, see `encode_parity`.
+ */
+std::span<uint8_t> metadata_parity_header(bmp_image &im);
+std::span<const uint8_t> metadata_parity_header(const bmp_image &im);
+
+#endif  // METADATA_H
@@ -0,0 +1,30 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @brief Returns the default number of worker threads, which is the number
+ * of hardware threads, but at least 1.
+ */
+std::size_t default_jobs();
+
+/**
+ * @brief Calls `fn` for every index from 0 to `count - 1` using at most
+ * `jobs` worker threads. Indices are handed out in ascending order, so
+ * a worker always takes the lowest index which was not processed yet.
+ * The function returns after all calls have finished.
+ * 
+ * @param count number of indices to be processed
+ * @param jobs maximum number of worker threads, `0` is treated as `1`
+ * @param fn function called for each index, it has to be safe to call it
+ * from multiple threads at the same time (with different indices)
+ */
+void parallel_for(
+    std::size_t count,
+    std::size_t jobs,
+    const std::function<void(std::size_t)> &fn
+);
+
+#endif  // PARALLEL_H
@@ -0,0 +1,119 @@
+#ifndef PARITY_H
+#define PARITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "bitmap.h"
+#include "extract.h"
+
+/**
+ * @brief Multiplies two elements of GF(256) (polynomial 0x11d).
+ */
+uint8_t gf_mul(uint8_t a, uint8_t b);
+
+/**
+ * @brief Returns the multiplicative inverse of a nonzero element of GF(256).
+ */
+uint8_t gf_inv(uint8_t a);
+
+/**
+ * @brief Adds `coef * src` to `dst` in GF(256), byte by byte, `src` can be
+ * shorter than `dst`. The product is looked up in tables of both nibbles,
+ * 16 or 32 bytes at once by SSSE3/AVX2 shuffles when the CPU supports them.
+ */
+void gf_mul_add(std::span<uint8_t> dst, std::span<const uint8_t> src, uint8_t coef);
+
+/**
+ * @brief Computes the same as `gf_mul_add` without using special instructions.
+ */
+void gf_mul_add_portable(
+    std::span<uint8_t> dst,
+    std::span<const uint8_t> src,
+    uint8_t coef
+);
+
+/* bytes at the start of each parity part which code sizes of data parts,
+ * they are stored in the metadata of parity carriers, so parity carriers
+ * need the same capacity as the largest data part */
+const std::size_t PARITY_HEADER_SIZE = 4;
+
+/**
+ * @brief Computes parity parts of data parts by systematic Reed-Solomon code
+ * with Cauchy matrix, any `parts.size()` parts out of data and parity parts
+ * are enough to rebuild all data parts. Each data part is coded together
+ * with its size, so a rebuilt part knows its size.
+ * 
+ * @param parts data parts, at most `MAX_IMAGES - count` of them
+ * @param count number of parity parts
+ * 
+ * @return parity parts, each of them starts with the parity header
+ * (`PARITY_HEADER_SIZE` bytes) followed by bytes as long as the largest
+ * data part
+ */
+std::vector<std::vector<uint8_t>> encode_parity(
+    const std::vector<std::span<const uint8_t>> &parts,
+    std::size_t count
+);
+
+/**
+ * @brief Rebuilds missing data parts from the others and the parity parts.
+ * 
+ * @param parts data parts, missing ones are empty optionals and will be set
+ * @param parity parity parts in their order (with headers), missing ones
+ * are empty optionals
+ * 
+ * @return `true` on success, `false` if there are not enough parity parts
+ * or they are inconsistent
+ */
+bool rebuild_parts(
+    std::vector<std::optional<std::vector<uint8_t>>> &parts,
+    const std::vector<std::optional<std::vector<uint8_t>>> &parity
+);
+
+/**
+ * Checks whether some data carriers of a hiding with parity carriers are
+ * missing, otherwise parity carriers are removed from the session.
+ * 
+ * @param images images of the session
+ * @param indx indices of images sorted by seq (see `order_session`),
+ * parity carriers are removed if they are not needed
+ * 
+ * @return `true` if data parts have to be rebuilt (`rebuild_message`)
+ */
+bool data_carriers_missing(
+    const std::vector<bmp_image> &images,
+    std::vector<std::size_t> &indx
+);
+
+/**
+ * Reads the stored (encrypted, compressed) data parts of all present carriers
+ * and rebuilds the missing data parts. Carriers whose checksum does not match
+ * are treated as missing. Images which are not held in memory already are
+ * read into memory one by one, so they have to be seekable.
+ * 
+ * @param images images of the session with extracted metadata
+ * @param indx indices of images sorted by seq
+ * @param decoding decoding of the session, its scatter key is used
+ * @param message stored data parts of all data carriers will be stored here,
+ * in order, interleaved data parts are reordered into the stored message
+ * @param err output stream for error logging
+ * @param files whole image files indexed like `images` if they are held
+ * in memory already
+ * 
+ * @return `true` on success, `false` otherwise
+ */
+bool rebuild_message(
+    std::vector<bmp_image> &images,
+    const std::vector<std::size_t> &indx,
+    const data_decoding &decoding,
+    std::vector<uint8_t> &message,
+    std::ostream &err,
+    std::span<const std::vector<std::byte>> files = {}
+);
+
+#endif  // PARITY_H
@@ -0,0 +1,67 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <vector>
+
+/**
+ * @brief How carriers of a hiding are selected from the given images.
+ */
+enum class carrier_selection {
+    /* images are used in the given order */
+    ORDER,
+    /* the smallest number of images, the largest ones are used first */
+    FEWEST_CARRIERS,
+    /* the smallest number of pixel bytes of used images, so the least data
+     * are read and written */
+    FEWEST_BYTES,
+};
+
+/**
+ * @brief Image which can be used as a carrier, known from its header only.
+ */
+struct carrier_candidate {
+    /* byte capacity with the encoding of the message applied */
+    std::size_t capacity{0};
+    /* size of pixel data, which have to be read and written if it is used */
+    std::size_t cost{0};
+};
+
+/**
+ * @brief Carriers selected for a message.
+ */
+struct carrier_plan {
+    /* indices of candidates in the order in which they are used, data
+     * carriers first, parity carriers after them */
+    std::vector<std::size_t> order{};
+    std::size_t data_count{0};
+};
+
+/**
+ * @brief Selects carriers of a message before any of them is opened,
+ * so a message which does not fit is rejected without writing anything.
+ * Data parts fill carriers in the order of the plan, each parity carrier
+ * needs the capacity of the largest data part.
+ * 
+ * @param candidates images which can be used
+ * @param data_size size of the encoded message
+ * @param parity_count number of parity carriers
+ * @param selection how carriers are selected
+ * @param plan selected carriers
+ * @param err output stream for error logging
+ * 
+ * @return `true` on success, `false` if the message does not fit into
+ * `MAX_IMAGES` candidates or there are not enough candidates for parity
+ */
+bool select_carriers(
+    std::span<const carrier_candidate> candidates,
+    std::size_t data_size,
+    std::size_t parity_count,
+    carrier_selection selection,
+    carrier_plan &plan,
+    std::ostream &err = std::cerr
+);
+
+#endif  // PLANNER_H
@@ -0,0 +1,83 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "bitmap.h"
+
+/* bytes at the start of an image file which are read ahead, the header
+ * and the first pixel rows */
+const std::size_t PREFETCH_WINDOW = 1 << 20;
+
+/**
+ * @brief Asks the kernel to read the start of the image file into the page
+ * cache in the background, so the image does not wait for the storage when
+ * it is opened later. Images which are streamed (see `is_streamed`) or have
+ * an assigned input stream are not hinted.
+ * 
+ * @param im image with loaded header
+ * @param window bytes at the start of the file which are read ahead, at most
+ * the size of the image file
+ * 
+ * @return `true` if the read-ahead was started, `false` if the image can not
+ * be hinted or its file could not be opened
+ */
+bool prefetch_image(const bmp_image &im, std::size_t window = PREFETCH_WINDOW);
+
+/**
+ * @brief Reads ahead the images which follow the image being processed
+ * by a serial hiding or extraction, so the latency of opening and reading
+ * each file (spinning disks, network filesystems) overlaps with the work
+ * on the previous images. Each image is hinted once, when it gets among
+ * the `depth` images following the current one.
+ */
+class image_prefetcher {
+public:
+    /**
+     * @param depth number of images read ahead of the current one, `0`
+     * for no read-ahead
+     * @param memory_limit bytes which can be read ahead at the same time,
+     * the window of each image shrinks so `depth` windows fit, `0` for
+     * `PREFETCH_WINDOW` per image
+     */
+    explicit image_prefetcher(std::size_t depth = 0,
+                              std::size_t memory_limit = 0);
+
+    /**
+     * @brief Reads ahead the images which follow the current one and were
+     * not hinted yet.
+     *
+     * @param images images of the run
+     * @param current position of the image being processed
+     * @param order indices into `images` in the order in which they are
+     * processed, empty if they are processed in the order of `images`
+     */
+    void advance(
+        const std::vector<bmp_image> &images,
+        std::size_t current,
+        std::span<const std::size_t> order = {}
+    );
+
+    /**
+     * @brief Starts reading ahead from the first image again, when the images
+     * are processed once more (extraction reads metadata and then data).
+     */
+    void restart();
+
+    /**
+     * @brief Returns the number of images for which the read-ahead
+     * was started.
+     */
+    std::size_t hinted() const;
+
+private:
+    std::size_t depth;
+    std::size_t window;
+    /* position of the first image which was not hinted yet */
+    std::size_t next{0};
+    std::size_t hinted_images{0};
+};
+
+#endif  // PREFETCH_H
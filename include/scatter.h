@@ -0,0 +1,66 @@
+#ifndef SCATTER_H
+#define SCATTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "bitmap.h"
+#include "crypto.h"
+
+/**
+ * @brief Keyed pseudo-random order of data cells of an image, used to spread
+ * hidden data over the whole image.
+ * 
+ * Data cells are split into blocks of `SCATTER_BLOCK_CELLS` cells. The order
+ * of the blocks and the order of cells inside each block are permuted by
+ * Feistel networks. Consecutive data cells therefore stay in one block, which
+ * spans only a few pages of the pixel data, so hiding and extraction keep
+ * close to sequential memory access. Cells after the last full block form
+ * a smaller block which stays at the end.
+ */
+class cell_scatter {
+public:
+    /**
+     * @param key secret key, the order is derived from it
+     * @param im image with loaded header and flags, cells from
+     * `im.data_start_cell()` to the last cell are permuted
+     */
+    cell_scatter(const key_type &key, const bmp_image &im);
+
+    /**
+     * @brief Returns the cell where the data cell with the given index
+     * is placed.
+     * 
+     * @param index index of data cell, less than `cell_count()`
+     */
+    std::size_t operator()(std::size_t index) const;
+
+    /**
+     * @brief Returns number of permuted cells.
+     */
+    std::size_t cell_count() const;
+
+private:
+    /* permutation of [0, size) */
+    struct feistel {
+        std::size_t size{0};
+        /* bits of one half of the domain, the domain is the smallest power
+         * of 4 which is not smaller than `size` */
+        unsigned half_bits{0};
+
+        explicit feistel(std::size_t size);
+        std::size_t permute(std::size_t index, uint64_t tweak,
+                            const std::array<uint64_t, 4> &keys) const;
+    };
+
+    std::array<uint64_t, 4> keys{};
+    std::size_t first_cell;
+    std::size_t count;
+    std::size_t full_blocks;
+    feistel blocks;
+    feistel block_cells;
+    feistel tail_cells;
+};
+
+#endif  // SCATTER_H
@@ -0,0 +1,91 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <iostream>
+
+/**
+ * @brief Statistics of a single worker of `work_stealing_scheduler`.
+ */
+struct worker_stats {
+    /* number of jobs run by the worker, stolen ones included */
+    std::size_t executed{0};
+    /* number of jobs stolen from queues of other workers */
+    std::size_t stolen{0};
+    /* time spent running jobs */
+    std::chrono::nanoseconds busy{0};
+};
+
+/**
+ * @brief Writes statistics of workers, one line per worker.
+ */
+void print_worker_stats(std::ostream &os, const std::vector<worker_stats> &stats);
+
+/**
+ * @brief Scheduler running jobs on a fixed number of workers. Each worker
+ * has its own queue. A worker runs the most recently added jobs from its own
+ * queue first, and when the queue is empty, it steals the oldest job from
+ * the queue of another worker, so no worker stays idle while there is work.
+ * Workers which find no job sleep until a job is added or all jobs finish.
+ */
+class work_stealing_scheduler {
+public:
+    using job = std::function<void()>;
+
+    /**
+     * @param workers number of workers, `0` is treated as `1`
+     */
+    explicit work_stealing_scheduler(std::size_t workers);
+
+    /**
+     * @brief Adds a job. When called from a running job, the job is added to
+     * the queue of the current worker, otherwise jobs are distributed among
+     * the queues evenly. Outside of jobs, it must not be called from multiple
+     * threads at the same time.
+     */
+    void spawn(job j);
+
+    /**
+     * @brief Runs all added jobs, including jobs spawned by them, and returns
+     * after all of them finished. The calling thread is used as one
+     * of the workers.
+     */
+    void run();
+
+    /**
+     * @brief Returns statistics of workers, accumulated over all `run` calls.
+     */
+    const std::vector<worker_stats> &stats() const;
+
+private:
+    struct worker_queue {
+        std::mutex mutex{};
+        std::deque<job> jobs{};
+    };
+
+    bool pop(std::size_t worker, job &j);
+    bool steal(std::size_t thief, job &j);
+    void work(std::size_t worker);
+    void wake(bool all);
+
+    std::vector<std::unique_ptr<worker_queue>> queues{};
+    std::vector<worker_stats> workers_stats{};
+    /* jobs which were added and did not finish yet */
+    std::atomic<std::size_t> pending{0};
+    /* jobs which were added and were not taken by a worker yet */
+    std::atomic<std::size_t> queued{0};
+    /* idle workers wait for `queued` jobs or for `pending` to reach 0 */
+    std::mutex idle_mutex{};
+    std::condition_variable idle{};
+    std::size_t next_queue{0};
+};
+
+#endif  // SCHEDULER_H
@@ -0,0 +1,74 @@
+#ifndef STRIPES_H
+#define STRIPES_H
+
+#include <vector>
+#include <iostream>
+
+#include "bitmap.h"
+#include "extract.h"
+#include "hide.h"
+#include "scheduler.h"
+
+/**
+ * @brief Returns number of data bytes hidden in one stripe of the image.
+ * A stripe covers whole rows, about `STRIPE_CELLS` cells, so stripes of
+ * images with different widths take roughly the same time.
+ */
+std::size_t stripe_bytes(const bmp_image &im);
+
+/**
+ * @brief Hides message (data) into images in parallel. Data is split among
+ * images the same way as by `hide`, then each image is read into memory and
+ * its data part is hidden stripe by stripe, stripes are jobs of the
+ * scheduler, so large images are processed by all workers. An image is
+ * written as soon as all its stripes are done.
+ * 
+ * All used images are held in memory during the hiding, unless
+ * `options.memory_limit` is set, then an image is read only when it fits
+ * into the memory left by the message and freed once it is written.
+ * 
+ * @param images vector of images, where text will be hidden
+ * @param data input stream of the message file
+ * @param scheduler scheduler which runs the stripes, its statistics
+ * can be checked afterwards
+ * @param out output stream for info logging
+ * @param err output stream for error logging
+ * @param options optional stages applied to the message
+ * 
+ * @return 0 on success, 1 if the full message could not be hidden
+ * due to small images sizes, 2 in case of stream errors
+ */
+int hide_in_stripes(
+    std::vector<bmp_image> &images,
+    std::istream &data,
+    work_stealing_scheduler &scheduler,
+    std::ostream &out = std::cout,
+    std::ostream &err = std::cerr,
+    const hide_options &options = {}
+);
+
+/**
+ * @brief Extracts hidden data from images in parallel. Images are read into
+ * memory in parallel, then their data parts are extracted stripe by stripe
+ * directly to their place in the message, which is written (decompressed
+ * if needed) at the end. With `options.memory_limit`, images are read
+ * for their metadata and for their data separately, each time only when
+ * they fit into the limit.
+ * 
+ * @param images vector of images, where the data are hidden
+ * @param data_ostream where the data will be written
+ * @param scheduler scheduler which runs the stripes
+ * @param err output stream for error logging
+ * @param options options of extraction
+ * 
+ * @return 0 on success, 1 on failure
+ */
+int extract_in_stripes(
+    std::vector<bmp_image> &images,
+    std::ostream &data_ostream,
+    work_stealing_scheduler &scheduler,
+    std::ostream &err = std::cerr,
+    const extract_options &options = {}
+);
+
+#endif  // STRIPES_H
@@ -0,0 +1,41 @@
+#ifndef UPDATE_H
+#define UPDATE_H
+
+#include <iostream>
+#include <vector>
+
+#include "bitmap.h"
+#include "extract.h"
+
+/**
+ * @brief Replaces the message hidden in images by a new one, rewriting
+ * the image files in place. The new message is encoded the same way as
+ * the hidden one (the same nonce, key and stages from metadata) and split
+ * among the images the same way as by `hide`, then the stored data of each
+ * image are compared with the new data block by block and only blocks which
+ * differ are hidden again. Only pages of the image files which were changed
+ * are written, so appending to or patching a large message rewrites only
+ * a few small ranges.
+ * 
+ * Images which are not necessary for the new message keep an empty data part,
+ * so the session stays complete. Parity images are updated as well.
+ * 
+ * @param images all images of the hiding, in any order, they have to be
+ * seekable files (or have both streams assigned)
+ * @param data_in input stream of the new message
+ * @param out output stream for info logging
+ * @param err output stream for error logging
+ * @param options options with the key, if the hidden data are encrypted
+ * 
+ * @return 0 on success, 1 if the images do not form a complete session
+ * or the new message does not fit, 2 in case of stream errors
+ */
+int update(
+    std::vector<bmp_image> &images,
+    std::istream &data_in,
+    std::ostream &out = std::cout,
+    std::ostream &err = std::cerr,
+    const extract_options &options = {}
+);
+
+#endif  // UPDATE_H
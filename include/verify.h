@@ -0,0 +1,35 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include "bitmap.h"
+#include "extract.h"
+
+/**
+ * @brief Checks integrity of data hidden in images without writing them
+ * anywhere. Stored data of each image are checksummed and compared with
+ * the checksum in its metadata, nothing is decrypted or decompressed, so
+ * the key is needed only for scattered data. Images are checked in parallel
+ * and the result of each image is reported in the order of images.
+ * 
+ * @param images images with loaded headers
+ * @param jobs maximum number of worker threads
+ * @param options options with the key, used for scattered data
+ * @param out output stream for results of images
+ * @param err output stream for error logging
+ * 
+ * @return 0 if data in all images are intact, 1 if some image could not be
+ * checked, does not belong to the session or its checksum does not match
+ */
+int verify(
+    std::vector<bmp_image> &images,
+    std::size_t jobs,
+    const extract_options &options,
+    std::ostream &out = std::cout,
+    std::ostream &err = std::cerr
+);
+
+#endif  // VERIFY_H
@@ -0,0 +1,70 @@
+#include "async.h"
+
+#include "hide.h"
+#include "extract.h"
+
+thread_pool_executor::thread_pool_executor(std::size_t threads) {
+    for (std::size_t _ = 0; _ < std::max<std::size_t>(threads, 1); ++_)
+        this->threads.emplace_back([this]() { run(); });
+}
+
+thread_pool_executor::~thread_pool_executor() {
+    {
+        std::lock_guard lock{mutex};
+        stopping = true;
+    }
+    cv.notify_all();
+    threads.clear();
+}
+
+void thread_pool_executor::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard lock{mutex};
+        queue.push_back(handle);
+    }
+    cv.notify_one();
+}
+
+void thread_pool_executor::run() {
+    while (true) {
+        std::coroutine_handle<> handle;
+        {
+            std::unique_lock lock{mutex};
+            cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            handle = queue.front();
+            queue.pop_front();
+        }
+        handle.resume();
+    }
+}
+
+task<int> async_hide(
+    executor &ex,
+    std::vector<bmp_image> &images,
+    std::istream &data,
+    std::ostream &out,
+    std::ostream &err,
+    const hide_options &options
+) {
+    hide_session session{images, data, out, err, options};
+    do {
+        co_await next_block{ex};
+    } while (session.step());
+    co_return session.result();
+}
+
+task<int> async_extract(
+    executor &ex,
+    std::vector<bmp_image> &images,
+    std::ostream &data_ostream,
+    std::ostream &err,
+    const extract_options &options
+) {
+    extract_session session{images, data_ostream, err, options};
+    do {
+        co_await next_block{ex};
+    } while (session.step());
+    co_return session.result();
+}
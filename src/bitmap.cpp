@@ -15,6 +15,10 @@ bmp_image::bmp_image(const std::string &filename, uint8_t chunk_size)
     , cells_per_byte(8 / chunk_size) {}
 
 bool bmp_image::assign_input() {
+    if (filename == STDIO_FILENAME) {
+        this->input = std::make_unique<std::istream>(std::cin.rdbuf());
+        return true;
+    }
     auto ifstream = std::make_unique<std::ifstream>(filename, std::ios::binary);
     if (ifstream == nullptr || !ifstream->is_open() || !ifstream->good()) {
         return false;
@@ -46,15 +50,28 @@ static uint8_t count_padding(auto width, auto channels) {
 }
 
 bool bmp_image::load_header(std::ostream &err) {
-    const auto smaller_header_size = 14u;
-    header.resize(smaller_header_size);
+    header.resize(BMP_FILE_HEADER_SIZE);
 
     if (!input->read(reinterpret_cast<char *>(header.data()),
-                     smaller_header_size)) {
+                     BMP_FILE_HEADER_SIZE)) {
+        err << "there was an error while reading file " << filename
+            << ", bytes read: " << input->gcount() << '\n';
+        return false;
+    }
+    if (!parse_file_header(err))
+        return false;
+
+    header.resize(data_offset);
+    if (!input->read(reinterpret_cast<char *>(header.data()) + BMP_FILE_HEADER_SIZE,
+                       data_offset - BMP_FILE_HEADER_SIZE)) {
         err << "there was an error while reading file " << filename
             << ", bytes read: " << input->gcount() << '\n';
         return false;
     }
+    return parse_info_header(err);
+}
+
+bool bmp_image::parse_file_header(std::ostream &err) {
     if (header[0] != 'B' || header[1] != 'M') {
         err << "file " << filename << " has invalid magic number to be bmp file"
                " (expected BM, got " << header[0] << header[1] << ")\n";
@@ -62,7 +79,8 @@ bool bmp_image::load_header(std::ostream &err) {
     }
 
     data_offset = to_uint32(header.data() + 10);
-    if (data_offset <= smaller_header_size) {
+    /* the info header has to fit in front of the data */
+    if (data_offset < BMP_FILE_HEADER_SIZE + BMP_INFO_HEADER_SIZE) {
         err << "data offset in header of " << filename
             << " is too small to be bmp\n";
         return false;
@@ -74,14 +92,10 @@ bool bmp_image::load_header(std::ostream &err) {
             << " is smaller than data offset\n";
         return false;
     }
+    return true;
+}
 
-    header.resize(data_offset);
-    if (!input->read(reinterpret_cast<char *>(header.data()) + smaller_header_size,
-                       data_offset - smaller_header_size)) {
-        err << "there was an error while reading file " << filename
-            << ", bytes read: " << input->gcount() << '\n';
-        return false;
-    }
+bool bmp_image::parse_info_header(std::ostream &err) {
     width = to_uint32(header.data() + 18);
     height = to_uint32(header.data() + 22);
 
@@ -92,7 +106,7 @@ bool bmp_image::load_header(std::ostream &err) {
         return false;
     }
     channel_count = bit_count / 8;
-    capacity = width * channel_count * height;
+    capacity = static_cast<std::size_t>(width) * channel_count * height;
     /* 4 * because chunk_size for metadata will be always 2 */
     if (capacity <= 4 * HIDDEN_METADATA_SIZE) {
         err << "file " << filename << " is too small to hide any data\n";
@@ -113,6 +127,9 @@ bool bmp_image::load_header(std::ostream &err) {
 std::string bmp_image::get_output_path() {
     using namespace std::string_literals;
 
+    if (!output_path.empty())
+        return output_path;
+
     auto basename_index = filename.rfind('/');
     if (basename_index == std::string::npos)
         basename_index = 0;
@@ -131,6 +148,10 @@ bool bmp_image::write_header_to_output() {
 }
 
 bool bmp_image::assign_output() {
+    if (get_output_path() == STDIO_FILENAME) {
+        this->output = std::make_unique<std::ostream>(std::cout.rdbuf());
+        return true;
+    }
     auto ofstream = std::make_unique<std::ofstream>(
         get_output_path(), std::ios::binary);
     if (ofstream == nullptr || !ofstream->is_open() || !ofstream->good()) {
@@ -145,16 +166,68 @@ bool bmp_image::assign_output(std::unique_ptr<std::ostream> output) {
     return this->output != nullptr;
 }
 
+bool bmp_image::open_input() {
+    if (input)
+        return true;
+    input_opened = assign_input();
+    return input_opened;
+}
+
+bool bmp_image::open_output() {
+    if (output)
+        return true;
+    output_opened = assign_output();
+    return output_opened && write_header_to_output();
+}
+
+void bmp_image::close() {
+    if (input_opened)
+        input.reset();
+    if (output_opened) {
+        output->flush();
+        output.reset();
+    }
+    input_opened = false;
+    output_opened = false;
+}
+
 auto bmp_image::operator<=>(const bmp_image &rhs) const {
     return this->seq <=> rhs.seq;
 }
 
 void bmp_image::set_data_start() {
+    if (!seekable)
+        return;
     this->input->seekg(this->data_offset, std::ios::beg);
 }
 
 std::size_t bmp_image::byte_capacity() const {
-    return capacity / cells_per_byte;
+    auto extra_cells = data_start_cell() - HIDDEN_METADATA_CELLS;
+    if (capacity <= extra_cells)
+        return 0;
+    return (capacity - extra_cells) / cells_per_byte;
+}
+
+std::size_t bmp_image::metadata_size() const {
+    auto size = HIDDEN_METADATA_SIZE;
+    if (flags & MD_FLAG_EXTENDED)
+        ++size;
+    if (flags & MD_FLAG_ENCRYPTED)
+        size += MD_NONCE_SIZE;
+    if (flags & MD_FLAG_CHECKSUM)
+        size += MD_CHECKSUM_SIZE;
+    if (flags & MD_FLAG_PARITY)
+        size += MD_CARRIERS_SIZE;
+    return size;
+}
+
+std::size_t bmp_image::data_start_cell() const {
+    return metadata_size() * 8 / MD_CHUNK_SIZE;
+}
+
+std::size_t bmp_image::cell_offset(std::size_t cell) const {
+    std::size_t row_size = static_cast<std::size_t>(width) * channel_count;
+    return (cell / row_size) * (row_size + padding) + cell % row_size;
 }
 
 bmp_image_buffer::bmp_image_buffer(bmp_image &im, uint8_t chunk_size)
@@ -168,8 +241,13 @@ bool bmp_image_buffer::hide_chunk(uint8_t chunk) {
     if (!move_index([this]() { return write_and_read(); }))
         return false;
 
+    auto before = static_cast<uint8_t>(buffer[index]);
     buffer[index] &= erase_mask;
-    buffer[index++] |= chunk;
+    buffer[index] |= chunk;
+    if (im.distortion)
+        im.distortion->add(x % im.channel_count, before,
+                           static_cast<uint8_t>(buffer[index]));
+    ++index;
     ++x;
     return true;
 }
@@ -189,7 +267,24 @@ void bmp_image_buffer::change_chunk_size(uint8_t chunk_size) {
 }
 
 void bmp_image_buffer::copy_rest() {
-    while (write_and_read()) {}
+    while (copy_block()) {}
+}
+
+bool bmp_image_buffer::copy_block() {
+    return write_and_read();
+}
+
+bool bmp_image_buffer::seek_cell(std::size_t cell) {
+    im.input->clear();
+    if (!im.input->seekg(im.data_offset + im.cell_offset(cell), std::ios::beg))
+        return false;
+
+    index = 0;
+    loaded = 0;
+    x = static_cast<uint32_t>(
+        cell % (static_cast<std::size_t>(im.width) * im.channel_count));
+    skip = 0;
+    return true;
 }
 
 bool bmp_image_buffer::read() {
@@ -0,0 +1,58 @@
+#include "budget.h"
+
+#include <vector>
+
+static void memory_limit_log(
+    std::ostream &os,
+    std::size_t limit,
+    std::size_t needed
+) {
+    os << "memory limit of " << limit << " bytes is too small, at least "
+       << needed << " bytes are needed\n";
+}
+
+bool check_memory_limit(
+    std::size_t limit,
+    std::size_t needed,
+    std::ostream &err
+) {
+    if (limit == 0 || needed <= limit)
+        return true;
+    memory_limit_log(err, limit, needed);
+    return false;
+}
+
+memory_budget::memory_budget(std::size_t limit, std::function<void(job)> start)
+    : limit(limit)
+    , start(std::move(start)) {}
+
+void memory_budget::submit(std::size_t bytes, job j) {
+    {
+        std::lock_guard lock{mutex};
+        auto fits = limit == 0 || reserved == 0 || reserved + bytes <= limit;
+        /* jobs are started in order, so a large job is not starved */
+        if (!waiting.empty() || !fits) {
+            waiting.emplace_back(bytes, std::move(j));
+            return;
+        }
+        reserved += bytes;
+    }
+    start(std::move(j));
+}
+
+void memory_budget::release(std::size_t bytes) {
+    std::vector<job> ready{};
+    {
+        std::lock_guard lock{mutex};
+        reserved -= bytes;
+        while (!waiting.empty() && (reserved == 0 ||
+                                    reserved + waiting.front().first <= limit)) {
+            reserved += waiting.front().first;
+            ready.push_back(std::move(waiting.front().second));
+            waiting.pop_front();
+        }
+    }
+    /* jobs are started without the lock, they may submit other jobs */
+    for (auto &j : ready)
+        start(std::move(j));
+}
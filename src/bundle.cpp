@@ -0,0 +1,299 @@
+#include "bundle.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#include "configuration.h"
+#include "extract.h"
+#include "metadata.h"
+
+static const uint8_t BUNDLE_VERSION = 1;
+
+static void read_error_log(std::ostream &os, std::string_view path) {
+    os << "file " << path << " could not be read\n";
+}
+
+static void duplicate_name_log(std::ostream &os, std::string_view name) {
+    os << "file name " << name << " is used more than once in the bundle\n";
+}
+
+static void name_too_long_log(std::ostream &os, std::string_view name) {
+    os << "file name " << name << " is too long for the bundle\n";
+}
+
+static void not_bundle_log(std::ostream &os) {
+    os << "hidden data are not a bundle\n";
+}
+
+static void corrupted_toc_log(std::ostream &os) {
+    os << "table of contents of the bundle is corrupted\n";
+}
+
+static void write_error_log(std::ostream &os, std::string_view path) {
+    os << "file " << path << " could not be written\n";
+}
+
+static void missing_file_log(std::ostream &os, std::string_view name) {
+    os << "file " << name << " is not in the bundle\n";
+}
+
+static void put_le(std::string &out, uint64_t value, std::size_t size) {
+    for (auto _ = 0u; _ < size; ++_) {
+        out.push_back(static_cast<char>(value & 0xffu));
+        value >>= 8;
+    }
+}
+
+static uint64_t get_le(std::span<const uint8_t> bytes) {
+    uint64_t value = 0;
+    for (auto i = bytes.size(); i-- > 0;)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+bool write_bundle(
+    const std::vector<std::string> &paths,
+    std::ostream &out,
+    std::ostream &err
+) {
+    std::string toc{};
+    std::set<std::string> names{};
+    for (auto &path : paths) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        if (ec) {
+            read_error_log(err, path);
+            return false;
+        }
+        auto name = std::filesystem::path(path).filename().string();
+        if (!names.insert(name).second) {
+            duplicate_name_log(err, name);
+            return false;
+        }
+        if (name.size() > UINT16_MAX) {
+            name_too_long_log(err, name);
+            return false;
+        }
+        put_le(toc, name.size(), 2);
+        toc += name;
+        put_le(toc, size, 8);
+    }
+
+    std::string header{'S', 'B', static_cast<char>(BUNDLE_VERSION), '\0'};
+    put_le(header, paths.size(), 4);
+    put_le(header, toc.size(), 4);
+    out.write(header.data(), header.size());
+    out.write(toc.data(), toc.size());
+
+    /* file data are copied block by block, sizes were checked above */
+    std::vector<char> block(BUFFER_SIZE);
+    for (auto &path : paths) {
+        std::ifstream file{path, std::ios::binary};
+        auto expected = std::filesystem::file_size(path);
+        uint64_t copied = 0;
+        while (file.read(block.data(), block.size()) || file.gcount() > 0) {
+            out.write(block.data(), file.gcount());
+            copied += file.gcount();
+        }
+        if (!file.eof() || copied != expected) {
+            read_error_log(err, path);
+            return false;
+        }
+    }
+    return out.good();
+}
+
+bool parse_bundle_header(
+    std::span<const uint8_t> header,
+    std::size_t &entries_size,
+    std::ostream &err
+) {
+    if (header.size() < BUNDLE_HEADER_SIZE || header[0] != 'S' ||
+        header[1] != 'B' || header[2] != BUNDLE_VERSION) {
+        not_bundle_log(err);
+        return false;
+    }
+    entries_size = get_le(header.subspan(8, 4));
+    return true;
+}
+
+bool parse_bundle_toc(
+    std::span<const uint8_t> toc,
+    std::vector<bundle_entry> &entries,
+    std::ostream &err
+) {
+    std::size_t entries_size;
+    if (!parse_bundle_header(toc, entries_size, err))
+        return false;
+    if (toc.size() - BUNDLE_HEADER_SIZE < entries_size) {
+        corrupted_toc_log(err);
+        return false;
+    }
+    auto count = get_le(toc.subspan(4, 4));
+    auto rest = toc.subspan(BUNDLE_HEADER_SIZE, entries_size);
+    uint64_t offset = BUNDLE_HEADER_SIZE + entries_size;
+
+    entries.clear();
+    for (auto _ = 0u; _ < count; ++_) {
+        if (rest.size() < 2) {
+            corrupted_toc_log(err);
+            return false;
+        }
+        auto name_size = get_le(rest.first(2));
+        if (rest.size() < 2 + name_size + 8) {
+            corrupted_toc_log(err);
+            return false;
+        }
+        auto name = rest.subspan(2, name_size);
+        auto size = get_le(rest.subspan(2 + name_size, 8));
+        entries.push_back({std::string(name.begin(), name.end()), offset, size});
+        offset += size;
+        rest = rest.subspan(2 + name_size + 8);
+    }
+    if (!rest.empty()) {
+        corrupted_toc_log(err);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks that the name is a plain file name, so files of a bundle
+ * can not be written outside the directory.
+ */
+static bool plain_name(const std::string &name) {
+    return !name.empty() && name != "." && name != ".." &&
+           name.find('/') == std::string::npos &&
+           name.find('\\') == std::string::npos;
+}
+
+int unpack_bundle(
+    std::span<const uint8_t> bundle,
+    const std::string &directory,
+    std::ostream &out,
+    std::ostream &err
+) {
+    std::vector<bundle_entry> entries{};
+    if (!parse_bundle_toc(bundle, entries, err))
+        return 1;
+    for (auto &entry : entries) {
+        if (!plain_name(entry.name) || entry.offset > bundle.size() ||
+            entry.size > bundle.size() - entry.offset) {
+            corrupted_toc_log(err);
+            return 1;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    for (auto &entry : entries) {
+        auto path = (std::filesystem::path(directory) / entry.name).string();
+        std::ofstream file{path, std::ios::binary};
+        auto data = bundle.subspan(entry.offset, entry.size);
+        file.write(reinterpret_cast<const char *>(data.data()), data.size());
+        if (!file.good()) {
+            write_error_log(err, path);
+            return 2;
+        }
+    }
+    out << entries.size() << " files were extracted into " << directory
+        << '\n';
+    return 0;
+}
+
+static std::span<const uint8_t> as_bytes(const std::string &data) {
+    return {reinterpret_cast<const uint8_t *>(data.data()), data.size()};
+}
+
+/**
+ * @brief Extracts the whole bundle and writes only the requested file.
+ */
+static int extract_whole_bundle_file(
+    std::vector<bmp_image> &images,
+    const std::string &name,
+    std::ostream &data_ostream,
+    std::ostream &err,
+    const extract_options &options
+) {
+    std::stringstream bundle{};
+    if (auto res = extract(images, bundle, err, options))
+        return res;
+    auto data = bundle.str();
+    std::vector<bundle_entry> entries{};
+    if (!parse_bundle_toc(as_bytes(data), entries, err))
+        return 1;
+    auto entry = std::ranges::find(entries, name, &bundle_entry::name);
+    if (entry == entries.end()) {
+        missing_file_log(err, name);
+        return 1;
+    }
+    if (entry->offset > data.size() ||
+        entry->size > data.size() - entry->offset) {
+        corrupted_toc_log(err);
+        return 1;
+    }
+    data_ostream.write(data.data() + entry->offset, entry->size);
+    return 0;
+}
+
+/**
+ * @brief Checks whether the range of the bundle can be extracted, ranges
+ * of compressed data can not be extracted and images which can not seek
+ * can be read only once.
+ */
+static bool ranges_supported(std::vector<bmp_image> &images, std::ostream &err) {
+    if (std::ranges::any_of(images, [](auto &im) { return !im.seekable; }))
+        return false;
+    auto &im = images[0];
+    if (!im.open_input())
+        return false;
+    bmp_image_buffer buffer{im, MD_CHUNK_SIZE};
+    auto extracted = extract_hidden_metadata(im, buffer, err);
+    im.close();
+    return extracted && !(im.flags & MD_FLAG_COMPRESSED);
+}
+
+int extract_bundle_file(
+    std::vector<bmp_image> &images,
+    const std::string &name,
+    std::ostream &data_ostream,
+    std::ostream &err,
+    const extract_options &options
+) {
+    if (!ranges_supported(images, err))
+        return extract_whole_bundle_file(images, name, data_ostream, err,
+                                         options);
+
+    std::stringstream header{};
+    if (auto res = extract_range(images, 0, BUNDLE_HEADER_SIZE, header, err,
+                                 options))
+        return res;
+    std::size_t entries_size;
+    auto toc = header.str();
+    if (!parse_bundle_header(as_bytes(toc), entries_size, err))
+        return 1;
+
+    std::stringstream entries_data{};
+    if (entries_size > 0) {
+        if (auto res = extract_range(images, BUNDLE_HEADER_SIZE,
+                                     entries_size, entries_data, err, options))
+            return res;
+    }
+    toc += entries_data.str();
+    std::vector<bundle_entry> entries{};
+    if (!parse_bundle_toc(as_bytes(toc), entries, err))
+        return 1;
+
+    auto entry = std::ranges::find(entries, name, &bundle_entry::name);
+    if (entry == entries.end()) {
+        missing_file_log(err, name);
+        return 1;
+    }
+    if (entry->size == 0)
+        return 0;
+    return extract_range(images, entry->offset, entry->size, data_ostream, err,
+                         options);
+}
@@ -0,0 +1,295 @@
+#include "catalog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "configuration.h"
+#include "loader.h"
+#include "parallel.h"
+
+static const uint32_t CATALOG_VERSION = 1;
+static const std::size_t CATALOG_HEADER_SIZE = 16;
+static const std::size_t CATALOG_ENTRY_SIZE = 48;
+
+static void invalid_catalog_log(std::ostream &os, std::string_view path) {
+    os << "file " << path << " is not a valid carrier catalog\n";
+}
+
+static void could_not_open_log(std::ostream &os, std::string_view path) {
+    os << "catalog " << path << " could not be opened\n";
+}
+
+static void write_error_log(std::ostream &os, std::string_view path) {
+    os << "catalog " << path << " could not be written\n";
+}
+
+static void stat_error_log(std::ostream &os, std::string_view path) {
+    os << "image " << path << " could not be opened\n";
+}
+
+static void indexed_log(
+    std::ostream &os,
+    std::string_view path,
+    std::size_t images,
+    std::size_t read
+) {
+    os << "catalog " << path << " holds " << images << " images, "
+       << read << " of them were read\n";
+}
+
+static uint64_t get_le(const uint8_t *data, std::size_t size) {
+    uint64_t value = 0;
+    for (auto i = size; i-- > 0;)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+static void put_le(std::string &out, uint64_t value, std::size_t size) {
+    for (auto _ = 0u; _ < size; ++_) {
+        out.push_back(static_cast<char>(value & 0xffu));
+        value >>= 8;
+    }
+}
+
+/**
+ * @brief Reads modification time and size of the file, without opening it.
+ */
+static bool file_stamp(const std::string &path, int64_t &mtime, uint64_t &size) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+    mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 +
+            st.st_mtim.tv_nsec;
+    size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+std::size_t catalog_entry::byte_capacity(uint8_t chunk_size) const {
+    return capacity / (8 / chunk_size);
+}
+
+carrier_catalog::carrier_catalog(carrier_catalog &&other) noexcept
+    : data(std::exchange(other.data, nullptr))
+    , data_size(std::exchange(other.data_size, 0))
+    , count(std::exchange(other.count, 0)) {}
+
+carrier_catalog &carrier_catalog::operator=(carrier_catalog &&other) noexcept {
+    std::swap(data, other.data);
+    std::swap(data_size, other.data_size);
+    std::swap(count, other.count);
+    return *this;
+}
+
+carrier_catalog::~carrier_catalog() {
+    if (data)
+        munmap(const_cast<uint8_t *>(data), data_size);
+}
+
+bool carrier_catalog::open(const std::string &path, std::ostream &err) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        could_not_open_log(err, path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        static_cast<std::size_t>(st.st_size) < CATALOG_HEADER_SIZE) {
+        close(fd);
+        invalid_catalog_log(err, path);
+        return false;
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    auto mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        could_not_open_log(err, path);
+        return false;
+    }
+
+    auto bytes = static_cast<const uint8_t *>(mapped);
+    auto entries = get_le(bytes + 8, 8);
+    if (std::memcmp(bytes, "SHCT", 4) != 0 ||
+        get_le(bytes + 4, 4) != CATALOG_VERSION ||
+        entries > (size - CATALOG_HEADER_SIZE) / CATALOG_ENTRY_SIZE) {
+        munmap(mapped, size);
+        invalid_catalog_log(err, path);
+        return false;
+    }
+
+    if (data)
+        munmap(const_cast<uint8_t *>(data), data_size);
+    data = bytes;
+    data_size = size;
+    count = entries;
+    return true;
+}
+
+std::size_t carrier_catalog::size() const {
+    return count;
+}
+
+catalog_entry carrier_catalog::entry(std::size_t index) const {
+    auto bytes = data + CATALOG_HEADER_SIZE + index * CATALOG_ENTRY_SIZE;
+    catalog_entry entry{};
+    /* entries are checked when they are used, so opening does not touch
+     * the whole file, entries pointing outside of it are left empty */
+    auto path_offset = get_le(bytes, 8);
+    auto header_offset = get_le(bytes + 16, 8);
+    if (path_offset > data_size ||
+        get_le(bytes + 8, 4) > data_size - path_offset ||
+        header_offset > data_size ||
+        get_le(bytes + 12, 4) > data_size - header_offset)
+        return entry;
+    entry.path = std::string_view(
+        reinterpret_cast<const char *>(data + path_offset),
+        get_le(bytes + 8, 4));
+    entry.header = std::span(data + header_offset, get_le(bytes + 12, 4));
+    entry.mtime = static_cast<int64_t>(get_le(bytes + 24, 8));
+    entry.file_size = get_le(bytes + 32, 8);
+    entry.capacity = get_le(bytes + 40, 8);
+    return entry;
+}
+
+std::optional<catalog_entry> carrier_catalog::find(std::string_view path) const {
+    std::size_t low = 0;
+    std::size_t high = count;
+    while (low < high) {
+        auto middle = low + (high - low) / 2;
+        auto candidate = entry(middle);
+        if (candidate.path == path)
+            return candidate;
+        if (candidate.path < path)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return std::nullopt;
+}
+
+bool carrier_catalog::load(bmp_image &im, std::ostream &err) const {
+    auto found = find(im.filename);
+    int64_t mtime;
+    uint64_t size;
+    if (!found || !file_stamp(im.filename, mtime, size) ||
+        found->mtime != mtime || found->file_size != size)
+        return false;
+    im.header.assign(found->header.begin(), found->header.end());
+    return im.header.size() >= BMP_FILE_HEADER_SIZE &&
+           im.parse_file_header(err) &&
+           im.header.size() == im.data_offset &&
+           im.parse_info_header(err);
+}
+
+/* entry of the catalog which is being built */
+struct indexed_image {
+    int64_t mtime{0};
+    uint64_t file_size{0};
+    uint64_t capacity{0};
+    std::vector<uint8_t> header{};
+    bool read{false};
+};
+
+/**
+ * @brief Writes the catalog, `images` are sorted by path.
+ */
+static bool write_catalog(
+    const std::string &path,
+    const std::vector<std::pair<std::string, indexed_image>> &images
+) {
+    std::string entries{};
+    std::string blob{};
+    auto blob_offset = CATALOG_HEADER_SIZE + images.size() * CATALOG_ENTRY_SIZE;
+    for (auto &[name, image] : images) {
+        put_le(entries, blob_offset + blob.size(), 8);
+        put_le(entries, name.size(), 4);
+        put_le(entries, image.header.size(), 4);
+        blob += name;
+        put_le(entries, blob_offset + blob.size(), 8);
+        blob.append(image.header.begin(), image.header.end());
+        put_le(entries, static_cast<uint64_t>(image.mtime), 8);
+        put_le(entries, image.file_size, 8);
+        put_le(entries, image.capacity, 8);
+    }
+    std::string header{"SHCT"};
+    put_le(header, CATALOG_VERSION, 4);
+    put_le(header, images.size(), 8);
+
+    auto tmp_path = path + ".tmp";
+    {
+        std::ofstream file{tmp_path, std::ios::binary};
+        file << header << entries << blob;
+        if (!file.good())
+            return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    return !ec;
+}
+
+int build_catalog(
+    const std::string &catalog_path,
+    const std::vector<std::string> &paths,
+    std::size_t jobs,
+    std::ostream &out,
+    std::ostream &err
+) {
+    std::vector<std::string> sorted = paths;
+    std::ranges::sort(sorted);
+    auto [first, last] = std::ranges::unique(sorted);
+    sorted.erase(first, last);
+
+    /* an invalid old catalog is reported and rebuilt from scratch */
+    carrier_catalog old{};
+    if (std::filesystem::exists(catalog_path))
+        old.open(catalog_path, err);
+
+    std::vector<std::optional<indexed_image>> indexed(sorted.size());
+    std::vector<std::ostringstream> errors(sorted.size());
+    parallel_for(sorted.size(), jobs, [&](std::size_t i) {
+        indexed_image image{};
+        if (!file_stamp(sorted[i], image.mtime, image.file_size)) {
+            stat_error_log(errors[i], sorted[i]);
+            return;
+        }
+        auto found = old.find(sorted[i]);
+        if (found && found->mtime == image.mtime &&
+            found->file_size == image.file_size) {
+            image.header.assign(found->header.begin(), found->header.end());
+            image.capacity = found->capacity;
+            indexed[i] = std::move(image);
+            return;
+        }
+        bmp_image im(sorted[i], MD_CHUNK_SIZE);
+        if (!probe_header(im, errors[i]))
+            return;
+        image.header = std::move(im.header);
+        image.capacity = im.capacity;
+        image.read = true;
+        indexed[i] = std::move(image);
+    });
+
+    std::vector<std::pair<std::string, indexed_image>> images{};
+    std::size_t read = 0;
+    for (auto i = 0u; i < sorted.size(); ++i) {
+        err << errors[i].str();
+        if (!indexed[i])
+            continue;
+        read += indexed[i]->read;
+        images.emplace_back(std::move(sorted[i]), std::move(*indexed[i]));
+    }
+    if (!write_catalog(catalog_path, images)) {
+        write_error_log(err, catalog_path);
+        return 2;
+    }
+    indexed_log(out, catalog_path, images.size(), read);
+    return 0;
+}
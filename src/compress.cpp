@@ -0,0 +1,226 @@
+#include "compress.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "configuration.h"
+
+/*
+ * LZ block format, a sequence of:
+ * 
+ *   1 byte   token, high 4 bits literal count, low 4 bits match length
+ *            minus MIN_MATCH, value 15 means the length continues
+ *   ...      literal count continuation, bytes are added while they are 255
+ *   ...      literals
+ *   2 bytes  match offset (little endian), distance back in the output
+ *   ...      match length continuation
+ * 
+ * The last sequence has only literals, the block ends right after them.
+ */
+
+static constexpr std::size_t MIN_MATCH = 4;
+static constexpr std::size_t MAX_OFFSET = 0xffff;
+static constexpr std::size_t HASH_BITS = 14;
+static constexpr std::size_t BLOCK_HEADER_SIZE = 8;
+/* how many misses in a row make the search skip bytes in incompressible data */
+static constexpr std::size_t SKIP_TRIGGER = 6;
+
+static uint32_t read32(const uint8_t *data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static uint32_t to_uint32(const uint8_t *data) {
+    return static_cast<uint32_t>(data[0]) |
+           (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+}
+
+static void put_uint32(std::vector<uint8_t> &out, std::size_t value) {
+    for (auto _ = 0u; _ < sizeof(uint32_t); ++_) {
+        out.push_back(static_cast<uint8_t>(value & 0xffu));
+        value >>= 8;
+    }
+}
+
+static std::size_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void write_length(std::vector<uint8_t> &out, std::size_t length) {
+    for (; length >= 255; length -= 255)
+        out.push_back(255);
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+static void write_sequence(
+    std::vector<uint8_t> &out,
+    std::span<const uint8_t> literals,
+    std::size_t offset,
+    std::size_t match
+) {
+    auto token = static_cast<uint8_t>(std::min<std::size_t>(literals.size(), 15) << 4);
+    if (match > 0)
+        token |= static_cast<uint8_t>(std::min<std::size_t>(match - MIN_MATCH, 15));
+    out.push_back(token);
+    if (literals.size() >= 15)
+        write_length(out, literals.size() - 15);
+    out.insert(out.end(), literals.begin(), literals.end());
+    if (match == 0)
+        return;
+
+    out.push_back(static_cast<uint8_t>(offset & 0xffu));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (match - MIN_MATCH >= 15)
+        write_length(out, match - MIN_MATCH - 15);
+}
+
+static void compress_block(
+    std::span<const uint8_t> in,
+    std::vector<uint32_t> &table,
+    std::vector<uint8_t> &out
+) {
+    std::ranges::fill(table, 0);
+    std::size_t anchor = 0;
+    std::size_t pos = 0;
+    std::size_t misses = 0;
+
+    while (pos + MIN_MATCH <= in.size()) {
+        auto sequence = read32(in.data() + pos);
+        auto &entry = table[hash(sequence)];
+        std::size_t candidate = entry;
+        entry = static_cast<uint32_t>(pos);
+
+        if (candidate >= pos || pos - candidate > MAX_OFFSET ||
+            read32(in.data() + candidate) != sequence) {
+            pos += 1 + (misses++ >> SKIP_TRIGGER);
+            continue;
+        }
+
+        auto length = MIN_MATCH;
+        while (pos + length < in.size() && in[candidate + length] == in[pos + length])
+            ++length;
+        write_sequence(out, in.subspan(anchor, pos - anchor), pos - candidate, length);
+        pos += length;
+        anchor = pos;
+        misses = 0;
+    }
+    write_sequence(out, in.subspan(anchor), 0, 0);
+}
+
+std::vector<uint8_t> compress(std::span<const uint8_t> data) {
+    std::vector<uint8_t> out{};
+    std::vector<uint8_t> block{};
+    std::vector<uint32_t> table(std::size_t{1} << HASH_BITS);
+
+    for (std::size_t offset = 0; offset < data.size();
+         offset += COMPRESSION_BLOCK_SIZE) {
+        auto in = data.subspan(offset,
+            std::min(COMPRESSION_BLOCK_SIZE, data.size() - offset));
+        block.clear();
+        compress_block(in, table, block);
+
+        put_uint32(out, in.size());
+        if (block.size() >= in.size()) {
+            put_uint32(out, in.size());
+            out.insert(out.end(), in.begin(), in.end());
+        } else {
+            put_uint32(out, block.size());
+            out.insert(out.end(), block.begin(), block.end());
+        }
+    }
+    return out;
+}
+
+static bool read_length(
+    std::span<const uint8_t> in,
+    std::size_t &pos,
+    std::size_t &length
+) {
+    while (pos < in.size()) {
+        auto byte = in[pos++];
+        length += byte;
+        if (byte != 255)
+            return true;
+    }
+    return false;
+}
+
+static bool decompress_block(
+    std::span<const uint8_t> in,
+    std::span<uint8_t> out
+) {
+    std::size_t pos = 0;
+    std::size_t written = 0;
+
+    while (pos < in.size()) {
+        auto token = in[pos++];
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !read_length(in, pos, literals))
+            return false;
+        if (literals > in.size() - pos || literals > out.size() - written)
+            return false;
+        std::memcpy(out.data() + written, in.data() + pos, literals);
+        pos += literals;
+        written += literals;
+
+        if (pos == in.size())
+            return (token & 0x0f) == 0 && written == out.size();
+
+        if (in.size() - pos < 2)
+            return false;
+        std::size_t offset = in[pos] | (static_cast<std::size_t>(in[pos + 1]) << 8);
+        pos += 2;
+        std::size_t match = (token & 0x0f) + MIN_MATCH;
+        if ((token & 0x0f) == 15 && !read_length(in, pos, match))
+            return false;
+        if (offset == 0 || offset > written || match > out.size() - written)
+            return false;
+
+        /* matches can overlap with the bytes they produce */
+        auto from = written - offset;
+        if (offset >= match) {
+            std::memcpy(out.data() + written, out.data() + from, match);
+        } else {
+            for (std::size_t i = 0; i < match; ++i)
+                out[written + i] = out[from + i];
+        }
+        written += match;
+    }
+    return false;
+}
+
+bool decompressor::write(std::span<const uint8_t> data, std::ostream &os) {
+    pending.insert(pending.end(), data.begin(), data.end());
+
+    std::size_t consumed = 0;
+    while (pending.size() - consumed >= BLOCK_HEADER_SIZE) {
+        auto header = pending.data() + consumed;
+        std::size_t raw_size = to_uint32(header);
+        std::size_t stored_size = to_uint32(header + 4);
+        if (raw_size == 0 || raw_size > COMPRESSION_BLOCK_SIZE ||
+            stored_size > raw_size)
+            return false;
+        if (pending.size() - consumed - BLOCK_HEADER_SIZE < stored_size)
+            break;
+
+        std::span stored(header + BLOCK_HEADER_SIZE, stored_size);
+        if (stored_size == raw_size) {
+            os.write(reinterpret_cast<const char *>(stored.data()), stored.size());
+        } else {
+            block.resize(raw_size);
+            if (!decompress_block(stored, block))
+                return false;
+            os.write(reinterpret_cast<const char *>(block.data()), block.size());
+        }
+        consumed += BLOCK_HEADER_SIZE + stored_size;
+    }
+    pending.erase(pending.begin(), pending.begin() + consumed);
+    return true;
+}
+
+bool decompressor::finished() const {
+    return pending.empty();
+}
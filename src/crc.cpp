@@ -0,0 +1,71 @@
+#include "crc.h"
+
+#include <array>
+#include <cstring>
+
+/* reflected Castagnoli polynomial */
+static constexpr uint32_t CRC32C_POLY = 0x82f63b78;
+
+/* tables for slicing by 8 bytes, `table[k][b]` is the crc of byte `b`
+ * followed by `k` zero bytes */
+static constexpr auto CRC32C_TABLES = [] {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t b = 0; b < 256; ++b) {
+        auto crc = b;
+        for (auto _ = 0; _ < 8; ++_)
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+        tables[0][b] = crc;
+    }
+    for (auto k = 1u; k < 8; ++k)
+        for (auto b = 0u; b < 256; ++b)
+            tables[k][b] = (tables[k - 1][b] >> 8)
+                           ^ tables[0][tables[k - 1][b] & 0xff];
+    return tables;
+}();
+
+static uint32_t update_portable(uint32_t crc, const uint8_t *data, std::size_t size) {
+    const auto &t = CRC32C_TABLES;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) |
+                              (static_cast<uint32_t>(data[1]) << 8) |
+                              (static_cast<uint32_t>(data[2]) << 16) |
+                              (static_cast<uint32_t>(data[3]) << 24));
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff]
+              ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24]
+              ^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    }
+    for (; size > 0; --size, ++data)
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+    return crc;
+}
+
+uint32_t crc32c_portable(std::span<const uint8_t> data, uint32_t crc) {
+    return ~update_portable(~crc, data.data(), data.size());
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHARKY_CRC32C_SSE42
+
+__attribute__((target("sse4.2")))
+static uint32_t update_sse42(uint32_t crc, const uint8_t *data, std::size_t size) {
+    uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = __builtin_ia32_crc32di(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+    for (; size > 0; --size, ++data)
+        crc = __builtin_ia32_crc32qi(crc, *data);
+    return crc;
+}
+#endif
+
+uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc) {
+#ifdef SHARKY_CRC32C_SSE42
+    static const bool sse42 = __builtin_cpu_supports("sse4.2");
+    if (sse42)
+        return ~update_sse42(~crc, data.data(), data.size());
+#endif
+    return crc32c_portable(data, crc);
+}
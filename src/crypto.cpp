@@ -0,0 +1,273 @@
+#include "crypto.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/* number of ChaCha20 blocks generated at once, the block function works on
+ * all of them in lock step, each word of the state in a vector register */
+static constexpr std::size_t LANES = 8;
+static constexpr std::size_t CHACHA_BLOCK_SIZE = 64;
+
+/* the block function is compiled for AVX2 (one 256 bit register per word)
+ * as well as for the baseline (two 128 bit registers), the variant is picked
+ * at runtime on x86-64 */
+#if defined(__x86_64__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define SHARKY_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#ifndef SHARKY_TARGET_CLONES
+#define SHARKY_TARGET_CLONES
+#endif
+
+static uint32_t rotr(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static uint32_t to_uint32(const uint8_t *data) {
+    return static_cast<uint32_t>(data[0]) |
+           (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+}
+
+static uint32_t to_uint32_be(const uint8_t *data) {
+    return (static_cast<uint32_t>(data[0]) << 24) |
+           (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) |
+           static_cast<uint32_t>(data[3]);
+}
+
+static constexpr std::array<uint32_t, 64> SHA256_K = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static void sha256_block(std::array<uint32_t, 8> &h, const uint8_t *block) {
+    std::array<uint32_t, 64> w;
+    for (auto i = 0u; i < 16; ++i)
+        w[i] = to_uint32_be(block + 4 * i);
+    for (auto i = 16u; i < 64; ++i) {
+        auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, k] = h;
+    for (auto i = 0u; i < 64; ++i) {
+        auto s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        auto ch = (e & f) ^ (~e & g);
+        auto t1 = k + s1 + ch + SHA256_K[i] + w[i];
+        auto s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        auto maj = (a & b) ^ (a & c) ^ (b & c);
+        auto t2 = s0 + maj;
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += k;
+}
+
+static constexpr std::array<uint32_t, 8> SHA256_INIT = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+/**
+ * @brief Finishes SHA-256 of a message whose first `absorbed` bytes
+ * (whole blocks) were already compressed into `h`.
+ */
+static std::array<uint8_t, 32> sha256_finish(
+    std::array<uint32_t, 8> h,
+    std::span<const uint8_t> data,
+    uint64_t absorbed
+) {
+    std::size_t full = data.size() / 64 * 64;
+    for (std::size_t i = 0; i < full; i += 64)
+        sha256_block(h, data.data() + i);
+
+    /* the rest, 0x80 and the message length in bits */
+    std::array<uint8_t, 128> tail{};
+    auto rest = data.size() - full;
+    std::memcpy(tail.data(), data.data() + full, rest);
+    tail[rest] = 0x80;
+    auto tail_size = rest + 9 <= 64 ? 64u : 128u;
+    uint64_t bits = (absorbed + data.size()) * 8;
+    for (auto i = 0u; i < 8; ++i)
+        tail[tail_size - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+    for (auto i = 0u; i < tail_size; i += 64)
+        sha256_block(h, tail.data() + i);
+
+    std::array<uint8_t, 32> digest;
+    for (auto i = 0u; i < 8; ++i)
+        for (auto j = 0u; j < 4; ++j)
+            digest[4 * i + j] = static_cast<uint8_t>(h[i] >> (24 - 8 * j));
+    return digest;
+}
+
+std::array<uint8_t, 32> sha256(std::span<const uint8_t> data) {
+    return sha256_finish(SHA256_INIT, data, 0);
+}
+
+key_type pbkdf2_hmac_sha256(
+    std::string_view passphrase,
+    std::span<const uint8_t> salt,
+    std::size_t iterations
+) {
+    /* HMAC keys longer than a block are hashed first */
+    std::array<uint8_t, 64> hmac_key{};
+    auto key_bytes = std::span(reinterpret_cast<const uint8_t *>(
+                                   passphrase.data()), passphrase.size());
+    if (key_bytes.size() > hmac_key.size())
+        std::ranges::copy(sha256(key_bytes), hmac_key.begin());
+    else
+        std::ranges::copy(key_bytes, hmac_key.begin());
+
+    /* the padded keys are compressed once, every HMAC continues from them */
+    auto inner = SHA256_INIT;
+    auto outer = SHA256_INIT;
+    std::array<uint8_t, 64> pad;
+    for (auto i = 0u; i < pad.size(); ++i)
+        pad[i] = hmac_key[i] ^ 0x36;
+    sha256_block(inner, pad.data());
+    for (auto i = 0u; i < pad.size(); ++i)
+        pad[i] = hmac_key[i] ^ 0x5c;
+    sha256_block(outer, pad.data());
+    auto hmac = [&](std::span<const uint8_t> message) {
+        return sha256_finish(outer, sha256_finish(inner, message, 64), 64);
+    };
+
+    /* a single output block, its index is 1 */
+    std::vector<uint8_t> first(salt.begin(), salt.end());
+    first.insert(first.end(), {0, 0, 0, 1});
+    auto u = hmac(first);
+    auto key = u;
+    for (std::size_t _ = 1; _ < iterations; ++_) {
+        u = hmac(u);
+        for (auto i = 0u; i < key.size(); ++i)
+            key[i] ^= u[i];
+    }
+    return key;
+}
+
+key_type derive_key(std::string_view passphrase, const nonce_type &nonce) {
+    return pbkdf2_hmac_sha256(passphrase, nonce, KEY_DERIVATION_ITERATIONS);
+}
+
+nonce_type generate_nonce() {
+    std::random_device device{};
+    nonce_type nonce;
+    for (auto &byte : nonce)
+        byte = static_cast<uint8_t>(device());
+    return nonce;
+}
+
+chacha20::chacha20(const key_type &key, const nonce_type &nonce) {
+    /* "expand 32-byte k" */
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (auto i = 0u; i < 8; ++i)
+        state[4 + i] = to_uint32(key.data() + 4 * i);
+    /* state[12] is the block counter */
+    for (auto i = 0u; i < 3; ++i)
+        state[13 + i] = to_uint32(nonce.data() + 4 * i);
+}
+
+/* one word of the state in each of `LANES` blocks, a vector of the GCC/Clang
+ * vector extensions, so every operation of the quarter-round is a single SIMD
+ * instruction on AVX2 and two on SSE2 */
+typedef uint32_t lanes __attribute__((vector_size(LANES * sizeof(uint32_t))));
+
+#define ROTL_LANES(v, bits) (((v) << (bits)) | ((v) >> (32 - (bits))))
+
+static inline void quarter_round(lanes &a, lanes &b, lanes &c, lanes &d) {
+    a += b; d = ROTL_LANES(d ^ a, 16);
+    c += d; b = ROTL_LANES(b ^ c, 12);
+    a += b; d = ROTL_LANES(d ^ a, 8);
+    c += d; b = ROTL_LANES(b ^ c, 7);
+}
+
+/**
+ * @brief Generates `LANES` consecutive keystream blocks starting
+ * with the given block counter.
+ */
+SHARKY_TARGET_CLONES
+static void chacha20_blocks(
+    const std::array<uint32_t, 16> &state,
+    uint32_t counter,
+    uint8_t *keystream
+) {
+    std::array<lanes, 16> x;
+    for (auto i = 0u; i < 16; ++i)
+        x[i] = lanes{} + state[i];
+    for (auto l = 0u; l < LANES; ++l)
+        x[12][l] = counter + l;
+    auto initial = x;
+
+    for (auto _ = 0; _ < 10; ++_) {
+        quarter_round(x[0], x[4], x[8], x[12]);
+        quarter_round(x[1], x[5], x[9], x[13]);
+        quarter_round(x[2], x[6], x[10], x[14]);
+        quarter_round(x[3], x[7], x[11], x[15]);
+        quarter_round(x[0], x[5], x[10], x[15]);
+        quarter_round(x[1], x[6], x[11], x[12]);
+        quarter_round(x[2], x[7], x[8], x[13]);
+        quarter_round(x[3], x[4], x[9], x[14]);
+    }
+
+    for (auto i = 0u; i < 16; ++i)
+        x[i] += initial[i];
+    for (auto l = 0u; l < LANES; ++l) {
+        for (auto i = 0u; i < 16; ++i) {
+            uint32_t word = x[i][l];
+            auto out = keystream + l * CHACHA_BLOCK_SIZE + 4 * i;
+            for (auto j = 0u; j < 4; ++j)
+                out[j] = static_cast<uint8_t>(word >> (8 * j));
+        }
+    }
+}
+
+void chacha20::apply(std::span<uint8_t> data, uint64_t offset) const {
+    assert(offset <= CHACHA_MAX_MESSAGE_SIZE &&
+           data.size() <= CHACHA_MAX_MESSAGE_SIZE - offset);
+    std::array<uint8_t, LANES * CHACHA_BLOCK_SIZE> keystream;
+    auto counter = static_cast<uint32_t>(offset / CHACHA_BLOCK_SIZE);
+    auto skip = offset % CHACHA_BLOCK_SIZE;
+
+    std::size_t done = 0;
+    while (done < data.size()) {
+        chacha20_blocks(state, counter, keystream.data());
+        counter += LANES;
+        auto size = std::min(keystream.size() - skip, data.size() - done);
+        for (std::size_t i = 0; i < size; ++i)
+            data[done + i] ^= keystream[skip + i];
+        done += size;
+        skip = 0;
+    }
+}
@@ -0,0 +1,427 @@
+#include "daemon.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <span>
+#include <streambuf>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "bitmap.h"
+
+static void socket_error_log(std::ostream &os, std::string_view path) {
+    os << "could not listen on socket " << path << ": "
+       << std::strerror(errno) << '\n';
+}
+
+static void socket_used_log(std::ostream &os, std::string_view path) {
+    os << "socket " << path << " is used by a running daemon\n";
+}
+
+static void not_socket_log(std::ostream &os, std::string_view path) {
+    os << "path " << path << " exists and is not a socket\n";
+}
+
+static void path_too_long_log(std::ostream &os, std::string_view path) {
+    os << "socket path " << path << " is too long\n";
+}
+
+static void connect_error_log(std::ostream &os, std::string_view path) {
+    os << "could not connect to the daemon on socket " << path << ": "
+       << std::strerror(errno) << '\n';
+}
+
+static void request_error_log(std::ostream &os) {
+    os << "request could not be sent to the daemon or it did not answer\n";
+}
+
+static void request_too_large_log(std::ostream &os) {
+    os << "arguments of the request are larger than "
+       << DAEMON_MAX_REQUEST_SIZE << " bytes\n";
+}
+
+/**
+ * @brief Stream buffer reading or writing a file descriptor it does not own.
+ * It can not seek, so the data are read block by block.
+ */
+class fd_streambuf : public std::streambuf {
+public:
+    explicit fd_streambuf(int fd) : fd(fd) {
+        setp(out.data(), out.data() + out.size());
+    }
+
+    ~fd_streambuf() override {
+        flush_buffer();
+    }
+
+protected:
+    int_type underflow() override {
+        ssize_t size;
+        do {
+            size = ::read(fd, in.data(), in.size());
+        } while (size < 0 && errno == EINTR);
+        if (size <= 0)
+            return traits_type::eof();
+        setg(in.data(), in.data(), in.data() + size);
+        return traits_type::to_int_type(in[0]);
+    }
+
+    int_type overflow(int_type ch) override {
+        if (!flush_buffer())
+            return traits_type::eof();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override {
+        return flush_buffer() ? 0 : -1;
+    }
+
+private:
+    bool flush_buffer() {
+        auto data = pbase();
+        auto size = static_cast<std::size_t>(pptr() - pbase());
+        setp(out.data(), out.data() + out.size());
+        while (size > 0) {
+            auto written = ::write(fd, data, size);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    int fd;
+    std::array<char, BUFFER_SIZE> in{};
+    std::array<char, BUFFER_SIZE> out{};
+};
+
+static bool socket_address(
+    const std::string &path,
+    sockaddr_un &address,
+    std::ostream &err
+) {
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        path_too_long_log(err, path);
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+static bool read_all(int fd, char *data, std::size_t size) {
+    while (size > 0) {
+        auto received = ::read(fd, data, size);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+static bool write_all(int fd, const char *data, std::size_t size) {
+    while (size > 0) {
+        auto sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+static void put32(char *at, uint32_t value) {
+    for (auto i = 0; i < 4; ++i)
+        at[i] = static_cast<char>(value >> (8 * i));
+}
+
+static uint32_t get32(const char *at) {
+    uint32_t value = 0;
+    for (auto i = 0; i < 4; ++i)
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(at[i])) << (8 * i);
+    return value;
+}
+
+daemon_server::daemon_server(daemon_handler handler, std::size_t workers)
+    : handler(std::move(handler))
+    , buffers(std::max<std::size_t>(workers, 1)) {
+    for (auto i = 0u; i < buffers.size(); ++i)
+        this->workers.emplace_back([this, i]() { work(i); });
+}
+
+daemon_server::~daemon_server() {
+    {
+        std::lock_guard lock{mutex};
+        closing = true;
+    }
+    cv.notify_all();
+    workers.clear();
+    for (auto connection : connections)
+        ::close(connection);
+    if (listen_fd >= 0)
+        ::close(listen_fd);
+}
+
+bool daemon_server::listen(const std::string &socket_path, std::ostream &err) {
+    sockaddr_un address;
+    if (!socket_address(socket_path, address, err))
+        return false;
+
+    /* a socket file nobody listens on is left by a daemon which was killed */
+    auto probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        auto connected = ::connect(probe, reinterpret_cast<sockaddr *>(&address),
+                                   sizeof(address)) == 0;
+        ::close(probe);
+        if (connected) {
+            socket_used_log(err, socket_path);
+            return false;
+        }
+    }
+    struct stat status;
+    if (::lstat(socket_path.c_str(), &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            not_socket_log(err, socket_path);
+            return false;
+        }
+        ::unlink(socket_path.c_str());
+    }
+
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0 ||
+        ::bind(listen_fd, reinterpret_cast<sockaddr *>(&address),
+               sizeof(address)) != 0 ||
+        ::listen(listen_fd, SOMAXCONN) != 0) {
+        socket_error_log(err, socket_path);
+        return false;
+    }
+    this->socket_path = socket_path;
+    return true;
+}
+
+void daemon_server::run() {
+    while (!stopping) {
+        auto connection = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+        {
+            std::lock_guard lock{mutex};
+            connections.push_back(connection);
+        }
+        cv.notify_one();
+    }
+
+    /* requests which were accepted are still served */
+    {
+        std::lock_guard lock{mutex};
+        closing = true;
+    }
+    cv.notify_all();
+    workers.clear();
+    if (!socket_path.empty())
+        ::unlink(socket_path.c_str());
+}
+
+void daemon_server::stop() {
+    stopping = true;
+    if (listen_fd >= 0)
+        ::shutdown(listen_fd, SHUT_RDWR);
+}
+
+void daemon_server::work(std::size_t worker) {
+    while (true) {
+        int connection;
+        {
+            std::unique_lock lock{mutex};
+            cv.wait(lock, [this]() { return closing || !connections.empty(); });
+            if (connections.empty())
+                return;
+            connection = connections.front();
+            connections.pop_front();
+        }
+        serve(connection, buffers[worker]);
+        ::close(connection);
+    }
+}
+
+/**
+ * @brief Receives the header of the request with the passed file descriptors.
+ * Descriptors which do not fit into `fds` are closed, a wrong number
+ * of descriptors or truncated control data are a protocol error.
+ * 
+ * @return `true` on success, descriptors which were received are stored
+ * into `fds` even on failure, so they can be closed
+ */
+static bool receive_header(
+    int connection,
+    std::array<char, DAEMON_HEADER_SIZE> &header,
+    std::array<int, 3> &fds
+) {
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))];
+    iovec io{header.data(), header.size()};
+    msghdr message{};
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    do {
+        received = ::recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+    if (received <= 0)
+        return false;
+
+    std::size_t fd_count = 0;
+    for (auto cmsg = CMSG_FIRSTHDR(&message); cmsg;
+         cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+        auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (auto i = 0u; i < count; ++i, ++fd_count) {
+            int fd;
+            std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (fd_count < fds.size())
+                fds[fd_count] = fd;
+            else
+                ::close(fd);
+        }
+    }
+    if (fd_count != fds.size() || (message.msg_flags & MSG_CTRUNC))
+        return false;
+    return read_all(connection, header.data() + received,
+                    header.size() - received) &&
+           header[0] == 'S' && header[1] == 'D' && header[2] == 1;
+}
+
+/**
+ * @brief Splits the zero terminated strings of the request.
+ */
+static bool parse_request(std::span<const char> arguments, daemon_request &request) {
+    if (arguments.empty() || arguments.back() != '\0')
+        return false;
+    std::vector<std::string> strings{};
+    for (auto begin = arguments.begin(); begin != arguments.end();) {
+        auto end = std::find(begin, arguments.end(), '\0');
+        strings.emplace_back(begin, end);
+        begin = end + 1;
+    }
+    request.cwd = std::move(strings[0]);
+    request.args.assign(std::make_move_iterator(strings.begin() + 1),
+                        std::make_move_iterator(strings.end()));
+    return true;
+}
+
+void daemon_server::serve(int connection, std::vector<char> &arguments) {
+    std::array<char, DAEMON_HEADER_SIZE> header{};
+    std::array<int, 3> fds{-1, -1, -1};
+    auto received = receive_header(connection, header, fds);
+    auto size = get32(header.data() + 4);
+    daemon_request request{};
+    if (received && size <= DAEMON_MAX_REQUEST_SIZE) {
+        arguments.resize(size);
+        received = read_all(connection, arguments.data(), size) &&
+                   parse_request(arguments, request);
+    }
+
+    if (received && size <= DAEMON_MAX_REQUEST_SIZE) {
+        int res;
+        {
+            fd_streambuf in_buffer{fds[0]};
+            fd_streambuf out_buffer{fds[1]};
+            fd_streambuf err_buffer{fds[2]};
+            std::istream in{&in_buffer};
+            std::ostream out{&out_buffer};
+            std::ostream err{&err_buffer};
+            res = handler(request, in, out, err);
+        }
+        std::array<char, 4> response{};
+        put32(response.data(), static_cast<uint32_t>(res));
+        write_all(connection, response.data(), response.size());
+    }
+    for (auto fd : fds)
+        if (fd >= 0)
+            ::close(fd);
+}
+
+int send_request(
+    const std::string &socket_path,
+    const daemon_request &request,
+    std::array<int, 3> fds,
+    std::ostream &err
+) {
+    std::string arguments = request.cwd;
+    arguments.push_back('\0');
+    for (auto &arg : request.args) {
+        arguments += arg;
+        arguments.push_back('\0');
+    }
+    if (arguments.size() > DAEMON_MAX_REQUEST_SIZE) {
+        request_too_large_log(err);
+        return 1;
+    }
+
+    sockaddr_un address;
+    if (!socket_address(socket_path, address, err))
+        return 1;
+    auto connection = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection < 0 ||
+        ::connect(connection, reinterpret_cast<sockaddr *>(&address),
+                  sizeof(address)) != 0) {
+        connect_error_log(err, socket_path);
+        if (connection >= 0)
+            ::close(connection);
+        return 1;
+    }
+
+    std::array<char, DAEMON_HEADER_SIZE> header{'S', 'D', 1, 0};
+    put32(header.data() + 4, static_cast<uint32_t>(arguments.size()));
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+    iovec io{header.data(), header.size()};
+    msghdr message{};
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    auto cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(fds));
+
+    ssize_t sent;
+    do {
+        sent = ::sendmsg(connection, &message, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+
+    std::array<char, 4> response{};
+    auto answered = sent > 0 &&
+        write_all(connection, header.data() + sent, header.size() - sent) &&
+        write_all(connection, arguments.data(), arguments.size()) &&
+        read_all(connection, response.data(), response.size());
+    ::close(connection);
+    if (!answered) {
+        request_error_log(err);
+        return 1;
+    }
+    return static_cast<int>(get32(response.data()));
+}
@@ -0,0 +1,148 @@
+#include "discover.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <tuple>
+
+#include "configuration.h"
+#include "crypto.h"
+#include "metadata.h"
+#include "parallel.h"
+
+bool discovered_hiding::complete() const {
+    if (!duplicate.empty() || images.empty())
+        return false;
+    auto &first = images.front();
+    if (first.flags & MD_FLAG_PARITY)
+        return images.size() >= metadata_carriers(first).data;
+    return missing.empty();
+}
+
+std::vector<image_arg> expand_directories(const std::vector<image_arg> &args) {
+    std::vector<image_arg> expanded{};
+    for (auto &arg : args) {
+        std::error_code ec{};
+        if (!std::filesystem::is_directory(arg.filename, ec)) {
+            expanded.push_back(arg);
+            continue;
+        }
+        std::vector<std::string> files{};
+        for (auto &entry : std::filesystem::directory_iterator(arg.filename, ec))
+            if (entry.is_regular_file(ec))
+                files.push_back(entry.path().string());
+        std::ranges::sort(files);
+        for (auto &file : files)
+            expanded.push_back({file, arg.chunk_size});
+    }
+    return expanded;
+}
+
+/* id, flags, nonce and numbers of data and parity carriers */
+using hiding_key = std::tuple<uint8_t, uint16_t, nonce_type, std::size_t,
+                              std::size_t>;
+
+/**
+ * @brief Returns the key of the hiding to which the carrier belongs,
+ * the nonce and the carrier counts are zeroed unless their flags are set.
+ */
+static hiding_key key_of(const bmp_image &im) {
+    nonce_type nonce{};
+    if (im.flags & MD_FLAG_ENCRYPTED)
+        std::ranges::copy(extra_metadata_field(im, MD_FLAG_ENCRYPTED),
+                          nonce.begin());
+    carrier_counts carriers{};
+    if (im.flags & MD_FLAG_PARITY)
+        carriers = metadata_carriers(im);
+    return {im.id, im.flags, nonce, carriers.data, carriers.parity};
+}
+
+/**
+ * @brief Sorts carriers of the hiding by seq and finds missing
+ * and duplicated seq numbers.
+ */
+static void check_seqs(discovered_hiding &hiding) {
+    std::ranges::stable_sort(hiding.images, {}, &bmp_image::seq);
+    auto &first = hiding.images.front();
+    std::size_t count = hiding.images.back().seq + 1u;
+    if (first.flags & MD_FLAG_PARITY) {
+        auto carriers = metadata_carriers(first);
+        count = std::max(count, carriers.data + carriers.parity);
+    }
+
+    std::vector<std::size_t> found(count, 0);
+    for (auto &im : hiding.images)
+        ++found[im.seq];
+    for (auto seq = 0u; seq < count; ++seq) {
+        if (found[seq] == 0)
+            hiding.missing.push_back(seq);
+        else if (found[seq] > 1)
+            hiding.duplicate.push_back(seq);
+    }
+}
+
+std::vector<discovered_hiding> discover_hidings(
+    const std::vector<image_arg> &args,
+    std::size_t jobs,
+    std::size_t &skipped
+) {
+    std::vector<std::optional<bmp_image>> probed(args.size());
+    parallel_for(args.size(), jobs, [&](std::size_t i) {
+        bmp_image im(args[i].filename, args[i].chunk_size);
+        /* most files of a directory are not carriers, that is no error */
+        std::ostringstream ignored{};
+        if (probe_metadata(im, ignored))
+            probed[i] = std::move(im);
+    });
+
+    std::map<hiding_key, discovered_hiding> groups{};
+    skipped = 0;
+    for (auto &im : probed) {
+        if (!im) {
+            ++skipped;
+            continue;
+        }
+        auto &hiding = groups[key_of(*im)];
+        hiding.id = im->id;
+        hiding.images.push_back(std::move(*im));
+    }
+
+    std::vector<discovered_hiding> hidings{};
+    for (auto &[_, hiding] : groups) {
+        check_seqs(hiding);
+        hidings.push_back(std::move(hiding));
+    }
+    std::ranges::stable_sort(hidings, [](auto &a, auto &b) {
+        return std::tie(a.id, a.images.front().filename) <
+               std::tie(b.id, b.images.front().filename);
+    });
+    return hidings;
+}
+
+static void print_seqs(
+    std::ostream &os,
+    std::string_view what,
+    const std::vector<std::size_t> &seqs
+) {
+    os << ", " << what << " seq";
+    for (auto i = 0u; i < seqs.size(); ++i)
+        os << (i ? "," : " ") << seqs[i];
+}
+
+void print_hidings(
+    std::ostream &os,
+    const std::vector<discovered_hiding> &hidings
+) {
+    for (auto &hiding : hidings) {
+        os << "hiding " << static_cast<int>(hiding.id) << " in "
+           << hiding.images.size() << " image(s): "
+           << (hiding.complete() ? "complete" : "incomplete");
+        if (!hiding.missing.empty())
+            print_seqs(os, "missing", hiding.missing);
+        if (!hiding.duplicate.empty())
+            print_seqs(os, "duplicated", hiding.duplicate);
+        os << '\n';
+    }
+}
@@ -0,0 +1,55 @@
+#include "distortion.h"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+void image_distortion::merge(const image_distortion &other) {
+    for (auto c = 0u; c < MAX_CHANNELS; ++c) {
+        changed[c] += other.changed[c];
+        squared_error[c] += other.squared_error[c];
+        max_delta[c] = std::max(max_delta[c], other.max_delta[c]);
+    }
+}
+
+uint64_t image_distortion::changed_cells() const {
+    return std::accumulate(changed.begin(), changed.end(), uint64_t{0});
+}
+
+double image_distortion::mse() const {
+    if (cells == 0)
+        return 0;
+    auto sum = std::accumulate(squared_error.begin(), squared_error.end(),
+                               uint64_t{0});
+    return static_cast<double>(sum) / static_cast<double>(cells);
+}
+
+double image_distortion::psnr() const {
+    auto error = mse();
+    if (error == 0)
+        return std::numeric_limits<double>::infinity();
+    return 10 * std::log10(255.0 * 255.0 / error);
+}
+
+void write_distortion_header(std::ostream &os) {
+    os << "image\toutput\tchanged\tcells\tmse\tpsnr\tmax_delta\n";
+}
+
+void write_distortion(
+    std::ostream &os,
+    std::string_view carrier,
+    std::string_view output,
+    const image_distortion &distortion
+) {
+    os << carrier << '\t' << output << '\t' << distortion.changed_cells()
+       << '\t' << distortion.cells << '\t' << distortion.mse() << '\t';
+    auto psnr = distortion.psnr();
+    if (std::isinf(psnr))
+        os << "inf";
+    else
+        os << psnr;
+    auto channels = std::min<std::size_t>(distortion.channel_count, MAX_CHANNELS);
+    for (auto c = 0u; c < channels; ++c)
+        os << (c ? ',' : '\t') << static_cast<int>(distortion.max_delta[c]);
+    os << '\n';
+}
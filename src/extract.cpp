@@ -4,12 +4,18 @@
 #include <vector>
 #include <span>
 #include <algorithm>
+#include <filesystem>
 #include <numeric>
+#include <memory>
 #include <iostream>
 
 #include "configuration.h"
 #include "chunker.h"
+#include "crc.h"
 #include "bitmap.h"
+#include "in_memory.h"
+#include "metadata.h"
+#include "parity.h"
 
 static void run_out_of_bytes_error_log(
     std::ostream &os,
@@ -18,16 +24,6 @@ static void run_out_of_bytes_error_log(
     os << "image file " << filename << " run out of bytes too early!\n";
 }
 
-static void invalid_magic_number_log(
-    std::ostream &os,
-    std::string_view filename,
-    uint8_t byte1,
-    uint8_t byte2
-) {
-    os << "image " << filename << " has invalid sharky magic number! ("
-       << std::hex << byte1 << ", " << byte2 << std::dec << ")\n";
-}
-
 static void invalid_seq_number_log(
     std::ostream &os,
     std::string_view filename,
@@ -48,6 +44,13 @@ static void invalid_id_log(
        << id1 << ", expected: " << id2 << ")\n";
 }
 
+static void invalid_flags_log(
+    std::ostream &os,
+    std::string_view filename
+) {
+    os << "image " << filename << " has different flags than other images!\n";
+}
+
 static bool extract_bytes(
     bmp_image_buffer& buffer,
     chunker& chunker,
@@ -57,7 +60,7 @@ static bool extract_bytes(
     std::ostream& err
 ) {
     uint8_t chunk;
-    for (auto _ = 0u; _ < size * (8 / chunk_size); ++_) {
+    for (std::size_t _ = 0; _ < size * (8 / chunk_size); ++_) {
         if (!buffer.extract_chunk(chunk) || !chunker.send_chunk(chunk)) {
             run_out_of_bytes_error_log(err, filename);
             return false;
@@ -72,25 +75,25 @@ bool extract_hidden_metadata(
     std::ostream& err
 ) {
     std::vector<uint8_t> data(HIDDEN_METADATA_SIZE);
-    chunker chunker{std::span(data.data(), data.size()), MD_CHUNK_SIZE, false};
+    chunker md_chunker{std::span(data.data(), data.size()), MD_CHUNK_SIZE, false};
 
-    if (!extract_bytes(buffer, chunker, MD_CHUNK_SIZE,
+    if (!extract_bytes(buffer, md_chunker, MD_CHUNK_SIZE,
                        HIDDEN_METADATA_SIZE, im.filename, err))
         return false;
-
-    if (data[0] != 'S' || data[1] != 'H') {
-        invalid_magic_number_log(err, im.filename, data[0], data[1]);
+    if (!parse_metadata(im, data, err))
         return false;
-    }
-
-    im.id = data[2];
-    im.seq = data[3];
 
-    im.hidden_data_size = 0u;
-    for (std::size_t i = 0; i < 4; ++i)
-        im.hidden_data_size |= data[4 + i] << (i * 8);
-
-    im.chunk_size = data[8];
+    /* extra metadata follow right after the fixed size ones */
+    while (auto size = missing_extra_metadata(im)) {
+        auto extracted = im.extra_metadata.size();
+        im.extra_metadata.resize(extracted + size);
+        chunker extra_chunker{std::span(im.extra_metadata).subspan(extracted),
+                              MD_CHUNK_SIZE, false};
+        if (!extract_bytes(buffer, extra_chunker, MD_CHUNK_SIZE, size,
+                           im.filename, err) ||
+            !parse_extra_metadata(im, err))
+            return false;
+    }
     return true;
 }
 
@@ -108,56 +111,707 @@ bool extract_data(
     return true;
 }
 
-int extract(
+static void range_error_log(
+    std::ostream &os,
+    std::size_t offset,
+    std::size_t length,
+    std::size_t data_size
+) {
+    os << "range " << offset << ':' << length << " is out of hidden data "
+          "bounds (" << data_size << " bytes are hidden)\n";
+}
+
+static void open_error_log(std::ostream &os, std::string_view filename) {
+    os << "image " << filename << " could not be opened\n";
+}
+
+static void seek_error_log(std::ostream &os, std::string_view filename) {
+    os << "could not seek in image file " << filename << '\n';
+}
+
+static void write_error_log(std::ostream &os) {
+    os << "could not write extracted data\n";
+}
+
+static void compressed_range_log(std::ostream &os) {
+    os << "range of compressed data can not be extracted\n";
+}
+
+static void scattered_stream_log(std::ostream &os, std::string_view filename) {
+    os << "scattered data can not be extracted from image " << filename
+       << ", which can not seek\n";
+}
+
+static void corrupted_data_log(std::ostream &os) {
+    os << "hidden compressed data are corrupted\n";
+}
+
+static void checksum_mismatch_log(std::ostream &os, std::string_view filename) {
+    os << "checksum of data hidden in image " << filename
+       << " does not match, the data are corrupted\n";
+}
+
+extract_session::extract_session(
     std::vector<bmp_image>& images,
     std::ostream& data_ostream,
-    std::ostream& err
-) {
+    std::ostream& err,
+    const extract_options& options
+)
+    : images(images)
+    , data_ostream(data_ostream)
+    , err(err)
+    , options(options)
+    , whole(true)
+    , prefetcher(options.prefetch, options.memory_limit) {
     assert(images.size() > 0);
-    std::vector<bmp_image_buffer> buffers{};
-    auto data_size = 0;
+}
 
-    for (auto i = 0u; i < images.size(); ++i) {
-        buffers.emplace_back(images[i], MD_CHUNK_SIZE);
-        if (!extract_hidden_metadata(images[i], buffers[i], err))
-            return 1;
-        data_size += images[i].hidden_data_size;
+extract_session::extract_session(
+    std::vector<bmp_image>& images,
+    std::size_t offset,
+    std::size_t length,
+    std::ostream& data_ostream,
+    std::ostream& err,
+    const extract_options& options
+)
+    : images(images)
+    , data_ostream(data_ostream)
+    , err(err)
+    , options(options)
+    , whole(false)
+    , offset(offset)
+    , length(length)
+    , prefetcher(options.prefetch, options.memory_limit) {
+    assert(images.size() > 0);
+}
+
+bool extract_session::step() {
+    switch (state) {
+    case METADATA:
+        return load_metadata();
+    case CHECK:
+        return check_session();
+    case DATA:
+        if (layout)
+            return extract_unit();
+        return current ? extract_block() : start_part();
+    case REBUILT:
+        return extract_rebuilt();
+    default:
+        return false;
+    }
+}
+
+int extract_session::result() const {
+    return res;
+}
+
+bool extract_session::finish(int result) {
+    if (current)
+        current->close();
+    current = nullptr;
+    for (auto part = 0u; part < part_readers.size(); ++part)
+        if (part_readers[part])
+            images[indx[part]].close();
+    part_readers.clear();
+    part_buffers.clear();
+    res = result;
+    state = FINISHED;
+    return false;
+}
+
+bool extract_session::load_metadata() {
+    auto &im = images[next];
+    prefetcher.advance(images, next);
+    if (is_small_image(im)) {
+        auto &file = small_image_buffer();
+        if (!read_image_file(im, file)) {
+            open_error_log(err, im.filename);
+            return finish(1);
+        }
+        if (!extract_metadata_in_memory(im, file, err))
+            return finish(1);
+        data_size += im.hidden_data_size;
+        if (++next == images.size())
+            state = CHECK;
+        return true;
+    }
+
+    if (!im.open_input()) {
+        open_error_log(err, im.filename);
+        return finish(1);
+    }
+    auto image_buffer = std::make_unique<bmp_image_buffer>(im, MD_CHUNK_SIZE);
+    auto extracted = extract_hidden_metadata(im, *image_buffer, err);
+    /* the buffer is positioned at the first data byte, so it is kept for
+     * images which can not seek */
+    if (!im.seekable) {
+        streamed.resize(images.size());
+        streamed[next] = std::move(image_buffer);
+    }
+    im.close();
+    if (!extracted)
+        return finish(1);
+
+    data_size += im.hidden_data_size;
+    if (++next == images.size())
+        state = CHECK;
+    return true;
+}
+
+static void missing_carriers_log(
+    std::ostream &os,
+    std::size_t present,
+    carrier_counts carriers
+) {
+    os << "only " << present << " of " << carriers.data << " data and "
+       << carriers.parity << " parity images were given, at least "
+       << carriers.data << " are needed\n";
+}
+
+/**
+ * Checks seq numbers of a hiding with parity carriers, any images can be
+ * missing as long as there are at least as many images as data carriers.
+ */
+static bool check_carriers(
+    std::vector<bmp_image>& images,
+    std::vector<std::size_t>& indx,
+    std::ostream& err
+) {
+    auto carriers = metadata_carriers(images[indx[0]]);
+    for (auto i = 0u; i < indx.size(); ++i) {
+        auto& im = images[indx[i]];
+        auto expected = i == 0 ? 0 : images[indx[i - 1]].seq + 1;
+        if (im.seq < expected || im.seq >= carriers.data + carriers.parity) {
+            invalid_seq_number_log(err, im.filename, im.seq, expected);
+            return false;
+        }
     }
+    if (indx.size() < carriers.data) {
+        missing_carriers_log(err, indx.size(), carriers);
+        return false;
+    }
+    return true;
+}
 
-    std::vector<size_t> indx(images.size());
+bool order_session(
+    std::vector<bmp_image>& images,
+    std::vector<std::size_t>& indx,
+    std::ostream& err
+) {
+    indx.resize(images.size());
     std::iota(indx.begin(), indx.end(), 0);
     std::ranges::sort(indx, {},
                       [&](size_t i) { return images[i].seq; });
 
+    auto& first = images[indx[0]];
+    for (auto &im : images) {
+        if (im.id != first.id) {
+            invalid_id_log(err, im.filename, im.id, first.id);
+            return false;
+        }
+        if (im.flags != first.flags || im.extra_metadata.size() !=
+                                       first.extra_metadata.size()) {
+            invalid_flags_log(err, im.filename);
+            return false;
+        }
+        if ((im.flags & MD_FLAG_PARITY) &&
+            (metadata_carriers(im).data != metadata_carriers(first).data ||
+             metadata_carriers(im).parity != metadata_carriers(first).parity)) {
+            invalid_flags_log(err, im.filename);
+            return false;
+        }
+    }
+    if (first.flags & MD_FLAG_PARITY)
+        return check_carriers(images, indx, err);
+
     for (auto i = 0u; i < images.size(); ++i) {
         auto& im = images[indx[i]];
         if (im.seq != i) {
             invalid_seq_number_log(err, im.filename, im.seq, i);
-            return 1;
+            return false;
         }
     }
+    return true;
+}
 
-    uint8_t id = images[indx[0]].id;
-    for (auto &im : images) {
-        if (im.id != id) {
-            invalid_id_log(err, im.filename, im.id, id);
-            return 1;
+static void missing_key_log(std::ostream &os) {
+    os << "hidden data are encrypted, please provide the key\n";
+}
+
+bool prepare_decoding(
+    const bmp_image& im,
+    const extract_options& options,
+    data_decoding& decoding,
+    std::ostream& err
+) {
+    if (!(im.flags & MD_FLAG_ENCRYPTED))
+        return true;
+    if (options.key.empty()) {
+        missing_key_log(err);
+        return false;
+    }
+    nonce_type nonce;
+    std::ranges::copy(extra_metadata_field(im, MD_FLAG_ENCRYPTED), nonce.begin());
+    auto key = derive_key(options.key, nonce);
+    decoding.cipher.emplace(key, nonce);
+    if (im.flags & MD_FLAG_SCATTERED)
+        decoding.scatter_key = key;
+    return true;
+}
+
+memory_needs extraction_memory(
+    const std::vector<bmp_image>& images,
+    const std::vector<std::size_t>& indx,
+    bool rebuilding,
+    bool whole_images
+) {
+    auto& first = images[indx[0]];
+    memory_needs needs{};
+    std::size_t data_size = 0;
+    for (auto i : indx) {
+        auto& im = images[i];
+        data_size += im.hidden_data_size;
+        if (rebuilding || whole_images || (im.flags & MD_FLAG_SCATTERED) ||
+            is_small_image(im))
+            needs.image = std::max(needs.image, image_file_size(im));
+        else
+            needs.image = std::max(needs.image, BUFFER_SIZE);
+    }
+
+    auto copies = (first.flags & MD_FLAG_INTERLEAVED) ? 2u : 1u;
+    if (rebuilding) {
+        /* stored parts of all carriers, missing ones are as large as parity
+         * parts, and the message made of the data parts */
+        auto carriers = metadata_carriers(first);
+        std::size_t data_parts = 0;
+        std::size_t present = 0;
+        std::size_t parity_size = 0;
+        for (auto i : indx) {
+            auto& im = images[i];
+            if (im.seq < carriers.data) {
+                data_parts += im.hidden_data_size;
+                ++present;
+            } else {
+                parity_size = std::max(parity_size, im.hidden_data_size);
+            }
         }
+        data_parts += (carriers.data - present) * parity_size;
+        needs.message = data_size + (carriers.data - present) * parity_size
+                        + copies * data_parts;
+    } else if (whole_images) {
+        needs.message = copies * data_size;
+    } else if (first.flags & MD_FLAG_INTERLEAVED) {
+        /* each data part has its own reader */
+        needs.message = indx.size() * BUFFER_SIZE;
     }
+    if (first.flags & MD_FLAG_COMPRESSED)
+        needs.message += COMPRESSION_BLOCK_SIZE;
+    return needs;
+}
 
-    std::vector<uint8_t> data(data_size);
-    auto data_index = 0;
-    for (auto i = 0u; i < images.size(); ++i) {
-        auto j = indx[i];
-        auto n = images[j].hidden_data_size;
+bool extract_session::check_session() {
+    streamed.resize(images.size());
+    if (!order_session(images, indx, err))
+        return finish(1);
+    if (!prepare_decoding(images[indx[0]], options, decoding, err))
+        return finish(1);
+
+    /* missing data parts are rebuilt in memory, otherwise parity carriers
+     * are not used */
+    auto rebuilding = (images[indx[0]].flags & MD_FLAG_PARITY) &&
+                      data_carriers_missing(images, indx);
+    /* nothing is written if the extraction can not fit into the limit */
+    auto needs = extraction_memory(images, indx, rebuilding, false);
+    if (!check_memory_limit(options.memory_limit, needs.total(), err))
+        return finish(1);
+    if (rebuilding) {
+        if (!rebuild_message(images, indx, decoding, rebuilt, err))
+            return finish(1);
+        data_size = rebuilt.size();
+    } else {
+        data_size = 0;
+        for (auto i : indx)
+            data_size += images[i].hidden_data_size;
+    }
+
+    if (images[indx[0]].flags & MD_FLAG_COMPRESSED) {
+        if (!whole) {
+            compressed_range_log(err);
+            return finish(1);
+        }
+        decompress.emplace();
+    }
+    if (whole) {
+        offset = 0;
+        length = data_size;
+    }
+    if (offset > data_size || length > data_size - offset) {
+        range_error_log(err, offset, length, data_size);
+        return finish(1);
+    }
+
+    /* rebuilt data are reordered already */
+    if ((images[indx[0]].flags & MD_FLAG_INTERLEAVED) && !rebuilding) {
+        std::vector<std::size_t> part_sizes{};
+        for (auto i : indx)
+            part_sizes.push_back(images[i].hidden_data_size);
+        layout.emplace(part_sizes, data_size);
+        part_readers.assign(indx.size(), nullptr);
+        part_buffers.resize(indx.size());
+        part_positions.assign(indx.size(), 0);
+        part_checksums.assign(indx.size(), std::nullopt);
+        /* only whole data parts can be verified */
+        if (whole && (images[indx[0]].flags & MD_FLAG_CHECKSUM))
+            part_checksums.assign(indx.size(), 0);
+    }
+
+    next = 0;
+    image_offset = 0;
+    prefetcher.restart();
+    if (!options.journal.path.empty() && !open_journal(rebuilding))
+        return finish(1);
+    state = rebuilding ? REBUILT : DATA;
+    return true;
+}
+
+static void journal_unsupported_log(std::ostream &os) {
+    os << "compressed, interleaved or rebuilt data and ranges are not "
+          "extracted image by image, a journal can not be used\n";
+}
+
+static void journal_mismatch_log(std::ostream &os, std::string_view path) {
+    os << "journal " << path << " records a different job, remove it "
+          "to start again\n";
+}
+
+static void images_skipped_log(std::ostream &os, std::size_t count) {
+    os << count << " image(s) were already extracted, they are skipped\n";
+}
+
+/**
+ * Loads the journal of the resumed extraction, or starts a new one. Images
+ * whose data were written one after another from the start are skipped.
+ */
+bool extract_session::open_journal(bool rebuilding) {
+    if (!whole || decompress || layout || rebuilding) {
+        journal_unsupported_log(err);
+        return false;
+    }
+    auto& first = images[indx[0]];
+    journal.emplace();
+    journal_header header{"extract", first.id, data_size, 0, first.flags, {}};
+    auto& path = options.journal.path;
+    if (!options.journal.resume || !std::filesystem::exists(path))
+        return journal->start(path, header, err);
+
+    if (!journal->load(path, err))
+        return false;
+    if (journal->header() != header) {
+        journal_mismatch_log(err, path);
+        return false;
+    }
+    std::size_t skipped = 0;
+    for (; skipped < indx.size(); ++skipped) {
+        auto entry = journal->completed(skipped, options.data_path);
+        if (!entry || entry->offset != offset ||
+            entry->size != images[indx[skipped]].hidden_data_size)
+            break;
+        offset += entry->size;
+    }
+    if (skipped == 0)
+        return true;
+    images_skipped_log(err, skipped);
+    length -= offset;
+    if (!data_ostream.seekp(offset)) {
+        write_error_log(err);
+        return false;
+    }
+    return true;
+}
+
+bool extract_session::start_part() {
+    /* skip images which do not hold any byte of the range */
+    while (next < images.size() && length > 0 &&
+           offset >= image_offset + images[indx[next]].hidden_data_size) {
+        image_offset += images[indx[next]].hidden_data_size;
+        ++next;
+    }
+    if (length == 0 || next == images.size())
+        return finish_data();
+
+    auto &im = images[indx[next]];
+    prefetcher.advance(images, next, indx);
+    auto skipped = offset - image_offset;
+    remaining = std::min(im.hidden_data_size - skipped, length);
+    current = &im;
+    /* only whole data parts can be verified */
+    if ((im.flags & MD_FLAG_CHECKSUM) && remaining == im.hidden_data_size)
+        checksum = 0;
+    else
+        checksum.reset();
+
+    /* scattered data are extracted from the whole image held in memory */
+    if (decoding.scatter_key) {
+        if (streamed[indx[next]]) {
+            scattered_stream_log(err, im.filename);
+            return finish(1);
+        }
+        if (!read_image(im, memory_image)) {
+            open_error_log(err, im.filename);
+            return finish(1);
+        }
+        scatter.emplace(*decoding.scatter_key, im);
+        to_drop = 0;
+        return true;
+    }
+
+    /* the part of a small image is extracted in a single step */
+    if (is_small_image(im)) {
+        auto &file = small_image_buffer();
+        if (!read_image_file(im, file)) {
+            open_error_log(err, im.filename);
+            return finish(1);
+        }
+        block.resize(remaining);
+        if (!extract_bytes_at(im, std::span(file).subspan(im.data_offset),
+                              im.data_start_cell() + skipped * im.cells_per_byte,
+                              block, im.chunk_size)) {
+            run_out_of_bytes_error_log(err, im.filename);
+            return finish(1);
+        }
+        return process_block();
+    }
 
-        buffers[j].change_chunk_size(images[j].chunk_size);
-        if (!extract_data(images[j], buffers[j],
-                          std::span(data.data() + data_index, n), err))
-            return 1;
-        data_index += n;
+    /* images which can not seek are read sequentially from the data start */
+    if (auto &streamed_buffer = streamed[indx[next]]) {
+        part_buffer = streamed_buffer.get();
+        to_drop = skipped;
+        part_buffer->change_chunk_size(im.chunk_size);
+        return true;
     }
 
-    return data_ostream.write(reinterpret_cast<char *>(data.data()),
-                              data.size()).fail();
+    if (!im.open_input()) {
+        open_error_log(err, im.filename);
+        return finish(1);
+    }
+    buffer = std::make_unique<bmp_image_buffer>(im, im.chunk_size);
+    part_buffer = buffer.get();
+    to_drop = 0;
+    if (!buffer->seek_cell(im.data_start_cell()
+                           + skipped * im.cells_per_byte)) {
+        seek_error_log(err, im.filename);
+        return finish(1);
+    }
+    return true;
+}
+
+bool extract_session::extract_block() {
+    auto &im = *current;
+    block.resize(std::min(BUFFER_SIZE, to_drop > 0 ? to_drop : remaining));
+    if (scatter) {
+        auto pixels = std::span(memory_image).subspan(im.data_offset);
+        if (!extract_bytes_scattered(im, pixels, *scatter,
+                                     (offset - image_offset) * im.cells_per_byte,
+                                     block, im.chunk_size)) {
+            run_out_of_bytes_error_log(err, im.filename);
+            return finish(1);
+        }
+    } else if (!extract_data(im, *part_buffer, block, err)) {
+        return finish(1);
+    }
+
+    if (to_drop > 0) {
+        to_drop -= block.size();
+        return true;
+    }
+    return process_block();
+}
+
+/**
+ * Verifies, decrypts and writes the extracted block of the current image,
+ * the image is finished when the last block of its range is processed.
+ */
+bool extract_session::process_block() {
+    auto &im = *current;
+    if (checksum)
+        checksum = crc32c(block, *checksum);
+    if (decoding.cipher)
+        decoding.cipher->apply(block, offset);
+    if (journal)
+        written_checksum = crc32c(block, written_checksum);
+
+    if (!write_block())
+        return finish(1);
+    offset += block.size();
+    length -= block.size();
+    remaining -= block.size();
+
+    if (remaining == 0) {
+        if (checksum && *checksum != metadata_checksum(im)) {
+            checksum_mismatch_log(err, im.filename);
+            return finish(1);
+        }
+        /* the data are flushed, so the journal never records data which
+         * were not written */
+        if (journal) {
+            if (!data_ostream.flush()) {
+                write_error_log(err);
+                return finish(1);
+            }
+            journal_entry entry{next, options.data_path, image_offset,
+                                im.hidden_data_size, written_checksum};
+            if (!journal->record(entry, err))
+                return finish(1);
+            written_checksum = 0;
+        }
+        im.close();
+        buffer.reset();
+        scatter.reset();
+        memory_image.clear();
+        current = nullptr;
+        image_offset += im.hidden_data_size;
+        ++next;
+    }
+    return true;
+}
+
+/**
+ * Opens the reader of the interleaved data part, images which can seek
+ * start at the given offset of the part, the others are read from its start.
+ */
+bool extract_session::open_part(std::size_t part, std::size_t part_offset) {
+    auto &im = images[indx[part]];
+    prefetcher.advance(images, part, indx);
+    if (auto &streamed_buffer = streamed[indx[part]]) {
+        part_readers[part] = streamed_buffer.get();
+        streamed_buffer->change_chunk_size(im.chunk_size);
+        return true;
+    }
+
+    if (!im.open_input()) {
+        open_error_log(err, im.filename);
+        return false;
+    }
+    part_buffers[part] = std::make_unique<bmp_image_buffer>(im, im.chunk_size);
+    part_readers[part] = part_buffers[part].get();
+    if (!part_buffers[part]->seek_cell(im.data_start_cell()
+                                       + part_offset * im.cells_per_byte)) {
+        seek_error_log(err, im.filename);
+        return false;
+    }
+    part_positions[part] = part_offset;
+    return true;
+}
+
+bool extract_session::extract_unit() {
+    if (length == 0)
+        return finish_data();
+
+    auto &unit = layout->unit_at(offset);
+    auto part = unit.part;
+    auto &im = images[indx[part]];
+    auto part_offset = unit.part_offset + (offset - unit.message_offset);
+    if (!part_readers[part] && !open_part(part, part_offset))
+        return finish(1);
+
+    /* images read sequentially drop bytes before the unit */
+    auto &position = part_positions[part];
+    auto dropping = position < part_offset;
+    auto size = dropping
+        ? std::min(BUFFER_SIZE, part_offset - position)
+        : std::min({BUFFER_SIZE, unit.message_offset + unit.size - offset,
+                    length});
+    block.resize(size);
+    if (!extract_data(im, *part_readers[part], block, err))
+        return finish(1);
+    position += size;
+    if (dropping)
+        return true;
+
+    auto &checksum = part_checksums[part];
+    if (checksum) {
+        checksum = crc32c(block, *checksum);
+        if (position == im.hidden_data_size &&
+            *checksum != metadata_checksum(im)) {
+            checksum_mismatch_log(err, im.filename);
+            return finish(1);
+        }
+    }
+    if (decoding.cipher)
+        decoding.cipher->apply(block, offset);
+    if (!write_block())
+        return finish(1);
+    offset += size;
+    length -= size;
+
+    if (position == im.hidden_data_size) {
+        im.close();
+        part_buffers[part].reset();
+        part_readers[part] = nullptr;
+    }
+    return true;
+}
+
+bool extract_session::finish_data() {
+    if (decompress && !decompress->finished()) {
+        corrupted_data_log(err);
+        return finish(1);
+    }
+    return finish(0);
+}
+
+bool extract_session::extract_rebuilt() {
+    if (length == 0)
+        return finish_data();
+    auto size = std::min(BUFFER_SIZE, length);
+    block.assign(rebuilt.begin() + offset, rebuilt.begin() + offset + size);
+    if (decoding.cipher)
+        decoding.cipher->apply(block, offset);
+    if (!write_block())
+        return finish(1);
+    offset += size;
+    length -= size;
+    return true;
+}
+
+bool extract_session::write_block() {
+    if (decompress) {
+        if (!decompress->write(block, data_ostream)) {
+            corrupted_data_log(err);
+            return false;
+        }
+    } else {
+        data_ostream.write(reinterpret_cast<char *>(block.data()), block.size());
+    }
+    if (!data_ostream) {
+        write_error_log(err);
+        return false;
+    }
+    return true;
+}
+
+int extract(
+    std::vector<bmp_image>& images,
+    std::ostream& data_ostream,
+    std::ostream& err,
+    const extract_options& options
+) {
+    extract_session session{images, data_ostream, err, options};
+    while (session.step()) {}
+    return session.result();
+}
+
+int extract_range(
+    std::vector<bmp_image>& images,
+    std::size_t offset,
+    std::size_t length,
+    std::ostream& data_ostream,
+    std::ostream& err,
+    const extract_options& options
+) {
+    extract_session session{images, offset, length, data_ostream, err,
+                            options};
+    while (session.step()) {}
+    return session.result();
 }
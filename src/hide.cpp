@@ -1,13 +1,25 @@
 #include "hide.h"
 
+#include <array>
+#include <filesystem>
+#include <functional>
 #include <span>
 #include <iostream>
 #include <algorithm>
+#include <numeric>
 #include <random>
+#include <sstream>
 
 #include "configuration.h"
 #include "chunker.h"
 #include "bitmap.h"
+#include "compress.h"
+#include "crc.h"
+#include "in_memory.h"
+#include "interleave.h"
+#include "metadata.h"
+#include "parity.h"
+#include "scatter.h"
 
 static void run_out_of_bytes_log(std::ostream &os, std::string_view filename) {
     os << "image file " << filename << " is smaller than expected or there "
@@ -40,14 +52,40 @@ static void image_not_necessary_log(
     os << "image " << filename << " was not necessary to hide data\n";
 }
 
-static bool hide_bytes(
+static void parity_capacity_log(
+    std::ostream &os,
+    std::string_view filename,
+    std::size_t capacity,
+    std::size_t size
+) {
+    os << "image " << filename << " has only " << capacity << " byte capacity, "
+       << size << " bytes are needed for a parity image\n";
+}
+
+static void open_error_log(std::ostream &os, std::string_view filename) {
+    os << "could not open image " << filename << " or its output file\n";
+}
+
+/**
+ * @brief Hides at most `max_chunks` chunks from the chunker.
+ * 
+ * @return `true` on success, `false` if the image run out of bytes
+ */
+static bool hide_chunks(
     chunker &chnkr,
     bmp_image_buffer &buffer,
+    std::size_t max_chunks,
+    bool &finished,
     std::string_view image_filename,
     std::ostream &err
 ) {
     uint8_t chunk;
-    while (chnkr.get_chunk(chunk)) {
+    finished = false;
+    for (std::size_t _ = 0; _ < max_chunks; ++_) {
+        if (!chnkr.get_chunk(chunk)) {
+            finished = true;
+            return true;
+        }
         if (!buffer.hide_chunk(chunk)) {
             run_out_of_bytes_log(err, image_filename);
             return false;
@@ -56,6 +94,400 @@ static bool hide_bytes(
     return true;
 }
 
+void apply_encoding(bmp_image &im, const data_encoding &encoding) {
+    init_extra_metadata(im, encoding.flags);
+    if (encoding.flags & MD_FLAG_ENCRYPTED)
+        std::ranges::copy(encoding.nonce,
+                          extra_metadata_field(im, MD_FLAG_ENCRYPTED).begin());
+    if (encoding.flags & MD_FLAG_PARITY)
+        set_metadata_carriers(im, encoding.carriers);
+}
+
+/**
+ * @brief Returns candidates for `select_carriers` with the encoding applied.
+ */
+static std::vector<carrier_candidate> carrier_candidates(
+    std::vector<bmp_image> &images,
+    const data_encoding &encoding
+) {
+    std::vector<carrier_candidate> candidates{};
+    for (auto &im : images) {
+        apply_encoding(im, encoding);
+        std::size_t row_size = static_cast<std::size_t>(im.width)
+                               * im.channel_count + im.padding;
+        candidates.push_back({im.byte_capacity(), row_size * im.height});
+    }
+    return candidates;
+}
+
+static void set_chunk_size(bmp_image &im, uint8_t chunk_size) {
+    im.chunk_size = chunk_size;
+    im.cells_per_byte = 8 / chunk_size;
+}
+
+/**
+ * @brief Assigns each image the smallest chunk size with which the images
+ * hold the message. All images start with 1 bit chunks, then the largest
+ * images are upgraded first, all images to 2 bits before any of them gets
+ * 4 bits and so on. Capacity only grows with upgrades, so the smallest number
+ * of upgrades is found by binary search over the sequence of upgrades.
+ */
+static void plan_chunk_sizes(
+    std::vector<bmp_image> &images,
+    const data_encoding &encoding,
+    std::size_t data_size,
+    carrier_selection selection
+) {
+    std::vector<std::size_t> largest(images.size());
+    std::iota(largest.begin(), largest.end(), 0);
+    std::ranges::stable_sort(largest, std::ranges::greater{},
+                             [&](auto i) { return images[i].capacity; });
+
+    auto upgrade = [&](std::size_t upgrades) {
+        for (auto &im : images)
+            set_chunk_size(im, 1);
+        for (auto k = 0u; k < upgrades; ++k)
+            set_chunk_size(images[largest[k % images.size()]],
+                           static_cast<uint8_t>(2 << (k / images.size())));
+    };
+    auto fits = [&](std::size_t upgrades) {
+        upgrade(upgrades);
+        carrier_plan plan{};
+        std::ostringstream ignored{};
+        return select_carriers(carrier_candidates(images, encoding), data_size,
+                               encoding.carriers.parity, selection, plan,
+                               ignored);
+    };
+
+    /* 1 to 2, 2 to 4 and 4 to 8 bits for every image */
+    std::size_t low = 0;
+    std::size_t high = 3 * images.size();
+    while (low < high) {
+        auto middle = low + (high - low) / 2;
+        if (fits(middle))
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    upgrade(low);
+}
+
+static void interleave_scatter_log(std::ostream &os) {
+    os << "interleaved data can not be scattered\n";
+}
+
+static void keystream_limit_log(std::ostream &os, std::size_t data_size) {
+    os << "data of " << data_size << " bytes can not be encrypted, at most "
+       << CHACHA_MAX_MESSAGE_SIZE << " bytes can be encrypted by one nonce\n";
+}
+
+/**
+ * @brief Computes sizes of the interleaved data parts. Carriers given
+ * in order are used up to one unit each, so more of them can be read
+ * at once, selected carriers are kept.
+ */
+static bool plan_interleaving(
+    std::vector<bmp_image> &images,
+    data_encoding &encoding,
+    std::size_t data_size,
+    std::size_t data_count,
+    carrier_selection selection,
+    std::ostream &err
+) {
+    auto parity = encoding.carriers.parity;
+    if (selection == carrier_selection::ORDER) {
+        auto units = (data_size + INTERLEAVE_UNIT_SIZE - 1) / INTERLEAVE_UNIT_SIZE;
+        auto available = std::min(images.size(), MAX_IMAGES) - parity;
+        data_count = std::max(data_count, std::min(available, units));
+    }
+    std::vector<std::size_t> capacities{};
+    for (auto i = 0u; i < data_count; ++i)
+        capacities.push_back(images[i].byte_capacity());
+    interleaved_layout layout{capacities, data_size};
+    encoding.part_sizes = std::move(layout.part_sizes);
+    while (!encoding.part_sizes.empty() && encoding.part_sizes.back() == 0)
+        encoding.part_sizes.pop_back();
+    if (parity == 0)
+        return true;
+
+    /* parts differ from the sequential ones, so parity carriers are
+     * checked again */
+    encoding.carriers.data = encoding.part_sizes.size();
+    auto largest = std::ranges::max(encoding.part_sizes);
+    for (auto i = encoding.carriers.data;
+         i < encoding.carriers.data + parity; ++i) {
+        if (images[i].byte_capacity() < largest) {
+            parity_capacity_log(err, images[i].filename,
+                                images[i].byte_capacity(), largest);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool plan_carriers(
+    std::vector<bmp_image> &images,
+    data_encoding &encoding,
+    std::size_t data_size,
+    std::ostream &err,
+    const hide_options &options
+) {
+    if ((encoding.flags & MD_FLAG_INTERLEAVED) && encoding.scatter_key) {
+        interleave_scatter_log(err);
+        return false;
+    }
+    if (encoding.cipher && data_size > CHACHA_MAX_MESSAGE_SIZE) {
+        keystream_limit_log(err, data_size);
+        return false;
+    }
+    if (options.auto_chunk)
+        plan_chunk_sizes(images, encoding, data_size, options.select);
+
+    /* capacities are known from headers, nothing is opened */
+    auto candidates = carrier_candidates(images, encoding);
+    carrier_plan plan{};
+    if (!select_carriers(candidates, data_size, encoding.carriers.parity,
+                         options.select, plan, err))
+        return false;
+    if (encoding.flags & MD_FLAG_PARITY)
+        encoding.carriers.data = plan.data_count;
+
+    if (options.select != carrier_selection::ORDER) {
+        /* selected images are moved to the front, in the order of the plan */
+        std::vector<bool> selected(images.size());
+        std::vector<bmp_image> ordered{};
+        ordered.reserve(images.size());
+        for (auto i : plan.order) {
+            ordered.push_back(std::move(images[i]));
+            selected[i] = true;
+        }
+        for (auto i = 0u; i < images.size(); ++i)
+            if (!selected[i])
+                ordered.push_back(std::move(images[i]));
+        images = std::move(ordered);
+    }
+    if (encoding.flags & MD_FLAG_INTERLEAVED)
+        return plan_interleaving(images, encoding, data_size, plan.data_count,
+                                 options.select, err);
+    return true;
+}
+
+/**
+ * @brief Returns the buffer held while the data part is hidden into the image.
+ */
+static std::size_t carrier_memory(
+    const bmp_image &im,
+    const data_encoding &encoding,
+    bool whole_images
+) {
+    if (whole_images || encoding.scatter_key || is_small_image(im))
+        return image_file_size(im);
+    return BUFFER_SIZE;
+}
+
+memory_needs hiding_memory(
+    const std::vector<bmp_image> &images,
+    const data_encoding &encoding,
+    std::size_t data_size,
+    bool whole_images
+) {
+    memory_needs needs{};
+    std::size_t data_index = 0;
+    std::size_t largest_part = 0;
+    auto seq = 0u;
+    for (; data_index < data_size && seq < images.size(); ++seq) {
+        auto size = encoding.part_sizes.empty()
+            ? std::min(images[seq].byte_capacity(), data_size - data_index)
+            : encoding.part_sizes[seq];
+        data_index += size;
+        largest_part = std::max(largest_part, size);
+        needs.image = std::max(needs.image,
+                               carrier_memory(images[seq], encoding,
+                                              whole_images));
+    }
+    for (auto i = 0u; i < encoding.carriers.parity && seq < images.size();
+         ++i, ++seq)
+        needs.image = std::max(needs.image,
+                               carrier_memory(images[seq], encoding,
+                                              whole_images));
+
+    /* the reordered copy replaces the message before parity is computed */
+    auto parity = encoding.carriers.parity * (largest_part + PARITY_HEADER_SIZE);
+    needs.message = std::max(data_size + parity,
+                             (encoding.flags & MD_FLAG_INTERLEAVED)
+                                 ? 2 * data_size : data_size);
+    return needs;
+}
+
+void interleave_data(std::vector<uint8_t> &data, data_encoding &encoding) {
+    /* keystream offsets are offsets in the message */
+    if (encoding.cipher) {
+        encoding.cipher->apply(data, 0);
+        encoding.cipher.reset();
+    }
+    interleaved_layout layout{encoding.part_sizes, data.size()};
+    std::vector<uint8_t> parts(data.size());
+    layout.interleave(data, parts);
+    data = std::move(parts);
+}
+
+void measure_distortion(bmp_image &im, const hide_options &options) {
+    if (!options.distortion)
+        return;
+    im.distortion.emplace();
+    im.distortion->cells = static_cast<std::size_t>(im.width) * im.height
+                           * im.channel_count;
+    im.distortion->channel_count = im.channel_count;
+}
+
+void seal_data_part(
+    bmp_image &im,
+    std::span<uint8_t> to_hide,
+    const chacha20 *cipher,
+    std::size_t message_offset
+) {
+    if (cipher)
+        cipher->apply(to_hide, message_offset);
+    if (im.flags & MD_FLAG_CHECKSUM)
+        set_metadata_checksum(im, crc32c(to_hide));
+}
+
+/**
+ * @brief Checks whether the metadata of the image can be rewritten once
+ * the whole image was written, which requires seekable input and output.
+ */
+static bool metadata_rewritable(const bmp_image &im) {
+    return im.seekable && im.input && im.output && im.output->tellp() >= 0;
+}
+
+/**
+ * @brief Makes metadata of the hider. The checksum of the data part has to be
+ * stored in the metadata, which are hidden before the data part. If the
+ * metadata can be rewritten later, the checksum is computed as the data part
+ * is hidden block by block and the metadata made now are only a placeholder,
+ * otherwise the data part is sealed (encrypted and checksummed) in a single
+ * pass beforehand.
+ */
+static std::vector<uint8_t> hider_metadata(
+    bmp_image &im,
+    std::span<uint8_t> to_hide,
+    uint8_t id,
+    uint8_t seq,
+    const chacha20 *cipher,
+    std::size_t message_offset,
+    bool deferred
+) {
+    if ((im.flags & MD_FLAG_CHECKSUM) && !deferred)
+        seal_data_part(im, to_hide, cipher, message_offset);
+    return make_metadata(im, static_cast<uint32_t>(to_hide.size()), id, seq);
+}
+
+image_hider::image_hider(
+    bmp_image &im,
+    std::span<uint8_t> to_hide,
+    uint8_t id,
+    uint8_t seq,
+    const chacha20 *cipher,
+    std::size_t message_offset
+)
+    : im(im)
+    , deferred((im.flags & MD_FLAG_CHECKSUM) && metadata_rewritable(im))
+    , output_start(deferred ? std::streamoff(im.output->tellp()) : -1)
+    , metadata(hider_metadata(im, to_hide, id, seq, cipher, message_offset,
+                              deferred))
+    , buffer(im, MD_CHUNK_SIZE)
+    , metadata_chnkr(std::span(metadata.data(), metadata.size()), MD_CHUNK_SIZE)
+    , data_chnkr(to_hide, im.chunk_size)
+    , to_hide(to_hide)
+    , id(id)
+    , seq(seq)
+    , cipher(cipher)
+    , message_offset(message_offset)
+    , sealed(((im.flags & MD_FLAG_CHECKSUM) && !deferred) ? to_hide.size() : 0) {}
+
+bool image_hider::step(std::ostream &err) {
+    bool finished = false;
+    switch (state) {
+    case METADATA: {
+        /* the placeholder is replaced, so only the final metadata
+         * are measured */
+        auto measured = deferred ? std::exchange(im.distortion, std::nullopt)
+                                 : std::nullopt;
+        auto hidden = hide_chunks(metadata_chnkr, buffer, metadata.size() * 8,
+                                  finished, im.filename, err);
+        if (deferred)
+            im.distortion = std::move(measured);
+        if (!hidden)
+            break;
+        buffer.change_chunk_size(im.chunk_size);
+        state = DATA;
+        return true;
+    }
+    case DATA:
+        if (sealed < to_hide.size()) {
+            /* exactly the bytes hidden by this step, they are encrypted
+             * and checksummed right before they are hidden */
+            auto size = std::min(to_hide.size() - sealed,
+                                 BUFFER_SIZE / im.cells_per_byte);
+            auto block = to_hide.subspan(sealed, size);
+            if (cipher)
+                cipher->apply(block, message_offset + sealed);
+            if (deferred)
+                checksum = crc32c(block, checksum);
+            sealed += size;
+        }
+        if (!hide_chunks(data_chnkr, buffer, BUFFER_SIZE, finished,
+                         im.filename, err))
+            break;
+        if (finished)
+            state = REST;
+        return true;
+    case REST:
+        if (buffer.copy_block())
+            return true;
+        if (deferred && !rewrite_metadata()) {
+            run_out_of_bytes_log(err, im.filename);
+            break;
+        }
+        state = DONE;
+        return false;
+    default:
+        return false;
+    }
+    state = FAILED;
+    return false;
+}
+
+/**
+ * @brief Hides the final metadata with the checksum of the data part into
+ * the original pixel bytes which hold them, read again from the input,
+ * and writes them over the placeholder in the output.
+ */
+bool image_hider::rewrite_metadata() {
+    set_metadata_checksum(im, checksum);
+    metadata = make_metadata(im, static_cast<uint32_t>(to_hide.size()), id, seq);
+    auto cells = metadata.size() * 8 / MD_CHUNK_SIZE;
+    std::vector<std::byte> pixels(im.cell_offset(cells - 1) + 1);
+
+    im.input->clear();
+    if (!im.input->seekg(im.data_offset, std::ios::beg) ||
+        !im.input->read(reinterpret_cast<char *>(pixels.data()), pixels.size()))
+        return false;
+    auto distortion = im.distortion ? &*im.distortion : nullptr;
+    if (!hide_bytes_at(im, pixels, 0, metadata, MD_CHUNK_SIZE, distortion))
+        return false;
+    auto end = im.output->tellp();
+    im.output->seekp(output_start);
+    im.output->write(reinterpret_cast<const char *>(pixels.data()),
+                     pixels.size());
+    im.output->seekp(end);
+    return im.output->good();
+}
+
+bool image_hider::failed() const {
+    return state == FAILED;
+}
+
 bool hide_data(
     bmp_image &im,
     std::span<uint8_t> to_hide,
@@ -63,81 +495,550 @@ bool hide_data(
     uint8_t seq,
     std::ostream &err
 ) {
-    bmp_image_buffer buffer{im, MD_CHUNK_SIZE};
+    image_hider hider{im, to_hide, id, seq};
+    while (hider.step(err)) {}
+    return !hider.failed();
+}
+
+uint8_t generate_id() {
+    std::default_random_engine e(std::random_device{}());
+
+    std::uniform_int_distribution<int> dist(1, 255);
+    return static_cast<uint8_t>(dist(e));
+}
+
+std::vector<uint8_t> read_data(std::istream &data_in) {
+    std::vector<uint8_t> data{};
+    auto end = data_in.seekg(0, std::ios::end).tellg();
+    if (end >= 0) {
+        data.resize(end);
+        data_in.seekg(0, std::ios::beg);
+        data_in.read(reinterpret_cast<char*>(data.data()), data.size());
+        return data;
+    }
+
+    data_in.clear();
+    std::array<char, BUFFER_SIZE> block;
+    while (data_in.read(block.data(), block.size()) || data_in.gcount() > 0)
+        data.insert(data.end(), block.data(), block.data() + data_in.gcount());
+    return data;
+}
+
+bool read_message(
+    std::istream &data_in,
+    std::vector<uint8_t> &data,
+    const hide_options &options,
+    std::ostream &err
+) {
+    /* the compressed copy is assumed to be as large as the message */
+    auto copies = options.compress ? 2 : 1;
+    auto limit = options.memory_limit;
+    auto end = data_in.seekg(0, std::ios::end).tellg();
+    if (end >= 0) {
+        if (!check_memory_limit(limit, copies * static_cast<std::size_t>(end),
+                                err))
+            return false;
+        data = read_data(data_in);
+        return true;
+    }
 
-    std::vector<uint8_t> metadata{};
-    /* magic number for sharky images */
-    metadata.emplace_back(static_cast<uint8_t>('S'));
-    metadata.emplace_back(static_cast<uint8_t>('H'));
+    data_in.clear();
+    data.clear();
+    std::array<char, BUFFER_SIZE> block;
+    while (data_in.read(block.data(), block.size()) || data_in.gcount() > 0) {
+        data.insert(data.end(), block.data(), block.data() + data_in.gcount());
+        if (!check_memory_limit(limit, copies * data.size(), err))
+            return false;
+    }
+    return true;
+}
 
-    metadata.emplace_back(id);
-    metadata.emplace_back(seq);
+static void compressed_log(
+    std::ostream &os,
+    std::size_t data_size,
+    std::size_t compressed_size
+) {
+    os << "data were compressed from " << data_size << " to "
+       << compressed_size << " bytes\n";
+}
 
-    auto data_size = static_cast<uint32_t>(to_hide.size());
-    for (auto _ = 0u; _ < sizeof(uint32_t); ++_) {
-        metadata.emplace_back(static_cast<uint8_t>(data_size & 0xffu));
-        data_size >>= 8;
+data_encoding encode_data(
+    std::vector<uint8_t> &data,
+    const hide_options &options,
+    std::ostream &out
+) {
+    data_encoding encoding{};
+    if (options.compress) {
+        auto compressed = compress(data);
+        compressed_log(out, data.size(), compressed.size());
+        data = std::move(compressed);
+        encoding.flags |= MD_FLAG_COMPRESSED;
+    }
+    if (!options.key.empty()) {
+        auto nonce = generate_nonce();
+        auto key = derive_key(options.key, nonce);
+        encoding.cipher.emplace(key, nonce);
+        encoding.nonce = nonce;
+        encoding.flags |= MD_FLAG_ENCRYPTED;
+        if (options.scatter) {
+            encoding.scatter_key = key;
+            encoding.flags |= MD_FLAG_SCATTERED;
+        }
+    }
+    if (options.checksum)
+        encoding.flags |= MD_FLAG_CHECKSUM;
+    if (options.interleave)
+        encoding.flags |= MD_FLAG_INTERLEAVED;
+    /* an empty message has no data part to protect */
+    if (options.parity > 0 && !data.empty()) {
+        encoding.flags |= MD_FLAG_PARITY;
+        encoding.carriers.parity = options.parity;
     }
-    metadata.emplace_back(im.chunk_size);
+    return encoding;
+}
 
-    chunker metadata_chnkr{
-        std::span(metadata.data(), metadata.size()), MD_CHUNK_SIZE};
+/**
+ * @brief Hides the data part block by block, each block is encrypted
+ * and checksummed right before it is hidden, so the data part is not passed
+ * over separately. The checksum is stored into the metadata of the image
+ * if it has `MD_FLAG_CHECKSUM` set, the metadata have to be made afterwards.
+ * 
+ * @param hide_block hides the block at the given offset of the data part
+ * 
+ * @return `true` on success, `false` if a block could not be hidden
+ */
+static bool hide_sealed_blocks(
+    bmp_image &im,
+    std::span<uint8_t> to_hide,
+    const chacha20 *cipher,
+    std::size_t message_offset,
+    const std::function<bool(std::size_t, std::span<const uint8_t>)> &hide_block
+) {
+    uint32_t checksum = 0;
+    for (std::size_t offset = 0; offset < to_hide.size(); offset += BUFFER_SIZE) {
+        auto block = to_hide.subspan(offset,
+                                     std::min(BUFFER_SIZE, to_hide.size() - offset));
+        if (cipher)
+            cipher->apply(block, message_offset + offset);
+        if (im.flags & MD_FLAG_CHECKSUM)
+            checksum = crc32c(block, checksum);
+        if (!hide_block(offset, block))
+            return false;
+    }
+    if (im.flags & MD_FLAG_CHECKSUM)
+        set_metadata_checksum(im, checksum);
+    return true;
+}
 
-    if (!hide_bytes(metadata_chnkr, buffer, im.filename, err))
+/**
+ * @brief Hides data part into the image in the keyed order, the image is read
+ * into memory, altered there and written at once.
+ * 
+ * @return `true` on success, `false` on failure
+ */
+static bool hide_scattered(
+    bmp_image &im,
+    std::span<uint8_t> to_hide,
+    uint8_t id,
+    uint8_t seq,
+    const chacha20 *cipher,
+    const key_type &scatter_key,
+    std::size_t message_offset,
+    std::ostream &err
+) {
+    std::vector<std::byte> file{};
+    if (!read_image(im, file)) {
+        open_error_log(err, im.filename);
         return false;
+    }
+    auto pixels = std::span(file).subspan(im.data_offset);
+    cell_scatter scatter{scatter_key, im};
+    auto distortion = im.distortion ? &*im.distortion : nullptr;
+    auto hidden = hide_sealed_blocks(im, to_hide, cipher, message_offset,
+        [&](std::size_t offset, std::span<const uint8_t> block) {
+            return hide_bytes_scattered(im, pixels, scatter,
+                                        offset * im.cells_per_byte, block,
+                                        im.chunk_size, distortion);
+        });
+    auto metadata = make_metadata(im, static_cast<uint32_t>(to_hide.size()), id, seq);
+    if (!hidden ||
+        !hide_bytes_at(im, pixels, 0, metadata, MD_CHUNK_SIZE, distortion)) {
+        run_out_of_bytes_log(err, im.filename);
+        return false;
+    }
 
-    buffer.change_chunk_size(im.chunk_size);
-    chunker data_chnkr{to_hide, im.chunk_size};
-    if (!hide_bytes(data_chnkr, buffer, im.filename, err))
+    if (!im.open_output()) {
+        open_error_log(err, im.filename);
         return false;
+    }
+    im.output->write(reinterpret_cast<const char *>(pixels.data()), pixels.size());
+    auto written = im.output->good();
+    im.close();
+    if (!written)
+        run_out_of_bytes_log(err, im.filename);
+    return written;
+}
+
+/**
+ * @brief Checks whether the image can be hidden by `hide_small`.
+ */
+static bool small_hiding(bmp_image &im) {
+    return is_small_image(im) && !im.output &&
+           im.get_output_path() != STDIO_FILENAME;
+}
 
-    buffer.copy_rest();
+/**
+ * @brief Hides data part into a small image in a single step, the image is
+ * read into the buffer of the thread, altered there and written at once.
+ * 
+ * @return `true` on success, `false` on failure
+ */
+static bool hide_small(
+    bmp_image &im,
+    std::span<uint8_t> to_hide,
+    uint8_t id,
+    uint8_t seq,
+    const chacha20 *cipher,
+    std::size_t message_offset,
+    std::ostream &err
+) {
+    auto &file = small_image_buffer();
+    if (!read_image_file(im, file)) {
+        open_error_log(err, im.filename);
+        return false;
+    }
+    if (file.size() < im.data_offset) {
+        run_out_of_bytes_log(err, im.filename);
+        return false;
+    }
+    auto pixels = std::span(file).subspan(im.data_offset);
+    auto distortion = im.distortion ? &*im.distortion : nullptr;
+    auto hidden = hide_sealed_blocks(im, to_hide, cipher, message_offset,
+        [&](std::size_t offset, std::span<const uint8_t> block) {
+            return hide_bytes_at(im, pixels, im.data_start_cell()
+                                 + offset * im.cells_per_byte, block,
+                                 im.chunk_size, distortion);
+        });
+    auto metadata = make_metadata(im, static_cast<uint32_t>(to_hide.size()), id, seq);
+    if (!hidden ||
+        !hide_bytes_at(im, pixels, 0, metadata, MD_CHUNK_SIZE, distortion)) {
+        run_out_of_bytes_log(err, im.filename);
+        return false;
+    }
+    if (!write_image_file(im, file)) {
+        open_error_log(err, im.filename);
+        return false;
+    }
     return true;
 }
 
-static uint8_t generate_id() {
-    std::default_random_engine e(std::random_device{}());
+static void too_many_images_log(std::ostream &os) {
+    os << "data can be hidden into at most " << MAX_IMAGES << " images\n";
+}
 
-    std::uniform_int_distribution<int> dist(1, 255);
-    return static_cast<uint8_t>(dist(e));
+static void journal_mismatch_log(std::ostream &os, std::string_view path) {
+    os << "journal " << path << " records a different job, remove it "
+          "to start again\n";
 }
 
-int hide(
+static void image_skipped_log(std::ostream &os, std::string_view filename) {
+    os << "image " << filename << " was already hidden, it is skipped\n";
+}
+
+static void output_read_error_log(std::ostream &os, std::string_view path) {
+    os << "could not read altered image " << path << " to record it\n";
+}
+
+/**
+ * @brief Makes the encryption use the nonce of the resumed hiding.
+ */
+static void reuse_nonce(
+    data_encoding &encoding,
+    const hide_options &options,
+    const nonce_type &nonce
+) {
+    auto key = derive_key(options.key, nonce);
+    encoding.cipher.emplace(key, nonce);
+    encoding.nonce = nonce;
+    if (encoding.scatter_key)
+        encoding.scatter_key = key;
+}
+
+hide_session::hide_session(
     std::vector<bmp_image> &images,
     std::istream &data_in,
     std::ostream &out,
-    std::ostream &err
-) {
-    std::size_t data_size = data_in.seekg(0, std::ios::end).tellg();
-    data_in.seekg(0, std::ios::beg);
+    std::ostream &err,
+    const hide_options &options
+)
+    : images(images)
+    , data_in(data_in)
+    , out(out)
+    , err(err)
+    , options(options)
+    , id(generate_id())
+    , prefetcher(options.prefetch, options.memory_limit) {}
 
-    std::vector<uint8_t> data(data_size);
-    data_in.read(reinterpret_cast<char*>(data.data()), data_size);
-    std::span span(data);
+bool hide_session::step() {
+    if (finished)
+        return false;
 
-    uint8_t id = generate_id();
+    if (!data_loaded) {
+        if (!read_message(data_in, data, options, err))
+            return finish(1);
+        auto message_size = data.size();
+        auto message_checksum = options.journal.path.empty() ? 0 : crc32c(data);
+        encoding = encode_data(data, options, out);
+        if (!options.journal.path.empty() &&
+            !open_journal(message_size, message_checksum))
+            return finish(1);
+        if (!plan_carriers(images, encoding, data.size(), err, options))
+            return finish(1);
+        /* nothing is written if the hiding can not fit into the limit */
+        auto needs = hiding_memory(images, encoding, data.size(), false);
+        if (!check_memory_limit(options.memory_limit, needs.total(), err))
+            return finish(1);
+        if (encoding.flags & MD_FLAG_INTERLEAVED)
+            interleave_data(data, encoding);
+        data_loaded = true;
+        return true;
+    }
 
-    uint8_t seq = 0u;
-    auto data_index = 0ul;
+    if (hider) {
+        if (hider->step(err))
+            return true;
+        auto failed = hider->failed();
+        hider.reset();
+        images[seq].close();
+        if (failed || !record_image())
+            return finish(2);
+        if (parity_parts.empty())
+            data_index += data_parts.back().size();
+        ++seq;
+        return true;
+    }
 
-    for (; data_index < data_size && seq < images.size(); ++seq) {
-        auto capacity = images[seq].byte_capacity();
-        image_capacity_log(out, images[seq].filename, capacity);
+    if (data_index < data.size() && seq < images.size()) {
+        if (seq >= MAX_IMAGES) {
+            too_many_images_log(err);
+            return finish(1);
+        }
+        auto &im = images[seq];
+        prefetcher.advance(images, seq);
+        /* extra metadata reduce the capacity */
+        apply_encoding(im, encoding);
+        auto capacity = im.byte_capacity();
 
-        auto sspan_size = std::min(capacity, data_size - data_index);
-        std::span data_part = span.subspan(data_index, sspan_size);
+        auto sspan_size = encoding.part_sizes.empty()
+            ? std::min(capacity, data.size() - data_index)
+            : encoding.part_sizes[seq];
+        std::span data_part = std::span(data).subspan(data_index, sspan_size);
+        data_parts.push_back(data_part);
+        auto cipher = encoding.cipher ? &*encoding.cipher : nullptr;
 
-        if (!hide_data(images[seq], data_part, id, seq, err))
-            return 2;
-        data_index += capacity;
+        part_offset = data_index;
+        part_size = data_part.size();
+        bool completed = false;
+        if (!completed_image(completed))
+            return finish(1);
+        if (completed) {
+            image_skipped_log(out, im.filename);
+            seal_data_part(im, data_part, cipher, data_index);
+            data_index += data_part.size();
+            ++seq;
+            return true;
+        }
+        image_capacity_log(out, im.filename, capacity);
+        measure_distortion(im, options);
+
+        if (encoding.scatter_key) {
+            if (!hide_scattered(im, data_part, id, static_cast<uint8_t>(seq),
+                                cipher, *encoding.scatter_key, data_index, err)
+                || !record_image())
+                return finish(2);
+            data_index += data_part.size();
+            ++seq;
+            return true;
+        }
+        if (small_hiding(im)) {
+            if (!hide_small(im, data_part, id, static_cast<uint8_t>(seq),
+                            cipher, data_index, err) || !record_image())
+                return finish(2);
+            data_index += data_part.size();
+            ++seq;
+            return true;
+        }
+
+        if (!im.open_input() || !im.open_output()) {
+            open_error_log(err, im.filename);
+            im.close();
+            return finish(2);
+        }
+        hider.emplace(im, data_part, id, static_cast<uint8_t>(seq), cipher,
+                      data_index);
+        return true;
     }
 
-    for (; seq < images.size(); ++seq)
+    if (data_index >= data.size() &&
+        seq < encoding.carriers.data + encoding.carriers.parity)
+        return hide_parity_part();
+
+    /* a selection usually leaves most of a large pool unused */
+    for (; seq < images.size() && options.select == carrier_selection::ORDER;
+         ++seq)
         image_not_necessary_log(out, images[seq].filename);
 
-    if (data_index < data_size) {
-        data_size_error_log(err, data_index, data_size);
-        return 1;
+    if (data_index < data.size()) {
+        data_size_error_log(err, data_index, data.size());
+        return finish(1);
+    }
+    return finish(0);
+}
+
+bool hide_session::hide_parity_part() {
+    /* data parts are already encrypted, so parity covers the stored data */
+    if (parity_parts.empty())
+        parity_parts = encode_parity(data_parts, encoding.carriers.parity);
+
+    auto &im = images[seq];
+    prefetcher.advance(images, seq);
+    auto &parity_part = parity_parts[seq - encoding.carriers.data];
+    apply_encoding(im, encoding);
+    std::ranges::copy(std::span(parity_part).first(PARITY_HEADER_SIZE),
+                      metadata_parity_header(im).begin());
+    auto part = std::span(parity_part).subspan(PARITY_HEADER_SIZE);
+    part_offset = 0;
+    part_size = part.size();
+    bool completed = false;
+    if (!completed_image(completed))
+        return finish(1);
+    if (completed) {
+        image_skipped_log(out, im.filename);
+        ++seq;
+        return true;
+    }
+    image_capacity_log(out, im.filename, im.byte_capacity());
+    if (im.byte_capacity() < part.size()) {
+        parity_capacity_log(err, im.filename, im.byte_capacity(), part.size());
+        return finish(1);
+    }
+    measure_distortion(im, options);
+
+    if (encoding.scatter_key) {
+        if (!hide_scattered(im, part, id, static_cast<uint8_t>(seq), nullptr,
+                            *encoding.scatter_key, 0, err) || !record_image())
+            return finish(2);
+        ++seq;
+        return true;
     }
-    return 0;
+    if (small_hiding(im)) {
+        if (!hide_small(im, part, id, static_cast<uint8_t>(seq), nullptr, 0,
+                        err) || !record_image())
+            return finish(2);
+        ++seq;
+        return true;
+    }
+    if (!im.open_input() || !im.open_output()) {
+        open_error_log(err, im.filename);
+        im.close();
+        return finish(2);
+    }
+    hider.emplace(im, part, id, static_cast<uint8_t>(seq));
+    return true;
+}
+
+/**
+ * @brief Loads the journal of the resumed hiding, or starts a new one. The id
+ * and the nonce of the recorded hiding are used, so the skipped images belong
+ * to the same hiding.
+ */
+bool hide_session::open_journal(
+    std::size_t message_size,
+    uint32_t message_checksum
+) {
+    journal.emplace();
+    journal_header header{"hide", id, message_size, message_checksum,
+                          encoding.flags, encoding.nonce};
+    auto &path = options.journal.path;
+    if (!options.journal.resume || !std::filesystem::exists(path))
+        return journal->start(path, header, err);
+
+    if (!journal->load(path, err))
+        return false;
+    auto &recorded = journal->header();
+    header.id = recorded.id;
+    header.nonce = recorded.nonce;
+    if (recorded != header) {
+        journal_mismatch_log(err, path);
+        return false;
+    }
+    id = recorded.id;
+    if (encoding.cipher)
+        reuse_nonce(encoding, options, recorded.nonce);
+    return true;
+}
+
+/**
+ * @brief Checks whether the current image is recorded in the journal
+ * of the resumed hiding and its altered file is unchanged. The recorded
+ * image has to hold the same part of the message with the same chunk size,
+ * otherwise the images of both runs could not be extracted together.
+ * 
+ * @param completed set if the image can be skipped
+ * 
+ * @return `false` if the image was recorded with a different part
+ * or chunk size, which is logged
+ */
+bool hide_session::completed_image(bool &completed) {
+    auto entry = journal
+        ? journal->completed(seq, images[seq].get_output_path())
+        : nullptr;
+    completed = entry != nullptr;
+    if (entry && (entry->part_offset != part_offset ||
+                  entry->part_size != part_size ||
+                  entry->chunk_size != images[seq].chunk_size)) {
+        journal_mismatch_log(err, options.journal.path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Records the current image in the journal, after its altered file
+ * was written and closed.
+ */
+bool hide_session::record_image() {
+    if (!journal)
+        return true;
+    auto path = images[seq].get_output_path();
+    std::error_code ec{};
+    journal_entry entry{seq, path, 0, std::filesystem::file_size(path, ec), 0,
+                        part_offset, part_size, images[seq].chunk_size};
+    if (ec || !file_checksum(path, 0, entry.size, entry.checksum)) {
+        output_read_error_log(err, path);
+        return false;
+    }
+    return journal->record(entry, err);
+}
+
+bool hide_session::finish(int result) {
+    this->res = result;
+    finished = true;
+    return false;
+}
+
+int hide_session::result() const {
+    return res;
+}
+
+int hide(
+    std::vector<bmp_image> &images,
+    std::istream &data_in,
+    std::ostream &out,
+    std::ostream &err,
+    const hide_options &options
+) {
+    hide_session session{images, data_in, out, err, options};
+    while (session.step()) {}
+    return session.result();
 }
@@ -0,0 +1,420 @@
+#include "in_memory.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "configuration.h"
+#include "chunker.h"
+#include "metadata.h"
+
+static void too_short_log(
+    std::ostream &os,
+    std::string_view filename,
+    std::size_t size
+) {
+    os << "image " << filename << " is too short, bytes available: "
+       << size << '\n';
+}
+
+static void output_too_small_log(std::ostream &os, std::string_view filename) {
+    os << "output buffer for image " << filename
+       << " is smaller than the image\n";
+}
+
+static void capacity_log(
+    std::ostream &os,
+    std::string_view filename,
+    std::size_t capacity,
+    std::size_t data_size
+) {
+    os << "image " << filename << " has only " << capacity << " byte capacity ("
+       << data_size << " byte capacity is needed)\n";
+}
+
+static void run_out_of_bytes_log(std::ostream &os, std::string_view filename) {
+    os << "image " << filename << " is smaller than its header states\n";
+}
+
+static std::size_t cell_count(const bmp_image &im) {
+    return static_cast<std::size_t>(im.width) * im.channel_count * im.height;
+}
+
+/**
+ * @brief Checks whether `cells` cells starting at `first_cell` are inside
+ * the image and inside the pixel data of size `pixels_size`.
+ */
+static bool cells_fit(
+    const bmp_image &im,
+    std::size_t pixels_size,
+    std::size_t first_cell,
+    std::size_t cells
+) {
+    if (cells == 0)
+        return true;
+    auto last_cell = first_cell + cells - 1;
+    return last_cell < cell_count(im) && im.cell_offset(last_cell) < pixels_size;
+}
+
+bool load_header_from_memory(
+    bmp_image &im,
+    std::span<const std::byte> image,
+    std::ostream &err
+) {
+    auto bytes = reinterpret_cast<const uint8_t *>(image.data());
+    if (image.size() < BMP_FILE_HEADER_SIZE) {
+        too_short_log(err, im.filename, image.size());
+        return false;
+    }
+    im.header.assign(bytes, bytes + BMP_FILE_HEADER_SIZE);
+    if (!im.parse_file_header(err))
+        return false;
+
+    if (image.size() < im.data_offset) {
+        too_short_log(err, im.filename, image.size());
+        return false;
+    }
+    im.header.assign(bytes, bytes + im.data_offset);
+    return im.parse_info_header(err);
+}
+
+bool read_image(bmp_image &im, std::vector<std::byte> &image) {
+    if (!im.open_input())
+        return false;
+    if (im.seekable) {
+        /* the stream may have been read to the end already */
+        im.input->clear();
+        auto end = im.input->seekg(0, std::ios::end).tellg();
+        if (end > 0)
+            image.reserve(end);
+    }
+    im.set_data_start();
+
+    auto header = reinterpret_cast<const std::byte *>(im.header.data());
+    image.assign(header, header + im.header.size());
+    std::array<char, BUFFER_SIZE> block;
+    while (im.input->read(block.data(), block.size()) || im.input->gcount() > 0) {
+        auto bytes = reinterpret_cast<const std::byte *>(block.data());
+        image.insert(image.end(), bytes, bytes + im.input->gcount());
+    }
+    im.close();
+    return true;
+}
+
+std::size_t image_file_size(const bmp_image &im) {
+    std::size_t row_size = static_cast<std::size_t>(im.width)
+                           * im.channel_count + im.padding;
+    return im.data_offset + row_size * im.height;
+}
+
+bool is_small_image(const bmp_image &im) {
+    return im.seekable && !im.input && im.filename != STDIO_FILENAME &&
+           image_file_size(im) <= SMALL_IMAGE_SIZE;
+}
+
+std::vector<std::byte> &small_image_buffer() {
+    thread_local std::vector<std::byte> buffer{};
+    return buffer;
+}
+
+bool read_image_file(const bmp_image &im, std::vector<std::byte> &image) {
+    auto fd = ::open(im.filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    auto ok = ::fstat(fd, &st) == 0;
+    if (ok) {
+        image.resize(st.st_size);
+        std::size_t size = 0;
+        while (size < image.size()) {
+            auto n = ::read(fd, image.data() + size, image.size() - size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            size += n;
+        }
+        ok = size == image.size();
+    }
+    ::close(fd);
+    return ok;
+}
+
+bool write_image_file(bmp_image &im, std::span<const std::byte> image) {
+    auto fd = ::open(im.get_output_path().c_str(),
+                     O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        return false;
+    std::size_t size = 0;
+    while (size < image.size()) {
+        auto n = ::write(fd, image.data() + size, image.size() - size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size += n;
+    }
+    return ::close(fd) == 0 && size == image.size();
+}
+
+bool hide_bytes_at(
+    const bmp_image &im,
+    std::span<std::byte> pixels,
+    std::size_t first_cell,
+    std::span<const uint8_t> bytes,
+    uint8_t chunk_size,
+    image_distortion *distortion
+) {
+    auto cells_per_byte = 8 / chunk_size;
+    if (!cells_fit(im, pixels.size(), first_cell, bytes.size() * cells_per_byte))
+        return false;
+
+    auto mask = get_mask(chunk_size);
+    uint8_t erase_mask = ~mask;
+    std::size_t row_size = static_cast<std::size_t>(im.width) * im.channel_count;
+    auto col = first_cell % row_size;
+    /* rows hold whole pixels, so the channel restarts with each row */
+    std::size_t channel = col % im.channel_count;
+    auto cell = reinterpret_cast<uint8_t *>(pixels.data())
+                + im.cell_offset(first_cell);
+
+    for (auto byte : bytes) {
+        for (auto _ = 0; _ < cells_per_byte; ++_) {
+            auto before = *cell;
+            *cell = (before & erase_mask) | (byte & mask);
+            if (distortion)
+                distortion->add(channel, before, *cell);
+            byte >>= chunk_size;
+            ++cell;
+            if (++channel == im.channel_count)
+                channel = 0;
+            if (++col == row_size) {
+                col = 0;
+                cell += im.padding;
+            }
+        }
+    }
+    return true;
+}
+
+bool extract_bytes_at(
+    const bmp_image &im,
+    std::span<const std::byte> pixels,
+    std::size_t first_cell,
+    std::span<uint8_t> bytes,
+    uint8_t chunk_size
+) {
+    auto cells_per_byte = 8 / chunk_size;
+    if (!cells_fit(im, pixels.size(), first_cell, bytes.size() * cells_per_byte))
+        return false;
+
+    auto mask = get_mask(chunk_size);
+    std::size_t row_size = static_cast<std::size_t>(im.width) * im.channel_count;
+    auto col = first_cell % row_size;
+    auto cell = reinterpret_cast<const uint8_t *>(pixels.data())
+                + im.cell_offset(first_cell);
+
+    for (auto &byte : bytes) {
+        byte = 0;
+        for (auto i = 0; i < cells_per_byte; ++i) {
+            byte |= (*cell & mask) << (i * chunk_size);
+            ++cell;
+            if (++col == row_size) {
+                col = 0;
+                cell += im.padding;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks whether all data cells of the scatter are inside the pixel data
+ * and `cells` cells starting at `first_index` are inside the scatter.
+ */
+static bool scattered_cells_fit(
+    const bmp_image &im,
+    std::size_t pixels_size,
+    const cell_scatter &scatter,
+    std::size_t first_index,
+    std::size_t cells
+) {
+    return first_index <= scatter.cell_count() &&
+           cells <= scatter.cell_count() - first_index &&
+           cells_fit(im, pixels_size, im.data_start_cell(), scatter.cell_count());
+}
+
+bool hide_bytes_scattered(
+    const bmp_image &im,
+    std::span<std::byte> pixels,
+    const cell_scatter &scatter,
+    std::size_t first_index,
+    std::span<const uint8_t> bytes,
+    uint8_t chunk_size,
+    image_distortion *distortion
+) {
+    auto cells_per_byte = 8 / chunk_size;
+    if (!scattered_cells_fit(im, pixels.size(), scatter, first_index,
+                             bytes.size() * cells_per_byte))
+        return false;
+
+    auto mask = get_mask(chunk_size);
+    uint8_t erase_mask = ~mask;
+    auto data = reinterpret_cast<uint8_t *>(pixels.data());
+    auto index = first_index;
+    for (auto byte : bytes) {
+        for (auto _ = 0; _ < cells_per_byte; ++_) {
+            auto cell_index = scatter(index++);
+            auto &cell = data[im.cell_offset(cell_index)];
+            auto before = cell;
+            cell = (before & erase_mask) | (byte & mask);
+            if (distortion)
+                distortion->add(cell_index % im.channel_count, before, cell);
+            byte >>= chunk_size;
+        }
+    }
+    return true;
+}
+
+bool extract_bytes_scattered(
+    const bmp_image &im,
+    std::span<const std::byte> pixels,
+    const cell_scatter &scatter,
+    std::size_t first_index,
+    std::span<uint8_t> bytes,
+    uint8_t chunk_size
+) {
+    auto cells_per_byte = 8 / chunk_size;
+    if (!scattered_cells_fit(im, pixels.size(), scatter, first_index,
+                             bytes.size() * cells_per_byte))
+        return false;
+
+    auto mask = get_mask(chunk_size);
+    auto data = reinterpret_cast<const uint8_t *>(pixels.data());
+    auto index = first_index;
+    for (auto &byte : bytes) {
+        byte = 0;
+        for (auto i = 0; i < cells_per_byte; ++i)
+            byte |= (data[im.cell_offset(scatter(index++))] & mask)
+                    << (i * chunk_size);
+    }
+    return true;
+}
+
+/**
+ * @brief Hides metadata and data part into the image with already
+ * loaded header.
+ */
+static bool hide_loaded(
+    bmp_image &im,
+    std::span<std::byte> image,
+    std::span<const uint8_t> to_hide,
+    uint8_t id,
+    uint8_t seq,
+    std::ostream &err
+) {
+    if (to_hide.size() > im.byte_capacity()) {
+        capacity_log(err, im.filename, im.byte_capacity(), to_hide.size());
+        return false;
+    }
+
+    auto metadata = make_metadata(
+        im, static_cast<uint32_t>(to_hide.size()), id, seq);
+    auto pixels = image.subspan(im.data_offset);
+    auto distortion = im.distortion ? &*im.distortion : nullptr;
+
+    if (!hide_bytes_at(im, pixels, 0, metadata, MD_CHUNK_SIZE, distortion) ||
+        !hide_bytes_at(im, pixels, im.data_start_cell(), to_hide,
+                       im.chunk_size, distortion)) {
+        run_out_of_bytes_log(err, im.filename);
+        return false;
+    }
+    return true;
+}
+
+bool hide_data_in_memory(
+    bmp_image &im,
+    std::span<const std::byte> carrier,
+    std::span<std::byte> output,
+    std::span<const uint8_t> to_hide,
+    uint8_t id,
+    uint8_t seq,
+    std::ostream &err
+) {
+    if (!load_header_from_memory(im, carrier, err))
+        return false;
+    if (output.size() < carrier.size()) {
+        output_too_small_log(err, im.filename);
+        return false;
+    }
+    if (output.data() != carrier.data())
+        std::memcpy(output.data(), carrier.data(), carrier.size());
+
+    return hide_loaded(im, output.first(carrier.size()), to_hide, id, seq, err);
+}
+
+bool hide_data_in_place(
+    bmp_image &im,
+    std::span<std::byte> image,
+    std::span<const uint8_t> to_hide,
+    uint8_t id,
+    uint8_t seq,
+    std::ostream &err
+) {
+    if (!load_header_from_memory(im, image, err))
+        return false;
+    return hide_loaded(im, image, to_hide, id, seq, err);
+}
+
+bool extract_metadata_in_memory(
+    bmp_image &im,
+    std::span<const std::byte> image,
+    std::ostream &err
+) {
+    if (!load_header_from_memory(im, image, err))
+        return false;
+
+    auto pixels = image.subspan(im.data_offset);
+    std::vector<uint8_t> metadata(HIDDEN_METADATA_SIZE);
+    if (!extract_bytes_at(im, pixels, 0, metadata, MD_CHUNK_SIZE)) {
+        run_out_of_bytes_log(err, im.filename);
+        return false;
+    }
+    if (!parse_metadata(im, metadata, err))
+        return false;
+
+    auto cells_per_byte = 8 / MD_CHUNK_SIZE;
+    while (auto size = missing_extra_metadata(im)) {
+        auto extracted = im.extra_metadata.size();
+        im.extra_metadata.resize(extracted + size);
+        if (!extract_bytes_at(im, pixels,
+                              HIDDEN_METADATA_CELLS + extracted * cells_per_byte,
+                              std::span(im.extra_metadata).subspan(extracted),
+                              MD_CHUNK_SIZE)) {
+            run_out_of_bytes_log(err, im.filename);
+            return false;
+        }
+        if (!parse_extra_metadata(im, err))
+            return false;
+    }
+    return true;
+}
+
+bool extract_data_in_memory(
+    const bmp_image &im,
+    std::span<const std::byte> image,
+    std::span<uint8_t> data,
+    std::ostream &err
+) {
+    if (data.size() > im.hidden_data_size ||
+        !extract_bytes_at(im, image.subspan(im.data_offset),
+                          im.data_start_cell(), data, im.chunk_size)) {
+        run_out_of_bytes_log(err, im.filename);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#include "interleave.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "configuration.h"
+
+interleaved_layout::interleaved_layout(
+    std::span<const std::size_t> capacities,
+    std::size_t data_size
+)
+    : part_sizes(capacities.size())
+    , part_starts(capacities.size()) {
+    auto count = capacities.size();
+    std::size_t part = 0;
+    std::size_t offset = 0;
+    while (offset < data_size) {
+        /* full parts are skipped */
+        for (auto _ = 0u; _ < count && part_sizes[part] == capacities[part]; ++_)
+            part = (part + 1) % count;
+        if (part_sizes[part] == capacities[part])
+            break;
+        auto size = std::min({INTERLEAVE_UNIT_SIZE,
+                              capacities[part] - part_sizes[part],
+                              data_size - offset});
+        units.push_back({part, part_sizes[part], offset, size});
+        part_sizes[part] += size;
+        offset += size;
+        part = (part + 1) % count;
+    }
+    for (auto i = 1u; i < count; ++i)
+        part_starts[i] = part_starts[i - 1] + part_sizes[i - 1];
+}
+
+const interleave_unit &interleaved_layout::unit_at(std::size_t offset) const {
+    auto unit = std::ranges::upper_bound(units, offset, {},
+                                         &interleave_unit::message_offset);
+    assert(unit != units.begin());
+    return *(unit - 1);
+}
+
+void interleaved_layout::interleave(
+    std::span<const uint8_t> message,
+    std::span<uint8_t> parts
+) const {
+    for (auto &unit : units)
+        std::memcpy(parts.data() + part_starts[unit.part] + unit.part_offset,
+                    message.data() + unit.message_offset, unit.size);
+}
+
+void interleaved_layout::deinterleave(
+    std::span<const uint8_t> parts,
+    std::span<uint8_t> message
+) const {
+    for (auto &unit : units)
+        std::memcpy(message.data() + unit.message_offset,
+                    parts.data() + part_starts[unit.part] + unit.part_offset,
+                    unit.size);
+}
@@ -0,0 +1,195 @@
+#include "journal.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <span>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bitmap.h"
+#include "crc.h"
+
+static void corrupted_journal_log(std::ostream &os, std::string_view path) {
+    os << "journal " << path << " is corrupted\n";
+}
+
+static void journal_write_error_log(std::ostream &os, std::string_view path) {
+    os << "could not write journal " << path << '\n';
+}
+
+static std::string to_hex(std::span<const uint8_t> bytes) {
+    std::ostringstream os{};
+    os << std::hex << std::setfill('0');
+    for (auto byte : bytes)
+        os << std::setw(2) << static_cast<unsigned>(byte);
+    return os.str();
+}
+
+static bool from_hex(std::string_view hex, std::span<uint8_t> bytes) {
+    if (hex.size() != 2 * bytes.size())
+        return false;
+    for (auto i = 0u; i < bytes.size(); ++i) {
+        unsigned value = 0;
+        for (auto c : hex.substr(2 * i, 2)) {
+            value <<= 4;
+            if (c >= '0' && c <= '9')
+                value |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                value |= c - 'a' + 10;
+            else
+                return false;
+        }
+        bytes[i] = static_cast<uint8_t>(value);
+    }
+    return true;
+}
+
+bool job_journal::load(const std::string &path, std::ostream &err) {
+    std::ifstream file{path};
+    if (!file.is_open())
+        return false;
+
+    std::string line{};
+    if (!std::getline(file, line) || line != JOURNAL_MAGIC ||
+        !std::getline(file, line)) {
+        corrupted_journal_log(err, path);
+        return false;
+    }
+    journal_header header{};
+    std::istringstream fields{line};
+    unsigned id = 0;
+    std::string nonce{};
+    fields >> header.kind >> id >> header.size >> std::hex >> header.checksum
+           >> header.flags >> nonce;
+    if (!fields || id > UINT8_MAX || !from_hex(nonce, header.nonce)) {
+        corrupted_journal_log(err, path);
+        return false;
+    }
+    header.id = static_cast<uint8_t>(id);
+
+    std::vector<journal_entry> recorded{};
+    while (std::getline(file, line)) {
+        journal_entry entry{};
+        std::istringstream entry_fields{line};
+        unsigned chunk_size = 0;
+        entry_fields >> entry.seq >> entry.offset >> entry.size >> std::hex
+                     >> entry.checksum >> std::dec >> entry.part_offset
+                     >> entry.part_size >> chunk_size;
+        entry.chunk_size = static_cast<uint8_t>(chunk_size);
+        /* the path is the rest of the line, so it can contain spaces */
+        if (!entry_fields || chunk_size > UINT8_MAX ||
+            entry_fields.get() != ' ' ||
+            !std::getline(entry_fields, entry.path) || entry.path.empty()) {
+            corrupted_journal_log(err, path);
+            return false;
+        }
+        recorded.push_back(std::move(entry));
+    }
+
+    this->path = path;
+    hdr = header;
+    entries = std::move(recorded);
+    return true;
+}
+
+bool job_journal::start(
+    const std::string &path,
+    const journal_header &header,
+    std::ostream &err
+) {
+    this->path = path;
+    hdr = header;
+    entries.clear();
+    return write(err);
+}
+
+bool job_journal::record(const journal_entry &entry, std::ostream &err) {
+    entries.push_back(entry);
+    return write(err);
+}
+
+const journal_entry *job_journal::completed(
+    std::size_t seq,
+    const std::string &path
+) const {
+    for (auto &entry : entries) {
+        uint32_t checksum = 0;
+        if (entry.seq == seq && entry.path == path &&
+            file_checksum(entry.path, entry.offset, entry.size, checksum) &&
+            checksum == entry.checksum)
+            return &entry;
+    }
+    return nullptr;
+}
+
+const journal_header &job_journal::header() const {
+    return hdr;
+}
+
+bool job_journal::write(std::ostream &err) {
+    std::ostringstream os{};
+    os << JOURNAL_MAGIC << '\n'
+       << hdr.kind << ' ' << static_cast<unsigned>(hdr.id) << ' ' << hdr.size
+       << ' ' << std::hex << hdr.checksum << ' ' << hdr.flags << std::dec
+       << ' ' << to_hex(hdr.nonce) << '\n';
+    for (auto &entry : entries)
+        os << entry.seq << ' ' << entry.offset << ' ' << entry.size << ' '
+           << std::hex << entry.checksum << std::dec << ' '
+           << entry.part_offset << ' ' << entry.part_size << ' '
+           << static_cast<unsigned>(entry.chunk_size) << ' ' << entry.path
+           << '\n';
+    auto content = os.str();
+
+    /* the journal is replaced at once, a preempted write leaves only
+     * the temporary file */
+    auto tmp_path = path + ".tmp";
+    auto fd = ::open(tmp_path.c_str(),
+                     O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        journal_write_error_log(err, path);
+        return false;
+    }
+    std::size_t size = 0;
+    while (size < content.size()) {
+        auto n = ::write(fd, content.data() + size, content.size() - size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size += n;
+    }
+    auto ok = size == content.size() && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        journal_write_error_log(err, path);
+        return false;
+    }
+    return true;
+}
+
+bool file_checksum(
+    const std::string &path,
+    std::size_t offset,
+    std::size_t size,
+    uint32_t &checksum
+) {
+    std::ifstream file{path, std::ios::binary};
+    if (!file.is_open() || !file.seekg(offset))
+        return false;
+    checksum = 0;
+    std::array<char, BUFFER_SIZE> block;
+    while (size > 0) {
+        auto count = std::min(size, block.size());
+        if (!file.read(block.data(), count))
+            return false;
+        checksum = crc32c({reinterpret_cast<const uint8_t *>(block.data()),
+                           count}, checksum);
+        size -= count;
+    }
+    return true;
+}
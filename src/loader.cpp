@@ -0,0 +1,166 @@
+#include "loader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "catalog.h"
+#include "configuration.h"
+#include "in_memory.h"
+#include "parallel.h"
+
+static void could_not_open_log(std::ostream &os, std::string_view filename) {
+    os << "image " << filename << " could not be opened\n";
+}
+
+static void read_error_log(
+    std::ostream &os,
+    std::string_view filename,
+    std::size_t bytes_read
+) {
+    os << "there was an error while reading file " << filename
+       << ", bytes read: " << bytes_read << '\n';
+}
+
+/**
+ * @brief Reads `size` bytes at `offset` of the file, retrying after
+ * interrupted and partial reads.
+ * 
+ * @return number of bytes read, it is smaller than `size` only on error or
+ * at the end of file
+ */
+static std::size_t read_at(int fd, uint8_t *data, std::size_t size, off_t offset) {
+    std::size_t total = 0;
+    while (total < size) {
+        auto n = pread(fd, data + total, size - total, offset + total);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        total += n;
+    }
+    return total;
+}
+
+/**
+ * @brief Reads and checks the header of the open image file.
+ */
+static bool read_header(int fd, bmp_image &im, std::ostream &err) {
+    im.header.resize(BMP_FILE_HEADER_SIZE);
+    auto n = read_at(fd, im.header.data(), BMP_FILE_HEADER_SIZE, 0);
+    if (n != BMP_FILE_HEADER_SIZE) {
+        read_error_log(err, im.filename, n);
+        return false;
+    }
+    if (!im.parse_file_header(err))
+        return false;
+
+    im.header.resize(im.data_offset);
+    auto rest = im.data_offset - BMP_FILE_HEADER_SIZE;
+    n = read_at(fd, im.header.data() + BMP_FILE_HEADER_SIZE, rest,
+                BMP_FILE_HEADER_SIZE);
+    if (n != rest) {
+        read_error_log(err, im.filename, BMP_FILE_HEADER_SIZE + n);
+        return false;
+    }
+    return im.parse_info_header(err);
+}
+
+bool probe_header(bmp_image &im, std::ostream &err) {
+    int fd = open(im.filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        could_not_open_log(err, im.filename);
+        return false;
+    }
+    auto result = read_header(fd, im, err);
+    close(fd);
+    return result;
+}
+
+bool probe_metadata(bmp_image &im, std::ostream &err) {
+    int fd = open(im.filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        could_not_open_log(err, im.filename);
+        return false;
+    }
+
+    auto result = [&]() {
+        if (!read_header(fd, im, err))
+            return false;
+        /* metadata are hidden in the first cells, padding can follow
+         * each row of them */
+        std::size_t cells = static_cast<std::size_t>(im.width)
+                            * im.channel_count * im.height;
+        auto metadata_cells = std::min(MAX_METADATA_SIZE * 8 / MD_CHUNK_SIZE,
+                                       cells);
+        auto size = im.cell_offset(metadata_cells - 1) + 1;
+        std::vector<std::byte> prefix(im.data_offset + size);
+        std::memcpy(prefix.data(), im.header.data(), im.data_offset);
+        auto n = read_at(fd, reinterpret_cast<uint8_t *>(prefix.data())
+                                 + im.data_offset, size, im.data_offset);
+        prefix.resize(im.data_offset + n);
+        return extract_metadata_in_memory(im, prefix, err);
+    }();
+
+    close(fd);
+    return result;
+}
+
+bool is_streamed(const std::string &filename) {
+    if (filename == STDIO_FILENAME)
+        return true;
+    std::error_code ec;
+    auto status = std::filesystem::status(filename, ec);
+    return !ec && std::filesystem::exists(status)
+        && !std::filesystem::is_regular_file(status)
+        && !std::filesystem::is_directory(status);
+}
+
+/**
+ * @brief Loads header of the image which has to be read sequentially.
+ * Its input stream is assigned (not opened), so it stays open until
+ * the image is destroyed and it is positioned at the pixel data.
+ */
+static bool load_streamed(bmp_image &im, std::ostream &err) {
+    if (!im.assign_input()) {
+        could_not_open_log(err, im.filename);
+        return false;
+    }
+    im.seekable = false;
+    return im.load_header(err);
+}
+
+void load_images(
+    const std::vector<image_arg> &args,
+    std::vector<bmp_image> &images,
+    std::size_t jobs,
+    std::ostream &err,
+    const carrier_catalog *catalog
+) {
+    std::vector<std::optional<bmp_image>> loaded(args.size());
+    std::vector<std::ostringstream> errors(args.size());
+
+    parallel_for(args.size(), jobs, [&](std::size_t i) {
+        bmp_image im(args[i].filename, args[i].chunk_size);
+        bool ok;
+        if (is_streamed(im.filename))
+            ok = load_streamed(im, errors[i]);
+        else
+            ok = (catalog && catalog->load(im, errors[i])) ||
+                 probe_header(im, errors[i]);
+        if (ok)
+            loaded[i] = std::move(im);
+    });
+
+    for (auto i = 0u; i < args.size(); ++i) {
+        err << errors[i].str();
+        if (loaded[i])
+            images.push_back(std::move(*loaded[i]));
+    }
+}
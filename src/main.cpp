@@ -1,18 +1,155 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <sstream>
 #include <string>
 #include <string_view>
 
 #include "bitmap.h"
+#include "bundle.h"
+#include "catalog.h"
+#include "daemon.h"
+#include "discover.h"
 #include "hide.h"
 #include "extract.h"
+#include "loader.h"
+#include "parallel.h"
+#include "scheduler.h"
+#include "stripes.h"
+#include "update.h"
+#include "verify.h"
 
-enum mode { NO_MODE, HIDE, EXTRACT };
+enum mode { NO_MODE, HIDE, EXTRACT, VERIFY, UPDATE, INDEX, DAEMON };
+
+/* byte range of hidden data selected by --range */
+struct data_range {
+    bool used{false};
+    std::size_t offset{0};
+    std::size_t length{0};
+};
+
+static bool parse_range(const std::string &arg, data_range &range) {
+    auto colon = arg.find(':');
+    if (colon == std::string::npos)
+        return false;
+    try {
+        std::size_t end;
+        range.offset = std::stoull(arg.substr(0, colon), &end);
+        if (end != colon)
+            return false;
+        range.length = std::stoull(arg.substr(colon + 1), &end);
+        if (end != arg.size() - colon - 1)
+            return false;
+    }
+    catch(const std::exception& _) {
+        return false;
+    }
+    range.used = true;
+    return true;
+}
+
+/* everything parsed from the command line, no file is opened yet */
+struct cli_options {
+    std::vector<image_arg> images{};
+    std::string data_filename{};
+    /* files packed when hiding, or the directory of extracted files,
+     * see --bundle */
+    std::vector<std::string> bundle{};
+    /* single file extracted from a bundle, see --member */
+    std::string member{};
+    /* socket of the daemon, see --daemon and --client */
+    std::string socket{};
+    /* catalog of image headers, see --catalog */
+    std::string catalog{};
+    /* chunk size of images taken from the catalog */
+    uint8_t chunk_size{2};
+    /* output file or directory for altered images, see --output */
+    std::string output{};
+    data_range range{};
+    std::size_t jobs{default_jobs()};
+    /* maximum number of files open at the same time, see carrier_workers */
+    std::size_t max_open{64};
+    /* hide or extract stripes of images on all workers, see --parallel */
+    bool parallel{false};
+    bool stats{false};
+    /* tab-separated report of the distortion of altered images,
+     * see --distortion */
+    std::string distortion{};
+    /* group the images by hiding before extraction, see --discover */
+    bool discover{false};
+    /* the only discovered hiding which is extracted, 0 for all */
+    std::size_t hiding_id{0};
+    /* checksums are stored unless --no-checksum is used */
+    hide_options hiding{.checksum = true};
+    extract_options extracting{};
+};
+
+/* the key file holds the passphrase, a trailing newline is ignored */
+static bool read_key_file(const std::string &path, std::string &key) {
+    std::ifstream file{path, std::ios::binary};
+    if (!file.is_open())
+        return false;
+    key.assign(std::istreambuf_iterator<char>(file), {});
+    if (!key.empty() && key.back() == '\n')
+        key.pop_back();
+    return !key.empty();
+}
+
+static bool parse_count(const std::string &arg, std::size_t &count) {
+    try {
+        std::size_t end;
+        count = std::stoull(arg, &end);
+        return end == arg.size() && count > 0;
+    }
+    catch(const std::exception& _) {
+        return false;
+    }
+}
+
+/* size in bytes, optionally followed by K, M or G (powers of 1024) */
+static bool parse_size(const std::string &arg, std::size_t &size) {
+    std::size_t shift = 0;
+    auto digits = arg;
+    if (!digits.empty()) {
+        auto unit = std::string_view("KMG").find(digits.back());
+        if (unit != std::string_view::npos) {
+            shift = 10 * (unit + 1);
+            digits.pop_back();
+        }
+    }
+    if (digits.empty() || !parse_count(digits, size) ||
+        size > (SIZE_MAX >> shift))
+        return false;
+    size <<= shift;
+    return true;
+}
+
+/**
+ * @brief Selects the mode of the run, only one mode can be selected, but its
+ * option can be repeated.
+ * 
+ * @return `false` if a different mode was selected before
+ */
+static bool set_mode(mode &selected, mode m, std::ostream &err) {
+    if (selected != NO_MODE && selected != m) {
+        err << "only one of hide, extract, verify, "
+               "update, index and daemon can be used\n";
+        return false;
+    }
+    selected = m;
+    return true;
+}
 
 mode process_args(
     std::vector<std::string> &args,
-    std::vector<bmp_image> &images,
-    std::string &data_filename
+    cli_options &opts,
+    std::ostream &err
 ) {
     using namespace std::literals;
     mode m = NO_MODE;
@@ -22,105 +159,852 @@ mode process_args(
 
         if (args[i] == "--chunk_size"sv || args[i] == "-c"sv) {
             if (++i == args.size()) {
-                std::cerr << "-c|--chunk_size was used as the last argument\n";
+                err << "-c|--chunk_size was used as the last argument\n";
                 return NO_MODE;
             }
             try {
                 chunk_size = static_cast<uint8_t>(std::stoi(args[i]));
                 if (8 % chunk_size != 0) {
-                    std::cerr << "supported chunk_size values are: 1, 2, 4, 8\n";
+                    err << "supported chunk_size values are: 1, 2, 4, 8\n";
                     return NO_MODE;
                 }
             }
             catch(const std::exception& _) {
-                std::cerr << "could not convert given chunk_size into an integer\n";
+                err << "could not convert given chunk_size into an integer\n";
                 return NO_MODE;
             }
         }
         else if (args[i] == "--hide"sv || args[i] == "-h"sv) {
-            if (m == EXTRACT) {
-                std::cerr << "cannot use hide and extract at the same time\n";
+            if (!set_mode(m, HIDE, err))
                 return NO_MODE;
-            }
-            m = HIDE;
         }
         else if (args[i] == "--extract"sv || args[i] == "-e"sv) {
-            if (m == HIDE) {
-                std::cerr << "cannot use hide and extract at the same time\n";
+            if (!set_mode(m, EXTRACT, err))
+                return NO_MODE;
+        }
+        else if (args[i] == "--verify"sv) {
+            if (!set_mode(m, VERIFY, err))
+                return NO_MODE;
+        }
+        else if (args[i] == "--update"sv) {
+            if (!set_mode(m, UPDATE, err))
+                return NO_MODE;
+        }
+        else if (args[i] == "--index"sv) {
+            if (!set_mode(m, INDEX, err))
+                return NO_MODE;
+        }
+        else if (args[i] == "--daemon"sv) {
+            if (!set_mode(m, DAEMON, err))
+                return NO_MODE;
+            if (++i == args.size()) {
+                err << "--daemon was used as the last argument\n";
                 return NO_MODE;
             }
-            m = EXTRACT;
+            opts.socket = args[i];
+        }
+        else if (args[i] == "--catalog"sv) {
+            if (++i == args.size()) {
+                err << "--catalog was used as the last argument\n";
+                return NO_MODE;
+            }
+            opts.catalog = args[i];
         }
         else if (args[i] == "--file"sv || args[i] == "-f"sv) {
             if (++i == args.size()) {
-                std::cerr << "-f or --file was used as the last argument\n";
+                err << "-f or --file was used as the last argument\n";
                 return NO_MODE;
             }
-            data_filename = args[i];
+            opts.data_filename = args[i];
         }
-        else {
-            auto im = bmp_image(args[i], chunk_size);
-            if (!im.assign_input()) {
-                std::cerr << "image " << args[i] << " could not be opened\n";
-            } else if (im.load_header()) {
-                images.push_back(std::move(im));
+        else if (args[i] == "--bundle"sv || args[i] == "-b"sv) {
+            if (++i == args.size()) {
+                err << "-b or --bundle was used as the last argument\n";
+                return NO_MODE;
+            }
+            opts.bundle.push_back(args[i]);
+        }
+        else if (args[i] == "--member"sv) {
+            if (++i == args.size()) {
+                err << "--member was used as the last argument\n";
+                return NO_MODE;
+            }
+            opts.member = args[i];
+        }
+        else if (args[i] == "--output"sv || args[i] == "-o"sv) {
+            if (++i == args.size()) {
+                err << "-o or --output was used as the last argument\n";
+                return NO_MODE;
+            }
+            opts.output = args[i];
+        }
+        else if (args[i] == "--range"sv || args[i] == "-r"sv) {
+            if (++i == args.size()) {
+                err << "-r or --range was used as the last argument\n";
+                return NO_MODE;
+            }
+            if (!parse_range(args[i], opts.range)) {
+                err << "range has to be in OFFSET:LENGTH format\n";
+                return NO_MODE;
+            }
+        }
+        else if (args[i] == "--jobs"sv || args[i] == "-j"sv) {
+            if (++i == args.size()) {
+                err << "-j or --jobs was used as the last argument\n";
+                return NO_MODE;
+            }
+            if (!parse_count(args[i], opts.jobs)) {
+                err << "number of jobs has to be a positive integer\n";
+                return NO_MODE;
+            }
+        }
+        else if (args[i] == "--max-open"sv) {
+            if (++i == args.size()) {
+                err << "--max-open was used as the last argument\n";
+                return NO_MODE;
+            }
+            if (!parse_count(args[i], opts.max_open) || opts.max_open < 2) {
+                err << "--max-open has to be an integer of at least 2\n";
+                return NO_MODE;
+            }
+        }
+        else if (args[i] == "--memory-limit"sv) {
+            if (++i == args.size()) {
+                err << "--memory-limit was used as the last argument\n";
+                return NO_MODE;
+            }
+            if (!parse_size(args[i], opts.hiding.memory_limit)) {
+                err << "--memory-limit has to be a positive number of bytes, "
+                       "optionally followed by K, M or G\n";
+                return NO_MODE;
+            }
+        }
+        else if (args[i] == "--prefetch"sv) {
+            if (++i == args.size()) {
+                err << "--prefetch was used as the last argument\n";
+                return NO_MODE;
+            }
+            if (!parse_count(args[i], opts.hiding.prefetch)) {
+                err << "--prefetch has to be a positive number of images\n";
+                return NO_MODE;
+            }
+        }
+        else if (args[i] == "--parallel"sv || args[i] == "-p"sv) {
+            opts.parallel = true;
+        }
+        else if (args[i] == "--compress"sv || args[i] == "-z"sv) {
+            opts.hiding.compress = true;
+        }
+        else if (args[i] == "--key"sv || args[i] == "-k"sv) {
+            if (++i == args.size() || args[i].empty()) {
+                err << "-k or --key has to be followed by a passphrase\n";
+                return NO_MODE;
+            }
+            opts.hiding.key = args[i];
+        }
+        else if (args[i] == "--scatter"sv || args[i] == "-s"sv) {
+            opts.hiding.scatter = true;
+        }
+        else if (args[i] == "--key-file"sv) {
+            if (++i == args.size()) {
+                err << "--key-file was used as the last argument\n";
+                return NO_MODE;
+            }
+            if (!read_key_file(args[i], opts.hiding.key)) {
+                err << "could not read a passphrase from " << args[i]
+                    << '\n';
+                return NO_MODE;
+            }
+        }
+        else if (args[i] == "--stats"sv) {
+            opts.stats = true;
+        }
+        else if (args[i] == "--parity"sv) {
+            if (++i == args.size()) {
+                err << "--parity was used as the last argument\n";
+                return NO_MODE;
+            }
+            if (!parse_count(args[i], opts.hiding.parity) ||
+                opts.hiding.parity >= MAX_IMAGES) {
+                err << "number of parity images has to be a positive "
+                       "integer less than " << MAX_IMAGES << '\n';
+                return NO_MODE;
+            }
+        }
+        else if (args[i] == "--select"sv) {
+            if (++i == args.size()) {
+                err << "--select was used as the last argument\n";
+                return NO_MODE;
+            }
+            if (args[i] == "fewest-images"sv) {
+                opts.hiding.select = carrier_selection::FEWEST_CARRIERS;
+            } else if (args[i] == "fewest-bytes"sv) {
+                opts.hiding.select = carrier_selection::FEWEST_BYTES;
+            } else {
+                err << "--select has to be fewest-images or "
+                       "fewest-bytes\n";
+                return NO_MODE;
             }
         }
+        else if (args[i] == "--auto-chunk"sv) {
+            opts.hiding.auto_chunk = true;
+        }
+        else if (args[i] == "--interleave"sv) {
+            opts.hiding.interleave = true;
+        }
+        else if (args[i] == "--no-checksum"sv) {
+            opts.hiding.checksum = false;
+        }
+        else if (args[i] == "--journal"sv) {
+            if (++i == args.size() || args[i].empty()) {
+                err << "--journal has to be followed by a path\n";
+                return NO_MODE;
+            }
+            opts.hiding.journal.path = args[i];
+        }
+        else if (args[i] == "--resume"sv) {
+            opts.hiding.journal.resume = true;
+        }
+        else if (args[i] == "--distortion"sv) {
+            if (++i == args.size() || args[i].empty()) {
+                err << "--distortion has to be followed by a path\n";
+                return NO_MODE;
+            }
+            opts.distortion = args[i];
+            opts.hiding.distortion = true;
+        }
+        else if (args[i] == "--discover"sv) {
+            opts.discover = true;
+        }
+        else if (args[i] == "--id"sv) {
+            if (++i == args.size()) {
+                err << "--id was used as the last argument\n";
+                return NO_MODE;
+            }
+            if (!parse_count(args[i], opts.hiding_id) || opts.hiding_id > 255) {
+                err << "id of hiding has to be a number from 1 to 255\n";
+                return NO_MODE;
+            }
+        }
+        else {
+            opts.images.push_back({args[i], chunk_size});
+        }
     }
     if (m == NO_MODE) {
-        std::cerr << "no mode was selected\n";   
+        err << "no mode was selected\n";   
+        return NO_MODE;
+    } else if (m == DAEMON && (!opts.images.empty() || opts.data_filename != ""
+                               || !opts.bundle.empty())) {
+        err << "--daemon serves requests of clients, images and data "
+               "are given to --client\n";
+        return NO_MODE;
+    } else if (!opts.bundle.empty() && m != HIDE && m != EXTRACT) {
+        err << "-b/--bundle can be used only with hiding and "
+               "extraction\n";
+        return NO_MODE;
+    } else if (!opts.bundle.empty() && opts.data_filename != "") {
+        err << "-b/--bundle selects the data files, -f/--file can not "
+               "be used\n";
+        return NO_MODE;
+    } else if (opts.bundle.size() > 1 && m == EXTRACT) {
+        err << "-b/--bundle selects a single directory in extraction\n";
         return NO_MODE;
-    } else if (data_filename == "") {
-        std::cerr << "no data file was provided, please do so with -f/--file\n";
+    } else if (opts.member != "" && (m != EXTRACT || !opts.bundle.empty())) {
+        err << "--member can be used only with extraction, without "
+               "-b/--bundle\n";
+        return NO_MODE;
+    } else if (opts.member != "" && (opts.range.used || opts.parallel)) {
+        err << "--member can not be used with -r/--range or "
+               "-p/--parallel\n";
+        return NO_MODE;
+    } else if (opts.range.used && !opts.bundle.empty()) {
+        err << "-r/--range can not be used with -b/--bundle\n";
+        return NO_MODE;
+    } else if (m == INDEX && opts.catalog == "") {
+        err << "--index requires --catalog\n";
+        return NO_MODE;
+    } else if (m == INDEX && (opts.data_filename != "" || !opts.bundle.empty()
+                              || opts.parallel)) {
+        err << "--index reads only image headers, data options can not "
+               "be used\n";
+        return NO_MODE;
+    } else if (opts.data_filename == "" && opts.bundle.empty() &&
+               m != VERIFY && m != INDEX && m != DAEMON) {
+        err << "no data file was provided, please do so with -f/--file\n";
+        return NO_MODE;
+    } else if (opts.range.used && m != EXTRACT) {
+        err << "-r/--range can be used only with extraction\n";
+        return NO_MODE;
+    } else if (opts.output != "" && m != HIDE) {
+        err << "-o/--output can be used only with hiding\n";
+        return NO_MODE;
+    } else if (opts.hiding.compress && m != HIDE) {
+        err << "-z/--compress can be used only with hiding, compressed "
+               "data are detected during extraction\n";
+        return NO_MODE;
+    } else if (opts.hiding.scatter && m != HIDE) {
+        err << "-s/--scatter can be used only with hiding, scattered "
+               "data are detected during extraction\n";
+        return NO_MODE;
+    } else if (opts.hiding.scatter && opts.hiding.key.empty()) {
+        err << "-s/--scatter requires a key, use -k/--key\n";
+        return NO_MODE;
+    } else if (opts.range.used && opts.parallel) {
+        err << "-r/--range can not be used with -p/--parallel\n";
+        return NO_MODE;
+    } else if (opts.data_filename != "" && m == VERIFY) {
+        err << "--verify does not write any data, -f/--file can not "
+               "be used\n";
+        return NO_MODE;
+    } else if (opts.parallel && m == VERIFY) {
+        err << "--verify always runs in parallel, use -j/--jobs\n";
+        return NO_MODE;
+    } else if (opts.hiding.parity > 0 && m != HIDE) {
+        err << "--parity can be used only with hiding, parity images "
+               "are detected during extraction\n";
+        return NO_MODE;
+    } else if (opts.hiding.select != carrier_selection::ORDER && m != HIDE) {
+        err << "--select can be used only with hiding\n";
+        return NO_MODE;
+    } else if (opts.hiding.auto_chunk && m != HIDE) {
+        err << "--auto-chunk can be used only with hiding, chunk sizes "
+               "are stored in metadata\n";
+        return NO_MODE;
+    } else if (opts.hiding.interleave && m != HIDE) {
+        err << "--interleave can be used only with hiding, interleaved "
+               "data are detected during extraction\n";
+        return NO_MODE;
+    } else if (opts.hiding.interleave && opts.hiding.scatter) {
+        err << "--interleave can not be used with -s/--scatter\n";
+        return NO_MODE;
+    } else if (!opts.hiding.checksum && m != HIDE) {
+        err << "--no-checksum can be used only with hiding\n";
+        return NO_MODE;
+    } else if (opts.parallel && m == UPDATE) {
+        err << "--update rewrites only changed blocks, -p/--parallel can "
+               "not be used\n";
+        return NO_MODE;
+    } else if (opts.hiding.memory_limit > 0 && m != HIDE && m != EXTRACT) {
+        err << "--memory-limit can be used only with hiding and "
+               "extraction\n";
+        return NO_MODE;
+    } else if (opts.hiding.prefetch > 0 && m != HIDE && m != EXTRACT) {
+        err << "--prefetch can be used only with hiding and extraction\n";
+        return NO_MODE;
+    } else if (opts.hiding.prefetch > 0 && opts.parallel) {
+        err << "--prefetch reads ahead images of serial runs, -p/--parallel "
+               "reads them concurrently\n";
+        return NO_MODE;
+    } else if (opts.hiding.journal.resume && opts.hiding.journal.path == "") {
+        err << "--resume requires --journal\n";
+        return NO_MODE;
+    } else if (opts.hiding.journal.path != "" && m != HIDE && m != EXTRACT) {
+        err << "--journal can be used only with hiding and extraction\n";
+        return NO_MODE;
+    } else if (opts.hiding.journal.path != "" &&
+               (opts.parallel || opts.range.used || opts.member != "" ||
+                (m == EXTRACT && !opts.bundle.empty()))) {
+        err << "--journal can not be used with -p/--parallel, -r/--range, "
+               "--member or extraction of -b/--bundle\n";
+        return NO_MODE;
+    } else if (opts.hiding.journal.path != "" &&
+               (opts.output == STDIO_FILENAME ||
+                (m == EXTRACT && opts.data_filename == STDIO_FILENAME))) {
+        err << "--journal records written files, the standard output "
+               "can not be used\n";
+        return NO_MODE;
+    } else if (opts.distortion != "" && m != HIDE) {
+        err << "--distortion can be used only with hiding\n";
+        return NO_MODE;
+    } else if (opts.distortion == STDIO_FILENAME &&
+               opts.output == STDIO_FILENAME) {
+        err << "--distortion and -o/--output can not both use "
+               "the standard output\n";
+        return NO_MODE;
+    } else if (opts.discover && m != EXTRACT) {
+        err << "--discover can be used only with extraction\n";
+        return NO_MODE;
+    } else if (opts.hiding_id != 0 && !opts.discover) {
+        err << "--id selects a discovered hiding, it requires --discover\n";
+        return NO_MODE;
+    } else if (opts.discover && (opts.range.used || opts.member != "" ||
+                                 !opts.bundle.empty() ||
+                                 opts.hiding.journal.path != "")) {
+        err << "--discover can not be used with -r/--range, --member, "
+               "-b/--bundle or --journal\n";
+        return NO_MODE;
+    } else if (opts.discover && opts.hiding_id == 0 &&
+               opts.data_filename == STDIO_FILENAME) {
+        err << "--discover writes each hiding into the -f/--file directory, "
+               "select a single hiding by --id to use the standard output\n";
+        return NO_MODE;
+    } else if (opts.stats && !opts.parallel) {
+        err << "--stats can be used only with -p/--parallel\n";
+        return NO_MODE;
+    }
+
+    opts.extracting.key = opts.hiding.key;
+    opts.extracting.memory_limit = opts.hiding.memory_limit;
+    opts.extracting.prefetch = opts.hiding.prefetch;
+    opts.extracting.journal = opts.hiding.journal;
+    opts.chunk_size = chunk_size;
+
+    auto stdin_count = std::ranges::count_if(opts.images, [](auto &im) {
+        return im.filename == STDIO_FILENAME;
+    });
+    if ((m == HIDE || m == UPDATE) && opts.data_filename == STDIO_FILENAME)
+        ++stdin_count;
+    if (stdin_count > 1) {
+        err << "standard input can be used only once\n";
         return NO_MODE;
-    } else if (images.size() == 0) {
-        std::cerr << "no proper images to hide data were supplied\n";
-        return NO_MODE;   
     }
     return m;
 }
 
-static int open_output_files(std::vector<bmp_image> &images) {
-    for (auto &im : images) {
-        if (!im.assign_output()) {
-            std::cerr << "could not open output file for image "
-                      << im.filename << "\n";
+/**
+ * @brief Returns the number of workers of a run which opens carriers,
+ * at most `--jobs`, so that `files` carriers kept open by each worker at
+ * the same time stay within `--max-open`.
+ */
+static std::size_t carrier_workers(const cli_options &opts,
+                                   std::size_t files = 1) {
+    return std::max<std::size_t>(1, std::min(opts.jobs, opts.max_open / files));
+}
+
+/**
+ * @brief Sets output paths of images according to --output. The output is
+ * a directory if it exists as a directory or ends with '/', otherwise it is
+ * a file (or standard output) and only one image can be used.
+ */
+static bool assign_output_paths(
+    std::vector<bmp_image> &images,
+    const std::string &output,
+    std::ostream &err
+) {
+    if (output == "")
+        return true;
+
+    if (output.back() == '/' || std::filesystem::is_directory(output)) {
+        for (auto &im : images) {
+            auto basename = std::filesystem::path(im.filename).filename();
+            im.output_path = (std::filesystem::path(output) / basename).string();
+        }
+        return true;
+    }
+    if (images.size() != 1) {
+        err << "output " << output << " is not a directory, so only "
+               "one image can be used\n";
+        return false;
+    }
+    images[0].output_path = output;
+    return true;
+}
+
+/**
+ * @brief Extracts hidden data of a single discovered hiding, on `--parallel`
+ * workers if selected.
+ */
+static int extract_hiding(
+    discovered_hiding &hiding,
+    std::ostream &data_out,
+    const cli_options &opts,
+    std::ostream &err
+) {
+    if (!opts.parallel)
+        return extract(hiding.images, data_out, err, opts.extracting);
+
+    work_stealing_scheduler scheduler{carrier_workers(opts)};
+    auto res = extract_in_stripes(hiding.images, data_out, scheduler, err,
+                                  opts.extracting);
+    if (opts.stats)
+        print_worker_stats(err, scheduler.stats());
+    return res;
+}
+
+/**
+ * @brief Discovers hidings among the images and directories of arguments
+ * and extracts the selected one into the data file, or every complete one
+ * into a file named by its id in the data directory.
+ */
+static int extract_discovered(
+    const cli_options &opts,
+    std::ostream &out,
+    std::ostream &err
+) {
+    std::size_t skipped = 0;
+    auto hidings = discover_hidings(expand_directories(opts.images),
+                                    carrier_workers(opts),
+                                    skipped);
+    /* info messages must not mix with the data written to stdout */
+    auto &info = opts.data_filename == STDIO_FILENAME ? err : out;
+    info << skipped << " file(s) hold no hidden data\n";
+    print_hidings(info, hidings);
+
+    if (opts.hiding_id != 0) {
+        std::erase_if(hidings, [&](auto &hiding) {
+            return hiding.id != opts.hiding_id;
+        });
+        if (hidings.empty()) {
+            err << "no hiding with id " << opts.hiding_id << " was found\n";
             return 1;
         }
-        if (!im.write_header_to_output()) {
-            std::cerr << "could not write bmp header to output file for image "
-                      << im.filename << "\n";
+        if (hidings.size() > 1) {
+            err << "more hidings with id " << opts.hiding_id << " were found, "
+                   "extract all of them without --id\n";
             return 1;
         }
+        if (!hidings[0].complete()) {
+            err << "hiding " << opts.hiding_id << " is incomplete\n";
+            return 1;
+        }
+        std::ofstream data_file{};
+        std::ostream data_out{out.rdbuf()};
+        if (opts.data_filename != STDIO_FILENAME) {
+            data_file.open(opts.data_filename, std::ios::binary);
+            if (!data_file.is_open())
+                return 1;
+            data_out.rdbuf(data_file.rdbuf());
+        }
+        return extract_hiding(hidings[0], data_out, opts, err);
     }
-    return 0;
+
+    std::error_code ec{};
+    std::filesystem::create_directories(opts.data_filename, ec);
+    std::set<std::string> names{};
+    auto extracted = 0u;
+    auto res = 0;
+    for (auto &hiding : hidings) {
+        if (!hiding.complete())
+            continue;
+        /* ids of unrelated hidings can be the same */
+        auto id = "hiding-" + std::to_string(hiding.id);
+        auto name = id;
+        for (auto k = 2; names.contains(name); ++k)
+            name = id + "-" + std::to_string(k);
+        names.insert(name);
+        auto path = std::filesystem::path(opts.data_filename) / name;
+
+        std::ofstream data_file{path, std::ios::binary};
+        if (!data_file.is_open()) {
+            err << "could not open " << path.string() << '\n';
+            return 1;
+        }
+        if (extract_hiding(hiding, data_file, opts, err) != 0) {
+            res = 1;
+            continue;
+        }
+        info << "hiding " << static_cast<int>(hiding.id)
+             << " was extracted to " << path.string() << '\n';
+        ++extracted;
+    }
+    if (extracted == 0 && res == 0) {
+        err << "no complete hiding was found\n";
+        return 1;
+    }
+    return res;
 }
 
-int main(int argc, char *argv[])
-{
-    std::vector<std::string> args(argv + 1, argv + argc);
+/**
+ * @brief Writes the distortion of images altered by hiding, in the order
+ * in which they were hidden, to the file or to `out` for `STDIO_FILENAME`.
+ * Images skipped by a resumed hiding are not listed.
+ */
+static bool write_distortion_report(
+    std::vector<bmp_image> &images,
+    const std::string &path,
+    std::ostream &out,
+    std::ostream &err
+) {
+    std::ofstream file{};
+    std::ostream report{out.rdbuf()};
+    if (path != STDIO_FILENAME) {
+        file.open(path);
+        if (!file.is_open()) {
+            err << "distortion report " << path << " could not be written\n";
+            return false;
+        }
+        report.rdbuf(file.rdbuf());
+    }
+    write_distortion_header(report);
+    for (auto &im : images)
+        if (im.distortion)
+            write_distortion(report, im.filename, im.get_output_path(),
+                             *im.distortion);
+    report.flush();
+    if (!report.good()) {
+        err << "distortion report " << path << " could not be written\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the selected mode, the streams are the standard streams
+ * of the process, or of the client if the daemon serves the request.
+ */
+static int run_mode(
+    mode m,
+    cli_options &opts,
+    std::istream &in,
+    std::ostream &out,
+    std::ostream &err
+) {
     std::vector<bmp_image> images;
+    if (m == INDEX) {
+        std::vector<std::string> paths{};
+        for (auto &im : opts.images)
+            paths.push_back(im.filename);
+        return build_catalog(opts.catalog, paths,
+                             carrier_workers(opts), out, err);
+    }
 
-    std::string data_filename("");
+    carrier_catalog catalog{};
+    if (opts.catalog != "" && !catalog.open(opts.catalog, err))
+        return 1;
+    /* without image arguments, all images of the catalog are carriers */
+    if (opts.catalog != "" && opts.images.empty() && m == HIDE) {
+        for (auto i = 0u; i < catalog.size(); ++i)
+            opts.images.push_back({std::string(catalog.entry(i).path),
+                                   opts.chunk_size});
+    }
+
+    if (m == EXTRACT && opts.discover)
+        return extract_discovered(opts, out, err);
+
+    /* each worker keeps only one image open while loading its header */
+    load_images(opts.images, images, carrier_workers(opts),
+                err, opts.catalog != "" ? &catalog : nullptr);
+    if (images.size() == 0) {
+        err << "no proper images to hide data were supplied\n";
+        return 1;
+    }
 
-    switch (process_args(args, images, data_filename))
+    switch (m)
     {
     case HIDE: {
-        std::ifstream data_in{data_filename, std::ios::binary};
-        if (!data_in.is_open() || !data_in.good())
+        if (!assign_output_paths(images, opts.output, err))
             return 1;
-        if (open_output_files(images))
-            return 1;
-        return hide(images, data_in);
+        std::ifstream data_file{};
+        std::stringstream bundle{};
+        std::istream data_in{in.rdbuf()};
+        if (!opts.bundle.empty()) {
+            if (!write_bundle(opts.bundle, bundle, err))
+                return 1;
+            data_in.rdbuf(bundle.rdbuf());
+        } else if (opts.data_filename != STDIO_FILENAME) {
+            data_file.open(opts.data_filename, std::ios::binary);
+            if (!data_file.is_open() || !data_file.good())
+                return 1;
+            data_in.rdbuf(data_file.rdbuf());
+        }
+        /* info messages must not mix with the image or the report
+         * written to stdout */
+        bool uses_stdout = opts.distortion == STDIO_FILENAME ||
+                           std::ranges::any_of(images, [](auto &im) {
+            return im.get_output_path() == STDIO_FILENAME;
+        });
+        auto &info = uses_stdout ? err : out;
+        int res;
+        if (!opts.parallel) {
+            res = hide(images, data_in, info, err, opts.hiding);
+        } else {
+            work_stealing_scheduler scheduler{carrier_workers(opts)};
+            res = hide_in_stripes(images, data_in, scheduler, info,
+                                  err, opts.hiding);
+            if (opts.stats)
+                print_worker_stats(err, scheduler.stats());
+        }
+        if (res == 0 && opts.distortion != "" &&
+            !write_distortion_report(images, opts.distortion, out, err))
+            return 2;
+        return res;
     }
 
     case EXTRACT: {
-        std::ofstream data_out{data_filename, std::ios::binary};
-        if (!data_out.is_open() || !data_out.good())
-            return 1;
-        return extract(images, data_out);
+        if (!opts.bundle.empty()) {
+            std::stringstream bundle{};
+            int res;
+            if (!opts.parallel) {
+                res = extract(images, bundle, err, opts.extracting);
+            } else {
+                work_stealing_scheduler scheduler{carrier_workers(opts)};
+                res = extract_in_stripes(images, bundle, scheduler, err,
+                                         opts.extracting);
+                if (opts.stats)
+                    print_worker_stats(err, scheduler.stats());
+            }
+            if (res)
+                return res;
+            auto data = bundle.str();
+            return unpack_bundle(
+                {reinterpret_cast<const uint8_t *>(data.data()), data.size()},
+                opts.bundle[0], out, err);
+        }
+        std::ofstream data_file{};
+        std::ostream data_out{out.rdbuf()};
+        /* a resumed extraction keeps the data written before */
+        auto &journal = opts.extracting.journal;
+        auto resuming = journal.resume &&
+                        std::filesystem::exists(journal.path) &&
+                        std::filesystem::exists(opts.data_filename);
+        if (opts.data_filename != STDIO_FILENAME) {
+            data_file.open(opts.data_filename,
+                           resuming ? std::ios::binary | std::ios::in
+                                          | std::ios::out
+                                    : std::ios::binary);
+            if (!data_file.is_open() || !data_file.good())
+                return 1;
+            data_out.rdbuf(data_file.rdbuf());
+        }
+        opts.extracting.data_path = opts.data_filename;
+        if (resuming) {
+            auto res = extract(images, data_out, err, opts.extracting);
+            /* data of a different job could have been longer */
+            auto end = data_out.tellp();
+            data_file.close();
+            std::error_code ec{};
+            if (res == 0 && end >= 0)
+                std::filesystem::resize_file(opts.data_filename, end, ec);
+            return res;
+        }
+        if (opts.member != "")
+            return extract_bundle_file(images, opts.member, data_out,
+                                       err, opts.extracting);
+        if (opts.range.used)
+            return extract_range(images, opts.range.offset, opts.range.length,
+                                 data_out, err, opts.extracting);
+        if (!opts.parallel)
+            return extract(images, data_out, err, opts.extracting);
+
+        work_stealing_scheduler scheduler{carrier_workers(opts)};
+        auto res = extract_in_stripes(images, data_out, scheduler,
+                                      err, opts.extracting);
+        if (opts.stats)
+            print_worker_stats(err, scheduler.stats());
+        return res;
+    }
+    case VERIFY:
+        return verify(images, carrier_workers(opts), opts.extracting, out, err);
+    case UPDATE: {
+        std::ifstream data_file{};
+        std::istream data_in{in.rdbuf()};
+        if (opts.data_filename != STDIO_FILENAME) {
+            data_file.open(opts.data_filename, std::ios::binary);
+            if (!data_file.is_open() || !data_file.good())
+                return 1;
+            data_in.rdbuf(data_file.rdbuf());
+        }
+        return update(images, data_in, out, err, opts.extracting);
     }
     default:
         return 1;
     }
 }
+
+/**
+ * @brief Makes paths of the request absolute, the daemon does not share
+ * the working directory of the client.
+ */
+static void resolve_paths(cli_options &opts, const std::string &cwd) {
+    auto resolve = [&](std::string &path) {
+        if (path != "" && path != STDIO_FILENAME)
+            path = (std::filesystem::path(cwd) / path).string();
+    };
+    for (auto &im : opts.images)
+        resolve(im.filename);
+    for (auto &path : opts.bundle)
+        resolve(path);
+    resolve(opts.data_filename);
+    resolve(opts.catalog);
+    resolve(opts.hiding.journal.path);
+    resolve(opts.extracting.journal.path);
+    resolve(opts.distortion);
+    /* a trailing '/' marks a directory, it is kept by the join */
+    resolve(opts.output);
+}
+
+static int serve_request(
+    const daemon_request &request,
+    std::istream &in,
+    std::ostream &out,
+    std::ostream &err
+) {
+    auto args = request.args;
+    /* the key file is read while the arguments are processed */
+    for (auto i = 0u; i + 1 < args.size(); ++i)
+        if (args[i] == "--key-file")
+            args[i + 1] = (std::filesystem::path(request.cwd) / args[i + 1])
+                              .string();
+    cli_options opts{};
+    auto m = process_args(args, opts, err);
+    if (m == NO_MODE)
+        return 1;
+    if (m == DAEMON) {
+        err << "--daemon can not be requested from a daemon\n";
+        return 1;
+    }
+    /* images of the standard streams are bound to the daemon process */
+    if (opts.output == STDIO_FILENAME ||
+        std::ranges::any_of(opts.images, [](auto &im) {
+            return im.filename == STDIO_FILENAME;
+        })) {
+        err << "images can not be read from or written to standard streams "
+               "of the client, only -f - can be used\n";
+        return 1;
+    }
+    resolve_paths(opts, request.cwd);
+    return run_mode(m, opts, in, out, err);
+}
+
+/* server stopped by SIGINT and SIGTERM */
+static daemon_server *running_server = nullptr;
+
+static void stop_server(int) {
+    if (running_server)
+        running_server->stop();
+}
+
+static int run_daemon(const cli_options &opts) {
+    /* a session keeps the input and the output of an image open */
+    daemon_server server{serve_request, carrier_workers(opts, 2)};
+    if (!server.listen(opts.socket))
+        return 1;
+    /* clients closing their streams must not kill the daemon */
+    std::signal(SIGPIPE, SIG_IGN);
+    running_server = &server;
+    std::signal(SIGINT, stop_server);
+    std::signal(SIGTERM, stop_server);
+    std::cerr << "daemon is listening on " << opts.socket << '\n';
+    server.run();
+    running_server = nullptr;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    /* standard streams can be used for images and data */
+    std::ios::sync_with_stdio(false);
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    /* the client passes all the other arguments to the daemon */
+    auto client = std::ranges::find(args, "--client");
+    if (client != args.end()) {
+        if (client + 1 == args.end()) {
+            std::cerr << "--client was used as the last argument\n";
+            return 1;
+        }
+        auto socket = *(client + 1);
+        args.erase(client, client + 2);
+        return send_request(socket, {std::filesystem::current_path().string(),
+                                     args});
+    }
+
+    cli_options opts{};
+    auto m = process_args(args, opts, std::cerr);
+    if (m == NO_MODE)
+        return 1;
+    if (m == DAEMON)
+        return run_daemon(opts);
+    return run_mode(m, opts, std::cin, std::cout, std::cerr);
+}
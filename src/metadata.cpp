@@ -0,0 +1,193 @@
+#include "metadata.h"
+
+#include <cassert>
+#include <utility>
+
+#include "configuration.h"
+
+static void invalid_magic_number_log(
+    std::ostream &os,
+    std::string_view filename,
+    uint8_t byte1,
+    uint8_t byte2
+) {
+    os << "image " << filename << " has invalid sharky magic number! ("
+       << std::hex << byte1 << ", " << byte2 << std::dec << ")\n";
+}
+
+static void invalid_chunk_size_log(
+    std::ostream &os,
+    std::string_view filename,
+    uint8_t chunk_size
+) {
+    os << "image " << filename << " has invalid chunk size! ("
+       << static_cast<int>(chunk_size) << ")\n";
+}
+
+static void unsupported_flags_log(
+    std::ostream &os,
+    std::string_view filename,
+    uint16_t flags
+) {
+    os << "image " << filename << " uses unsupported features! (flags "
+       << static_cast<int>(flags) << ")\n";
+}
+
+static bool check_flags(const bmp_image &im, std::ostream &err) {
+    /* scattered order is derived from the encryption key */
+    if ((im.flags & ~MD_SUPPORTED_FLAGS) != 0 ||
+        ((im.flags & MD_FLAG_SCATTERED) && !(im.flags & MD_FLAG_ENCRYPTED)) ||
+        ((im.flags & MD_FLAG_SCATTERED) && (im.flags & MD_FLAG_INTERLEAVED))) {
+        unsupported_flags_log(err, im.filename, im.flags);
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint8_t> make_metadata(
+    const bmp_image &im,
+    uint32_t data_size,
+    uint8_t id,
+    uint8_t seq
+) {
+    std::vector<uint8_t> metadata{};
+    /* magic number for sharky images */
+    metadata.emplace_back(static_cast<uint8_t>('S'));
+    metadata.emplace_back(static_cast<uint8_t>('H'));
+
+    metadata.emplace_back(id);
+    metadata.emplace_back(seq);
+
+    for (auto _ = 0u; _ < sizeof(uint32_t); ++_) {
+        metadata.emplace_back(static_cast<uint8_t>(data_size & 0xffu));
+        data_size >>= 8;
+    }
+    metadata.emplace_back(im.chunk_size | (im.flags & 0xf0));
+    metadata.insert(metadata.end(), im.extra_metadata.begin(),
+                    im.extra_metadata.end());
+    assert(metadata.size() == im.metadata_size());
+    return metadata;
+}
+
+bool parse_metadata(
+    bmp_image &im,
+    std::span<const uint8_t> metadata,
+    std::ostream &err
+) {
+    if (metadata[0] != 'S' || metadata[1] != 'H') {
+        invalid_magic_number_log(err, im.filename, metadata[0], metadata[1]);
+        return false;
+    }
+
+    im.id = metadata[2];
+    im.seq = metadata[3];
+
+    im.hidden_data_size = 0u;
+    for (std::size_t i = 0; i < 4; ++i)
+        im.hidden_data_size |= static_cast<std::size_t>(metadata[4 + i]) << (i * 8);
+
+    uint8_t chunk_size = metadata[8] & MD_CHUNK_SIZE_MASK;
+    if (chunk_size == 0 || 8 % chunk_size != 0) {
+        invalid_chunk_size_log(err, im.filename, chunk_size);
+        return false;
+    }
+    im.flags = metadata[8] & ~MD_CHUNK_SIZE_MASK;
+    im.extra_metadata.clear();
+    if (!check_flags(im, err))
+        return false;
+    im.chunk_size = chunk_size;
+    im.cells_per_byte = 8 / im.chunk_size;
+    return true;
+}
+
+std::size_t missing_extra_metadata(const bmp_image &im) {
+    /* the extended flags come first */
+    if ((im.flags & MD_FLAG_EXTENDED) && im.extra_metadata.empty())
+        return 1;
+    return im.metadata_size() - HIDDEN_METADATA_SIZE - im.extra_metadata.size();
+}
+
+bool parse_extra_metadata(bmp_image &im, std::ostream &err) {
+    if ((im.flags & MD_FLAG_EXTENDED) && !im.extra_metadata.empty()) {
+        im.flags = (im.flags & 0xff) | (im.extra_metadata[0] << 8);
+        return check_flags(im, err);
+    }
+    return true;
+}
+
+void init_extra_metadata(bmp_image &im, uint16_t flags) {
+    if (flags > 0xff)
+        flags |= MD_FLAG_EXTENDED;
+    im.flags = flags;
+    im.extra_metadata.assign(im.metadata_size() - HIDDEN_METADATA_SIZE, 0);
+    if (flags & MD_FLAG_EXTENDED)
+        im.extra_metadata[0] = static_cast<uint8_t>(flags >> 8);
+}
+
+/**
+ * @brief Returns offset and size of the field in extra metadata, fields
+ * are stored in the order of their flags.
+ */
+static std::pair<std::size_t, std::size_t> field_position(
+    uint16_t flags,
+    uint16_t flag
+) {
+    std::size_t offset = 0;
+    for (auto [field, size] : {std::pair{MD_FLAG_EXTENDED, std::size_t{1}},
+                               std::pair{MD_FLAG_ENCRYPTED, MD_NONCE_SIZE},
+                               std::pair{MD_FLAG_CHECKSUM, MD_CHECKSUM_SIZE},
+                               std::pair{MD_FLAG_PARITY, MD_CARRIERS_SIZE}}) {
+        if (field == flag)
+            return {offset, size};
+        if (flags & field)
+            offset += size;
+    }
+    assert(false);
+    return {offset, 0};
+}
+
+std::span<uint8_t> extra_metadata_field(bmp_image &im, uint16_t flag) {
+    assert(im.flags & flag);
+    auto [offset, size] = field_position(im.flags, flag);
+    return std::span(im.extra_metadata).subspan(offset, size);
+}
+
+std::span<const uint8_t> extra_metadata_field(const bmp_image &im, uint16_t flag) {
+    assert(im.flags & flag);
+    auto [offset, size] = field_position(im.flags, flag);
+    return std::span(im.extra_metadata).subspan(offset, size);
+}
+
+uint32_t metadata_checksum(const bmp_image &im) {
+    auto field = extra_metadata_field(im, MD_FLAG_CHECKSUM);
+    uint32_t checksum = 0;
+    for (std::size_t i = 0; i < field.size(); ++i)
+        checksum |= static_cast<uint32_t>(field[i]) << (i * 8);
+    return checksum;
+}
+
+void set_metadata_checksum(bmp_image &im, uint32_t checksum) {
+    for (auto &byte : extra_metadata_field(im, MD_FLAG_CHECKSUM)) {
+        byte = static_cast<uint8_t>(checksum & 0xffu);
+        checksum >>= 8;
+    }
+}
+
+carrier_counts metadata_carriers(const bmp_image &im) {
+    auto field = extra_metadata_field(im, MD_FLAG_PARITY);
+    return {field[0], field[1]};
+}
+
+void set_metadata_carriers(bmp_image &im, carrier_counts carriers) {
+    auto field = extra_metadata_field(im, MD_FLAG_PARITY);
+    field[0] = static_cast<uint8_t>(carriers.data);
+    field[1] = static_cast<uint8_t>(carriers.parity);
+}
+
+std::span<uint8_t> metadata_parity_header(bmp_image &im) {
+    return extra_metadata_field(im, MD_FLAG_PARITY).subspan(2);
+}
+
+std::span<const uint8_t> metadata_parity_header(const bmp_image &im) {
+    return extra_metadata_field(im, MD_FLAG_PARITY).subspan(2);
+}
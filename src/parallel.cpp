@@ -0,0 +1,35 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+std::size_t default_jobs() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallel_for(
+    std::size_t count,
+    std::size_t jobs,
+    const std::function<void(std::size_t)> &fn
+) {
+    jobs = std::clamp<std::size_t>(jobs, 1, std::max<std::size_t>(count, 1));
+    std::atomic<std::size_t> next{0};
+
+    auto worker = [&]() {
+        for (auto i = next++; i < count; i = next++)
+            fn(i);
+    };
+
+    if (jobs == 1) {
+        worker();
+        return;
+    }
+
+    std::vector<std::jthread> workers{};
+    /* the calling thread works as well */
+    for (auto _ = 1u; _ < jobs; ++_)
+        workers.emplace_back(worker);
+    worker();
+}
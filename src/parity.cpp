@@ -0,0 +1,429 @@
+#include "parity.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "configuration.h"
+#include "crc.h"
+#include "in_memory.h"
+#include "interleave.h"
+#include "metadata.h"
+#include "scatter.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SHARKY_GF_SIMD
+#endif
+
+/* x^8 + x^4 + x^3 + x^2 + 1 */
+static constexpr unsigned GF_POLY = 0x11d;
+
+struct gf_tables {
+    std::array<uint8_t, 512> exp{};
+    std::array<uint8_t, 256> log{};
+};
+
+static constexpr gf_tables GF = [] {
+    gf_tables t{};
+    unsigned x = 1;
+    for (auto i = 0u; i < 255; ++i) {
+        t.exp[i] = static_cast<uint8_t>(x);
+        t.log[x] = static_cast<uint8_t>(i);
+        x <<= 1;
+        if (x & 0x100)
+            x ^= GF_POLY;
+    }
+    /* products are looked up without reducing the sum of logarithms */
+    for (auto i = 255u; i < t.exp.size(); ++i)
+        t.exp[i] = t.exp[i - 255];
+    return t;
+}();
+
+uint8_t gf_mul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0)
+        return 0;
+    return GF.exp[GF.log[a] + GF.log[b]];
+}
+
+uint8_t gf_inv(uint8_t a) {
+    return GF.exp[255 - GF.log[a]];
+}
+
+void gf_mul_add_portable(
+    std::span<uint8_t> dst,
+    std::span<const uint8_t> src,
+    uint8_t coef
+) {
+    if (coef == 0)
+        return;
+    std::array<uint8_t, 256> row;
+    for (auto x = 0u; x < row.size(); ++x)
+        row[x] = gf_mul(coef, static_cast<uint8_t>(x));
+    for (std::size_t i = 0; i < src.size(); ++i)
+        dst[i] ^= row[src[i]];
+}
+
+#ifdef SHARKY_GF_SIMD
+/**
+ * @brief Tables of products of `coef` and all values of the low and the high
+ * nibble, the product of a byte is the XOR of both.
+ */
+static void nibble_tables(uint8_t coef, uint8_t *low, uint8_t *high) {
+    for (auto x = 0u; x < 16; ++x) {
+        low[x] = gf_mul(coef, static_cast<uint8_t>(x));
+        high[x] = gf_mul(coef, static_cast<uint8_t>(x << 4));
+    }
+}
+
+__attribute__((target("avx2")))
+static std::size_t mul_add_avx2(uint8_t *dst, const uint8_t *src,
+                                std::size_t size, uint8_t coef) {
+    alignas(16) uint8_t low[16], high[16];
+    nibble_tables(coef, low, high);
+    auto low_table = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i *>(low)));
+    auto high_table = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i *>(high)));
+    auto mask = _mm256_set1_epi8(0x0f);
+
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        auto s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        auto d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        auto l = _mm256_shuffle_epi8(low_table, _mm256_and_si256(s, mask));
+        auto h = _mm256_shuffle_epi8(
+            high_table, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask));
+        d = _mm256_xor_si256(d, _mm256_xor_si256(l, h));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), d);
+    }
+    return i;
+}
+
+__attribute__((target("ssse3")))
+static std::size_t mul_add_ssse3(uint8_t *dst, const uint8_t *src,
+                                 std::size_t size, uint8_t coef) {
+    alignas(16) uint8_t low[16], high[16];
+    nibble_tables(coef, low, high);
+    auto low_table = _mm_load_si128(reinterpret_cast<const __m128i *>(low));
+    auto high_table = _mm_load_si128(reinterpret_cast<const __m128i *>(high));
+    auto mask = _mm_set1_epi8(0x0f);
+
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        auto d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        auto l = _mm_shuffle_epi8(low_table, _mm_and_si128(s, mask));
+        auto h = _mm_shuffle_epi8(high_table,
+                                  _mm_and_si128(_mm_srli_epi64(s, 4), mask));
+        d = _mm_xor_si128(d, _mm_xor_si128(l, h));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), d);
+    }
+    return i;
+}
+#endif
+
+void gf_mul_add(std::span<uint8_t> dst, std::span<const uint8_t> src, uint8_t coef) {
+    if (coef == 0)
+        return;
+    std::size_t done = 0;
+#ifdef SHARKY_GF_SIMD
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    static const bool ssse3 = __builtin_cpu_supports("ssse3");
+    if (avx2)
+        done = mul_add_avx2(dst.data(), src.data(), src.size(), coef);
+    else if (ssse3)
+        done = mul_add_ssse3(dst.data(), src.data(), src.size(), coef);
+#endif
+    gf_mul_add_portable(dst.subspan(done), src.subspan(done), coef);
+}
+
+/**
+ * @brief Returns coefficient of the data part in the parity part, elements
+ * of the Cauchy matrix 1 / (x + y) with x = data_count + parity, y = part,
+ * all its square submatrices are invertible.
+ */
+static uint8_t parity_coefficient(
+    std::size_t parity,
+    std::size_t data_count,
+    std::size_t part
+) {
+    return gf_inv(static_cast<uint8_t>((data_count + parity) ^ part));
+}
+
+static std::array<uint8_t, PARITY_HEADER_SIZE> encode_size(std::size_t size) {
+    std::array<uint8_t, PARITY_HEADER_SIZE> bytes;
+    for (auto &byte : bytes) {
+        byte = static_cast<uint8_t>(size & 0xffu);
+        size >>= 8;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Adds `coef * (size of part, part)` to the coded row.
+ */
+static void add_part(
+    std::span<uint8_t> row,
+    std::span<const uint8_t> part,
+    uint8_t coef
+) {
+    gf_mul_add(row, encode_size(part.size()), coef);
+    gf_mul_add(row.subspan(PARITY_HEADER_SIZE), part, coef);
+}
+
+std::vector<std::vector<uint8_t>> encode_parity(
+    const std::vector<std::span<const uint8_t>> &parts,
+    std::size_t count
+) {
+    std::size_t size = 0;
+    for (auto part : parts)
+        size = std::max(size, PARITY_HEADER_SIZE + part.size());
+
+    std::vector<std::vector<uint8_t>> parity(count, std::vector<uint8_t>(size));
+    for (auto j = 0u; j < count; ++j)
+        for (auto i = 0u; i < parts.size(); ++i)
+            add_part(parity[j], parts[i],
+                     parity_coefficient(j, parts.size(), i));
+    return parity;
+}
+
+/**
+ * @brief Inverts the square matrix in GF(256) by Gauss-Jordan elimination.
+ * 
+ * @return `false` if the matrix is singular
+ */
+static bool invert(std::vector<std::vector<uint8_t>> &matrix) {
+    auto n = matrix.size();
+    std::vector<std::vector<uint8_t>> inverse(n, std::vector<uint8_t>(n, 0));
+    for (auto i = 0u; i < n; ++i)
+        inverse[i][i] = 1;
+
+    for (auto col = 0u; col < n; ++col) {
+        auto pivot = col;
+        while (pivot < n && matrix[pivot][col] == 0)
+            ++pivot;
+        if (pivot == n)
+            return false;
+        std::swap(matrix[col], matrix[pivot]);
+        std::swap(inverse[col], inverse[pivot]);
+
+        auto scale = gf_inv(matrix[col][col]);
+        for (auto k = 0u; k < n; ++k) {
+            matrix[col][k] = gf_mul(matrix[col][k], scale);
+            inverse[col][k] = gf_mul(inverse[col][k], scale);
+        }
+        for (auto row = 0u; row < n; ++row) {
+            auto factor = matrix[row][col];
+            if (row == col || factor == 0)
+                continue;
+            for (auto k = 0u; k < n; ++k) {
+                matrix[row][k] ^= gf_mul(factor, matrix[col][k]);
+                inverse[row][k] ^= gf_mul(factor, inverse[col][k]);
+            }
+        }
+    }
+    matrix = std::move(inverse);
+    return true;
+}
+
+bool rebuild_parts(
+    std::vector<std::optional<std::vector<uint8_t>>> &parts,
+    const std::vector<std::optional<std::vector<uint8_t>>> &parity
+) {
+    std::vector<std::size_t> missing{};
+    for (auto i = 0u; i < parts.size(); ++i)
+        if (!parts[i])
+            missing.push_back(i);
+    if (missing.empty())
+        return true;
+
+    std::vector<std::size_t> used{};
+    for (auto j = 0u; j < parity.size() && used.size() < missing.size(); ++j)
+        if (parity[j])
+            used.push_back(j);
+    if (used.size() < missing.size())
+        return false;
+    auto size = parity[used[0]]->size();
+    for (auto j : used)
+        if (parity[j]->size() != size)
+            return false;
+
+    /* parity rows without the contribution of present data parts, they are
+     * combinations of the missing parts only */
+    std::vector<std::vector<uint8_t>> syndromes{};
+    for (auto j : used) {
+        syndromes.push_back(*parity[j]);
+        for (auto i = 0u; i < parts.size(); ++i) {
+            if (!parts[i])
+                continue;
+            if (parts[i]->size() + PARITY_HEADER_SIZE > size)
+                return false;
+            add_part(syndromes.back(), *parts[i],
+                     parity_coefficient(j, parts.size(), i));
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> matrix(used.size());
+    for (auto r = 0u; r < used.size(); ++r)
+        for (auto i : missing)
+            matrix[r].push_back(parity_coefficient(used[r], parts.size(), i));
+    if (!invert(matrix))
+        return false;
+
+    for (auto t = 0u; t < missing.size(); ++t) {
+        std::vector<uint8_t> row(size, 0);
+        for (auto r = 0u; r < used.size(); ++r)
+            gf_mul_add(row, syndromes[r], matrix[t][r]);
+
+        std::size_t part_size = 0;
+        for (auto b = PARITY_HEADER_SIZE; b-- > 0;)
+            part_size = (part_size << 8) | row[b];
+        if (part_size > size - PARITY_HEADER_SIZE)
+            return false;
+        parts[missing[t]].emplace(row.begin() + PARITY_HEADER_SIZE,
+                                  row.begin() + PARITY_HEADER_SIZE + part_size);
+    }
+    return true;
+}
+
+bool data_carriers_missing(
+    const std::vector<bmp_image> &images,
+    std::vector<std::size_t> &indx
+) {
+    auto data_count = metadata_carriers(images[indx[0]]).data;
+    auto present = std::ranges::count_if(indx, [&](std::size_t i) {
+        return images[i].seq < data_count;
+    });
+    if (static_cast<std::size_t>(present) < data_count)
+        return true;
+    indx.resize(data_count);
+    return false;
+}
+
+static void open_error_log(std::ostream &os, std::string_view filename) {
+    os << "image " << filename << " could not be opened\n";
+}
+
+static void not_seekable_log(std::ostream &os, std::string_view filename) {
+    os << "data can not be rebuilt from image " << filename
+       << ", which can not seek\n";
+}
+
+static void run_out_of_bytes_log(std::ostream &os, std::string_view filename) {
+    os << "image " << filename << " is smaller than its header states\n";
+}
+
+static void corrupted_carrier_log(std::ostream &os, std::string_view filename) {
+    os << "checksum of data hidden in image " << filename
+       << " does not match, the image is not used\n";
+}
+
+static void rebuild_error_log(std::ostream &os) {
+    os << "missing data could not be rebuilt, not enough intact carriers\n";
+}
+
+static void rebuilt_log(std::ostream &os, std::ptrdiff_t count) {
+    os << count << " missing data part(s) were rebuilt from parity carriers\n";
+}
+
+/**
+ * @brief Reads the image into memory, if it is not held there already.
+ */
+static bool load_file(
+    bmp_image &im,
+    std::vector<std::byte> &file,
+    std::ostream &err
+) {
+    if (!im.seekable) {
+        not_seekable_log(err, im.filename);
+        return false;
+    }
+    if (!read_image(im, file)) {
+        open_error_log(err, im.filename);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Extracts the stored data part of the image, the part is not set
+ * if the image is corrupted.
+ */
+static bool read_part(
+    const bmp_image &im,
+    std::span<const std::byte> file,
+    const data_decoding &decoding,
+    std::optional<std::vector<uint8_t>> &part,
+    std::ostream &err
+) {
+    auto pixels = file.subspan(im.data_offset);
+    std::vector<uint8_t> data(im.hidden_data_size);
+    auto extracted = decoding.scatter_key
+        ? extract_bytes_scattered(im, pixels,
+                                  cell_scatter{*decoding.scatter_key, im}, 0,
+                                  data, im.chunk_size)
+        : extract_bytes_at(im, pixels, im.data_start_cell(), data,
+                           im.chunk_size);
+    if (!extracted) {
+        run_out_of_bytes_log(err, im.filename);
+        return false;
+    }
+    if ((im.flags & MD_FLAG_CHECKSUM) && crc32c(data) != metadata_checksum(im)) {
+        corrupted_carrier_log(err, im.filename);
+        return true;
+    }
+    /* the parity header is stored in the metadata */
+    if (im.seq >= metadata_carriers(im).data) {
+        auto header = metadata_parity_header(im);
+        data.insert(data.begin(), header.begin(), header.end());
+    }
+    part = std::move(data);
+    return true;
+}
+
+bool rebuild_message(
+    std::vector<bmp_image> &images,
+    const std::vector<std::size_t> &indx,
+    const data_decoding &decoding,
+    std::vector<uint8_t> &message,
+    std::ostream &err,
+    std::span<const std::vector<std::byte>> files
+) {
+    auto carriers = metadata_carriers(images[indx[0]]);
+    std::vector<std::optional<std::vector<uint8_t>>> parts(carriers.data);
+    std::vector<std::optional<std::vector<uint8_t>>> parity(carriers.parity);
+    for (auto i : indx) {
+        auto &im = images[i];
+        auto &part = im.seq < carriers.data ? parts[im.seq]
+                                            : parity[im.seq - carriers.data];
+        std::vector<std::byte> file{};
+        if (files.empty() && !load_file(im, file, err))
+            return false;
+        if (!read_part(im, files.empty() ? file : files[i], decoding, part, err))
+            return false;
+    }
+
+    auto missing = std::ranges::count_if(parts, [](auto &part) {
+        return !part;
+    });
+    if (!rebuild_parts(parts, parity)) {
+        rebuild_error_log(err);
+        return false;
+    }
+    rebuilt_log(err, missing);
+
+    message.clear();
+    std::vector<std::size_t> part_sizes{};
+    for (auto &part : parts) {
+        message.insert(message.end(), part->begin(), part->end());
+        part_sizes.push_back(part->size());
+    }
+    if (images[indx[0]].flags & MD_FLAG_INTERLEAVED) {
+        interleaved_layout layout{part_sizes, message.size()};
+        std::vector<uint8_t> parts_data = std::move(message);
+        message.resize(parts_data.size());
+        layout.deinterleave(parts_data, message);
+    }
+    return true;
+}
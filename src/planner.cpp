@@ -0,0 +1,227 @@
+#include "planner.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "configuration.h"
+
+static void capacity_log(
+    std::ostream &os,
+    std::size_t capacity,
+    std::size_t data_size
+) {
+    os << "images can hold only " << capacity << " bytes (" << data_size
+       << " byte capacity is needed), please use more or larger images\n";
+}
+
+static void parity_images_log(
+    std::ostream &os,
+    std::size_t parity_count,
+    std::size_t data_count,
+    std::size_t image_count
+) {
+    os << parity_count << " parity images are needed besides "
+       << data_count << " images for data, but only " << image_count
+       << " images were given\n";
+}
+
+static void parity_candidates_log(
+    std::ostream &os,
+    std::size_t parity_count,
+    std::size_t data_count,
+    std::size_t part_size
+) {
+    os << parity_count << " parity images with " << part_size
+       << " byte capacity are needed besides " << data_count
+       << " images for data, but they were not given\n";
+}
+
+static constexpr auto NONE = std::numeric_limits<std::size_t>::max();
+
+/**
+ * @brief Returns the cheapest unused candidate with at least `size` capacity,
+ * or `NONE`.
+ */
+static std::size_t cheapest_fitting(
+    std::span<const carrier_candidate> candidates,
+    const std::vector<bool> &used,
+    std::size_t size
+) {
+    auto best = NONE;
+    for (auto i = 0u; i < candidates.size(); ++i) {
+        if (used[i] || candidates[i].capacity < size)
+            continue;
+        if (best == NONE || candidates[i].cost < candidates[best].cost)
+            best = i;
+    }
+    return best;
+}
+
+/**
+ * @brief Takes the largest candidates, the last one is replaced by the cheapest
+ * candidate which still holds the rest of the message.
+ */
+static std::vector<std::size_t> fewest_carriers(
+    std::span<const carrier_candidate> candidates,
+    std::size_t data_size
+) {
+    std::vector<std::size_t> sorted(candidates.size());
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::ranges::sort(sorted, [&](auto a, auto b) {
+        if (candidates[a].capacity != candidates[b].capacity)
+            return candidates[a].capacity > candidates[b].capacity;
+        return candidates[a].cost < candidates[b].cost;
+    });
+
+    std::vector<std::size_t> order{};
+    std::size_t capacity = 0;
+    for (auto i : sorted) {
+        if (capacity >= data_size || order.size() == MAX_IMAGES)
+            break;
+        order.push_back(i);
+        capacity += candidates[i].capacity;
+    }
+    if (capacity < data_size)
+        return order;
+
+    std::vector<bool> used(candidates.size());
+    for (auto i : order)
+        used[i] = true;
+    used[order.back()] = false;
+    auto rest = data_size - (capacity - candidates[order.back()].capacity);
+    order.back() = cheapest_fitting(candidates, used, rest);
+    return order;
+}
+
+/**
+ * @brief Takes candidates with the most capacity per pixel byte, at each step
+ * finishing the plan by the cheapest candidate which holds the rest of the
+ * message is considered, and the cheapest of these plans is used.
+ */
+static std::vector<std::size_t> fewest_bytes(
+    std::span<const carrier_candidate> candidates,
+    std::size_t data_size
+) {
+    std::vector<std::size_t> sorted{};
+    for (auto i = 0u; i < candidates.size(); ++i)
+        if (candidates[i].capacity > 0)
+            sorted.push_back(i);
+    std::ranges::sort(sorted, [&](auto a, auto b) {
+        return static_cast<double>(candidates[a].cost) / candidates[a].capacity <
+               static_cast<double>(candidates[b].cost) / candidates[b].capacity;
+    });
+
+    std::vector<bool> used(candidates.size());
+    std::vector<std::size_t> order{};
+    std::vector<std::size_t> best{};
+    auto best_cost = std::numeric_limits<std::size_t>::max();
+    std::size_t cost = 0;
+    std::size_t rest = data_size;
+    for (auto i : sorted) {
+        auto last = cheapest_fitting(candidates, used, rest);
+        if (last != NONE && cost + candidates[last].cost < best_cost) {
+            best = order;
+            best.push_back(last);
+            best_cost = cost + candidates[last].cost;
+        }
+        if (order.size() + 1 >= MAX_IMAGES)
+            break;
+        order.push_back(i);
+        used[i] = true;
+        cost += candidates[i].cost;
+        rest -= std::min(rest, candidates[i].capacity);
+        if (rest == 0) {
+            if (cost < best_cost)
+                best = order;
+            break;
+        }
+    }
+    return best.empty() ? order : best;
+}
+
+/**
+ * @brief Returns the size of the largest data part of the plan.
+ */
+static std::size_t largest_part(
+    std::span<const carrier_candidate> candidates,
+    const std::vector<std::size_t> &order,
+    std::size_t data_size
+) {
+    std::size_t largest = 0;
+    for (auto i : order) {
+        auto part = std::min(candidates[i].capacity, data_size);
+        largest = std::max(largest, part);
+        data_size -= part;
+    }
+    return largest;
+}
+
+bool select_carriers(
+    std::span<const carrier_candidate> candidates,
+    std::size_t data_size,
+    std::size_t parity_count,
+    carrier_selection selection,
+    carrier_plan &plan,
+    std::ostream &err
+) {
+    plan = {};
+    if (data_size == 0)
+        return true;
+
+    switch (selection) {
+    case carrier_selection::FEWEST_CARRIERS:
+        plan.order = fewest_carriers(candidates, data_size);
+        break;
+    case carrier_selection::FEWEST_BYTES:
+        plan.order = fewest_bytes(candidates, data_size);
+        break;
+    default:
+        for (std::size_t i = 0, capacity = 0; i < candidates.size() &&
+             i < MAX_IMAGES && capacity < data_size; ++i) {
+            plan.order.push_back(i);
+            capacity += candidates[i].capacity;
+        }
+    }
+    std::size_t capacity = 0;
+    for (auto i : plan.order)
+        capacity += candidates[i].capacity;
+    if (capacity < data_size) {
+        capacity_log(err, capacity, data_size);
+        return false;
+    }
+    plan.data_count = plan.order.size();
+    if (parity_count == 0)
+        return true;
+    if (plan.data_count + parity_count > std::min(candidates.size(), MAX_IMAGES)) {
+        parity_images_log(err, parity_count, plan.data_count,
+                          candidates.size());
+        return false;
+    }
+
+    /* parity carriers follow the data carriers in the given order, or
+     * the cheapest ones large enough are used */
+    auto part_size = largest_part(candidates, plan.order, data_size);
+    std::vector<bool> used(candidates.size());
+    for (auto i : plan.order)
+        used[i] = true;
+    for (auto _ = 0u; _ < parity_count; ++_) {
+        auto i = NONE;
+        if (selection == carrier_selection::ORDER) {
+            auto next = plan.order.size();
+            if (next < candidates.size() &&
+                candidates[next].capacity >= part_size)
+                i = next;
+        } else {
+            i = cheapest_fitting(candidates, used, part_size);
+        }
+        if (i == NONE) {
+            parity_candidates_log(err, parity_count, plan.data_count,
+                                  part_size);
+            return false;
+        }
+        plan.order.push_back(i);
+        used[i] = true;
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#include "prefetch.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "in_memory.h"
+
+bool prefetch_image(const bmp_image &im, std::size_t window) {
+    if (!im.seekable || im.input || im.filename == STDIO_FILENAME)
+        return false;
+    /* a zero length would hint the whole file */
+    auto size = std::min(window, image_file_size(im));
+    if (size == 0)
+        return false;
+
+    auto fd = ::open(im.filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    /* the pages stay in the page cache after the file is closed */
+    auto res = ::posix_fadvise(fd, 0, static_cast<off_t>(size),
+                               POSIX_FADV_WILLNEED);
+    ::close(fd);
+    return res == 0;
+}
+
+image_prefetcher::image_prefetcher(std::size_t depth, std::size_t memory_limit)
+    : depth(depth)
+    , window(memory_limit > 0 && depth > 0
+             ? std::min(PREFETCH_WINDOW, memory_limit / depth)
+             : PREFETCH_WINDOW) {}
+
+void image_prefetcher::advance(
+    const std::vector<bmp_image> &images,
+    std::size_t current,
+    std::span<const std::size_t> order
+) {
+    if (depth == 0 || window == 0)
+        return;
+    auto count = order.empty() ? images.size() : order.size();
+    auto last = std::min(count, current + 1 + depth);
+    for (next = std::max(next, current + 1); next < last; ++next) {
+        auto &im = images[order.empty() ? next : order[next]];
+        if (prefetch_image(im, window))
+            ++hinted_images;
+    }
+}
+
+void image_prefetcher::restart() {
+    next = 0;
+}
+
+std::size_t image_prefetcher::hinted() const {
+    return hinted_images;
+}
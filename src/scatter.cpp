@@ -0,0 +1,83 @@
+#include "scatter.h"
+
+#include <algorithm>
+#include <span>
+#include <string_view>
+
+#include "configuration.h"
+
+/* splitmix64 finalizer */
+static uint64_t mix(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebull;
+    value ^= value >> 31;
+    return value;
+}
+
+cell_scatter::feistel::feistel(std::size_t size) : size(size) {
+    while ((std::size_t{1} << (2 * half_bits)) < size)
+        ++half_bits;
+}
+
+std::size_t cell_scatter::feistel::permute(
+    std::size_t index,
+    uint64_t tweak,
+    const std::array<uint64_t, 4> &keys
+) const {
+    if (size <= 1)
+        return index;
+    uint64_t mask = (uint64_t{1} << half_bits) - 1;
+    /* cycle walking, the domain is at most 4 times larger than `size` */
+    do {
+        uint64_t left = index >> half_bits;
+        uint64_t right = index & mask;
+        for (auto key : keys) {
+            auto next = left ^ (mix(right ^ key ^ tweak) & mask);
+            left = right;
+            right = next;
+        }
+        index = static_cast<std::size_t>((left << half_bits) | right);
+    } while (index >= size);
+    return index;
+}
+
+static std::size_t data_cell_count(const bmp_image &im) {
+    auto cells = static_cast<std::size_t>(im.width) * im.channel_count * im.height;
+    return cells > im.data_start_cell() ? cells - im.data_start_cell() : 0;
+}
+
+cell_scatter::cell_scatter(const key_type &key, const bmp_image &im)
+    : first_cell(im.data_start_cell())
+    , count(data_cell_count(im))
+    , full_blocks(count / SCATTER_BLOCK_CELLS)
+    , blocks(full_blocks)
+    , block_cells(SCATTER_BLOCK_CELLS)
+    , tail_cells(count % SCATTER_BLOCK_CELLS) {
+    /* round keys are independent of the keystream of the cipher */
+    std::array<uint8_t, 40> input{};
+    std::ranges::copy(key, input.begin());
+    std::ranges::copy(std::string_view("scatter!"), input.begin() + key.size());
+    auto digest = sha256(input);
+    for (auto i = 0u; i < keys.size(); ++i)
+        for (auto j = 0u; j < 8; ++j)
+            keys[i] |= static_cast<uint64_t>(digest[8 * i + j]) << (8 * j);
+}
+
+std::size_t cell_scatter::operator()(std::size_t index) const {
+    auto block = index / SCATTER_BLOCK_CELLS;
+    auto cell = index % SCATTER_BLOCK_CELLS;
+    if (block == full_blocks)
+        return first_cell + block * SCATTER_BLOCK_CELLS
+               + tail_cells.permute(cell, ~uint64_t{0}, keys);
+
+    /* each block has its own order of cells */
+    auto target = blocks.permute(block, 0, keys);
+    return first_cell + target * SCATTER_BLOCK_CELLS
+           + block_cells.permute(cell, mix(block + 1), keys);
+}
+
+std::size_t cell_scatter::cell_count() const {
+    return count;
+}
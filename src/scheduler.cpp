@@ -0,0 +1,127 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+/* scheduler and worker which run the current thread's job */
+static thread_local work_stealing_scheduler *current_scheduler = nullptr;
+static thread_local std::size_t current_worker = 0;
+
+void print_worker_stats(std::ostream &os, const std::vector<worker_stats> &stats) {
+    for (auto i = 0u; i < stats.size(); ++i) {
+        auto busy = std::chrono::duration_cast<std::chrono::microseconds>(
+            stats[i].busy);
+        os << "worker " << i << ": " << stats[i].executed << " jobs ("
+           << stats[i].stolen << " stolen), busy " << busy.count() / 1000.0
+           << " ms\n";
+    }
+}
+
+work_stealing_scheduler::work_stealing_scheduler(std::size_t workers)
+    : workers_stats(std::max<std::size_t>(workers, 1)) {
+    for (auto _ = 0u; _ < workers_stats.size(); ++_)
+        queues.push_back(std::make_unique<worker_queue>());
+}
+
+void work_stealing_scheduler::spawn(job j) {
+    std::size_t worker;
+    if (current_scheduler == this) {
+        worker = current_worker;
+    } else {
+        worker = next_queue;
+        next_queue = (next_queue + 1) % queues.size();
+    }
+
+    ++pending;
+    /* counted before the job is queued, so it never drops below the number
+     * of queued jobs */
+    ++queued;
+    {
+        std::lock_guard lock{queues[worker]->mutex};
+        queues[worker]->jobs.push_back(std::move(j));
+    }
+    wake(false);
+}
+
+void work_stealing_scheduler::run() {
+    std::vector<std::jthread> threads{};
+    for (auto i = 1u; i < queues.size(); ++i)
+        threads.emplace_back([this, i]() { work(i); });
+    work(0);
+}
+
+const std::vector<worker_stats> &work_stealing_scheduler::stats() const {
+    return workers_stats;
+}
+
+bool work_stealing_scheduler::pop(std::size_t worker, job &j) {
+    auto &queue = *queues[worker];
+    std::lock_guard lock{queue.mutex};
+    if (queue.jobs.empty())
+        return false;
+    j = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    --queued;
+    return true;
+}
+
+bool work_stealing_scheduler::steal(std::size_t thief, job &j) {
+    for (auto i = 1u; i < queues.size(); ++i) {
+        auto &queue = *queues[(thief + i) % queues.size()];
+        std::lock_guard lock{queue.mutex};
+        if (queue.jobs.empty())
+            continue;
+        j = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        --queued;
+        return true;
+    }
+    return false;
+}
+
+void work_stealing_scheduler::work(std::size_t worker) {
+    auto previous_scheduler = current_scheduler;
+    auto previous_worker = current_worker;
+    current_scheduler = this;
+    current_worker = worker;
+
+    auto &stats = workers_stats[worker];
+    job j;
+    while (pending > 0) {
+        if (pop(worker, j)) {
+            ++stats.executed;
+        } else if (steal(worker, j)) {
+            ++stats.executed;
+            ++stats.stolen;
+        } else {
+            std::unique_lock lock{idle_mutex};
+            idle.wait(lock, [this]() { return queued > 0 || pending == 0; });
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        j();
+        stats.busy += std::chrono::steady_clock::now() - start;
+        j = nullptr;
+        if (--pending == 0)
+            wake(true);
+    }
+
+    current_scheduler = previous_scheduler;
+    current_worker = previous_worker;
+}
+
+/**
+ * Wakes one idle worker after a job was added, or all of them after the last
+ * job finished. The mutex is taken, so a worker which is just about to wait
+ * does not miss the change.
+ */
+void work_stealing_scheduler::wake(bool all) {
+    {
+        std::lock_guard lock{idle_mutex};
+    }
+    if (all)
+        idle.notify_all();
+    else
+        idle.notify_one();
+}
@@ -0,0 +1,611 @@
+#include "stripes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <utility>
+
+#include "budget.h"
+#include "compress.h"
+#include "configuration.h"
+#include "crc.h"
+#include "extract.h"
+#include "hide.h"
+#include "in_memory.h"
+#include "interleave.h"
+#include "metadata.h"
+#include "parity.h"
+
+static void data_size_error_log(
+    std::ostream &os,
+    std::size_t images_bytes_capacity,
+    std::size_t data_size
+) {
+    os << "only first " << images_bytes_capacity << " bytes were hidden, "
+          "please use more or larger images (" << data_size
+       << " byte capacity is needed)\n";
+}
+
+static void image_capacity_log(
+    std::ostream &os,
+    std::string_view filename,
+    std::size_t capacity
+) {
+    os << "image " << filename << " was opened with " << capacity
+       << " byte capacity\n";
+}
+
+static void image_not_necessary_log(
+    std::ostream &os,
+    std::string_view filename
+) {
+    os << "image " << filename << " was not necessary to hide data\n";
+}
+
+static void too_many_images_log(std::ostream &os) {
+    os << "data can be hidden into at most " << MAX_IMAGES << " images\n";
+}
+
+static void open_error_log(std::ostream &os, std::string_view filename) {
+    os << "could not open image " << filename << " or its output file\n";
+}
+
+static void run_out_of_bytes_log(std::ostream &os, std::string_view filename) {
+    os << "image file " << filename << " is smaller than its header states\n";
+}
+
+static void parity_capacity_log(
+    std::ostream &os,
+    std::string_view filename,
+    std::size_t capacity,
+    std::size_t size
+) {
+    os << "image " << filename << " has only " << capacity << " byte capacity, "
+       << size << " bytes are needed for a parity image\n";
+}
+
+static void write_error_log(std::ostream &os, std::string_view filename) {
+    os << "could not write altered image " << filename << '\n';
+}
+
+std::size_t stripe_bytes(const bmp_image &im) {
+    std::size_t row_size = static_cast<std::size_t>(im.width) * im.channel_count;
+    auto rows = std::max<std::size_t>(STRIPE_CELLS / row_size, 1);
+    return std::max<std::size_t>(rows * row_size / im.cells_per_byte, 1);
+}
+
+/* image processed by stripe jobs */
+struct striped_image {
+    bmp_image *im{nullptr};
+    std::vector<std::byte> file{};
+    /* part of the message hidden in (or extracted from) the image */
+    std::span<uint8_t> data{};
+    std::size_t message_offset{0};
+    const chacha20 *cipher{nullptr};
+    /* set if the data are scattered */
+    std::optional<cell_scatter> scatter{};
+    /* set if the whole file was read by `read_image_file` */
+    bool small{false};
+    /* distortion of each stripe, merged by `finish_image`, empty if
+     * the distortion is not measured */
+    std::vector<image_distortion> distortion{};
+    /* budget from which `reserved` bytes were reserved for the file */
+    memory_budget *budget{nullptr};
+    std::size_t reserved{0};
+    std::atomic<std::size_t> stripes_left{0};
+    std::atomic<bool> failed{false};
+    /* errors are written by jobs, so they are printed in image order later */
+    std::ostringstream err{};
+
+    std::span<std::byte> pixels() {
+        return std::span(file).subspan(im->data_offset);
+    }
+
+    bool hide_stripe(std::span<const uint8_t> stripe, std::size_t offset) {
+        auto first_cell = im->data_start_cell() + offset * im->cells_per_byte;
+        /* stripes are hidden concurrently, each into its own distortion */
+        auto stripe_distortion = distortion.empty()
+            ? nullptr : &distortion[offset / stripe_bytes(*im)];
+        if (scatter)
+            return hide_bytes_scattered(*im, pixels(), *scatter,
+                                        offset * im->cells_per_byte, stripe,
+                                        im->chunk_size, stripe_distortion);
+        return hide_bytes_at(*im, pixels(), first_cell, stripe, im->chunk_size,
+                             stripe_distortion);
+    }
+
+    /* frees the image file and releases its memory to the budget */
+    void release() {
+        std::vector<std::byte>{}.swap(file);
+        if (budget)
+            budget->release(std::exchange(reserved, 0));
+    }
+
+    bool extract_stripe(std::span<uint8_t> stripe, std::size_t offset) {
+        auto first_cell = im->data_start_cell() + offset * im->cells_per_byte;
+        if (scatter)
+            return extract_bytes_scattered(*im, pixels(), *scatter,
+                                           offset * im->cells_per_byte, stripe,
+                                           im->chunk_size);
+        return extract_bytes_at(*im, pixels(), first_cell, stripe,
+                                im->chunk_size);
+    }
+};
+
+/**
+ * @brief Reads the whole image into memory, small images by a single system
+ * call.
+ */
+static bool read_part_image(striped_image &part) {
+    part.small = is_small_image(*part.im);
+    if (part.small)
+        return read_image_file(*part.im, part.file) &&
+               part.file.size() >= part.im->data_offset;
+    return read_image(*part.im, part.file);
+}
+
+/**
+ * @brief Calls `fn(offset, size)` for every stripe of the image data part.
+ */
+static void for_each_stripe(striped_image &part, auto fn) {
+    auto size = stripe_bytes(*part.im);
+    for (std::size_t offset = 0; offset < part.data.size(); offset += size)
+        fn(offset, std::min(size, part.data.size() - offset));
+}
+
+static std::size_t stripe_count(striped_image &part) {
+    auto size = stripe_bytes(*part.im);
+    return (part.data.size() + size - 1) / size;
+}
+
+/**
+ * @brief Hides metadata of the image, the data part has to be hidden already,
+ * so its checksum is known, and writes the image.
+ */
+static void finish_image(striped_image &part, uint8_t id, uint8_t seq) {
+    auto &im = *part.im;
+    if (im.flags & MD_FLAG_CHECKSUM)
+        set_metadata_checksum(im, crc32c(part.data));
+    auto metadata = make_metadata(
+        im, static_cast<uint32_t>(part.data.size()), id, seq);
+    for (auto &stripe_distortion : part.distortion)
+        im.distortion->merge(stripe_distortion);
+    if (!hide_bytes_at(im, part.pixels(), 0, metadata, MD_CHUNK_SIZE,
+                       im.distortion ? &*im.distortion : nullptr)) {
+        run_out_of_bytes_log(part.err, im.filename);
+        part.failed = true;
+        return;
+    }
+
+    /* small images are written by a single system call */
+    if (part.small && !im.output && im.get_output_path() != STDIO_FILENAME) {
+        if (!write_image_file(im, part.file)) {
+            write_error_log(part.err, im.filename);
+            part.failed = true;
+        }
+        return;
+    }
+    if (!im.open_output()) {
+        open_error_log(part.err, im.filename);
+        part.failed = true;
+        return;
+    }
+    auto pixels = part.pixels();
+    if (!im.output->write(reinterpret_cast<const char *>(pixels.data()),
+                          pixels.size())) {
+        write_error_log(part.err, im.filename);
+        part.failed = true;
+    }
+    im.close();
+}
+
+static void hide_stripes(
+    striped_image &part,
+    work_stealing_scheduler &scheduler,
+    const data_encoding &encoding,
+    uint8_t id,
+    uint8_t seq
+) {
+    auto &im = *part.im;
+    if (!read_part_image(part)) {
+        open_error_log(part.err, im.filename);
+        part.failed = true;
+        part.release();
+        return;
+    }
+    if (encoding.scatter_key)
+        part.scatter.emplace(*encoding.scatter_key, im);
+
+    part.stripes_left = stripe_count(part);
+    if (im.distortion)
+        part.distortion.resize(part.stripes_left);
+    if (part.stripes_left == 0) {
+        finish_image(part, id, seq);
+        part.release();
+        return;
+    }
+    for_each_stripe(part, [&](std::size_t offset, std::size_t size) {
+        scheduler.spawn([&part, offset, size, id, seq]() {
+            auto stripe = part.data.subspan(offset, size);
+            if (part.cipher)
+                part.cipher->apply(stripe, part.message_offset + offset);
+            if (!part.hide_stripe(stripe, offset)) {
+                /* only one stripe logs, others just notice the failure */
+                if (!part.failed.exchange(true))
+                    run_out_of_bytes_log(part.err, part.im->filename);
+            }
+            /* the last stripe writes the image and frees it */
+            if (--part.stripes_left == 0) {
+                if (!part.failed)
+                    finish_image(part, id, seq);
+                part.release();
+            }
+        });
+    });
+}
+
+int hide_in_stripes(
+    std::vector<bmp_image> &images,
+    std::istream &data_in,
+    work_stealing_scheduler &scheduler,
+    std::ostream &out,
+    std::ostream &err,
+    const hide_options &options
+) {
+    std::vector<uint8_t> data{};
+    if (!read_message(data_in, data, options, err))
+        return 1;
+    auto encoding = encode_data(data, options, out);
+    if (!plan_carriers(images, encoding, data.size(), err, options))
+        return 1;
+    auto needs = hiding_memory(images, encoding, data.size(), true);
+    if (!check_memory_limit(options.memory_limit, needs.total(), err))
+        return 1;
+    if (encoding.flags & MD_FLAG_INTERLEAVED)
+        interleave_data(data, encoding);
+    auto id = generate_id();
+
+    std::vector<std::unique_ptr<striped_image>> parts{};
+    std::size_t data_index = 0;
+    auto seq = 0u;
+    for (; data_index < data.size() && seq < images.size(); ++seq) {
+        if (seq >= MAX_IMAGES) {
+            too_many_images_log(err);
+            return 1;
+        }
+        auto &im = images[seq];
+        apply_encoding(im, encoding);
+        auto capacity = im.byte_capacity();
+        image_capacity_log(out, im.filename, capacity);
+        measure_distortion(im, options);
+
+        auto part = std::make_unique<striped_image>();
+        part->im = &im;
+        part->data = std::span(data).subspan(
+            data_index, encoding.part_sizes.empty()
+                ? std::min(capacity, data.size() - data_index)
+                : encoding.part_sizes[seq]);
+        part->message_offset = data_index;
+        part->cipher = encoding.cipher ? &*encoding.cipher : nullptr;
+        data_index += part->data.size();
+        parts.push_back(std::move(part));
+    }
+    /* images are read only when their files fit into the memory left
+     * by the message */
+    memory_budget budget{
+        options.memory_limit ? options.memory_limit - needs.message : 0,
+        [&](memory_budget::job j) { scheduler.spawn(std::move(j)); }};
+    auto run_parts = [&](std::size_t first) {
+        for (auto i = first; i < parts.size(); ++i) {
+            parts[i]->budget = &budget;
+            parts[i]->reserved = image_file_size(*parts[i]->im);
+            budget.submit(parts[i]->reserved, [&, i]() {
+                hide_stripes(*parts[i], scheduler, encoding, id,
+                             static_cast<uint8_t>(i));
+            });
+        }
+        scheduler.run();
+
+        auto failed = false;
+        for (auto i = first; i < parts.size(); ++i) {
+            err << parts[i]->err.str();
+            failed = failed || parts[i]->failed;
+        }
+        return !failed;
+    };
+    if (!run_parts(0))
+        return 2;
+
+    /* parity is computed from the stored (encrypted) data parts, so they
+     * are hidden after all data parts */
+    std::vector<std::vector<uint8_t>> parity{};
+    if (data_index == data.size() && encoding.carriers.parity > 0) {
+        std::vector<std::span<const uint8_t>> data_parts{};
+        for (auto &part : parts)
+            data_parts.push_back(part->data);
+        parity = encode_parity(data_parts, encoding.carriers.parity);
+
+        auto first = parts.size();
+        for (auto &parity_part : parity) {
+            auto &im = images[parts.size()];
+            apply_encoding(im, encoding);
+            std::ranges::copy(std::span(parity_part).first(PARITY_HEADER_SIZE),
+                              metadata_parity_header(im).begin());
+            auto data_part = std::span(parity_part).subspan(PARITY_HEADER_SIZE);
+            image_capacity_log(out, im.filename, im.byte_capacity());
+            if (im.byte_capacity() < data_part.size()) {
+                parity_capacity_log(err, im.filename, im.byte_capacity(),
+                                    data_part.size());
+                return 1;
+            }
+            measure_distortion(im, options);
+            auto part = std::make_unique<striped_image>();
+            part->im = &im;
+            part->data = data_part;
+            parts.push_back(std::move(part));
+        }
+        if (!run_parts(first))
+            return 2;
+    }
+    for (auto i = parts.size(); i < images.size() &&
+                                options.select == carrier_selection::ORDER; ++i)
+        image_not_necessary_log(out, images[i].filename);
+
+    if (data_index < data.size()) {
+        data_size_error_log(err, data_index, data.size());
+        return 1;
+    }
+    return 0;
+}
+
+static void extract_error_log(std::ostream &os) {
+    os << "could not write extracted data\n";
+}
+
+static void corrupted_data_log(std::ostream &os) {
+    os << "hidden compressed data are corrupted\n";
+}
+
+static void checksum_mismatch_log(std::ostream &os, std::string_view filename) {
+    os << "checksum of data hidden in image " << filename
+       << " does not match, the data are corrupted\n";
+}
+
+/**
+ * @brief Spawns jobs which extract stripes of the image data part, stripes
+ * are decrypted right away unless the checksum of the stored data has to be
+ * verified first.
+ */
+static void extract_stripes(
+    striped_image &part,
+    work_stealing_scheduler &scheduler,
+    bool decrypt
+) {
+    /* files dropped after the metadata were extracted are read again */
+    if (part.file.empty() && !read_part_image(part)) {
+        part.err << "image " << part.im->filename << " could not be opened\n";
+        part.failed = true;
+        part.release();
+        return;
+    }
+    part.stripes_left = stripe_count(part);
+    if (part.stripes_left == 0) {
+        part.release();
+        return;
+    }
+    for_each_stripe(part, [&](std::size_t offset, std::size_t size) {
+        scheduler.spawn([&part, offset, size, decrypt]() {
+            auto stripe = part.data.subspan(offset, size);
+            if (!part.extract_stripe(stripe, offset)) {
+                if (!part.failed.exchange(true))
+                    run_out_of_bytes_log(part.err, part.im->filename);
+            } else if (decrypt && part.cipher) {
+                part.cipher->apply(stripe, part.message_offset + offset);
+            }
+            /* the last stripe frees the image */
+            if (--part.stripes_left == 0)
+                part.release();
+        });
+    });
+}
+
+/**
+ * @brief Verifies checksum of the extracted data part and then spawns jobs
+ * which decrypt its stripes.
+ */
+static void verify_stripes(striped_image &part, work_stealing_scheduler &scheduler) {
+    if (crc32c(part.data) != metadata_checksum(*part.im)) {
+        checksum_mismatch_log(part.err, part.im->filename);
+        part.failed = true;
+        return;
+    }
+    if (!part.cipher)
+        return;
+    for_each_stripe(part, [&](std::size_t offset, std::size_t size) {
+        scheduler.spawn([&part, offset, size]() {
+            part.cipher->apply(part.data.subspan(offset, size),
+                               part.message_offset + offset);
+        });
+    });
+}
+
+/**
+ * @brief Extracts data parts of images in order given by `indx`, stripes
+ * of all images are extracted in parallel.
+ * 
+ * @return `true` on success, `false` otherwise
+ */
+static bool extract_parts(
+    std::vector<std::unique_ptr<striped_image>> &parts,
+    const std::vector<std::size_t> &indx,
+    const data_decoding &decoding,
+    work_stealing_scheduler &scheduler,
+    memory_budget &budget,
+    std::vector<uint8_t> &data,
+    std::ostream &err
+) {
+    std::size_t data_size = 0;
+    for (auto i : indx)
+        data_size += parts[i]->im->hidden_data_size;
+    data.resize(data_size);
+
+    auto checksum = (parts[indx[0]]->im->flags & MD_FLAG_CHECKSUM) != 0;
+    std::size_t data_index = 0;
+    for (auto i : indx) {
+        auto &part = *parts[i];
+        part.data = std::span(data).subspan(data_index, part.im->hidden_data_size);
+        part.message_offset = data_index;
+        /* interleaved data are decrypted after they are reordered */
+        part.cipher = decoding.cipher && !(part.im->flags & MD_FLAG_INTERLEAVED)
+            ? &*decoding.cipher : nullptr;
+        if (decoding.scatter_key)
+            part.scatter.emplace(*decoding.scatter_key, *part.im);
+        data_index += part.data.size();
+
+        part.budget = &budget;
+        part.reserved = image_file_size(*part.im);
+        budget.submit(part.reserved, [&part, &scheduler, checksum]() {
+            extract_stripes(part, scheduler, !checksum);
+        });
+    }
+    scheduler.run();
+
+    /* the checksum covers the stored data, so it is verified before
+     * decryption */
+    if (checksum) {
+        for (auto i : indx) {
+            auto &part = *parts[i];
+            if (!part.failed)
+                scheduler.spawn([&part, &scheduler]() {
+                    verify_stripes(part, scheduler);
+                });
+        }
+        scheduler.run();
+    }
+
+    for (auto i : indx) {
+        err << parts[i]->err.str();
+        if (parts[i]->failed)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reorders extracted interleaved data parts into the message
+ * and decrypts it.
+ */
+static void deinterleave_parts(
+    const std::vector<bmp_image> &images,
+    const std::vector<std::size_t> &indx,
+    const data_decoding &decoding,
+    std::vector<uint8_t> &data
+) {
+    std::vector<std::size_t> part_sizes{};
+    for (auto i : indx)
+        part_sizes.push_back(images[i].hidden_data_size);
+    interleaved_layout layout{part_sizes, data.size()};
+    std::vector<uint8_t> message(data.size());
+    layout.deinterleave(data, message);
+    data = std::move(message);
+    if (decoding.cipher)
+        decoding.cipher->apply(data, 0);
+}
+
+int extract_in_stripes(
+    std::vector<bmp_image> &images,
+    std::ostream &data_ostream,
+    work_stealing_scheduler &scheduler,
+    std::ostream &err,
+    const extract_options &options
+) {
+    auto limit = options.memory_limit;
+    auto spawn = [&](memory_budget::job j) { scheduler.spawn(std::move(j)); };
+    std::vector<std::unique_ptr<striped_image>> parts{};
+    std::size_t largest = 0;
+    for (auto &im : images) {
+        parts.push_back(std::make_unique<striped_image>());
+        parts.back()->im = &im;
+        largest = std::max(largest, image_file_size(im));
+    }
+    if (!check_memory_limit(limit, largest, err))
+        return 1;
+
+    /* with a memory limit, files are read again when the data are extracted,
+     * so only the files being read are held, except for images which can
+     * not seek */
+    memory_budget metadata_budget{limit, spawn};
+    for (auto &part : parts) {
+        part->reserved = image_file_size(*part->im);
+        metadata_budget.submit(part->reserved, [&, &part = *part]() {
+            auto &im = *part.im;
+            if (!read_part_image(part)) {
+                part.err << "image " << im.filename << " could not be opened\n";
+                part.failed = true;
+            } else if (!extract_metadata_in_memory(im, part.file, part.err)) {
+                part.failed = true;
+            }
+            if (limit && im.seekable)
+                std::vector<std::byte>{}.swap(part.file);
+            metadata_budget.release(part.reserved);
+        });
+    }
+    scheduler.run();
+
+    for (auto &part : parts) {
+        err << part->err.str();
+        if (part->failed)
+            return 1;
+    }
+
+    std::vector<std::size_t> indx{};
+    if (!order_session(images, indx, err))
+        return 1;
+    data_decoding decoding{};
+    if (!prepare_decoding(images[indx[0]], options, decoding, err))
+        return 1;
+
+    auto rebuilding = (images[indx[0]].flags & MD_FLAG_PARITY) &&
+                      data_carriers_missing(images, indx);
+    auto needs = extraction_memory(images, indx, rebuilding, true);
+    if (!check_memory_limit(limit, needs.total(), err))
+        return 1;
+
+    std::vector<uint8_t> data{};
+    if (rebuilding) {
+        /* without files held in memory, images are read one by one */
+        std::vector<std::vector<std::byte>> files{};
+        for (auto &part : parts)
+            if (!limit)
+                files.push_back(std::move(part->file));
+        if (!rebuild_message(images, indx, decoding, data, err, files))
+            return 1;
+        if (decoding.cipher)
+            decoding.cipher->apply(data, 0);
+    } else {
+        memory_budget data_budget{limit ? limit - needs.message : 0, spawn};
+        if (!extract_parts(parts, indx, decoding, scheduler, data_budget,
+                           data, err))
+            return 1;
+        if (images[indx[0]].flags & MD_FLAG_INTERLEAVED)
+            deinterleave_parts(images, indx, decoding, data);
+    }
+
+    if (images[indx[0]].flags & MD_FLAG_COMPRESSED) {
+        decompressor decompress{};
+        if (!decompress.write(data, data_ostream) || !decompress.finished()) {
+            corrupted_data_log(err);
+            return 1;
+        }
+    } else {
+        data_ostream.write(reinterpret_cast<const char *>(data.data()),
+                           data.size());
+    }
+    if (!data_ostream) {
+        extract_error_log(err);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+#include "update.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <span>
+
+#include "compress.h"
+#include "configuration.h"
+#include "crc.h"
+#include "hide.h"
+#include "in_memory.h"
+#include "interleave.h"
+#include "metadata.h"
+#include "parity.h"
+
+static void open_error_log(std::ostream &os, std::string_view filename) {
+    os << "image " << filename << " could not be opened\n";
+}
+
+static void not_seekable_log(std::ostream &os, std::string_view filename) {
+    os << "image " << filename << " can not be updated in place, "
+          "only files can be updated\n";
+}
+
+static void incomplete_session_log(std::ostream &os) {
+    os << "all images of the hiding are needed to update it\n";
+}
+
+static void data_size_error_log(
+    std::ostream &os,
+    std::size_t images_bytes_capacity,
+    std::size_t data_size
+) {
+    os << "images can hold only " << images_bytes_capacity << " bytes ("
+       << data_size << " byte capacity is needed), please hide the data "
+          "again into more or larger images\n";
+}
+
+static void run_out_of_bytes_log(std::ostream &os, std::string_view filename) {
+    os << "image " << filename << " is smaller than its header states\n";
+}
+
+static void write_error_log(std::ostream &os, std::string_view filename) {
+    os << "could not write updated image " << filename << '\n';
+}
+
+static void rewritten_log(
+    std::ostream &os,
+    std::string_view filename,
+    std::size_t rewritten,
+    std::size_t size
+) {
+    os << "image " << filename << ": " << rewritten << " of " << size
+       << " bytes were rewritten\n";
+}
+
+/**
+ * @brief Recreates encoding of the hidden data from metadata, so the new
+ * message is stored the same way.
+ */
+static data_encoding session_encoding(
+    const bmp_image &im,
+    const data_decoding &decoding
+) {
+    data_encoding encoding{};
+    encoding.flags = im.flags & ~MD_FLAG_EXTENDED;
+    if (im.flags & MD_FLAG_ENCRYPTED) {
+        std::ranges::copy(extra_metadata_field(im, MD_FLAG_ENCRYPTED),
+                          encoding.nonce.begin());
+        encoding.cipher = decoding.cipher;
+        encoding.scatter_key = decoding.scatter_key;
+    }
+    if (im.flags & MD_FLAG_PARITY)
+        encoding.carriers = metadata_carriers(im);
+    return encoding;
+}
+
+/**
+ * @brief Stored data part of an image and where it is hidden.
+ */
+struct updated_part {
+    const data_encoding &encoding;
+    std::optional<cell_scatter> scatter{};
+
+    bool hide(const bmp_image &im, std::span<std::byte> pixels,
+              std::size_t offset, std::span<const uint8_t> bytes) const {
+        if (scatter)
+            return hide_bytes_scattered(im, pixels, *scatter,
+                                        offset * im.cells_per_byte, bytes,
+                                        im.chunk_size);
+        return hide_bytes_at(im, pixels,
+                             im.data_start_cell() + offset * im.cells_per_byte,
+                             bytes, im.chunk_size);
+    }
+
+    bool extract(const bmp_image &im, std::span<const std::byte> pixels,
+                 std::span<uint8_t> bytes) const {
+        if (scatter)
+            return extract_bytes_scattered(im, pixels, *scatter, 0, bytes,
+                                           im.chunk_size);
+        return extract_bytes_at(im, pixels, im.data_start_cell(), bytes,
+                                im.chunk_size);
+    }
+};
+
+/**
+ * @brief Writes pages of the image file which differ from the original.
+ * 
+ * @return number of written bytes, or `std::nullopt` on failure
+ */
+static std::optional<std::size_t> write_changes(
+    bmp_image &im,
+    std::span<const std::byte> original,
+    std::span<const std::byte> file
+) {
+    if (!im.output) {
+        auto output = std::make_unique<std::fstream>(
+            im.filename, std::ios::in | std::ios::out | std::ios::binary);
+        if (!output->is_open())
+            return std::nullopt;
+        im.output = std::move(output);
+        im.output_opened = true;
+    }
+    std::size_t written = 0;
+    for (std::size_t offset = 0; offset < file.size(); offset += BUFFER_SIZE) {
+        auto size = std::min(BUFFER_SIZE, file.size() - offset);
+        if (std::memcmp(original.data() + offset, file.data() + offset, size) == 0)
+            continue;
+        im.output->seekp(static_cast<std::streamoff>(offset));
+        im.output->write(reinterpret_cast<const char *>(file.data() + offset),
+                         static_cast<std::streamsize>(size));
+        written += size;
+    }
+    im.output->flush();
+    auto good = im.output->good();
+    im.close();
+    if (!good)
+        return std::nullopt;
+    return written;
+}
+
+/**
+ * @brief Hides the changed blocks of the new data part and the new metadata
+ * into the image and writes the changes.
+ * 
+ * @param parity_header parity header of a parity image, empty otherwise
+ */
+static int update_image(
+    bmp_image &im,
+    std::span<const uint8_t> part,
+    std::span<const uint8_t> parity_header,
+    const data_encoding &encoding,
+    std::ostream &out,
+    std::ostream &err
+) {
+    std::vector<std::byte> file{};
+    if (!read_image(im, file)) {
+        open_error_log(err, im.filename);
+        return 2;
+    }
+    auto original = file;
+    auto pixels = std::span(file).subspan(im.data_offset);
+
+    updated_part updated{encoding};
+    if (encoding.scatter_key)
+        updated.scatter.emplace(*encoding.scatter_key, im);
+    std::vector<uint8_t> old_part(im.hidden_data_size);
+    if (!updated.extract(im, pixels, old_part)) {
+        run_out_of_bytes_log(err, im.filename);
+        return 2;
+    }
+
+    /* only blocks which differ from the stored data are hidden again */
+    for (std::size_t offset = 0; offset < part.size(); offset += BUFFER_SIZE) {
+        auto block = part.subspan(offset, std::min(BUFFER_SIZE,
+                                                   part.size() - offset));
+        if (offset + block.size() <= old_part.size() &&
+            std::ranges::equal(block, std::span(old_part).subspan(
+                                          offset, block.size())))
+            continue;
+        if (!updated.hide(im, pixels, offset, block)) {
+            run_out_of_bytes_log(err, im.filename);
+            return 2;
+        }
+    }
+
+    if (im.flags & MD_FLAG_CHECKSUM)
+        set_metadata_checksum(im, crc32c(part));
+    if (!parity_header.empty())
+        std::ranges::copy(parity_header, metadata_parity_header(im).begin());
+    auto metadata = make_metadata(im, static_cast<uint32_t>(part.size()),
+                                  im.id, im.seq);
+    if (!hide_bytes_at(im, pixels, 0, metadata, MD_CHUNK_SIZE)) {
+        run_out_of_bytes_log(err, im.filename);
+        return 2;
+    }
+    im.hidden_data_size = part.size();
+
+    auto written = write_changes(im, original, file);
+    if (!written) {
+        write_error_log(err, im.filename);
+        return 2;
+    }
+    rewritten_log(out, im.filename, *written, file.size());
+    return 0;
+}
+
+int update(
+    std::vector<bmp_image> &images,
+    std::istream &data_in,
+    std::ostream &out,
+    std::ostream &err,
+    const extract_options &options
+) {
+    for (auto &im : images) {
+        if (!im.seekable || im.filename == STDIO_FILENAME) {
+            not_seekable_log(err, im.filename);
+            return 1;
+        }
+        if (!im.open_input()) {
+            open_error_log(err, im.filename);
+            return 2;
+        }
+        bmp_image_buffer buffer{im, MD_CHUNK_SIZE};
+        auto extracted = extract_hidden_metadata(im, buffer, err);
+        im.close();
+        if (!extracted)
+            return 1;
+    }
+
+    std::vector<std::size_t> indx{};
+    if (!order_session(images, indx, err))
+        return 1;
+    auto &first = images[indx[0]];
+    data_decoding decoding{};
+    if (!prepare_decoding(first, options, decoding, err))
+        return 1;
+    auto encoding = session_encoding(first, decoding);
+    auto data_count = (first.flags & MD_FLAG_PARITY) ? encoding.carriers.data
+                                                      : images.size();
+    if (indx.size() != data_count + encoding.carriers.parity) {
+        incomplete_session_log(err);
+        return 1;
+    }
+
+    auto data = read_data(data_in);
+    if (first.flags & MD_FLAG_COMPRESSED)
+        data = compress(data);
+
+    std::size_t capacity = 0;
+    for (auto i = 0u; i < data_count; ++i)
+        capacity += images[indx[i]].byte_capacity();
+    if (data.size() > capacity) {
+        data_size_error_log(err, capacity, data.size());
+        return 1;
+    }
+    if (encoding.cipher)
+        encoding.cipher->apply(data, 0);
+
+    /* data are split the same way as by `hide`, following images keep
+     * empty data parts */
+    std::vector<std::size_t> part_sizes{};
+    std::size_t data_index = 0;
+    for (auto i = 0u; i < data_count; ++i) {
+        auto size = std::min(images[indx[i]].byte_capacity(),
+                             data.size() - data_index);
+        part_sizes.push_back(size);
+        data_index += size;
+    }
+    if (first.flags & MD_FLAG_INTERLEAVED) {
+        std::vector<std::size_t> capacities{};
+        for (auto i = 0u; i < data_count; ++i)
+            capacities.push_back(images[indx[i]].byte_capacity());
+        interleaved_layout layout{capacities, data.size()};
+        std::vector<uint8_t> interleaved(data.size());
+        layout.interleave(data, interleaved);
+        data = std::move(interleaved);
+        part_sizes = std::move(layout.part_sizes);
+    }
+    std::vector<std::span<const uint8_t>> parts{};
+    data_index = 0;
+    for (auto size : part_sizes) {
+        parts.push_back(std::span(data).subspan(data_index, size));
+        data_index += size;
+    }
+    std::vector<std::vector<uint8_t>> parity{};
+    if (encoding.carriers.parity > 0)
+        parity = encode_parity(parts, encoding.carriers.parity);
+
+    for (auto i = 0u; i < indx.size(); ++i) {
+        auto &im = images[indx[i]];
+        std::span<const uint8_t> part{};
+        std::span<const uint8_t> header{};
+        if (i < data_count) {
+            part = parts[i];
+        } else {
+            auto &parity_part = parity[i - data_count];
+            header = std::span(parity_part).first(PARITY_HEADER_SIZE);
+            part = std::span(parity_part).subspan(PARITY_HEADER_SIZE);
+        }
+        if (auto res = update_image(im, part, header, encoding, out, err))
+            return res;
+    }
+    return 0;
+}
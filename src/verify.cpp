@@ -0,0 +1,140 @@
+#include "verify.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string_view>
+
+#include "configuration.h"
+#include "crc.h"
+#include "in_memory.h"
+#include "metadata.h"
+#include "parallel.h"
+#include "scatter.h"
+
+/* bytes checksummed at once */
+static constexpr std::size_t VERIFY_BLOCK_SIZE = 1 << 16;
+
+enum verify_status { NOT_CHECKED, OK, NO_CHECKSUM, MISMATCH, FAILED };
+
+/* image being verified */
+struct verified_image {
+    verify_status status{NOT_CHECKED};
+    /* kept only for scattered data, which need the key of the session */
+    std::vector<std::byte> file{};
+    std::ostringstream err{};
+};
+
+static void result_log(
+    std::ostream &os,
+    std::string_view filename,
+    verify_status status
+) {
+    os << "image " << filename << ": ";
+    switch (status) {
+    case OK:
+        os << "ok\n";
+        break;
+    case NO_CHECKSUM:
+        os << "no checksum stored\n";
+        break;
+    case MISMATCH:
+        os << "checksum mismatch, hidden data are corrupted\n";
+        break;
+    default:
+        os << "could not be verified\n";
+    }
+}
+
+/**
+ * @brief Checksums the stored data part of the image held in memory.
+ */
+static verify_status check_part(
+    const bmp_image &im,
+    std::span<const std::byte> file,
+    const cell_scatter *scatter
+) {
+    auto pixels = file.subspan(im.data_offset);
+    std::vector<uint8_t> block{};
+    uint32_t crc = 0;
+    for (std::size_t offset = 0; offset < im.hidden_data_size;
+         offset += block.size()) {
+        block.resize(std::min<std::size_t>(VERIFY_BLOCK_SIZE,
+                                           im.hidden_data_size - offset));
+        auto extracted = scatter
+            ? extract_bytes_scattered(im, pixels, *scatter,
+                                      offset * im.cells_per_byte, block,
+                                      im.chunk_size)
+            : extract_bytes_at(im, pixels,
+                               im.data_start_cell() + offset * im.cells_per_byte,
+                               block, im.chunk_size);
+        if (!extracted)
+            return FAILED;
+        crc = crc32c(block, crc);
+    }
+    return crc == metadata_checksum(im) ? OK : MISMATCH;
+}
+
+int verify(
+    std::vector<bmp_image> &images,
+    std::size_t jobs,
+    const extract_options &options,
+    std::ostream &out,
+    std::ostream &err
+) {
+    std::vector<verified_image> results(images.size());
+
+    parallel_for(images.size(), jobs, [&](std::size_t i) {
+        auto &im = images[i];
+        auto &result = results[i];
+        std::vector<std::byte> file{};
+        if (!read_image(im, file)) {
+            result.err << "image " << im.filename << " could not be opened\n";
+            result.status = FAILED;
+            return;
+        }
+        if (!extract_metadata_in_memory(im, file, result.err)) {
+            result.status = FAILED;
+            return;
+        }
+        if (!(im.flags & MD_FLAG_CHECKSUM))
+            result.status = NO_CHECKSUM;
+        else if (im.flags & MD_FLAG_SCATTERED)
+            result.file = std::move(file);
+        else
+            result.status = check_part(im, file, nullptr);
+    });
+
+    auto failed = false;
+    for (auto &result : results) {
+        err << result.err.str();
+        failed = failed || result.status == FAILED;
+    }
+
+    std::vector<std::size_t> indx{};
+    if (failed || !order_session(images, indx, err))
+        failed = true;
+
+    /* scattered data are checked once the key of the session is known */
+    auto scattered = std::ranges::any_of(results, [](auto &result) {
+        return result.status == NOT_CHECKED;
+    });
+    data_decoding decoding{};
+    if (!failed && scattered &&
+        prepare_decoding(images[indx[0]], options, decoding, err)) {
+        parallel_for(images.size(), jobs, [&](std::size_t i) {
+            auto &result = results[i];
+            if (result.status != NOT_CHECKED)
+                return;
+            cell_scatter scatter{*decoding.scatter_key, images[i]};
+            result.status = check_part(images[i], result.file, &scatter);
+            result.file = {};
+        });
+    }
+
+    for (auto i = 0u; i < images.size(); ++i) {
+        result_log(out, images[i].filename, results[i].status);
+        failed = failed || results[i].status == MISMATCH ||
+                 results[i].status == NOT_CHECKED;
+    }
+    return failed ? 1 : 0;
+}
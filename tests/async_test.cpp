@@ -0,0 +1,95 @@
+#include "async.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <sstream>
+#include <memory>
+#include <vector>
+
+#include "hide.h"
+#include "extract.h"
+#include "test_images.h"
+
+/* stego images written by hiding, used for extraction */
+struct job {
+    std::vector<bmp_image> images{};
+    std::vector<std::stringstream *> outputs{};
+    std::string payload{};
+    std::stringstream data{};
+    std::stringstream extracted{};
+    std::stringstream log{};
+    int result{-1};
+};
+
+static void prepare_hide(job &j, int n) {
+    for (int i = 0; i < 3; ++i) {
+        j.images.push_back(load_image("image" + std::to_string(i),
+                                      make_bmp(33 + i, 21)));
+        auto os = std::make_unique<std::stringstream>();
+        j.outputs.push_back(os.get());
+        j.images.back().assign_output(std::move(os));
+        j.images.back().write_header_to_output();
+    }
+    for (int i = 0; i < 900 + n; ++i)
+        j.payload.push_back(static_cast<char>(i * n + 5));
+    j.data.str(j.payload);
+}
+
+static void prepare_extract(job &j) {
+    std::vector<bmp_image> stego{};
+    /* images which were not necessary have only the header written */
+    for (auto i = 0u; i < j.outputs.size() && j.outputs[i]->str().size() > 54; ++i)
+        stego.push_back(load_image("stego" + std::to_string(i),
+                                   j.outputs[i]->str()));
+    j.images = std::move(stego);
+}
+
+static detached_task run(task<int> t, int &result, std::atomic<int> &done) {
+    result = co_await t;
+    ++done;
+    done.notify_one();
+}
+
+static void wait_for(std::atomic<int> &done, int count) {
+    for (auto current = done.load(); current < count; current = done.load())
+        done.wait(current);
+}
+
+TEST(async, many_sessions_share_few_threads) {
+    const int count = 64;
+    thread_pool_executor ex{2};
+    std::vector<std::unique_ptr<job>> jobs{};
+    for (int i = 0; i < count; ++i) {
+        jobs.push_back(std::make_unique<job>());
+        prepare_hide(*jobs.back(), i);
+    }
+
+    std::atomic<int> done{0};
+    for (auto &j : jobs)
+        run(async_hide(ex, j->images, j->data, j->log, j->log), j->result, done);
+    wait_for(done, count);
+
+    for (auto &j : jobs) {
+        ASSERT_EQ(j->result, 0) << j->log.str();
+        prepare_extract(*j);
+    }
+
+    done = 0;
+    for (auto &j : jobs)
+        run(async_extract(ex, j->images, j->extracted, j->log), j->result, done);
+    wait_for(done, count);
+
+    for (auto &j : jobs) {
+        ASSERT_EQ(j->result, 0) << j->log.str();
+        EXPECT_EQ(j->extracted.str(), j->payload);
+    }
+}
+
+TEST(async, sync_wait_returns_extract_result) {
+    thread_pool_executor ex{1};
+    std::vector<bmp_image> images{};
+    images.push_back(load_image("plain", make_bmp(10, 10)));
+    std::stringstream data_out, err;
+
+    EXPECT_EQ(sync_wait(async_extract(ex, images, data_out, err)), 1);
+    EXPECT_EQ(err.str().rfind("image plain has invalid sharky magic number!", 0), 0);
+}
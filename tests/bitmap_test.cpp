@@ -212,6 +212,12 @@ TEST(bmp_image, get_output_path_return_correct_path) {
     EXPECT_EQ(im.get_output_path(), "bitmaps_out/image3");
 }
 
+TEST(bmp_image, get_output_path_returns_output_path_if_set) {
+    bmp_image im("path/to/image.bmp", 2);
+    im.output_path = "out/stego.bmp";
+    EXPECT_EQ(im.get_output_path(), "out/stego.bmp");
+}
+
 TEST(bmp_image, assign_output_works) {
     bmp_image im("test_image", 2);
     auto ss = std::make_unique<std::stringstream>();
@@ -220,6 +226,24 @@ TEST(bmp_image, assign_output_works) {
     EXPECT_EQ(ss, nullptr);
 }
 
+TEST(bmp_image, close_keeps_assigned_streams) {
+    bmp_image im("test_image", 2);
+    ASSERT_TRUE(im.assign_input(std::make_unique<std::stringstream>()));
+    ASSERT_TRUE(im.assign_output(std::make_unique<std::stringstream>()));
+    ASSERT_TRUE(im.open_input());
+    ASSERT_TRUE(im.open_output());
+    im.close();
+    EXPECT_NE(im.input, nullptr);
+    EXPECT_NE(im.output, nullptr);
+}
+
+TEST(bmp_image, open_input_of_missing_file_returns_false) {
+    bmp_image im("sharky_missing_file.bmp", 2);
+    EXPECT_FALSE(im.open_input());
+    im.close();
+    EXPECT_EQ(im.input, nullptr);
+}
+
 TEST(bmp_image_buffer, constructor_initializes_members) {
     bmp_image im("test_image", 2);
     auto ss = std::make_unique<std::stringstream>();
@@ -389,3 +413,39 @@ TEST(bmp_image_buffer, extract_chunk_with_small_capacity_return_false) {
     }
     ASSERT_FALSE(ib.extract_chunk(chunk));
 }
+
+TEST(bmp_image, cell_offset_skips_padding) {
+    bmp_image im("test_image", 2);
+    im.width = 3;
+    im.channel_count = 3;
+    im.padding = 3;
+    EXPECT_EQ(im.cell_offset(0), 0);
+    EXPECT_EQ(im.cell_offset(8), 8);
+    EXPECT_EQ(im.cell_offset(9), 12);
+    EXPECT_EQ(im.cell_offset(20), 26);
+}
+
+TEST(bmp_image_buffer, seek_cell_skips_padding) {
+    bmp_image im("test_image", 2);
+    im.data_offset = 2;
+    im.width = 1;
+    im.channel_count = 3;
+    im.padding = 1;
+    auto is = std::make_unique<std::stringstream>();
+    const unsigned char data[] = {
+        0xff, 0xff, 0x01, 0x02, 0x03, 0x00, 0x04, 0x05, 0x06, 0x00
+    };
+    is->write(reinterpret_cast<const char*>(data), sizeof(data));
+    ASSERT_TRUE(im.assign_input(std::move(is)));
+
+    bmp_image_buffer ib(im, 8);
+    ASSERT_TRUE(ib.seek_cell(2));
+
+    uint8_t chunk;
+    std::vector<uint8_t> extracted{};
+    while (ib.extract_chunk(chunk))
+        extracted.push_back(chunk);
+
+    const std::vector<uint8_t> expected{0x03, 0x04, 0x05, 0x06};
+    EXPECT_EQ(extracted, expected);
+}
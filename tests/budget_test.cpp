@@ -0,0 +1,125 @@
+#include "budget.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "extract.h"
+#include "hide.h"
+#include "scheduler.h"
+#include "stripes.h"
+#include "test_images.h"
+
+static std::vector<std::stringstream *> assign_outputs(
+    std::vector<bmp_image> &images
+) {
+    std::vector<std::stringstream *> outputs{};
+    for (auto &im : images) {
+        auto os = std::make_unique<std::stringstream>();
+        outputs.push_back(os.get());
+        im.assign_output(std::move(os));
+        im.write_header_to_output();
+    }
+    return outputs;
+}
+
+TEST(budget, jobs_wait_for_released_memory) {
+    std::vector<std::string> started{};
+    memory_budget budget{10, [&](memory_budget::job j) { j(); }};
+    auto job = [&](std::string name) {
+        return [&started, name]() { started.push_back(name); };
+    };
+
+    budget.submit(4, job("a"));
+    budget.submit(4, job("b"));
+    budget.submit(4, job("c"));
+    /* jobs start in order, so the small one waits behind the large ones */
+    budget.submit(20, job("large"));
+    budget.submit(1, job("d"));
+    EXPECT_EQ(started, (std::vector<std::string>{"a", "b"}));
+
+    budget.release(4);
+    EXPECT_EQ(started, (std::vector<std::string>{"a", "b", "c"}));
+    /* a job larger than the limit runs alone */
+    budget.release(4);
+    budget.release(4);
+    EXPECT_EQ(started, (std::vector<std::string>{"a", "b", "c", "large"}));
+    budget.release(20);
+    EXPECT_EQ(started.back(), "d");
+}
+
+TEST(budget, limit_is_checked) {
+    std::stringstream err{};
+    EXPECT_TRUE(check_memory_limit(0, 1000, err));
+    EXPECT_TRUE(check_memory_limit(1000, 1000, err));
+    EXPECT_FALSE(check_memory_limit(999, 1000, err));
+    EXPECT_EQ(err.str(), "memory limit of 999 bytes is too small, at least "
+                         "1000 bytes are needed\n");
+}
+
+TEST(budget, stripes_hold_one_image_within_limit) {
+    std::vector<bmp_image> images{};
+    for (auto i = 0u; i < 4; ++i)
+        images.push_back(load_image("image" + std::to_string(i),
+                                    make_bmp(64, 64)));
+    auto file_size = make_bmp(64, 64).size();
+    auto outputs = assign_outputs(images);
+
+    std::string payload(3 * images[0].byte_capacity() - 100, '\0');
+    for (auto i = 0u; i < payload.size(); ++i)
+        payload[i] = static_cast<char>(i * 13 + 1);
+    std::stringstream log{};
+    work_stealing_scheduler scheduler{4};
+
+    /* the message and a single image fit, so images are hidden one by one */
+    hide_options options{.memory_limit = payload.size() + file_size};
+    std::stringstream data{payload};
+    ASSERT_EQ(hide_in_stripes(images, data, scheduler, log, log, options), 0)
+        << log.str();
+
+    std::vector<bmp_image> stego{};
+    for (auto i = 0u; i < 3; ++i)
+        stego.push_back(load_image("image" + std::to_string(i),
+                                   outputs[i]->str()));
+    std::stringstream striped{};
+    ASSERT_EQ(extract_in_stripes(stego, striped, scheduler, log,
+                                 {.memory_limit = payload.size() + file_size}),
+              0) << log.str();
+    EXPECT_EQ(striped.str(), payload);
+
+    /* serial extraction writes the message block by block */
+    stego.clear();
+    for (auto i = 0u; i < 3; ++i)
+        stego.push_back(load_image("image" + std::to_string(i),
+                                   outputs[i]->str()));
+    std::stringstream serial{};
+    ASSERT_EQ(extract(stego, serial, log, {.memory_limit = BUFFER_SIZE}), 0)
+        << log.str();
+    EXPECT_EQ(serial.str(), payload);
+}
+
+TEST(budget, impossible_limit_fails_before_writing) {
+    std::vector<bmp_image> images{};
+    images.push_back(load_image("image", make_bmp(64, 64)));
+    auto outputs = assign_outputs(images);
+    std::stringstream log{};
+
+    /* the message fits, but the image held in memory does not */
+    hide_options options{.memory_limit = 2000};
+    std::stringstream data{std::string(1000, 'x')};
+    work_stealing_scheduler scheduler{2};
+    EXPECT_EQ(hide_in_stripes(images, data, scheduler, log, log, options), 1);
+    EXPECT_NE(log.str().find("memory limit of 2000 bytes is too small"),
+              std::string::npos) << log.str();
+    EXPECT_EQ(outputs[0]->str().size(), 54u);
+
+    /* the message itself does not fit */
+    log.str("");
+    data.str(std::string(3000, 'x'));
+    data.clear();
+    EXPECT_EQ(hide(images, data, log, log, options), 1);
+    EXPECT_EQ(log.str(), "memory limit of 2000 bytes is too small, at least "
+                         "3000 bytes are needed\n");
+    EXPECT_EQ(outputs[0]->str().size(), 54u);
+}
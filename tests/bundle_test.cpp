@@ -0,0 +1,138 @@
+#include "bundle.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "hide.h"
+#include "test_images.h"
+
+static std::span<const uint8_t> as_bytes(const std::string &data) {
+    return {reinterpret_cast<const uint8_t *>(data.data()), data.size()};
+}
+
+/* incompressible, so the bundle needs both images even if compressed */
+static std::string random_data(std::size_t size) {
+    std::string data(size, '\0');
+    uint32_t state = 3;
+    for (auto &byte : data) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<char>(state >> 24);
+    }
+    return data;
+}
+
+static std::string read_file(const std::filesystem::path &path) {
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>(file), {}};
+}
+
+class bundle : public testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "sharky_bundle_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir / "in");
+        for (auto &[name, data] : files) {
+            std::ofstream file{dir / "in" / name, std::ios::binary};
+            file << data;
+            paths.push_back((dir / "in" / name).string());
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    std::filesystem::path dir{};
+    std::vector<std::pair<std::string, std::string>> files{
+        {"a.txt", "first file\n"},
+        {"empty", ""},
+        {"data.bin", random_data(2500)},
+    };
+    std::vector<std::string> paths{};
+};
+
+TEST_F(bundle, toc_describes_files) {
+    std::stringstream out{};
+    ASSERT_TRUE(write_bundle(paths, out));
+    auto data = out.str();
+
+    std::vector<bundle_entry> entries{};
+    ASSERT_TRUE(parse_bundle_toc(as_bytes(data), entries));
+    ASSERT_EQ(entries.size(), files.size());
+    for (auto i = 0u; i < files.size(); ++i) {
+        EXPECT_EQ(entries[i].name, files[i].first);
+        EXPECT_EQ(data.substr(entries[i].offset, entries[i].size),
+                  files[i].second);
+    }
+    EXPECT_EQ(entries.back().offset + entries.back().size, data.size());
+
+    std::stringstream log{};
+    ASSERT_EQ(unpack_bundle(as_bytes(data), (dir / "out").string(), log, log),
+              0) << log.str();
+    for (auto &[name, content] : files)
+        EXPECT_EQ(read_file(dir / "out" / name), content);
+}
+
+TEST_F(bundle, invalid_bundles_are_rejected) {
+    std::stringstream log{};
+    paths.push_back(paths[0]);
+    std::stringstream out{};
+    EXPECT_FALSE(write_bundle(paths, out, log));
+    EXPECT_NE(log.str().find("used more than once"), std::string::npos);
+
+    std::vector<bundle_entry> entries{};
+    EXPECT_FALSE(parse_bundle_toc(as_bytes("not a bundle at all"), entries,
+                                  log));
+
+    paths.pop_back();
+    std::stringstream valid{};
+    ASSERT_TRUE(write_bundle(paths, valid));
+    auto truncated = valid.str().substr(0, BUNDLE_HEADER_SIZE + 5);
+    EXPECT_FALSE(parse_bundle_toc(as_bytes(truncated), entries, log));
+    EXPECT_NE(log.str().find("corrupted"), std::string::npos);
+}
+
+TEST_F(bundle, single_file_is_extracted_by_name) {
+    for (auto options : {hide_options{}, hide_options{.compress = true,
+                                                      .key = "secret"}}) {
+        std::stringstream packed{};
+        ASSERT_TRUE(write_bundle(paths, packed));
+        std::vector<bmp_image> images{};
+        std::vector<std::stringstream *> outputs{};
+        for (auto i = 0; i < 2; ++i) {
+            images.push_back(load_image("image" + std::to_string(i),
+                                        make_bmp(60, 40)));
+            auto os = std::make_unique<std::stringstream>();
+            outputs.push_back(os.get());
+            images.back().assign_output(std::move(os));
+            images.back().write_header_to_output();
+        }
+        std::stringstream log{};
+        ASSERT_EQ(hide(images, packed, log, log, options), 0) << log.str();
+
+        for (auto &[name, content] : files) {
+            std::vector<bmp_image> stego{};
+            for (auto i = 0u; i < outputs.size(); ++i)
+                stego.push_back(load_image("stego" + std::to_string(i),
+                                           outputs[i]->str()));
+            std::stringstream extracted{};
+            ASSERT_EQ(extract_bundle_file(stego, name, extracted, log,
+                                          {.key = "secret"}), 0) << log.str();
+            EXPECT_EQ(extracted.str(), content);
+        }
+
+        std::vector<bmp_image> stego{};
+        stego.push_back(load_image("stego0", outputs[0]->str()));
+        stego.push_back(load_image("stego1", outputs[1]->str()));
+        std::stringstream extracted{};
+        EXPECT_EQ(extract_bundle_file(stego, "missing", extracted, log,
+                                      {.key = "secret"}), 1);
+        EXPECT_NE(log.str().find("missing is not in the bundle"),
+                  std::string::npos);
+    }
+}
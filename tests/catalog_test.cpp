@@ -0,0 +1,110 @@
+#include "catalog.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "loader.h"
+#include "test_images.h"
+
+class catalog : public testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "sharky_catalog_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        for (auto i = 0u; i < 5; ++i) {
+            paths.push_back((dir / ("image" + std::to_string(i) + ".bmp"))
+                                .string());
+            write(paths.back(), make_bmp(10 + i, 20));
+        }
+        catalog_path = (dir / "catalog").string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    static void write(const std::string &path, const std::string &data) {
+        std::ofstream file{path, std::ios::binary};
+        file << data;
+    }
+
+    std::filesystem::path dir{};
+    std::vector<std::string> paths{};
+    std::string catalog_path{};
+};
+
+TEST_F(catalog, headers_are_loaded_from_catalog) {
+    std::stringstream log{};
+    ASSERT_EQ(build_catalog(catalog_path, paths, 3, log, log), 0) << log.str();
+    EXPECT_NE(log.str().find("holds 5 images, 5 of them were read"),
+              std::string::npos) << log.str();
+
+    carrier_catalog cat{};
+    ASSERT_TRUE(cat.open(catalog_path, log)) << log.str();
+    ASSERT_EQ(cat.size(), 5u);
+    EXPECT_FALSE(cat.find(dir.string() + "/missing.bmp"));
+
+    for (auto &path : paths) {
+        bmp_image probed(path, 4);
+        ASSERT_TRUE(probe_header(probed, log));
+        auto entry = cat.find(path);
+        ASSERT_TRUE(entry);
+        EXPECT_EQ(entry->capacity, probed.capacity);
+        EXPECT_EQ(entry->byte_capacity(4), probed.byte_capacity());
+
+        bmp_image loaded(path, 4);
+        ASSERT_TRUE(cat.load(loaded, log));
+        EXPECT_EQ(loaded.header, probed.header);
+        EXPECT_EQ(loaded.width, probed.width);
+        EXPECT_EQ(loaded.padding, probed.padding);
+        EXPECT_EQ(loaded.byte_capacity(), probed.byte_capacity());
+    }
+}
+
+TEST_F(catalog, catalog_is_updated_incrementally) {
+    std::stringstream log{};
+    ASSERT_EQ(build_catalog(catalog_path, paths, 2, log, log), 0);
+
+    /* a changed image is not loaded from the stale catalog */
+    write(paths[1], make_bmp(40, 40));
+    {
+        carrier_catalog cat{};
+        ASSERT_TRUE(cat.open(catalog_path, log));
+        bmp_image im(paths[1], 2);
+        EXPECT_FALSE(cat.load(im, log));
+    }
+
+    paths.pop_back();
+    log.str("");
+    ASSERT_EQ(build_catalog(catalog_path, paths, 2, log, log), 0);
+    EXPECT_NE(log.str().find("holds 4 images, 1 of them were read"),
+              std::string::npos) << log.str();
+
+    carrier_catalog cat{};
+    ASSERT_TRUE(cat.open(catalog_path, log));
+    bmp_image im(paths[1], 2);
+    ASSERT_TRUE(cat.load(im, log));
+    EXPECT_EQ(im.width, 40u);
+
+    std::vector<bmp_image> images{};
+    load_images({{paths[0], 2}, {paths[1], 8}}, images, 2, log, &cat);
+    ASSERT_EQ(images.size(), 2u);
+    EXPECT_EQ(images[1].width, 40u);
+    EXPECT_EQ(images[1].chunk_size, 8);
+}
+
+TEST_F(catalog, invalid_catalog_is_rejected) {
+    write(catalog_path, "SHCT but nothing else");
+    std::stringstream log{};
+    carrier_catalog cat{};
+    EXPECT_FALSE(cat.open(catalog_path, log));
+    EXPECT_NE(log.str().find("not a valid carrier catalog"), std::string::npos);
+
+    /* the invalid catalog is replaced */
+    ASSERT_EQ(build_catalog(catalog_path, paths, 2, log, log), 0);
+    EXPECT_TRUE(cat.open(catalog_path, log));
+}
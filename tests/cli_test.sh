@@ -19,4 +19,233 @@ build/sharky \
 
 echo "Comparing input/output data..."
 cmp data/data_in data/data_out
+
+rm -f data/data_out
+build/sharky \
+    --extract \
+    bitmaps_out/image.bmp \
+    bitmaps_out/image2.bmp \
+    --range 11000:500 \
+    --file data/data_out
+
+echo "Comparing input/output data range..."
+cmp data/data_out <(tail -c +11001 data/data_in | head -c 500)
+echo "Comparing data hidden and extracted through pipes..."
+build/sharky --hide --chunk_size 8 - --output - --file data/data_in \
+    < bitmaps_in/image2.bmp 2> /dev/null \
+    | build/sharky --extract - --file - \
+    | cmp data/data_in -
+
+echo "Comparing compressed data hidden in parallel..."
+build/sharky --hide --compress --parallel bitmaps_in/image.bmp \
+    --output - --file data/data_in 2> /dev/null \
+    | build/sharky --extract --parallel - --file - \
+    | cmp data/data_in -
+
+echo "Comparing encrypted data..."
+echo "passphrase" > data/key
+build/sharky --hide --key-file data/key --chunk_size 8 bitmaps_in/image2.bmp \
+    --output - --file data/data_in 2> /dev/null \
+    | build/sharky --extract --key passphrase - --file - \
+    | cmp data/data_in -
+rm -f data/key
+
+echo "Comparing scattered data hidden in parallel..."
+build/sharky --hide --parallel --scatter --key passphrase --chunk_size 8 \
+    bitmaps_in/image2.bmp --output - --file data/data_in 2> /dev/null \
+    > data/scattered.bmp
+build/sharky --extract --key passphrase data/scattered.bmp --file - \
+    | cmp data/data_in -
+rm -f data/scattered.bmp
+
+echo "Verifying checksums of hidden data..."
+build/sharky --hide --chunk_size 8 bitmaps_in/image2.bmp --output - \
+    --file data/data_in 2> /dev/null > data/verified.bmp
+build/sharky --verify data/verified.bmp | grep -q ": ok"
+build/sharky --hide --no-checksum --chunk_size 8 bitmaps_in/image2.bmp \
+    --output - --file data/data_in 2> /dev/null > data/verified.bmp
+build/sharky --verify data/verified.bmp | grep -q "no checksum stored"
+rm -f data/verified.bmp
+
+echo "Comparing data rebuilt from a parity image..."
+mkdir -p data/parity
+build/sharky --hide --parity 1 --chunk_size 8 bitmaps_in/image.bmp \
+    bitmaps_in/image2.bmp --output data/parity/ --file data/data_in > /dev/null
+build/sharky --extract data/parity/image2.bmp --file - 2> /dev/null \
+    | cmp data/data_in -
+rm -rf data/parity
+
+echo "Comparing data updated in place..."
+build/sharky --hide --chunk_size 8 bitmaps_in/image2.bmp --output - \
+    --file data/data_in 2> /dev/null > data/updated.bmp
+{ cat data/data_in; echo "appended line"; } > data/data_new
+build/sharky --update data/updated.bmp --file data/data_new > /dev/null
+build/sharky --extract data/updated.bmp --file - | cmp data/data_new -
+rm -f data/updated.bmp data/data_new
+
+echo "Comparing files extracted from a bundle..."
+mkdir -p data/bundle
+echo "small file" > data/bundle/small
+build/sharky --hide --chunk_size 8 bitmaps_in/image2.bmp --output - \
+    --bundle data/data_in --bundle data/bundle/small 2> /dev/null \
+    > data/bundle.bmp
+build/sharky --extract data/bundle.bmp --bundle data/bundle/out > /dev/null
+cmp data/data_in data/bundle/out/data_in
+cmp data/bundle/small data/bundle/out/small
+build/sharky --extract data/bundle.bmp --member small --file - \
+    | cmp data/bundle/small -
+rm -rf data/bundle data/bundle.bmp
+
+echo "Comparing data hidden into images of a catalog..."
+mkdir -p data/catalog
+cp bitmaps_in/image2.bmp data/catalog/
+build/sharky --index --catalog data/catalog/index data/catalog/image2.bmp \
+    | grep -q "holds 1 images, 1 of them were read"
+build/sharky --index --catalog data/catalog/index data/catalog/image2.bmp \
+    | grep -q "holds 1 images, 0 of them were read"
+build/sharky --hide --catalog data/catalog/index --chunk_size 8 --output - \
+    --file data/data_in 2> /dev/null \
+    | build/sharky --extract - --file - \
+    | cmp data/data_in -
+rm -rf data/catalog
+
+echo "Comparing data hidden into selected images..."
+mkdir -p data/selected
+build/sharky --hide --select fewest-images --chunk_size 8 bitmaps_in/image.bmp \
+    bitmaps_in/image2.bmp --output data/selected/ --file data/data_in \
+    > /dev/null
+test "$(ls data/selected | wc -l)" -eq 1
+build/sharky --extract data/selected/*.bmp --file - | cmp data/data_in -
+rm -rf data/selected
+
+echo "Comparing data hidden with automatic chunk sizes..."
+build/sharky --hide --auto-chunk bitmaps_in/image2.bmp --output - \
+    --file data/data_in 2> /dev/null \
+    | build/sharky --extract - --file - \
+    | cmp data/data_in -
+
+echo "Comparing interleaved data..."
+mkdir -p data/interleaved
+build/sharky --hide --interleave --key passphrase --chunk_size 8 \
+    bitmaps_in/image.bmp bitmaps_in/image2.bmp --output data/interleaved/ \
+    --file data/data_in > /dev/null
+build/sharky --extract --key passphrase data/interleaved/*.bmp --file - \
+    | cmp data/data_in -
+build/sharky --extract --key passphrase data/interleaved/*.bmp \
+    --range 11000:500 --file - \
+    | cmp <(tail -c +11001 data/data_in | head -c 500) -
+build/sharky --extract --parallel --key passphrase data/interleaved/*.bmp \
+    --file - | cmp data/data_in -
+rm -rf data/interleaved
+
+echo "Comparing data hidden and extracted within a memory limit..."
+mkdir -p data/limited
+! build/sharky --hide --memory-limit 1K bitmaps_in/image.bmp \
+    --output data/limited/ --file data/data_in 2> /dev/null
+test ! -e data/limited/image.bmp
+build/sharky --hide --parallel --memory-limit 64K --chunk_size 8 \
+    bitmaps_in/image.bmp bitmaps_in/image2.bmp --output data/limited/ \
+    --file data/data_in > /dev/null
+build/sharky --extract --memory-limit 32K data/limited/*.bmp --file - \
+    | cmp data/data_in -
+build/sharky --extract --parallel --memory-limit 64K data/limited/*.bmp \
+    --file - | cmp data/data_in -
+rm -rf data/limited
+
+echo "Comparing data hidden and extracted by resumed runs..."
+mkdir -p data/journal
+build/sharky --hide --journal data/journal/hide --key passphrase \
+    --chunk_size 4 bitmaps_in/image.bmp bitmaps_in/image2.bmp \
+    --output data/journal/ --file data/data_in > /dev/null
+cp data/journal/image.bmp data/journal/first.bmp
+rm data/journal/image2.bmp
+build/sharky --hide --journal data/journal/hide --resume --key passphrase \
+    --chunk_size 4 bitmaps_in/image.bmp bitmaps_in/image2.bmp \
+    --output data/journal/ --file data/data_in | grep -q "already hidden"
+cmp data/journal/image.bmp data/journal/first.bmp
+rm data/journal/first.bmp data/journal/image2.bmp
+! build/sharky --hide --journal data/journal/hide --resume --key passphrase \
+    --chunk_size 8 bitmaps_in/image.bmp bitmaps_in/image2.bmp \
+    --output data/journal/ --file data/data_in > /dev/null 2>&1
+test ! -e data/journal/image2.bmp
+build/sharky --hide --journal data/journal/hide --resume --key passphrase \
+    --chunk_size 4 bitmaps_in/image.bmp bitmaps_in/image2.bmp \
+    --output data/journal/ --file data/data_in > /dev/null
+build/sharky --extract --journal data/journal/extract --key passphrase \
+    data/journal/*.bmp --file data/journal/data > /dev/null
+truncate -s 1000 data/journal/data
+build/sharky --extract --journal data/journal/extract --resume \
+    --key passphrase data/journal/*.bmp --file data/journal/data > /dev/null
+cmp data/data_in data/journal/data
+rm -rf data/journal
+
+echo "Comparing data of discovered hidings..."
+mkdir -p data/discover/pool
+build/sharky --hide --chunk_size 4 bitmaps_in/image.bmp bitmaps_in/image2.bmp \
+    --output data/discover/ --file data/data_in > /dev/null
+mv data/discover/image.bmp data/discover/pool/first0.bmp
+mv data/discover/image2.bmp data/discover/pool/first1.bmp
+head -c 1000 data/data_in > data/discover/small
+build/sharky --hide --no-checksum bitmaps_in/image.bmp \
+    --output data/discover/pool/second0.bmp --file data/discover/small > /dev/null
+cp bitmaps_in/image.bmp data/discover/pool/plain.bmp
+build/sharky --extract --discover data/discover/pool \
+    --file data/discover/out > data/discover/report
+grep -q "1 file(s) hold no hidden data" data/discover/report
+test "$(grep -c ": complete" data/discover/report)" -eq 2
+for out in data/discover/out/hiding-*; do
+    cmp -s "$out" data/data_in || cmp "$out" data/discover/small
+done
+test "$(ls data/discover/out | wc -l)" -eq 2
+rm data/discover/pool/first0.bmp
+build/sharky --extract --discover data/discover/pool --file data/discover/out \
+    | grep -q "incomplete, missing seq 0"
+id=$(build/sharky --extract --discover data/discover/pool \
+    --file data/discover/out | grep ": complete" | cut -d ' ' -f 2)
+build/sharky --extract --discover --id "$id" data/discover/pool --file - \
+    2> /dev/null | cmp data/discover/small -
+rm -rf data/discover
+
+echo "Checking the distortion report..."
+mkdir -p data/distortion
+build/sharky --hide --parallel --chunk_size 4 --distortion - \
+    bitmaps_in/image.bmp bitmaps_in/image2.bmp --output data/distortion/ \
+    --file data/data_in 2> /dev/null > data/distortion/report
+test "$(wc -l < data/distortion/report)" -eq 3
+grep -q "^bitmaps_in/image2.bmp	data/distortion/image2.bmp	" \
+    data/distortion/report
+rm -rf data/distortion
+
+echo "Comparing data hidden and extracted with read-ahead..."
+mkdir -p data/prefetch
+build/sharky --hide --prefetch 2 --memory-limit 4M --chunk_size 4 \
+    bitmaps_in/image.bmp bitmaps_in/image2.bmp --output data/prefetch/ \
+    --file data/data_in > /dev/null
+build/sharky --extract --prefetch 2 data/prefetch/*.bmp \
+    --file data/prefetch/data > /dev/null
+cmp data/data_in data/prefetch/data
+! build/sharky --extract --prefetch 2 --parallel data/prefetch/*.bmp \
+    --file data/prefetch/data 2> /dev/null
+rm -rf data/prefetch
+
+echo "Comparing data hidden and extracted by the daemon..."
+mkdir -p data/daemon
+build/sharky --daemon data/daemon/sock 2> /dev/null &
+daemon_pid=$!
+for _ in $(seq 50); do
+    test -S data/daemon/sock && break
+    sleep 0.1
+done
+build/sharky --client data/daemon/sock --hide --chunk_size 8 \
+    bitmaps_in/image2.bmp --output data/daemon/ --file - \
+    < data/data_in > /dev/null
+build/sharky --client data/daemon/sock --extract data/daemon/image2.bmp \
+    --file - | cmp data/data_in -
+! build/sharky --client data/daemon/sock --extract data/daemon/missing.bmp \
+    --file - 2> /dev/null
+kill $daemon_pid
+wait $daemon_pid
+test ! -e data/daemon/sock
+rm -rf data/daemon
+
 echo "Test passed"
@@ -0,0 +1,106 @@
+#include "compress.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "configuration.h"
+#include "extract.h"
+#include "hide.h"
+#include "test_images.h"
+
+static std::string decompress_all(
+    std::span<const uint8_t> compressed,
+    std::size_t part_size
+) {
+    std::stringstream out{};
+    decompressor decompress{};
+    for (std::size_t i = 0; i < compressed.size(); i += part_size) {
+        auto part = compressed.subspan(i, std::min(part_size, compressed.size() - i));
+        EXPECT_TRUE(decompress.write(part, out));
+    }
+    EXPECT_TRUE(decompress.finished());
+    return out.str();
+}
+
+static std::vector<uint8_t> as_bytes(const std::string &s) {
+    return {s.begin(), s.end()};
+}
+
+TEST(compress, round_trip) {
+    std::string log{};
+    for (auto i = 0; log.size() < 3 * COMPRESSION_BLOCK_SIZE + 123; ++i)
+        log += "{\"event\": \"write\", \"offset\": " + std::to_string(i * 4096) + "}\n";
+    std::string noise(100000, '\0');
+    uint32_t state = 1;
+    for (auto &c : noise) {
+        state = state * 1103515245u + 12345u;
+        c = static_cast<char>(state >> 24);
+    }
+
+    for (auto &data : {std::string{}, std::string("a"), std::string(70000, 'x'),
+                       log, noise}) {
+        auto compressed = compress(as_bytes(data));
+        /* whole blocks at once and parts which split headers and blocks */
+        EXPECT_EQ(decompress_all(compressed, compressed.size() + 1), data);
+        EXPECT_EQ(decompress_all(compressed, 7), data);
+    }
+
+    EXPECT_LT(compress(as_bytes(log)).size() * 5, log.size());
+    /* incompressible blocks are stored with only the block header */
+    EXPECT_LE(compress(as_bytes(noise)).size(), noise.size() + 2 * 8);
+}
+
+TEST(compress, detects_corrupted_data) {
+    std::string data(5000, 'a');
+    auto compressed = compress(as_bytes(data));
+    std::stringstream out{};
+
+    auto truncated = compressed;
+    truncated.pop_back();
+    decompressor decompress{};
+    EXPECT_TRUE(decompress.write(truncated, out));
+    EXPECT_FALSE(decompress.finished());
+
+    /* raw block size larger than the block limit */
+    auto corrupted = compressed;
+    corrupted[3] = 0xff;
+    EXPECT_FALSE(decompressor{}.write(corrupted, out));
+
+    /* match pointing before the start of the block */
+    corrupted = compressed;
+    corrupted[8 + 2] = 0xff;
+    corrupted[8 + 3] = 0xff;
+    EXPECT_FALSE(decompressor{}.write(corrupted, out));
+}
+
+TEST(compress, hide_and_extract_compressed) {
+    std::string payload{};
+    for (auto i = 0; i < 400; ++i)
+        payload += "line " + std::to_string(i % 10) + " of the log\n";
+
+    /* the payload does not fit uncompressed */
+    std::vector<bmp_image> images{};
+    images.push_back(load_image("image", make_bmp(40, 30)));
+    ASSERT_LT(images[0].byte_capacity(), payload.size());
+    auto os = std::make_unique<std::stringstream>();
+    auto output = os.get();
+    images[0].assign_output(std::move(os));
+    images[0].write_header_to_output();
+
+    std::stringstream data{payload};
+    std::stringstream log{};
+    ASSERT_EQ(hide(images, data, log, log, {.compress = true}), 0) << log.str();
+
+    std::vector<bmp_image> stego{};
+    stego.push_back(load_image("stego", output->str()));
+    std::stringstream extracted{};
+    ASSERT_EQ(extract(stego, extracted, log), 0) << log.str();
+    EXPECT_EQ(extracted.str(), payload);
+    EXPECT_EQ(stego[0].flags, MD_FLAG_COMPRESSED);
+
+    stego.clear();
+    stego.push_back(load_image("stego", output->str()));
+    EXPECT_EQ(extract_range(stego, 0, 10, extracted, log), 1);
+}
@@ -0,0 +1,164 @@
+#include "crc.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "extract.h"
+#include "hide.h"
+#include "metadata.h"
+#include "stripes.h"
+#include "verify.h"
+#include "test_images.h"
+
+static std::vector<uint8_t> as_bytes(const std::string &s) {
+    return {s.begin(), s.end()};
+}
+
+TEST(crc, crc32c_test_vectors) {
+    EXPECT_EQ(crc32c(as_bytes("")), 0u);
+    EXPECT_EQ(crc32c(as_bytes("123456789")), 0xe3069283u);
+    /* RFC 3720, B.4 */
+    EXPECT_EQ(crc32c(std::vector<uint8_t>(32, 0)), 0x8a9136aau);
+    EXPECT_EQ(crc32c(std::vector<uint8_t>(32, 0xff)), 0x62a8ab43u);
+    EXPECT_EQ(crc32c_portable(as_bytes("123456789")), 0xe3069283u);
+}
+
+TEST(crc, crc32c_incremental_and_portable_match) {
+    std::vector<uint8_t> data(10007);
+    for (auto i = 0u; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 131 + (i >> 5));
+
+    auto whole = crc32c(data);
+    EXPECT_EQ(crc32c_portable(data), whole);
+    uint32_t parts = 0;
+    for (std::size_t offset = 0; offset < data.size(); offset += 13)
+        parts = crc32c(std::span(data).subspan(offset,
+                       std::min<std::size_t>(13, data.size() - offset)), parts);
+    EXPECT_EQ(parts, whole);
+}
+
+TEST(crc, extended_metadata_fields) {
+    bmp_image im("image", 2);
+    init_extra_metadata(im, MD_FLAG_ENCRYPTED | MD_FLAG_CHECKSUM);
+    EXPECT_TRUE(im.flags & MD_FLAG_EXTENDED);
+    EXPECT_EQ(im.metadata_size(),
+              HIDDEN_METADATA_SIZE + 1 + MD_NONCE_SIZE + MD_CHECKSUM_SIZE);
+    set_metadata_checksum(im, 0x12345678);
+    EXPECT_EQ(metadata_checksum(im), 0x12345678u);
+    EXPECT_EQ(im.extra_metadata[0], MD_FLAG_CHECKSUM >> 8);
+    EXPECT_EQ(im.extra_metadata.back(), 0x12);
+
+    /* flags without extended ones keep the old layout */
+    init_extra_metadata(im, MD_FLAG_ENCRYPTED);
+    EXPECT_FALSE(im.flags & MD_FLAG_EXTENDED);
+    EXPECT_EQ(im.extra_metadata.size(), MD_NONCE_SIZE);
+}
+
+/* hides the payload into two images, returns the altered images */
+static std::vector<std::string> hide_payload(
+    const std::string &payload,
+    const hide_options &options
+) {
+    std::vector<bmp_image> images{};
+    std::vector<std::stringstream *> outputs{};
+    for (auto i = 0; i < 2; ++i) {
+        images.push_back(load_image("image" + std::to_string(i),
+                                    make_bmp(60, 40)));
+        auto os = std::make_unique<std::stringstream>();
+        outputs.push_back(os.get());
+        images.back().assign_output(std::move(os));
+        images.back().write_header_to_output();
+    }
+    std::stringstream data{payload};
+    std::stringstream log{};
+    EXPECT_EQ(hide(images, data, log, log, options), 0) << log.str();
+    return {outputs[0]->str(), outputs[1]->str()};
+}
+
+static std::vector<bmp_image> load_stego(const std::vector<std::string> &stego) {
+    std::vector<bmp_image> images{};
+    for (auto i = 0u; i < stego.size(); ++i)
+        images.push_back(load_image("stego" + std::to_string(i), stego[i]));
+    return images;
+}
+
+static std::string make_payload(std::size_t size) {
+    std::string payload(size, '\0');
+    for (auto i = 0u; i < payload.size(); ++i)
+        payload[i] = static_cast<char>(i % 251);
+    return payload;
+}
+
+TEST(crc, checksummed_data_are_extracted) {
+    auto payload = make_payload(2500);
+    for (auto options : {hide_options{.checksum = true},
+                         hide_options{.key = "secret", .checksum = true},
+                         hide_options{.key = "secret", .scatter = true,
+                                      .checksum = true}}) {
+        auto stego = hide_payload(payload, options);
+        std::stringstream log{};
+
+        auto images = load_stego(stego);
+        std::stringstream extracted{};
+        ASSERT_EQ(extract(images, extracted, log, {.key = "secret"}), 0)
+            << log.str();
+        EXPECT_EQ(extracted.str(), payload);
+        EXPECT_TRUE(images[0].flags & MD_FLAG_CHECKSUM);
+
+        images = load_stego(stego);
+        std::stringstream striped{};
+        work_stealing_scheduler scheduler{2};
+        ASSERT_EQ(extract_in_stripes(images, striped, scheduler, log,
+                                     {.key = "secret"}), 0) << log.str();
+        EXPECT_EQ(striped.str(), payload);
+
+        images = load_stego(stego);
+        std::stringstream results{};
+        EXPECT_EQ(verify(images, 2, {.key = "secret"}, results, log), 0)
+            << log.str();
+        EXPECT_EQ(results.str(), "image stego0: ok\nimage stego1: ok\n");
+    }
+}
+
+TEST(crc, corrupted_data_are_detected) {
+    auto payload = make_payload(2500);
+    auto stego = hide_payload(payload, {.checksum = true});
+    /* flip the lowest bit of a data cell of the second image */
+    stego[1][54 + 300] ^= 1;
+
+    auto images = load_stego(stego);
+    std::stringstream extracted{};
+    std::stringstream log{};
+    EXPECT_EQ(extract(images, extracted, log), 1);
+    EXPECT_NE(log.str().find("stego1 does not match"), std::string::npos);
+
+    images = load_stego(stego);
+    std::stringstream striped{};
+    work_stealing_scheduler scheduler{2};
+    EXPECT_EQ(extract_in_stripes(images, striped, scheduler, log), 1);
+    EXPECT_EQ(striped.str(), "");
+
+    images = load_stego(stego);
+    std::stringstream results{};
+    EXPECT_EQ(verify(images, 2, {}, results, log), 1);
+    EXPECT_EQ(results.str(), "image stego0: ok\n"
+                             "image stego1: checksum mismatch, hidden data "
+                             "are corrupted\n");
+
+    /* ranges are not verified, they do not cover whole data parts */
+    images = load_stego(stego);
+    std::stringstream range{};
+    EXPECT_EQ(extract_range(images, 0, 100, range, log), 0);
+}
+
+TEST(crc, images_without_checksum_are_reported) {
+    auto stego = hide_payload(make_payload(2500), {});
+    auto images = load_stego(stego);
+    std::stringstream results{};
+    std::stringstream log{};
+    EXPECT_EQ(verify(images, 1, {}, results, log), 0);
+    EXPECT_EQ(results.str(), "image stego0: no checksum stored\n"
+                             "image stego1: no checksum stored\n");
+}
@@ -0,0 +1,148 @@
+#include "crypto.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "extract.h"
+#include "hide.h"
+#include "stripes.h"
+#include "test_images.h"
+
+static std::string hex(std::span<const uint8_t> data) {
+    std::string out{};
+    for (auto byte : data) {
+        out += "0123456789abcdef"[byte >> 4];
+        out += "0123456789abcdef"[byte & 0xf];
+    }
+    return out;
+}
+
+static std::vector<uint8_t> as_bytes(const std::string &s) {
+    return {s.begin(), s.end()};
+}
+
+TEST(crypto, sha256_test_vectors) {
+    EXPECT_EQ(hex(sha256(as_bytes(""))),
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(hex(sha256(as_bytes("abc"))),
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(hex(sha256(as_bytes(
+                  "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"))),
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST(crypto, pbkdf2_test_vectors) {
+    auto salt = as_bytes("salt");
+    EXPECT_EQ(hex(pbkdf2_hmac_sha256("password", salt, 1)),
+              "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b");
+    EXPECT_EQ(hex(pbkdf2_hmac_sha256("password", salt, 4096)),
+              "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a");
+    /* the passphrase is longer than a block of SHA-256 */
+    EXPECT_EQ(hex(pbkdf2_hmac_sha256(std::string(65, 'p'), salt, 2)),
+              hex(pbkdf2_hmac_sha256(std::string_view(reinterpret_cast<const char *>(
+                      sha256(as_bytes(std::string(65, 'p'))).data()), 32),
+                  salt, 2)));
+}
+
+TEST(crypto, chacha20_test_vector) {
+    /* RFC 8439, section 2.4.2, the initial block counter is 1 */
+    key_type key;
+    for (auto i = 0u; i < key.size(); ++i)
+        key[i] = static_cast<uint8_t>(i);
+    nonce_type nonce{0, 0, 0, 0, 0, 0, 0, 0x4a, 0, 0, 0, 0};
+    auto data = as_bytes("Ladies and Gentlemen of the class of '99: If I could "
+                         "offer you only one tip for the future, sunscreen "
+                         "would be it.");
+
+    chacha20 cipher{key, nonce};
+    cipher.apply(data, 64);
+    EXPECT_EQ(hex(std::span(data).first(16)), "6e2e359a2568f98041ba0728dd0d6981");
+    EXPECT_EQ(hex(std::span(data).last(2)), "874d");
+}
+
+TEST(crypto, chacha20_parts_match_whole) {
+    key_type key{1, 2, 3};
+    nonce_type nonce{4, 5, 6};
+    chacha20 cipher{key, nonce};
+
+    std::vector<uint8_t> whole(3000, 0);
+    cipher.apply(whole, 0);
+    std::vector<uint8_t> parts(3000, 0);
+    for (std::size_t offset = 0; offset < parts.size(); offset += 77)
+        cipher.apply(std::span(parts).subspan(offset,
+                     std::min<std::size_t>(77, parts.size() - offset)), offset);
+    EXPECT_EQ(whole, parts);
+}
+
+TEST(crypto, keystream_limit_is_rejected) {
+    std::vector<bmp_image> images{};
+    data_encoding encoding{};
+    encoding.cipher.emplace(key_type{1}, nonce_type{2});
+    std::stringstream log{};
+    EXPECT_FALSE(plan_carriers(images, encoding, CHACHA_MAX_MESSAGE_SIZE + 1,
+                               log));
+    EXPECT_NE(log.str().find("can not be encrypted"), std::string::npos);
+}
+
+TEST(crypto, hide_and_extract_encrypted) {
+    std::vector<bmp_image> images{};
+    std::vector<std::stringstream *> outputs{};
+    for (auto i = 0; i < 2; ++i) {
+        images.push_back(load_image("image" + std::to_string(i),
+                                    make_bmp(60 + i, 40)));
+        auto os = std::make_unique<std::stringstream>();
+        outputs.push_back(os.get());
+        images.back().assign_output(std::move(os));
+        images.back().write_header_to_output();
+    }
+    std::string payload(images[0].byte_capacity() + 1000, '\0');
+    for (auto i = 0u; i < payload.size(); ++i)
+        payload[i] = static_cast<char>(i % 251);
+    /* the nonce is hidden after the metadata */
+    EXPECT_EQ(images[0].byte_capacity(), (60 * 3 * 40 - 36) / 4);
+
+    std::stringstream data{payload};
+    std::stringstream log{};
+    ASSERT_EQ(hide(images, data, log, log, {.key = "secret"}), 0) << log.str();
+    EXPECT_EQ(images[0].byte_capacity(), (60 * 3 * 40 - 36 - 48) / 4);
+    /* the plain payload is not hidden as it is */
+    EXPECT_EQ(outputs[0]->str().find(payload.substr(0, 64)), std::string::npos);
+
+    auto load_stego = [&]() {
+        std::vector<bmp_image> stego{};
+        stego.push_back(load_image("stego1", outputs[1]->str()));
+        stego.push_back(load_image("stego0", outputs[0]->str()));
+        return stego;
+    };
+
+    auto stego = load_stego();
+    std::stringstream extracted{};
+    ASSERT_EQ(extract(stego, extracted, log, {.key = "secret"}), 0) << log.str();
+    EXPECT_EQ(extracted.str(), payload);
+
+    /* the keystream can start in the middle of the message */
+    stego = load_stego();
+    std::stringstream range{};
+    ASSERT_EQ(extract_range(stego, 1000, 1500, range, log, {.key = "secret"}), 0)
+        << log.str();
+    EXPECT_EQ(range.str(), payload.substr(1000, 1500));
+
+    stego = load_stego();
+    std::stringstream striped{};
+    work_stealing_scheduler scheduler{2};
+    ASSERT_EQ(extract_in_stripes(stego, striped, scheduler, log,
+                                 {.key = "secret"}), 0);
+    EXPECT_EQ(striped.str(), payload);
+
+    stego = load_stego();
+    std::stringstream wrong{};
+    ASSERT_EQ(extract(stego, wrong, log, {.key = "wrong"}), 0);
+    EXPECT_NE(wrong.str(), payload);
+
+    stego = load_stego();
+    std::stringstream missing_key{};
+    EXPECT_EQ(extract(stego, missing_key, missing_key), 1);
+    EXPECT_NE(missing_key.str().find("please provide the key"), std::string::npos);
+}
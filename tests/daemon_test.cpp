@@ -0,0 +1,212 @@
+#include "daemon.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static std::string socket_path(const std::string &name) {
+    return (std::filesystem::temp_directory_path() /
+            ("sharky_" + name + "_" + std::to_string(::getpid()) + ".sock"))
+        .string();
+}
+
+/* writes everything read from `in`, the working directory and arguments */
+static int echo_handler(
+    const daemon_request &request,
+    std::istream &in,
+    std::ostream &out,
+    std::ostream &err
+) {
+    out << in.rdbuf() << request.cwd;
+    for (auto &arg : request.args)
+        out << ' ' << arg;
+    err << "served\n";
+    return static_cast<int>(request.args.size());
+}
+
+/**
+ * @brief Sends the request with the input written to a pipe and returns
+ * what the handler wrote to the standard output and error.
+ */
+static int request(
+    const std::string &path,
+    const daemon_request &req,
+    const std::string &input,
+    std::string &output,
+    std::string &errors
+) {
+    int in[2], out[2], err[2];
+    EXPECT_EQ(::pipe(in), 0);
+    EXPECT_EQ(::pipe(out), 0);
+    EXPECT_EQ(::pipe(err), 0);
+    EXPECT_EQ(::write(in[1], input.data(), input.size()),
+              static_cast<ssize_t>(input.size()));
+    ::close(in[1]);
+
+    std::stringstream log{};
+    auto res = send_request(path, req, {in[0], out[1], err[1]}, log);
+    ::close(in[0]);
+    ::close(out[1]);
+    ::close(err[1]);
+    auto read_pipe = [](int fd, std::string &data) {
+        char block[256];
+        ssize_t size;
+        while ((size = ::read(fd, block, sizeof(block))) > 0)
+            data.append(block, size);
+        ::close(fd);
+    };
+    read_pipe(out[0], output);
+    read_pipe(err[0], errors);
+    errors += log.str();
+    return res;
+}
+
+TEST(daemon, request_uses_passed_streams) {
+    auto path = socket_path("streams");
+    daemon_server server{echo_handler, 2};
+    ASSERT_TRUE(server.listen(path));
+    std::jthread runner{[&]() { server.run(); }};
+
+    std::string output, errors;
+    EXPECT_EQ(request(path, {"/work", {"--hide", "a b.bmp"}}, "input ",
+                      output, errors), 2);
+    EXPECT_EQ(output, "input /work --hide a b.bmp");
+    EXPECT_EQ(errors, "served\n");
+
+    server.stop();
+    runner.join();
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(daemon, concurrent_requests_are_served_by_workers) {
+    auto path = socket_path("concurrent");
+    daemon_server server{[](const daemon_request &request, std::istream &,
+                            std::ostream &out, std::ostream &) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        out << request.args[0];
+        return std::stoi(request.args[0]);
+    }, 4};
+    ASSERT_TRUE(server.listen(path));
+    std::jthread runner{[&]() { server.run(); }};
+
+    std::vector<std::jthread> clients{};
+    std::vector<int> results(16, -1);
+    std::vector<std::string> outputs(16);
+    for (auto i = 0; i < 16; ++i) {
+        clients.emplace_back([&, i]() {
+            std::string errors;
+            results[i] = request(path, {"/", {std::to_string(i)}}, "",
+                                 outputs[i], errors);
+        });
+    }
+    clients.clear();
+    for (auto i = 0; i < 16; ++i) {
+        EXPECT_EQ(results[i], i);
+        EXPECT_EQ(outputs[i], std::to_string(i));
+    }
+    server.stop();
+}
+
+TEST(daemon, socket_of_running_daemon_is_not_replaced) {
+    auto path = socket_path("used");
+    {
+        /* never runs, so its socket file is left behind */
+        daemon_server stale{echo_handler, 1};
+        ASSERT_TRUE(stale.listen(path));
+    }
+    ASSERT_TRUE(std::filesystem::exists(path));
+
+    daemon_server server{echo_handler, 1};
+    ASSERT_TRUE(server.listen(path));
+    std::jthread runner{[&]() { server.run(); }};
+
+    daemon_server other{echo_handler, 1};
+    std::stringstream log{};
+    EXPECT_FALSE(other.listen(path, log));
+    EXPECT_NE(log.str().find("is used by a running daemon"), std::string::npos)
+        << log.str();
+    server.stop();
+    runner.join();
+
+    std::string output, errors;
+    EXPECT_EQ(request(path, {"/", {}}, "", output, errors), 1);
+    EXPECT_NE(errors.find("could not connect to the daemon"),
+              std::string::npos) << errors;
+}
+
+TEST(daemon, path_which_is_not_a_socket_is_kept) {
+    auto path = socket_path("file");
+    std::ofstream{path} << "data";
+
+    daemon_server server{echo_handler, 1};
+    std::stringstream log{};
+    EXPECT_FALSE(server.listen(path, log));
+    EXPECT_NE(log.str().find("is not a socket"), std::string::npos)
+        << log.str();
+    EXPECT_TRUE(std::filesystem::exists(path));
+    std::filesystem::remove(path);
+}
+
+/**
+ * @brief Sends a header passing `fd` as every one of `count` descriptors
+ * and waits until the daemon closes the connection.
+ */
+static void send_descriptors(const std::string &path, int fd, std::size_t count) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    auto connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_EQ(::connect(connection, reinterpret_cast<sockaddr *>(&address),
+                        sizeof(address)), 0);
+
+    std::array<char, DAEMON_HEADER_SIZE> header{'S', 'D', 1, 0};
+    std::vector<int> fds(count, fd);
+    std::vector<char> control(CMSG_SPACE(count * sizeof(int)));
+    iovec io{header.data(), header.size()};
+    msghdr message{};
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+    auto cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), count * sizeof(int));
+    EXPECT_EQ(::sendmsg(connection, &message, 0),
+              static_cast<ssize_t>(header.size()));
+
+    char response;
+    while (::read(connection, &response, 1) > 0) {}
+    ::close(connection);
+}
+
+TEST(daemon, descriptors_of_malformed_requests_are_closed) {
+    auto path = socket_path("descriptors");
+    daemon_server server{echo_handler, 1};
+    ASSERT_TRUE(server.listen(path));
+    std::jthread runner{[&]() { server.run(); }};
+
+    for (std::size_t count : {1, 2, 4}) {
+        int fds[2];
+        ASSERT_EQ(::pipe(fds), 0);
+        send_descriptors(path, fds[1], count);
+        ::close(fds[1]);
+        /* the pipe ends only when the daemon closed every received copy */
+        pollfd poll_fd{fds[0], POLLIN, 0};
+        char data;
+        ASSERT_EQ(::poll(&poll_fd, 1, 2000), 1) << count;
+        EXPECT_EQ(::read(fds[0], &data, 1), 0) << count;
+        ::close(fds[0]);
+    }
+    server.stop();
+}
@@ -0,0 +1,120 @@
+#include "discover.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "extract.h"
+#include "hide.h"
+#include "test_images.h"
+
+class discover : public testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "sharky_discover_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir / "carriers");
+        write(dir / "carriers" / "plain.bmp", make_bmp(40, 30));
+        write(dir / "carriers" / "notes.txt", "not an image");
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    static void write(const std::filesystem::path &path, const std::string &data) {
+        std::ofstream file{path, std::ios::binary};
+        file << data;
+    }
+
+    /* hides the message into `count` new carriers named by `prefix` */
+    void hide_message(
+        const std::string &prefix,
+        std::size_t count,
+        const std::string &message,
+        const hide_options &options = {}
+    ) {
+        std::vector<bmp_image> images{};
+        for (auto i = 0u; i < count; ++i) {
+            auto path = (dir / (prefix + std::to_string(i) + ".bmp")).string();
+            write(path, make_bmp(40, 30));
+            images.emplace_back(path, 4);
+            ASSERT_TRUE(probe_header(images.back(), log)) << log.str();
+            images.back().output_path =
+                (dir / "carriers" / (prefix + std::to_string(i) + ".bmp"))
+                    .string();
+        }
+        std::stringstream data{message};
+        ASSERT_EQ(hide(images, data, log, log, options), 0) << log.str();
+    }
+
+    std::vector<discovered_hiding> find() {
+        auto args = expand_directories({{(dir / "carriers").string(), 2}});
+        return discover_hidings(args, 4, skipped);
+    }
+
+    std::filesystem::path dir{};
+    std::size_t skipped{0};
+    std::stringstream log{};
+};
+
+TEST_F(discover, carriers_are_grouped_by_hiding) {
+    std::string first(4000, 'a'), second(1000, 'b');
+    hide_message("first", 3, first);
+    /* different flags keep the hidings apart even if their ids are equal */
+    hide_message("second", 1, second, {.checksum = true});
+
+    auto hidings = find();
+    EXPECT_EQ(skipped, 2u);
+    ASSERT_EQ(hidings.size(), 2u);
+    for (auto &hiding : hidings) {
+        EXPECT_TRUE(hiding.complete());
+        std::stringstream data{};
+        ASSERT_EQ(extract(hiding.images, data, log), 0) << log.str();
+        EXPECT_EQ(data.str(), hiding.images.size() == 3 ? first : second);
+    }
+}
+
+TEST_F(discover, missing_and_duplicated_seqs_are_reported) {
+    std::string first(4000, 'a'), second(1000, 'b');
+    hide_message("first", 3, first);
+    hide_message("second", 1, second, {.checksum = true});
+    std::filesystem::remove(dir / "carriers" / "first1.bmp");
+    std::filesystem::copy(dir / "carriers" / "second0.bmp",
+                          dir / "carriers" / "second0_copy.bmp");
+
+    auto hidings = find();
+    ASSERT_EQ(hidings.size(), 2u);
+    for (auto &hiding : hidings) {
+        EXPECT_FALSE(hiding.complete());
+        if (hiding.images.size() == 2 && hiding.missing.size() == 1) {
+            EXPECT_EQ(hiding.missing[0], 1u);
+            EXPECT_TRUE(hiding.duplicate.empty());
+        } else {
+            EXPECT_EQ(hiding.duplicate, std::vector<std::size_t>{0});
+        }
+    }
+
+    std::stringstream report{};
+    print_hidings(report, hidings);
+    EXPECT_NE(report.str().find(" in 2 image(s): incomplete, missing seq 1\n"),
+              std::string::npos) << report.str();
+    EXPECT_NE(report.str().find(" in 2 image(s): incomplete, duplicated seq 0\n"),
+              std::string::npos) << report.str();
+}
+
+TEST_F(discover, parity_rebuilds_missing_carrier) {
+    std::string message(3000, 'c');
+    hide_message("parity", 3, message, {.checksum = true, .parity = 1});
+    std::filesystem::remove(dir / "carriers" / "parity0.bmp");
+
+    auto hidings = find();
+    ASSERT_EQ(hidings.size(), 1u);
+    EXPECT_EQ(hidings[0].missing, std::vector<std::size_t>{0});
+    ASSERT_TRUE(hidings[0].complete());
+    std::stringstream data{};
+    ASSERT_EQ(extract(hidings[0].images, data, log), 0) << log.str();
+    EXPECT_EQ(data.str(), message);
+}
@@ -0,0 +1,162 @@
+#include "distortion.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <memory>
+#include <vector>
+
+#include "hide.h"
+#include "in_memory.h"
+#include "scatter.h"
+#include "test_images.h"
+
+static std::vector<uint8_t> make_payload(std::size_t size) {
+    std::vector<uint8_t> payload(size);
+    for (auto i = 0u; i < size; ++i)
+        payload[i] = static_cast<uint8_t>(i * 7 + 3);
+    return payload;
+}
+
+/* distortion computed by comparing the carrier with the altered image */
+static image_distortion compare(
+    const bmp_image &im,
+    std::span<const std::byte> carrier,
+    std::span<const std::byte> output
+) {
+    image_distortion distortion{};
+    distortion.channel_count = im.channel_count;
+    std::size_t row_size = static_cast<std::size_t>(im.width) * im.channel_count;
+    for (std::size_t cell = 0; cell < row_size * im.height; ++cell) {
+        auto offset = im.data_offset + im.cell_offset(cell);
+        distortion.add(cell % im.channel_count,
+                       static_cast<uint8_t>(carrier[offset]),
+                       static_cast<uint8_t>(output[offset]));
+        ++distortion.cells;
+    }
+    return distortion;
+}
+
+static void expect_same(const image_distortion &a, const image_distortion &b) {
+    EXPECT_EQ(a.cells, b.cells);
+    EXPECT_EQ(a.channel_count, b.channel_count);
+    EXPECT_EQ(a.changed, b.changed);
+    EXPECT_EQ(a.squared_error, b.squared_error);
+    EXPECT_EQ(a.max_delta, b.max_delta);
+}
+
+static void measure(bmp_image &im) {
+    measure_distortion(im, {.distortion = true});
+}
+
+TEST(distortion, metrics_are_derived_from_deltas) {
+    image_distortion distortion{.cells = 8, .channel_count = 3};
+    EXPECT_TRUE(std::isinf(distortion.psnr()));
+    distortion.add(0, 10, 13);
+    distortion.add(1, 200, 200);
+    distortion.add(2, 7, 6);
+
+    image_distortion stripe{.cells = 8, .channel_count = 3};
+    stripe.add(2, 0, 2);
+    distortion.merge(stripe);
+
+    EXPECT_EQ(distortion.changed_cells(), 3u);
+    EXPECT_EQ(distortion.max_delta[0], 3);
+    EXPECT_EQ(distortion.max_delta[1], 0);
+    EXPECT_EQ(distortion.max_delta[2], 2);
+    EXPECT_DOUBLE_EQ(distortion.mse(), 14.0 / 8);
+    EXPECT_DOUBLE_EQ(distortion.psnr(), 10 * std::log10(255.0 * 255 / (14.0 / 8)));
+}
+
+TEST(distortion, streamed_hiding_is_measured) {
+    for (uint8_t chunk_size : {1, 2, 4, 8}) {
+        /* width 7 gives padding 3 */
+        auto carrier = make_bmp_bytes(7, 13);
+        auto payload = make_payload(20);
+
+        bmp_image im("stream", chunk_size);
+        im.assign_input(std::make_unique<std::stringstream>(as_string(carrier)));
+        ASSERT_TRUE(im.load_header());
+        auto os = std::make_unique<std::stringstream>();
+        auto output = os.get();
+        im.assign_output(std::move(os));
+        ASSERT_TRUE(im.write_header_to_output());
+        measure(im);
+        std::stringstream err;
+        ASSERT_TRUE(hide_data(im, payload, 42, 0, err)) << err.str();
+
+        auto altered = output->str();
+        auto expected = compare(im, carrier, std::as_bytes(std::span(altered)));
+        expect_same(*im.distortion, expected);
+        EXPECT_GT(im.distortion->changed_cells(), 0u);
+    }
+}
+
+TEST(distortion, checksummed_hiding_is_measured) {
+    /* the metadata are rewritten with the checksum after the data */
+    auto carrier = make_bmp_bytes(7, 13);
+    std::vector<bmp_image> images{};
+    images.emplace_back("stream", 2);
+    images[0].assign_input(std::make_unique<std::stringstream>(as_string(carrier)));
+    ASSERT_TRUE(images[0].load_header());
+    auto os = std::make_unique<std::stringstream>();
+    auto output = os.get();
+    images[0].assign_output(std::move(os));
+    ASSERT_TRUE(images[0].write_header_to_output());
+
+    auto payload = make_payload(20);
+    std::stringstream data{as_string(std::as_bytes(std::span(payload)))}, log{};
+    hide_options options{.key = "secret", .checksum = true, .distortion = true};
+    ASSERT_EQ(hide(images, data, log, log, options), 0) << log.str();
+
+    auto altered = output->str();
+    ASSERT_EQ(altered.size(), carrier.size());
+    expect_same(*images[0].distortion,
+                compare(images[0], carrier, std::as_bytes(std::span(altered))));
+}
+
+TEST(distortion, in_memory_hiding_is_measured) {
+    auto carrier = make_bmp_bytes(7, 13);
+    auto payload = make_payload(40);
+    std::stringstream err;
+
+    bmp_image im("memory", 2);
+    ASSERT_TRUE(load_header_from_memory(im, carrier, err));
+    measure(im);
+    std::vector<std::byte> output(carrier.size());
+    ASSERT_TRUE(hide_data_in_memory(im, carrier, output, payload, 42, 0, err))
+        << err.str();
+    expect_same(*im.distortion, compare(im, carrier, output));
+}
+
+TEST(distortion, scattered_hiding_is_measured) {
+    auto carrier = make_bmp_bytes(9, 11);
+    auto image = carrier;
+    auto payload = make_payload(30);
+    std::stringstream err;
+
+    bmp_image im("scattered", 4);
+    ASSERT_TRUE(load_header_from_memory(im, carrier, err));
+    measure(im);
+    cell_scatter scatter{key_type{}, im};
+    auto pixels = std::span(image).subspan(im.data_offset);
+    ASSERT_TRUE(hide_bytes_scattered(im, pixels, scatter, 0, payload,
+                                     im.chunk_size, &*im.distortion));
+    expect_same(*im.distortion, compare(im, carrier, image));
+}
+
+TEST(distortion, report_is_tab_separated) {
+    image_distortion distortion{.cells = 4, .channel_count = 3};
+    distortion.add(0, 1, 2);
+    distortion.add(2, 4, 1);
+    std::stringstream report{};
+    write_distortion_header(report);
+    write_distortion(report, "in.bmp", "out.bmp", distortion);
+    EXPECT_EQ(report.str(),
+              "image\toutput\tchanged\tcells\tmse\tpsnr\tmax_delta\n"
+              "in.bmp\tout.bmp\t2\t4\t2.5\t44.1514\t1,0,3\n");
+
+    std::stringstream unchanged{};
+    write_distortion(unchanged, "in.bmp", "out.bmp", {.cells = 4});
+    EXPECT_EQ(unchanged.str(), "in.bmp\tout.bmp\t0\t4\t0\tinf\n");
+}
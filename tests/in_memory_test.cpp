@@ -0,0 +1,142 @@
+#include "in_memory.h"
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <vector>
+
+#include "hide.h"
+#include "extract.h"
+#include "loader.h"
+#include "test_images.h"
+
+static std::vector<uint8_t> make_payload(std::size_t size) {
+    std::vector<uint8_t> payload(size);
+    for (auto i = 0u; i < size; ++i)
+        payload[i] = static_cast<uint8_t>(i * 7 + 3);
+    return payload;
+}
+
+TEST(in_memory, hide_matches_stream_hide) {
+    /* width 7 gives padding 3 */
+    auto carrier = make_bmp_bytes(7, 13);
+    auto payload = make_payload(40);
+
+    bmp_image stream_im("stream", 2);
+    stream_im.assign_input(std::make_unique<std::stringstream>(as_string(carrier)));
+    ASSERT_TRUE(stream_im.load_header());
+    auto os = std::make_unique<std::stringstream>();
+    auto stream_output = os.get();
+    stream_im.assign_output(std::move(os));
+    ASSERT_TRUE(stream_im.write_header_to_output());
+    std::stringstream err;
+    ASSERT_TRUE(hide_data(stream_im, payload, 42, 0, err)) << err.str();
+
+    bmp_image im("memory", 2);
+    std::vector<std::byte> output(carrier.size());
+    ASSERT_TRUE(hide_data_in_memory(im, carrier, output, payload, 42, 0, err))
+        << err.str();
+    EXPECT_EQ(as_string(output), stream_output->str());
+
+    ASSERT_TRUE(hide_data_in_place(im, carrier, payload, 42, 0, err));
+    EXPECT_EQ(carrier, output);
+}
+
+TEST(in_memory, extract_returns_hidden_data) {
+    for (uint8_t chunk_size : {1, 2, 4, 8}) {
+        auto image = make_bmp_bytes(13, 17);
+        auto payload = make_payload(50);
+        std::stringstream err;
+
+        bmp_image im("memory", chunk_size);
+        ASSERT_TRUE(hide_data_in_place(im, image, payload, 7, 3, err));
+
+        bmp_image extracted_im("memory", 2);
+        ASSERT_TRUE(extract_metadata_in_memory(extracted_im, image, err));
+        EXPECT_EQ(extracted_im.id, 7);
+        EXPECT_EQ(extracted_im.seq, 3);
+        EXPECT_EQ(extracted_im.chunk_size, chunk_size);
+        ASSERT_EQ(extracted_im.hidden_data_size, payload.size());
+
+        std::vector<uint8_t> data(extracted_im.hidden_data_size);
+        ASSERT_TRUE(extract_data_in_memory(extracted_im, image, data, err));
+        EXPECT_EQ(data, payload);
+    }
+}
+
+TEST(in_memory, hide_with_small_capacity_returns_false) {
+    auto image = make_bmp_bytes(4, 4);
+    auto payload = make_payload(100);
+    std::stringstream err;
+
+    bmp_image im("memory", 1);
+    ASSERT_FALSE(hide_data_in_place(im, image, payload, 1, 0, err));
+    EXPECT_EQ(err.str(), "image memory has only 1 byte capacity "
+                         "(100 byte capacity is needed)\n");
+}
+
+TEST(in_memory, load_header_of_short_image_returns_false) {
+    auto image = make_bmp_bytes(4, 4);
+    std::stringstream err;
+
+    bmp_image im("memory", 2);
+    ASSERT_FALSE(load_header_from_memory(im, std::span(image).first(20), err));
+    EXPECT_EQ(err.str(), "image memory is too short, bytes available: 20\n");
+}
+
+TEST(in_memory, load_header_of_truncated_header_returns_false) {
+    /* the data offset points right behind the 20 bytes of the image */
+    auto image = make_bmp_bytes(4, 4);
+    image.resize(20);
+    image[2] = image[10] = std::byte{20};
+    image[3] = image[11] = std::byte{0};
+    std::stringstream err;
+
+    bmp_image im("memory", 2);
+    ASSERT_FALSE(load_header_from_memory(im, image, err));
+    EXPECT_EQ(err.str(), "data offset in header of memory is too small to be bmp\n");
+}
+
+TEST(in_memory, small_image_files_are_hidden_and_extracted) {
+    auto dir = std::filesystem::temp_directory_path() / "sharky_in_memory_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    std::vector<std::string> paths{};
+    for (auto i = 0u; i < 3; ++i) {
+        paths.push_back((dir / ("image" + std::to_string(i) + ".bmp")).string());
+        auto carrier = make_bmp_bytes(9 + i, 11);
+        std::ofstream file{paths.back(), std::ios::binary};
+        file << as_string(carrier);
+    }
+    std::stringstream log{};
+
+    bmp_image small(paths[0], 2);
+    ASSERT_TRUE(probe_header(small, log)) << log.str();
+    EXPECT_TRUE(is_small_image(small));
+    std::vector<std::byte> file{};
+    ASSERT_TRUE(read_image_file(small, file));
+    EXPECT_EQ(file, make_bmp_bytes(9, 11));
+
+    auto payload = make_payload(120);
+    std::vector<bmp_image> images{};
+    for (auto &path : paths) {
+        images.emplace_back(path, 2);
+        ASSERT_TRUE(probe_header(images.back(), log)) << log.str();
+        images.back().output_path = path + ".out";
+    }
+    std::stringstream data(std::string(payload.begin(), payload.end()));
+    ASSERT_EQ(hide(images, data, log, log, {.checksum = true}), 0) << log.str();
+
+    std::vector<bmp_image> hidden{};
+    /* the last image is not necessary */
+    for (auto i = 0u; i < 2; ++i) {
+        hidden.emplace_back(paths[i] + ".out", 2);
+        ASSERT_TRUE(probe_header(hidden.back(), log)) << log.str();
+    }
+    std::stringstream extracted{};
+    ASSERT_EQ(extract(hidden, extracted, log), 0) << log.str();
+    EXPECT_EQ(extracted.str(), std::string(payload.begin(), payload.end()));
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,153 @@
+#include "interleave.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "configuration.h"
+#include "extract.h"
+#include "hide.h"
+#include "test_images.h"
+
+static std::string make_payload(std::size_t size) {
+    std::string payload(size, '\0');
+    for (auto i = 0u; i < size; ++i)
+        payload[i] = static_cast<char>(i * 7 + i / 4096);
+    return payload;
+}
+
+/**
+ * @brief Hides the payload into carriers held in memory and returns
+ * the outputs which hold a data part.
+ */
+static std::vector<std::string> hide_payload(
+    const std::vector<std::string> &carriers,
+    const std::string &payload,
+    const hide_options &options
+) {
+    std::vector<bmp_image> images{};
+    std::vector<std::stringstream *> outputs{};
+    for (auto i = 0u; i < carriers.size(); ++i) {
+        images.push_back(load_image("image" + std::to_string(i), carriers[i],
+                                    8));
+        auto os = std::make_unique<std::stringstream>();
+        outputs.push_back(os.get());
+        images.back().assign_output(std::move(os));
+        images.back().write_header_to_output();
+    }
+    std::stringstream data{payload};
+    std::stringstream log{};
+    EXPECT_EQ(hide(images, data, log, log, options), 0) << log.str();
+    std::vector<std::string> stego{};
+    for (auto os : outputs)
+        if (os->str().size() > 54)
+            stego.push_back(os->str());
+    return stego;
+}
+
+static std::vector<bmp_image> load_stego(const std::vector<std::string> &stego) {
+    std::vector<bmp_image> images{};
+    for (auto i = 0u; i < stego.size(); ++i)
+        images.push_back(load_image("stego" + std::to_string(i), stego[i],
+                                    8));
+    return images;
+}
+
+TEST(interleave, units_rotate_and_skip_full_parts) {
+    std::vector<std::size_t> capacities{10000, 3000, 10000, 0};
+    interleaved_layout layout{capacities, 20000};
+
+    EXPECT_EQ(layout.units[0].part, 0u);
+    EXPECT_EQ(layout.units[1].part, 1u);
+    EXPECT_EQ(layout.units[1].size, 3000u);
+    EXPECT_EQ(layout.units[2].part, 2u);
+    /* the part without capacity is skipped */
+    EXPECT_EQ(layout.units[3].part, 0u);
+    EXPECT_EQ(std::accumulate(layout.part_sizes.begin(),
+                              layout.part_sizes.end(), std::size_t{0}),
+              20000u);
+    for (auto i = 0u; i < capacities.size(); ++i)
+        EXPECT_LE(layout.part_sizes[i], capacities[i]);
+    EXPECT_EQ(layout.part_sizes[3], 0u);
+    EXPECT_EQ(layout.unit_at(4096 + 2999).part, 1u);
+    EXPECT_EQ(layout.unit_at(4096 + 3000).part, 2u);
+
+    /* sizes of the hidden parts give the same layout */
+    interleaved_layout extracted{layout.part_sizes, 20000};
+    ASSERT_EQ(extracted.units.size(), layout.units.size());
+    for (auto i = 0u; i < layout.units.size(); ++i) {
+        EXPECT_EQ(extracted.units[i].part, layout.units[i].part);
+        EXPECT_EQ(extracted.units[i].part_offset, layout.units[i].part_offset);
+        EXPECT_EQ(extracted.units[i].size, layout.units[i].size);
+    }
+
+    std::vector<uint8_t> message(20000);
+    std::iota(message.begin(), message.end(), 0);
+    std::vector<uint8_t> parts(message.size());
+    std::vector<uint8_t> restored(message.size());
+    layout.interleave(message, parts);
+    EXPECT_NE(parts, message);
+    layout.deinterleave(parts, restored);
+    EXPECT_EQ(restored, message);
+}
+
+TEST(interleave, data_are_spread_over_all_images) {
+    std::vector<std::string> carriers(4, make_bmp(100, 100));
+    auto payload = make_payload(5 * INTERLEAVE_UNIT_SIZE + 100);
+    auto stego = hide_payload(carriers, payload,
+                              {.key = "key", .checksum = true,
+                               .interleave = true});
+    /* the first image alone could hold all of it */
+    ASSERT_EQ(stego.size(), 4u);
+
+    std::stringstream log{};
+    auto images = load_stego(stego);
+    std::stringstream extracted{};
+    ASSERT_EQ(extract(images, extracted, log, {.key = "key"}), 0) << log.str();
+    EXPECT_EQ(extracted.str(), payload);
+    EXPECT_EQ(images[0].hidden_data_size, 2 * INTERLEAVE_UNIT_SIZE);
+    EXPECT_EQ(images[1].hidden_data_size, INTERLEAVE_UNIT_SIZE + 100);
+
+    /* the range spans units of three images */
+    images = load_stego(stego);
+    std::stringstream range{};
+    ASSERT_EQ(extract_range(images, 4000, 9000, range, log, {.key = "key"}), 0)
+        << log.str();
+    EXPECT_EQ(range.str(), payload.substr(4000, 9000));
+
+    /* a corrupted data part is detected */
+    stego[2][54 + 4000] ^= 0x0f;
+    images = load_stego(stego);
+    std::stringstream corrupted{};
+    EXPECT_EQ(extract(images, corrupted, log, {.key = "key"}), 1);
+    EXPECT_NE(log.str().find("checksum of data hidden in image stego2"),
+              std::string::npos) << log.str();
+}
+
+TEST(interleave, missing_image_is_rebuilt_from_parity) {
+    std::vector<std::string> carriers(4, make_bmp(100, 100));
+    auto payload = make_payload(3 * INTERLEAVE_UNIT_SIZE + 500);
+    auto stego = hide_payload(carriers, payload,
+                              {.parity = 1, .interleave = true});
+    ASSERT_EQ(stego.size(), 4u);
+
+    stego.erase(stego.begin() + 1);
+    auto images = load_stego(stego);
+    std::stringstream log{};
+    std::stringstream extracted{};
+    ASSERT_EQ(extract(images, extracted, log), 0) << log.str();
+    EXPECT_EQ(extracted.str(), payload);
+}
+
+TEST(interleave, scattering_is_rejected) {
+    std::vector<bmp_image> images{};
+    images.push_back(load_image("image", make_bmp(100, 100), 8));
+    std::stringstream data{make_payload(100)};
+    std::stringstream log{};
+    EXPECT_EQ(hide(images, data, log, log,
+                   {.key = "key", .scatter = true, .interleave = true}), 1);
+    EXPECT_NE(log.str().find("interleaved data can not be scattered"),
+              std::string::npos) << log.str();
+}
@@ -0,0 +1,183 @@
+#include "journal.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "crc.h"
+#include "extract.h"
+#include "hide.h"
+#include "loader.h"
+#include "test_images.h"
+
+static std::string read_file(const std::filesystem::path &path) {
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>(file), {}};
+}
+
+class journal : public testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "sharky_journal_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir / "out");
+        for (auto i = 0u; i < 3; ++i) {
+            paths.push_back((dir / ("image" + std::to_string(i) + ".bmp"))
+                                .string());
+            write(paths.back(), make_bmp(300, 100));
+        }
+        journal_path = (dir / "journal").string();
+        message.resize(40000);
+        for (auto i = 0u; i < message.size(); ++i)
+            message[i] = static_cast<char>(i * 13 + 1);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    static void write(const std::string &path, const std::string &data) {
+        std::ofstream file{path, std::ios::binary};
+        file << data;
+    }
+
+    std::vector<bmp_image> load(
+        const std::vector<std::string> &files,
+        uint8_t chunk_size = 2
+    ) {
+        std::vector<bmp_image> images{};
+        for (auto &path : files) {
+            images.emplace_back(path, chunk_size);
+            EXPECT_TRUE(probe_header(images.back(), log)) << log.str();
+            images.back().output_path =
+                (dir / "out" / std::filesystem::path(path).filename()).string();
+        }
+        return images;
+    }
+
+    int hide_message(const hide_options &options, uint8_t chunk_size = 2) {
+        auto images = load(paths, chunk_size);
+        std::stringstream data{message};
+        return hide(images, data, log, log, options);
+    }
+
+    std::vector<std::string> outputs() {
+        std::vector<std::string> files{};
+        for (auto &path : paths)
+            files.push_back((dir / "out" / std::filesystem::path(path)
+                                               .filename()).string());
+        return files;
+    }
+
+    std::filesystem::path dir{};
+    std::vector<std::string> paths{};
+    std::string journal_path{};
+    std::string message{};
+    std::stringstream log{};
+};
+
+TEST_F(journal, entries_are_loaded_and_checked) {
+    write(paths[0] + ".out", "0123456789");
+    job_journal written{};
+    journal_header header{"hide", 7, 100, 0x1234, 0x30, {1, 2, 3}};
+    ASSERT_TRUE(written.start(journal_path, header, log));
+    ASSERT_TRUE(written.record({0, paths[0] + ".out", 2, 5,
+                                crc32c(std::span(reinterpret_cast<const uint8_t *>(
+                                    "23456"), 5))}, log));
+    EXPECT_FALSE(std::filesystem::exists(journal_path + ".tmp"));
+
+    job_journal loaded{};
+    ASSERT_TRUE(loaded.load(journal_path, log)) << log.str();
+    EXPECT_EQ(loaded.header(), header);
+    ASSERT_TRUE(loaded.completed(0, paths[0] + ".out"));
+    EXPECT_FALSE(loaded.completed(1, paths[0] + ".out"));
+    EXPECT_FALSE(loaded.completed(0, paths[1]));
+
+    /* the recorded bytes changed */
+    write(paths[0] + ".out", "01x3456789");
+    EXPECT_FALSE(loaded.completed(0, paths[0] + ".out"));
+
+    write(journal_path, JOURNAL_MAGIC + "\nhide 7 100\n");
+    EXPECT_FALSE(loaded.load(journal_path, log));
+    EXPECT_NE(log.str().find("is corrupted"), std::string::npos);
+}
+
+TEST_F(journal, resumed_hiding_rewrites_only_changed_images) {
+    hide_options options{.key = "passphrase", .checksum = true, .parity = 1};
+    options.journal.path = journal_path;
+    ASSERT_EQ(hide_message(options), 0) << log.str();
+    auto files = outputs();
+    auto first = read_file(files[0]);
+
+    /* the second data carrier and the parity carrier were not finished */
+    std::filesystem::remove(files[1]);
+    write(files[2], "partial");
+    options.journal.resume = true;
+    log.str("");
+    ASSERT_EQ(hide_message(options), 0) << log.str();
+    EXPECT_NE(log.str().find("image0.bmp was already hidden"), std::string::npos)
+        << log.str();
+    EXPECT_EQ(log.str().find("image1.bmp was already hidden"), std::string::npos);
+    EXPECT_EQ(read_file(files[0]), first);
+
+    /* the resumed carriers belong to the same hiding, parity included */
+    std::vector<std::string> rest{files[1], files[2]};
+    auto images = load(rest);
+    std::stringstream extracted{};
+    ASSERT_EQ(extract(images, extracted, log, {.key = "passphrase"}), 0)
+        << log.str();
+    EXPECT_EQ(extracted.str(), message);
+
+    /* a different message is not resumed */
+    message[0] ^= 1;
+    log.str("");
+    EXPECT_EQ(hide_message(options), 1);
+    EXPECT_NE(log.str().find("records a different job"), std::string::npos);
+}
+
+TEST_F(journal, resumed_hiding_with_a_different_plan_fails) {
+    message.resize(60000, 'x');
+    hide_options options{};
+    options.journal.path = journal_path;
+    ASSERT_EQ(hide_message(options, 4), 0) << log.str();
+    auto files = outputs();
+    std::filesystem::remove(files[1]);
+
+    /* the first image would hold a larger part of the message */
+    options.journal.resume = true;
+    log.str("");
+    EXPECT_EQ(hide_message(options, 8), 1);
+    EXPECT_NE(log.str().find("records a different job"), std::string::npos)
+        << log.str();
+    EXPECT_FALSE(std::filesystem::exists(files[1]));
+}
+
+TEST_F(journal, resumed_extraction_appends_missing_images) {
+    message.resize(60000, 'x');
+    ASSERT_EQ(hide_message({}), 0) << log.str();
+    auto data_path = (dir / "data").string();
+    extract_options options{};
+    options.journal.path = journal_path;
+    options.data_path = data_path;
+    {
+        auto images = load(outputs());
+        std::ofstream data{data_path, std::ios::binary};
+        ASSERT_EQ(extract(images, data, log, options), 0) << log.str();
+    }
+    EXPECT_EQ(read_file(data_path), message);
+
+    /* data of the last image were not written */
+    auto images = load(outputs());
+    std::filesystem::resize_file(data_path, message.size() - 1000);
+    options.journal.resume = true;
+    std::fstream data{data_path, std::ios::binary | std::ios::in
+                                 | std::ios::out};
+    ASSERT_EQ(extract(images, data, log, options), 0) << log.str();
+    data.close();
+    EXPECT_NE(log.str().find("2 image(s) were already extracted"),
+              std::string::npos) << log.str();
+    EXPECT_EQ(read_file(data_path), message);
+}
@@ -0,0 +1,128 @@
+#include "loader.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "in_memory.h"
+#include "metadata.h"
+#include "configuration.h"
+#include "parallel.h"
+
+/* writes 24 bit bmp with 54 byte header and zeroed pixel data */
+static std::string write_bmp(const std::string &name, uint32_t width,
+                             uint32_t height) {
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    uint32_t row = (width * 3 + 3) & ~3u;
+    uint32_t size = 54 + row * height;
+    std::vector<uint8_t> data(size);
+    auto put32 = [&](std::size_t at, uint32_t v) {
+        for (int i = 0; i < 4; ++i)
+            data[at + i] = static_cast<uint8_t>(v >> (8 * i));
+    };
+    data[0] = 'B';
+    data[1] = 'M';
+    put32(2, size);
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, width);
+    put32(22, height);
+    data[26] = 1;
+    data[28] = 24;
+    std::ofstream(path, std::ios::binary)
+        .write(reinterpret_cast<const char*>(data.data()), data.size());
+    return path;
+}
+
+TEST(loader, probe_header_valid) {
+    bmp_image im(write_bmp("sharky_probe_valid.bmp", 10, 10), 2);
+    std::stringstream err;
+    ASSERT_TRUE(probe_header(im, err)) << err.str();
+    EXPECT_EQ(im.width, 10);
+    EXPECT_EQ(im.height, 10);
+    EXPECT_EQ(im.channel_count, 3);
+    EXPECT_EQ(im.padding, 2);
+    EXPECT_EQ(im.header.size(), 54);
+    EXPECT_EQ(im.input, nullptr);
+}
+
+TEST(loader, probe_header_missing_file_returns_false) {
+    bmp_image im("sharky_missing_file.bmp", 2);
+    std::stringstream err;
+    ASSERT_FALSE(probe_header(im, err));
+    EXPECT_EQ(err.str(), "image sharky_missing_file.bmp could not be opened\n");
+}
+
+TEST(loader, probe_metadata_of_narrow_image) {
+    /* rows of 9 cells and 3 padding bytes, so the metadata span many rows */
+    auto path = write_bmp("sharky_probe_metadata.bmp", 3, 100);
+    std::ifstream in(path, std::ios::binary);
+    std::vector<std::byte> file(std::filesystem::file_size(path));
+    in.read(reinterpret_cast<char *>(file.data()), file.size());
+    in.close();
+
+    bmp_image hidden(path, 4);
+    init_extra_metadata(hidden, MD_FLAG_ENCRYPTED | MD_FLAG_CHECKSUM
+                                | MD_FLAG_PARITY);
+    set_metadata_carriers(hidden, {2, 1});
+    std::vector<uint8_t> payload(10, 7);
+    std::stringstream err;
+    ASSERT_TRUE(hide_data_in_place(hidden, file, payload, 42, 1, err))
+        << err.str();
+    ASSERT_EQ(hidden.metadata_size(), MAX_METADATA_SIZE);
+    std::ofstream(path, std::ios::binary)
+        .write(reinterpret_cast<const char *>(file.data()), file.size());
+
+    bmp_image im(path, 2);
+    ASSERT_TRUE(probe_metadata(im, err)) << err.str();
+    EXPECT_EQ(im.id, 42);
+    EXPECT_EQ(im.seq, 1);
+    EXPECT_EQ(im.hidden_data_size, payload.size());
+    EXPECT_EQ(im.chunk_size, 4);
+    EXPECT_EQ(im.flags, hidden.flags);
+    EXPECT_EQ(im.extra_metadata, hidden.extra_metadata);
+    EXPECT_EQ(im.input, nullptr);
+
+    bmp_image plain(write_bmp("sharky_probe_plain.bmp", 10, 10), 2);
+    EXPECT_FALSE(probe_metadata(plain, err));
+}
+
+TEST(loader, load_images_keeps_argument_order) {
+    std::vector<image_arg> args{};
+    for (int i = 0; i < 16; ++i) {
+        if (i % 3 == 0)
+            args.push_back({"sharky_missing_" + std::to_string(i), 2});
+        else
+            args.push_back({write_bmp("sharky_load_" + std::to_string(i)
+                                      + ".bmp", 8 + i, 8), 2});
+    }
+
+    std::vector<bmp_image> images{};
+    std::stringstream err;
+    load_images(args, images, 4, err);
+
+    std::string expected_err{};
+    std::vector<std::string> expected_names{};
+    for (int i = 0; i < 16; ++i) {
+        if (i % 3 == 0)
+            expected_err += "image " + args[i].filename + " could not be opened\n";
+        else
+            expected_names.push_back(args[i].filename);
+    }
+    EXPECT_EQ(err.str(), expected_err);
+    ASSERT_EQ(images.size(), expected_names.size());
+    for (auto i = 0u; i < images.size(); ++i) {
+        EXPECT_EQ(images[i].filename, expected_names[i]);
+        EXPECT_EQ(images[i].input, nullptr);
+    }
+}
+
+TEST(parallel, parallel_for_visits_every_index_once) {
+    std::vector<std::atomic<int>> visited(1000);
+    parallel_for(visited.size(), 8, [&](std::size_t i) { ++visited[i]; });
+    for (auto &v : visited)
+        EXPECT_EQ(v, 1);
+}
@@ -0,0 +1,186 @@
+#include "parity.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "extract.h"
+#include "hide.h"
+#include "stripes.h"
+#include "test_images.h"
+
+TEST(parity, gf256_arithmetic) {
+    EXPECT_EQ(gf_mul(2, 0x80), 0x1d);
+    EXPECT_EQ(gf_mul(0, 0x53), 0);
+    EXPECT_EQ(gf_mul(1, 0x53), 0x53);
+    for (auto a = 1u; a < 256; ++a)
+        EXPECT_EQ(gf_mul(static_cast<uint8_t>(a), gf_inv(static_cast<uint8_t>(a))), 1);
+}
+
+TEST(parity, mul_add_matches_portable) {
+    std::vector<uint8_t> src(203);
+    for (auto i = 0u; i < src.size(); ++i)
+        src[i] = static_cast<uint8_t>(i * 73 + 5);
+    for (auto coef : {0, 1, 2, 0x53, 0xff}) {
+        for (auto size : {0u, 1u, 15u, 16u, 33u, 203u}) {
+            std::vector<uint8_t> fast(src.rbegin(), src.rend());
+            auto portable = fast;
+            auto part = std::span(src).first(size);
+            gf_mul_add(fast, part, static_cast<uint8_t>(coef));
+            gf_mul_add_portable(portable, part, static_cast<uint8_t>(coef));
+            EXPECT_EQ(fast, portable) << coef << ' ' << size;
+        }
+    }
+}
+
+TEST(parity, any_parts_rebuild_data) {
+    std::vector<std::vector<uint8_t>> data{};
+    for (auto size : {100u, 100u, 100u, 37u}) {
+        data.emplace_back(size);
+        for (auto i = 0u; i < size; ++i)
+            data.back()[i] = static_cast<uint8_t>(i * 31 + size + data.size());
+    }
+    std::vector<std::span<const uint8_t>> spans(data.begin(), data.end());
+    auto parity = encode_parity(spans, 2);
+    ASSERT_EQ(parity.size(), 2u);
+    EXPECT_EQ(parity[0].size(), PARITY_HEADER_SIZE + 100);
+
+    /* every combination of at most two lost parts out of six */
+    for (auto lost1 = 0u; lost1 < 6; ++lost1) {
+        for (auto lost2 = lost1; lost2 < 6; ++lost2) {
+            std::vector<std::optional<std::vector<uint8_t>>> parts(data.begin(),
+                                                                   data.end());
+            std::vector<std::optional<std::vector<uint8_t>>> parities(
+                parity.begin(), parity.end());
+            for (auto lost : {lost1, lost2}) {
+                if (lost < 4)
+                    parts[lost].reset();
+                else
+                    parities[lost - 4].reset();
+            }
+            ASSERT_TRUE(rebuild_parts(parts, parities)) << lost1 << ' ' << lost2;
+            for (auto i = 0u; i < data.size(); ++i)
+                EXPECT_EQ(*parts[i], data[i]);
+        }
+    }
+
+    std::vector<std::optional<std::vector<uint8_t>>> parts(data.begin(),
+                                                           data.end());
+    parts[0].reset();
+    parts[1].reset();
+    parts[2].reset();
+    std::vector<std::optional<std::vector<uint8_t>>> parities(parity.begin(),
+                                                              parity.end());
+    EXPECT_FALSE(rebuild_parts(parts, parities));
+}
+
+/* hides the payload into five images, three of them hold data */
+static std::vector<std::string> hide_payload(
+    const std::string &payload,
+    const hide_options &options,
+    bool parallel
+) {
+    std::vector<bmp_image> images{};
+    std::vector<std::stringstream *> outputs{};
+    for (auto i = 0; i < 5; ++i) {
+        images.push_back(load_image("image" + std::to_string(i),
+                                    make_bmp(60, 40)));
+        auto os = std::make_unique<std::stringstream>();
+        outputs.push_back(os.get());
+        images.back().assign_output(std::move(os));
+        images.back().write_header_to_output();
+    }
+    std::stringstream data{payload};
+    std::stringstream log{};
+    if (parallel) {
+        work_stealing_scheduler scheduler{2};
+        EXPECT_EQ(hide_in_stripes(images, data, scheduler, log, log, options), 0)
+            << log.str();
+    } else {
+        EXPECT_EQ(hide(images, data, log, log, options), 0) << log.str();
+    }
+    std::vector<std::string> stego{};
+    for (auto os : outputs)
+        stego.push_back(os->str());
+    return stego;
+}
+
+static std::vector<bmp_image> load_stego(
+    const std::vector<std::string> &stego,
+    std::initializer_list<std::size_t> used
+) {
+    std::vector<bmp_image> images{};
+    for (auto i : used)
+        images.push_back(load_image("stego" + std::to_string(i), stego[i]));
+    return images;
+}
+
+TEST(parity, lost_carriers_are_rebuilt) {
+    /* incompressible, so compressed data need three images as well */
+    std::string payload(4000, '\0');
+    uint32_t state = 1;
+    for (auto &byte : payload) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<char>(state >> 24);
+    }
+
+    for (auto parallel : {false, true}) {
+        for (auto options : {hide_options{.checksum = true, .parity = 2},
+                             hide_options{.compress = true, .key = "secret",
+                                          .scatter = true, .parity = 2}}) {
+            auto stego = hide_payload(payload, options, parallel);
+            for (auto used : {std::initializer_list<std::size_t>{0, 1, 2},
+                              {2, 3, 4}, {4, 0, 3}}) {
+                std::stringstream log{};
+                auto images = load_stego(stego, used);
+                std::stringstream extracted{};
+                ASSERT_EQ(extract(images, extracted, log, {.key = "secret"}), 0)
+                    << log.str();
+                EXPECT_EQ(extracted.str(), payload);
+
+                images = load_stego(stego, used);
+                std::stringstream striped{};
+                work_stealing_scheduler scheduler{2};
+                ASSERT_EQ(extract_in_stripes(images, striped, scheduler, log,
+                                             {.key = "secret"}), 0) << log.str();
+                EXPECT_EQ(striped.str(), payload);
+            }
+
+            std::stringstream log{};
+            auto images = load_stego(stego, {0, 4});
+            std::stringstream extracted{};
+            EXPECT_EQ(extract(images, extracted, log, {.key = "secret"}), 1);
+            EXPECT_NE(log.str().find("only 2 of 3 data and 2 parity images"),
+                      std::string::npos) << log.str();
+        }
+    }
+}
+
+TEST(parity, corrupted_carrier_is_not_used) {
+    std::string payload(4000, 'x');
+    auto stego = hide_payload(payload, {.checksum = true, .parity = 2}, false);
+    /* the first image is lost and the second one is corrupted */
+    stego[1][54 + 300] ^= 1;
+
+    auto images = load_stego(stego, {1, 2, 3, 4});
+    std::stringstream extracted{};
+    std::stringstream log{};
+    ASSERT_EQ(extract(images, extracted, log), 0) << log.str();
+    EXPECT_EQ(extracted.str(), payload);
+    EXPECT_NE(log.str().find("stego1 does not match"), std::string::npos);
+}
+
+TEST(parity, not_enough_images_for_parity) {
+    std::vector<bmp_image> images{};
+    for (auto i = 0; i < 2; ++i) {
+        images.push_back(load_image("image" + std::to_string(i),
+                                    make_bmp(60, 40)));
+        images.back().assign_output(std::make_unique<std::stringstream>());
+    }
+    std::stringstream data{std::string(100, 'x')};
+    std::stringstream log{};
+    EXPECT_EQ(hide(images, data, log, log, {.parity = 2}), 1);
+    EXPECT_NE(log.str().find("2 parity images are needed besides 1 images"),
+              std::string::npos) << log.str();
+}
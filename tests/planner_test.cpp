@@ -0,0 +1,141 @@
+#include "planner.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "configuration.h"
+#include "extract.h"
+#include "hide.h"
+#include "test_images.h"
+
+static std::size_t plan_cost(
+    const std::vector<carrier_candidate> &candidates,
+    const carrier_plan &plan
+) {
+    std::size_t cost = 0;
+    for (auto i : plan.order)
+        cost += candidates[i].cost;
+    return cost;
+}
+
+TEST(planner, order_uses_images_as_given) {
+    std::vector<carrier_candidate> candidates{{100, 400}, {50, 200},
+                                              {300, 1200}, {10, 40}};
+    carrier_plan plan{};
+    ASSERT_TRUE(select_carriers(candidates, 120, 1, carrier_selection::ORDER,
+                                plan));
+    EXPECT_EQ(plan.order, (std::vector<std::size_t>{0, 1, 2}));
+    EXPECT_EQ(plan.data_count, 2u);
+
+    /* the next image is too small for the parity part */
+    std::stringstream log{};
+    EXPECT_FALSE(select_carriers(candidates, 400, 1, carrier_selection::ORDER,
+                                 plan, log));
+    EXPECT_NE(log.str().find("with 250 byte capacity are needed"),
+              std::string::npos) << log.str();
+}
+
+TEST(planner, fewest_carriers_uses_largest_images) {
+    std::vector<carrier_candidate> candidates{{100, 400}, {50, 200},
+                                              {300, 1200}, {60, 240},
+                                              {500, 2000}};
+    carrier_plan plan{};
+    ASSERT_TRUE(select_carriers(candidates, 750, 0,
+                                carrier_selection::FEWEST_CARRIERS, plan));
+    /* the last carrier is the cheapest one holding the rest */
+    EXPECT_EQ(plan.order, (std::vector<std::size_t>{4, 2}));
+
+    ASSERT_TRUE(select_carriers(candidates, 540, 0,
+                                carrier_selection::FEWEST_CARRIERS, plan));
+    EXPECT_EQ(plan.order, (std::vector<std::size_t>{4, 1}));
+}
+
+TEST(planner, fewest_bytes_prefers_efficient_images) {
+    /* the first images are large but have low capacity per byte */
+    std::vector<carrier_candidate> candidates{{1000, 8000}, {1000, 8000},
+                                              {500, 1000}, {500, 1000},
+                                              {100, 200}, {2000, 16000}};
+    carrier_plan plan{};
+    ASSERT_TRUE(select_carriers(candidates, 1050, 0,
+                                carrier_selection::FEWEST_BYTES, plan));
+    EXPECT_EQ(plan_cost(candidates, plan), 2200u);
+
+    ASSERT_TRUE(select_carriers(candidates, 1050, 0,
+                                carrier_selection::FEWEST_CARRIERS, plan));
+    EXPECT_EQ(plan.order.size(), 1u);
+    EXPECT_EQ(plan_cost(candidates, plan), 16000u);
+}
+
+TEST(planner, parity_uses_cheapest_large_enough_images) {
+    std::vector<carrier_candidate> candidates{{100, 400}, {40, 100},
+                                              {100, 500}, {100, 450},
+                                              {90, 300}};
+    carrier_plan plan{};
+    ASSERT_TRUE(select_carriers(candidates, 100, 2,
+                                carrier_selection::FEWEST_CARRIERS, plan));
+    EXPECT_EQ(plan.data_count, 1u);
+    EXPECT_EQ(plan.order, (std::vector<std::size_t>{0, 3, 2}));
+}
+
+TEST(planner, infeasible_plans_are_rejected) {
+    std::vector<carrier_candidate> candidates{{100, 400}, {50, 200}};
+    for (auto selection : {carrier_selection::ORDER,
+                           carrier_selection::FEWEST_CARRIERS,
+                           carrier_selection::FEWEST_BYTES}) {
+        carrier_plan plan{};
+        std::stringstream log{};
+        EXPECT_FALSE(select_carriers(candidates, 151, 0, selection, plan, log));
+        EXPECT_NE(log.str().find("images can hold only 150 bytes"),
+                  std::string::npos) << log.str();
+        EXPECT_FALSE(select_carriers(candidates, 50, 2, selection, plan, log));
+    }
+
+    /* at most MAX_IMAGES carriers can be used */
+    std::vector<carrier_candidate> small(MAX_IMAGES + 10, {1, 4});
+    carrier_plan plan{};
+    std::stringstream log{};
+    EXPECT_FALSE(select_carriers(small, MAX_IMAGES + 1, 0,
+                                 carrier_selection::FEWEST_BYTES, plan, log));
+    EXPECT_TRUE(select_carriers(small, MAX_IMAGES - 1, 0,
+                                carrier_selection::FEWEST_BYTES, plan, log));
+    EXPECT_TRUE(select_carriers(small, MAX_IMAGES, 0,
+                                carrier_selection::FEWEST_CARRIERS, plan, log));
+    EXPECT_EQ(plan.order.size(), MAX_IMAGES);
+}
+
+TEST(planner, auto_chunk_upgrades_largest_images_first) {
+    /* 600, 1200 and 2400 cells */
+    std::vector<std::string> carriers{make_bmp(10, 20), make_bmp(20, 20),
+                                      make_bmp(40, 20)};
+    /* 1 bit chunks hold about 520 bytes, upgrading the largest image
+     * to 2 bits adds about 300 */
+    std::string payload(700, 'x');
+    std::vector<bmp_image> images{};
+    std::vector<std::stringstream *> outputs{};
+    for (auto i = 0u; i < carriers.size(); ++i) {
+        images.push_back(load_image("image" + std::to_string(i), carriers[i],
+                                    8));
+        auto os = std::make_unique<std::stringstream>();
+        outputs.push_back(os.get());
+        images.back().assign_output(std::move(os));
+        images.back().write_header_to_output();
+    }
+    std::stringstream data{payload};
+    std::stringstream log{};
+    ASSERT_EQ(hide(images, data, log, log, {.auto_chunk = true}), 0)
+        << log.str();
+    EXPECT_EQ(images[0].chunk_size, 1);
+    EXPECT_EQ(images[1].chunk_size, 1);
+    EXPECT_EQ(images[2].chunk_size, 2);
+
+    /* chunk sizes are stored in metadata as usual */
+    std::vector<bmp_image> stego{};
+    for (auto i = 0u; i < outputs.size(); ++i)
+        stego.push_back(load_image("stego" + std::to_string(i),
+                                   outputs[i]->str(), 8));
+    std::stringstream extracted{};
+    ASSERT_EQ(extract(stego, extracted, log), 0) << log.str();
+    EXPECT_EQ(extracted.str(), payload);
+}
@@ -0,0 +1,105 @@
+#include "prefetch.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "extract.h"
+#include "hide.h"
+#include "loader.h"
+#include "test_images.h"
+
+class prefetch : public testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() / "sharky_prefetch_test";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir / "out");
+        for (auto i = 0u; i < 5; ++i) {
+            auto path = dir / ("image" + std::to_string(i) + ".bmp");
+            std::ofstream file{path, std::ios::binary};
+            file << make_bmp(300, 100);
+            images.emplace_back(path.string(), 2);
+            EXPECT_TRUE(probe_header(images.back(), log)) << log.str();
+            images.back().output_path = (dir / "out" / path.filename()).string();
+        }
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    std::filesystem::path dir{};
+    std::vector<bmp_image> images{};
+    std::stringstream log{};
+};
+
+TEST_F(prefetch, images_are_hinted_once_within_depth) {
+    image_prefetcher prefetcher{2};
+    prefetcher.advance(images, 0);
+    EXPECT_EQ(prefetcher.hinted(), 2);
+    prefetcher.advance(images, 1);
+    prefetcher.advance(images, 1);
+    EXPECT_EQ(prefetcher.hinted(), 3);
+    prefetcher.advance(images, 3);
+    prefetcher.advance(images, 4);
+    EXPECT_EQ(prefetcher.hinted(), 4);
+
+    /* images processed again in another order */
+    std::vector<std::size_t> order{4, 3, 2, 1, 0};
+    prefetcher.restart();
+    prefetcher.advance(images, 0, order);
+    EXPECT_EQ(prefetcher.hinted(), 6);
+
+    image_prefetcher disabled{};
+    disabled.advance(images, 0);
+    EXPECT_EQ(disabled.hinted(), 0);
+}
+
+TEST_F(prefetch, streams_and_missing_files_are_not_hinted) {
+    EXPECT_TRUE(prefetch_image(images[0]));
+
+    images[1].assign_input(std::make_unique<std::stringstream>(
+        make_bmp(300, 100)));
+    EXPECT_FALSE(prefetch_image(images[1]));
+
+    images[2].seekable = false;
+    EXPECT_FALSE(prefetch_image(images[2]));
+
+    std::filesystem::remove(images[3].filename);
+    EXPECT_FALSE(prefetch_image(images[3]));
+
+    /* the header was not loaded, so the size of the file is unknown */
+    bmp_image unloaded{images[4].filename, 2};
+    EXPECT_FALSE(prefetch_image(unloaded));
+}
+
+TEST_F(prefetch, hiding_and_extraction_read_ahead) {
+    std::string message(100000, '\0');
+    for (auto i = 0u; i < message.size(); ++i)
+        message[i] = static_cast<char>(i * 13 + 1);
+
+    hide_options options{};
+    options.prefetch = 2;
+    options.memory_limit = 1 << 20;
+    std::stringstream data{message}, out{};
+    ASSERT_EQ(hide(images, data, out, log, options), 0) << log.str();
+
+    std::vector<bmp_image> altered{};
+    for (auto &im : images) {
+        if (!std::filesystem::exists(im.get_output_path()))
+            continue;
+        altered.emplace_back(im.get_output_path(), 2);
+        ASSERT_TRUE(probe_header(altered.back(), log)) << log.str();
+    }
+    ASSERT_GT(altered.size(), 2);
+
+    extract_options extracting{};
+    extracting.prefetch = 2;
+    std::stringstream extracted{};
+    ASSERT_EQ(extract(altered, extracted, log, extracting), 0) << log.str();
+    EXPECT_EQ(extracted.str(), message);
+}
@@ -0,0 +1,102 @@
+#include "scatter.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "configuration.h"
+#include "extract.h"
+#include "hide.h"
+#include "stripes.h"
+#include "test_images.h"
+
+TEST(scatter, is_permutation_of_data_cells) {
+    /* 3 full blocks and a partial one */
+    auto im = load_image("image", make_bmp(73, 61));
+    im.flags = MD_FLAG_ENCRYPTED;
+    key_type key{7};
+    cell_scatter scatter{key, im};
+
+    auto cells = static_cast<std::size_t>(73) * 3 * 61;
+    ASSERT_EQ(scatter.cell_count(), cells - im.data_start_cell());
+    ASSERT_GT(scatter.cell_count() % SCATTER_BLOCK_CELLS, 0u);
+
+    std::vector<bool> used(cells, false);
+    std::size_t in_place = 0;
+    for (std::size_t i = 0; i < scatter.cell_count(); ++i) {
+        auto cell = scatter(i);
+        ASSERT_GE(cell, im.data_start_cell());
+        ASSERT_LT(cell, cells);
+        EXPECT_FALSE(used[cell]);
+        used[cell] = true;
+        in_place += cell == im.data_start_cell() + i;
+    }
+    EXPECT_LT(in_place, 100u);
+
+    /* a different key gives a different order */
+    cell_scatter other{key_type{8}, im};
+    std::size_t same = 0;
+    for (std::size_t i = 0; i < scatter.cell_count(); ++i)
+        same += scatter(i) == other(i);
+    EXPECT_LT(same, 100u);
+}
+
+TEST(scatter, hide_and_extract_scattered) {
+    std::vector<bmp_image> images{};
+    std::vector<std::stringstream *> outputs{};
+    for (auto i = 0; i < 2; ++i) {
+        images.push_back(load_image("image" + std::to_string(i),
+                                    make_bmp(80 + i, 60)));
+        auto os = std::make_unique<std::stringstream>();
+        outputs.push_back(os.get());
+        images.back().assign_output(std::move(os));
+        images.back().write_header_to_output();
+    }
+    std::string payload(images[0].byte_capacity(), '\0');
+    for (auto i = 0u; i < payload.size(); ++i)
+        payload[i] = static_cast<char>(i % 253);
+    payload += "tail";
+
+    std::stringstream data{payload};
+    std::stringstream log{};
+    hide_options options{.key = "secret", .scatter = true};
+    ASSERT_EQ(hide(images, data, log, log, options), 0) << log.str();
+
+    /* the few bytes in the second image are not hidden right after
+     * the metadata, but spread over a block of cells */
+    auto original = make_bmp(81, 60);
+    auto stego = outputs[1]->str();
+    ASSERT_EQ(original.size(), stego.size());
+    std::size_t last_changed = 0;
+    for (auto i = 0u; i < original.size(); ++i)
+        if (original[i] != stego[i])
+            last_changed = i;
+    EXPECT_GT(last_changed, 54 + images[1].data_start_cell() + 1000);
+
+    auto load_stego = [&]() {
+        std::vector<bmp_image> stego{};
+        stego.push_back(load_image("stego1", outputs[1]->str()));
+        stego.push_back(load_image("stego0", outputs[0]->str()));
+        return stego;
+    };
+
+    auto images_stego = load_stego();
+    std::stringstream extracted{};
+    ASSERT_EQ(extract(images_stego, extracted, log, {.key = "secret"}), 0)
+        << log.str();
+    EXPECT_EQ(extracted.str(), payload);
+
+    images_stego = load_stego();
+    std::stringstream range{};
+    ASSERT_EQ(extract_range(images_stego, 1000, 2590, range, log,
+                            {.key = "secret"}), 0) << log.str();
+    EXPECT_EQ(range.str(), payload.substr(1000, 2590));
+
+    images_stego = load_stego();
+    std::stringstream striped{};
+    work_stealing_scheduler scheduler{2};
+    ASSERT_EQ(extract_in_stripes(images_stego, striped, scheduler, log,
+                                 {.key = "secret"}), 0) << log.str();
+    EXPECT_EQ(striped.str(), payload);
+}
@@ -0,0 +1,119 @@
+#include "scheduler.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <sstream>
+#include <thread>
+#include <memory>
+#include <vector>
+
+#include "extract.h"
+#include "hide.h"
+#include "stripes.h"
+#include "test_images.h"
+
+static std::vector<std::stringstream *> assign_outputs(
+    std::vector<bmp_image> &images
+) {
+    std::vector<std::stringstream *> outputs{};
+    for (auto &im : images) {
+        auto os = std::make_unique<std::stringstream>();
+        outputs.push_back(os.get());
+        im.assign_output(std::move(os));
+        im.write_header_to_output();
+    }
+    return outputs;
+}
+
+TEST(scheduler, runs_every_job_once) {
+    work_stealing_scheduler scheduler{4};
+    std::vector<std::atomic<int>> runs(1000);
+    for (auto i = 0u; i < 10; ++i) {
+        scheduler.spawn([&, i]() {
+            /* nested jobs go to the queue of the current worker */
+            for (auto j = 0u; j < 100; ++j)
+                scheduler.spawn([&, i, j]() { ++runs[i * 100 + j]; });
+        });
+    }
+    scheduler.run();
+
+    for (auto &r : runs)
+        EXPECT_EQ(r, 1);
+    std::size_t executed = 0;
+    for (auto &s : scheduler.stats())
+        executed += s.executed;
+    EXPECT_EQ(executed, 1010u);
+    EXPECT_EQ(scheduler.stats().size(), 4u);
+}
+
+TEST(scheduler, idle_workers_sleep_until_jobs_are_added) {
+    using namespace std::chrono_literals;
+    work_stealing_scheduler scheduler{4};
+    std::atomic<int> runs{0};
+    scheduler.spawn([&]() {
+        std::this_thread::sleep_for(200ms);
+        /* jobs added late wake the idle workers */
+        for (auto _ = 0u; _ < 3; ++_)
+            scheduler.spawn([&]() { ++runs; });
+    });
+    auto cpu_start = std::clock();
+    scheduler.run();
+    auto cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    EXPECT_EQ(runs, 3);
+    /* three spinning workers would burn about 0.6 s */
+    EXPECT_LT(cpu, 0.1);
+}
+
+TEST(scheduler, stripes_round_trip) {
+    /* the large image is split into multiple stripes */
+    std::vector<bmp_image> images{};
+    images.push_back(load_image("small", make_bmp(31, 17)));
+    images.push_back(load_image("large", make_bmp(1024, 1024)));
+    images.push_back(load_image("unused", make_bmp(40, 40)));
+    auto outputs = assign_outputs(images);
+    ASSERT_GT(images[1].byte_capacity(), 2 * stripe_bytes(images[1]));
+
+    std::string payload(images[0].byte_capacity() + 2 * stripe_bytes(images[1])
+                        + 100, '\0');
+    for (auto i = 0u; i < payload.size(); ++i)
+        payload[i] = static_cast<char>(i * 13 + 1);
+    std::stringstream data{payload};
+    std::stringstream log{};
+
+    work_stealing_scheduler scheduler{3};
+    ASSERT_EQ(hide_in_stripes(images, data, scheduler, log, log), 0)
+        << log.str();
+    EXPECT_NE(log.str().find("unused was not necessary"), std::string::npos);
+
+    /* stripes can be extracted by the serial extraction and vice versa */
+    std::vector<bmp_image> stego{};
+    stego.push_back(load_image("large", outputs[1]->str()));
+    stego.push_back(load_image("small", outputs[0]->str()));
+    std::stringstream serial{};
+    ASSERT_EQ(extract(stego, serial, log), 0) << log.str();
+    EXPECT_EQ(serial.str(), payload);
+
+    stego.clear();
+    stego.push_back(load_image("large", outputs[1]->str()));
+    stego.push_back(load_image("small", outputs[0]->str()));
+    std::stringstream striped{};
+    ASSERT_EQ(extract_in_stripes(stego, striped, scheduler, log), 0)
+        << log.str();
+    EXPECT_EQ(striped.str(), payload);
+}
+
+TEST(scheduler, stripes_report_small_images) {
+    std::vector<bmp_image> images{};
+    images.push_back(load_image("small", make_bmp(20, 20)));
+    auto outputs = assign_outputs(images);
+    std::stringstream data{std::string(1000, 'x')};
+    std::stringstream log{};
+
+    work_stealing_scheduler scheduler{2};
+    EXPECT_EQ(hide_in_stripes(images, data, scheduler, log, log), 1);
+    EXPECT_NE(log.str().find("images can hold only"), std::string::npos);
+    /* nothing is hidden if the data do not fit */
+    EXPECT_EQ(outputs[0]->str().size(), 54u);
+}
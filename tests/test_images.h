@@ -0,0 +1,58 @@
+#ifndef TEST_IMAGES_H
+#define TEST_IMAGES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bitmap.h"
+
+/* 24 bit bmp with 54 byte header and pseudo-random pixel data */
+inline std::vector<std::byte> make_bmp_bytes(uint32_t width, uint32_t height) {
+    uint32_t row = (width * 3 + 3) & ~3u;
+    uint32_t size = 54 + row * height;
+    std::vector<std::byte> data(size);
+    auto put32 = [&](std::size_t at, uint32_t v) {
+        for (int i = 0; i < 4; ++i)
+            data[at + i] = static_cast<std::byte>(v >> (8 * i));
+    };
+    data[0] = std::byte{'B'};
+    data[1] = std::byte{'M'};
+    put32(2, size);
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, width);
+    put32(22, height);
+    data[26] = std::byte{1};
+    data[28] = std::byte{24};
+    for (auto i = 54u; i < size; ++i)
+        data[i] = static_cast<std::byte>(i * 37 + 11);
+    return data;
+}
+
+inline std::string as_string(std::span<const std::byte> data) {
+    return {reinterpret_cast<const char *>(data.data()), data.size()};
+}
+
+/* the same image as `make_bmp_bytes`, as the content of a stream */
+inline std::string make_bmp(uint32_t width, uint32_t height) {
+    return as_string(make_bmp_bytes(width, height));
+}
+
+/* image read from a string stream, with loaded header */
+inline bmp_image load_image(
+    const std::string &name,
+    const std::string &data,
+    uint8_t chunk_size = 2
+) {
+    bmp_image im(name, chunk_size);
+    im.assign_input(std::make_unique<std::stringstream>(data));
+    im.load_header();
+    return im;
+}
+
+#endif  // TEST_IMAGES_H
@@ -0,0 +1,146 @@
+#include "update.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "extract.h"
+#include "hide.h"
+#include "test_images.h"
+
+static std::string random_payload(std::size_t size) {
+    std::string payload(size, '\0');
+    uint32_t state = 7;
+    for (auto &byte : payload) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<char>(state >> 24);
+    }
+    return payload;
+}
+
+static std::vector<std::string> hide_payload(
+    const std::string &payload,
+    const hide_options &options,
+    std::size_t count
+) {
+    std::vector<bmp_image> images{};
+    std::vector<std::stringstream *> outputs{};
+    for (auto i = 0u; i < count; ++i) {
+        images.push_back(load_image("image" + std::to_string(i),
+                                    make_bmp(60, 40)));
+        auto os = std::make_unique<std::stringstream>();
+        outputs.push_back(os.get());
+        images.back().assign_output(std::move(os));
+        images.back().write_header_to_output();
+    }
+    std::stringstream data{payload};
+    std::stringstream log{};
+    EXPECT_EQ(hide(images, data, log, log, options), 0) << log.str();
+    /* images which were not necessary are not part of the hiding */
+    std::vector<std::string> stego{};
+    for (auto os : outputs)
+        if (os->str().size() > 54)
+            stego.push_back(os->str());
+    return stego;
+}
+
+/* updates the stego images in place, as if they were files */
+static int update_payload(
+    std::vector<std::string> &stego,
+    const std::string &payload,
+    std::ostream &log,
+    const extract_options &options = {}
+) {
+    std::vector<bmp_image> images{};
+    std::vector<std::stringstream *> outputs{};
+    for (auto i = 0u; i < stego.size(); ++i) {
+        images.push_back(load_image("stego" + std::to_string(i), stego[i]));
+        auto os = std::make_unique<std::stringstream>(stego[i]);
+        outputs.push_back(os.get());
+        images.back().assign_output(std::move(os));
+    }
+    std::stringstream data{payload};
+    auto res = update(images, data, log, log, options);
+    for (auto i = 0u; i < stego.size(); ++i)
+        stego[i] = outputs[i]->str();
+    return res;
+}
+
+static std::string extract_payload(
+    const std::vector<std::string> &stego,
+    const extract_options &options = {}
+) {
+    std::vector<bmp_image> images{};
+    for (auto i = 0u; i < stego.size(); ++i)
+        images.push_back(load_image("stego" + std::to_string(i), stego[i]));
+    std::stringstream extracted{};
+    std::stringstream log{};
+    EXPECT_EQ(extract(images, extracted, log, options), 0) << log.str();
+    return extracted.str();
+}
+
+static std::size_t changed_bytes(
+    const std::vector<std::string> &before,
+    const std::vector<std::string> &after
+) {
+    std::size_t changed = 0;
+    for (auto i = 0u; i < before.size(); ++i)
+        for (auto j = 0u; j < before[i].size(); ++j)
+            changed += before[i][j] != after[i][j];
+    return changed;
+}
+
+TEST(update, patched_and_appended_payload) {
+    auto payload = random_payload(2500);
+    auto stego = hide_payload(payload, {.checksum = true}, 3);
+    ASSERT_EQ(stego.size(), 2u);
+    auto original = stego;
+
+    auto updated = payload;
+    updated[10] ^= 0x5a;
+    updated += random_payload(100);
+    std::stringstream log{};
+    ASSERT_EQ(update_payload(stego, updated, log), 0) << log.str();
+    EXPECT_EQ(extract_payload(stego), updated);
+
+    /* the patched byte, the appended bytes and metadata of both images,
+     * 4 cells per byte */
+    EXPECT_LE(changed_bytes(original, stego), 4u * (1 + 100 + 2 * 13));
+    EXPECT_NE(log.str().find("stego0: 4096 of 7254 bytes were rewritten"),
+              std::string::npos) << log.str();
+}
+
+TEST(update, keeps_encoding_and_parity) {
+    auto payload = random_payload(3000);
+    hide_options options{.compress = true, .key = "secret", .scatter = true,
+                         .checksum = true, .parity = 1};
+    auto stego = hide_payload(payload, options, 4);
+    ASSERT_EQ(stego.size(), 3u);
+
+    auto updated = payload;
+    updated[2000] ^= 1;
+    std::stringstream log{};
+    ASSERT_EQ(update_payload(stego, updated, log, {.key = "secret"}), 0)
+        << log.str();
+    EXPECT_EQ(extract_payload(stego, {.key = "secret"}), updated);
+
+    /* the parity image is updated as well, so a lost carrier is rebuilt */
+    stego.erase(stego.begin());
+    EXPECT_EQ(extract_payload(stego, {.key = "secret"}), updated);
+}
+
+TEST(update, payload_has_to_fit) {
+    auto payload = random_payload(2500);
+    auto stego = hide_payload(payload, {}, 2);
+    auto original = stego;
+
+    std::stringstream log{};
+    EXPECT_EQ(update_payload(stego, random_payload(10000), log), 1);
+    EXPECT_NE(log.str().find("please hide the data again"), std::string::npos);
+    EXPECT_EQ(stego, original);
+
+    /* the first image is missing */
+    auto partial = std::vector(stego.begin() + 1, stego.end());
+    EXPECT_EQ(update_payload(partial, payload, log), 1);
+}